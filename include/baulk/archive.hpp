@@ -4,8 +4,11 @@
 #include <bela/base.hpp>
 #include <bela/time.hpp>
 #include <bela/io.hpp>
+#include <gtl/phmap.hpp>
 #include <functional>
 #include <filesystem>
+#include <memory>
+#include <vector>
 #include "archive/format.hpp"
 
 namespace baulk::archive {
@@ -17,23 +20,72 @@ constexpr long ErrExtractGeneral = 800000;
 constexpr long ErrAnotherWay = 800001;
 constexpr long ErrNoOverlayArchive = 800002;
 namespace fs = std::filesystem;
+// DirectoryCache: directories known to exist during one extraction, each parent is created at most once
+class DirectoryCache {
+public:
+  DirectoryCache() = default;
+  DirectoryCache(const DirectoryCache &) = delete;
+  DirectoryCache &operator=(const DirectoryCache &) = delete;
+  bool Ensure(const fs::path &dir, bela::error_code &ec);
+  // Avoided: create_directories calls skipped, each one saves at least a stat and a CreateDirectoryW
+  uint64_t Avoided() const { return avoided; }
+  uint64_t Created() const { return created; }
+
+private:
+  gtl::flat_hash_set<std::wstring> dirs;
+  uint64_t avoided{0};
+  uint64_t created{0};
+};
+
+// DeferredTimes: directory timestamps collected during extraction and applied in one pass at the end, after every
+// child has been written
+class DeferredTimes {
+public:
+  DeferredTimes() = default;
+  DeferredTimes(const DeferredTimes &) = delete;
+  DeferredTimes &operator=(const DeferredTimes &) = delete;
+  void Push(const fs::path &dir, bela::Time modified) { entries.emplace_back(dir.native(), modified); }
+  // Apply: deepest directories first, failures are skipped when ignore_error is set
+  bool Apply(bool ignore_error, bela::error_code &ec);
+  size_t Size() const { return entries.size(); }
+
+private:
+  std::vector<std::pair<std::wstring, bela::Time>> entries;
+};
+
+class OverlappedWriter;
 class File {
 public:
-  File(HANDLE fd_) : fd(fd_) {}
+  File(HANDLE fd_);
+  File(HANDLE fd_, std::unique_ptr<OverlappedWriter> &&ow_);
   File(File &&o) noexcept;
   File &operator=(File &&o) noexcept;
   File(const File &) = delete;
   File &operator=(const File &) = delete;
   ~File();
   bool WriteFull(const void *data, size_t bytes, bela::error_code &ec);
+  // Flush: wait for outstanding overlapped writes, cut the file to the bytes written and apply the modified time, must
+  // be called before the entry is considered extracted
+  bool Flush(bela::error_code &ec);
   bool Discard();
   bool Chtimes(bela::Time t, bela::error_code &ec);
   static std::optional<File> NewFile(const fs::path &path, bela::Time modified, bool overwrite_mode,
-                                     bela::error_code &ec);
+                                     bela::error_code &ec) {
+    return NewFile(path, modified, 0, overwrite_mode, nullptr, ec);
+  }
+  // NewFile: size is the expected file size, the end of file is set up front and large files are written with
+  // overlapped I/O. Parent directory is created through dirs when it is not null
+  static std::optional<File> NewFile(const fs::path &path, bela::Time modified, int64_t size, bool overwrite_mode,
+                                     DirectoryCache *dirs, bela::error_code &ec);
 
 private:
   File() = default;
   HANDLE fd{INVALID_HANDLE_VALUE};
+  std::unique_ptr<OverlappedWriter> ow;
+  bela::Time modified;
+  int64_t reserved{0}; // end of file set by NewFile
+  int64_t written{0};
+  bool pending_times{false};
 };
 bool Chtimes(const fs::path &file, bela::Time t, bela::error_code &ec);
 inline bool MakeDirectories(const fs::path &path, bela::Time modified, bela::error_code &ec) {
@@ -44,9 +96,34 @@ inline bool MakeDirectories(const fs::path &path, bela::Time modified, bela::err
   }
   return baulk::archive::Chtimes(path, modified, ec);
 }
+inline bool MakeDirectories(const fs::path &path, bela::Time modified, DirectoryCache &dirs, DeferredTimes &times,
+                            bela::error_code &ec) {
+  if (!dirs.Ensure(path, ec)) {
+    return false;
+  }
+  times.Push(path, modified);
+  return true;
+}
 
 bool NewSymlink(const fs::path &path, const fs::path &source, bool overwrite_mode, bela::error_code &ec);
 
+// Source: filesystem entry to be written into an archive
+struct Source {
+  fs::path path;
+  std::string name;     // archive name, UTF-8 and '/' separated, directories end with '/'
+  std::string linkname; // symlink target
+  uint64_t size{0};
+  bela::Time time;
+  bela::os::FileMode mode{0};
+  bool IsDir() const { return (mode & bela::os::ModeDir) != 0; }
+  bool IsSymlink() const { return (mode & bela::os::ModeSymlink) != 0; }
+};
+using SourceVisitor = std::function<bool(const Source &src, bela::error_code &ec)>;
+// StatSource: resolve time, size and mode of file, symlinks are not followed
+std::optional<Source> StatSource(const fs::path &file, std::string_view name, bela::error_code &ec);
+// WalkSources: visit root recursively, names are relative to root and joined with prefix
+bool WalkSources(const fs::path &root, std::string_view prefix, const SourceVisitor &visitor, bela::error_code &ec);
+
 std::wstring_view PathStripExtension(std::wstring_view p);
 
 inline std::wstring FileDestination(std::wstring_view arfile) {
@@ -62,6 +139,25 @@ inline std::wstring FileDestination(std::wstring_view arfile) {
   return bela::StringCat(arfile, L".out");
 }
 
+// NameDecoder: decodes legacy (non UTF-8) entry names of one archive. Archives written by one tool use one code page,
+// once detection agrees often enough the code page is reused and detection only runs again when a decode fails
+class NameDecoder {
+public:
+  NameDecoder() = default;
+  NameDecoder(const NameDecoder &) = delete;
+  NameDecoder &operator=(const NameDecoder &) = delete;
+  std::wstring Decode(std::string_view name, bool always_utf8);
+  uint32_t CodePage() const { return codePage; }
+  uint64_t Detections() const { return detections; }
+
+private:
+  std::wstring detect(std::string_view name);
+  uint32_t codePage{0}; // settled code page, 0 while detecting
+  uint32_t candidate{0};
+  int agreements{0};
+  uint64_t detections{0};
+};
+
 std::optional<std::wstring> JoinSanitizePath(std::wstring_view root, std::string_view child_path,
                                              bool always_utf8 = true);
 //
@@ -69,6 +165,8 @@ std::wstring EncodeToNativePath(std::string_view filename, bool always_utf8);
 bool IsHarmfulPath(std::string_view child_path);
 std::optional<fs::path> JoinSanitizeFsPath(const fs::path &root, std::string_view child_path, bool always_utf8,
                                            std::wstring &encoded_path);
+std::optional<fs::path> JoinSanitizeFsPath(const fs::path &root, std::string_view child_path, bool always_utf8,
+                                           NameDecoder &decoder, std::wstring &encoded_path);
 
 //
 bool CheckFormat(bela::io::FD &fd, file_format_t &afmt, int64_t &offset, bela::error_code &ec);
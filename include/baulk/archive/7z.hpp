@@ -1,22 +1,114 @@
 //
 #ifndef BAULK_ARCHIVE_7Z_HPP
 #define BAULK_ARCHIVE_7Z_HPP
+#include <bela/base.hpp>
+#include <bela/os.hpp>
 #include <bela/io.hpp>
+#include <bela/time.hpp>
+#include <functional>
+#include <vector>
 
 namespace baulk::archive::n7z {
+using bela::os::FileMode;
+// https://github.com/ip7z/7zip/blob/main/DOC/7zFormat.txt
+// Method IDs, big-endian as stored in the coder record
+constexpr uint64_t methodCopy = 0x00;
+constexpr uint64_t methodDelta = 0x03;
+constexpr uint64_t methodARM64 = 0x0A;
+constexpr uint64_t methodRISCV = 0x0B;
+constexpr uint64_t methodLZMA2 = 0x21;
+constexpr uint64_t methodLZMA = 0x030101;
+constexpr uint64_t methodBCJ = 0x03030103;
+constexpr uint64_t methodBCJ2 = 0x0303011B;
+constexpr uint64_t methodPPC = 0x03030205;
+constexpr uint64_t methodIA64 = 0x03030401;
+constexpr uint64_t methodARM = 0x03030501;
+constexpr uint64_t methodARMT = 0x03030701;
+constexpr uint64_t methodSPARC = 0x03030805;
+constexpr uint64_t methodPPMD = 0x030401;
+constexpr uint64_t methodDeflate = 0x040108;
+constexpr uint64_t methodBZip2 = 0x040202;
+constexpr uint64_t methodAES = 0x06F10701;
+
+struct File {
+  std::string name;          /* UTF-8, '/' separated */
+  uint64_t size{0};          /* uncompressed size */
+  bela::Time time;           /* last modified date */
+  uint32_t attributes{0};    /* Windows attributes, unix mode in the high 16 bits when 0x8000 is set */
+  uint32_t crc32_value{0};   /* crc32, valid when has_crc */
+  int64_t folder{-1};        /* folder holding the data, -1 for directories and empty files */
+  bool has_crc{false};
+  bool has_stream{false};
+  bool is_dir{false};
+  bool is_anti{false};
+  FileMode Mode() const;
+  bool IsDir() const { return is_dir; }
+  bool IsSymlink() const { return (Mode() & FileMode::ModeSymlink) != 0; }
+};
+
+struct Coder {
+  uint64_t method{0};
+  std::vector<uint8_t> props;
+  uint64_t num_in{1};
+  uint64_t num_out{1};
+};
+
+struct BindPair {
+  uint64_t in_index{0};
+  uint64_t out_index{0};
+};
+
+// Folder: a solid block, decoded as one stream and split into the files listed in files
+struct Folder {
+  std::vector<Coder> coders;
+  std::vector<BindPair> bind_pairs;
+  std::vector<uint64_t> packed_streams; // folder in stream for each packed stream
+  std::vector<uint64_t> unpack_sizes;   // one per coder out stream
+  std::vector<size_t> files;            // indexes into Reader::Files()
+  size_t pack_index{0};                 // first packed stream of this folder
+  uint32_t crc32_value{0};
+  bool has_crc{false};
+  uint64_t UnpackSize() const;
+  // DictionarySize: memory needed by the LZMA decoders of this folder
+  uint64_t DictionarySize() const;
+};
+
+class ByteReader;
 class Reader {
 public:
+  // FolderHandler: begin and end surround the data of every file of a folder, crc32 is verified before end
+  struct FolderHandler {
+    std::function<bool(const File &file, bela::error_code &ec)> begin;
+    std::function<bool(const File &file, const void *data, size_t len, bela::error_code &ec)> write;
+    std::function<bool(const File &file, bela::error_code &ec)> end;
+  };
   Reader() = default;
   Reader(const Reader &) = delete;
   Reader &operator=(const Reader &) = delete;
   bool OpenReader(std::wstring_view file, bela::error_code &ec);
   bool OpenReader(HANDLE nfd, int64_t size_, int64_t offset_, bela::error_code &ec);
+  const auto &Files() const { return files; }
+  const auto &Folders() const { return folders; }
+  int64_t CompressedSize() const { return compressed_size; }
+  int64_t UncompressedSize() const { return uncompressed_size; }
+  // CheckMethods: ErrUnimplemented when a folder uses a coder this reader cannot decode
+  bool CheckMethods(bela::error_code &ec) const;
+  // DecompressFolder: safe to call for different folders from several threads
+  bool DecompressFolder(size_t index, const FolderHandler &h, bela::error_code &ec) const;
 
 private:
   bela::io::FD fd;
   int64_t size{bela::SizeUnInitialized};
   int64_t startPosition{0};
+  int64_t uncompressed_size{0};
+  int64_t compressed_size{0};
+  std::vector<File> files;
+  std::vector<Folder> folders;
+  std::vector<int64_t> pack_offsets; // absolute offset of every packed stream
+  std::vector<uint64_t> pack_sizes;
+  bool Initialize(bela::error_code &ec);
+  bool readHeader(ByteReader &r, int64_t headerBase, bela::error_code &ec);
 };
 } // namespace baulk::archive::n7z
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,81 @@
+//
+#ifndef BAULK_ARCHIVE_CAB_HPP
+#define BAULK_ARCHIVE_CAB_HPP
+#include <bela/base.hpp>
+#include <bela/io.hpp>
+#include <bela/time.hpp>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace baulk::archive::cab {
+// https://learn.microsoft.com/en-us/previous-versions/bb417343(v=msdn.10)
+constexpr uint16_t compressNone = 0;
+constexpr uint16_t compressMSZIP = 1;
+constexpr uint16_t compressQuantum = 2;
+constexpr uint16_t compressLZX = 3;
+constexpr uint16_t compressMask = 0x000F;
+constexpr uint32_t frameSize = 32768; // uncompressed size of one CFDATA block
+
+// Source: random access to the bytes of a cabinet, ReadAt must be safe to call from several threads
+class Source {
+public:
+  virtual ~Source() = default;
+  virtual bool ReadAt(void *buffer, size_t len, int64_t offset, bela::error_code &ec) const = 0;
+  virtual int64_t Size() const = 0;
+};
+// NewFileSource: a cabinet on disk
+std::shared_ptr<Source> NewFileSource(std::wstring_view file, bela::error_code &ec);
+
+struct File {
+  std::string name; /* UTF-8 when attributes has 0x80 (_A_NAME_IS_UTF), otherwise the cabinet code page */
+  uint32_t size{0};
+  uint32_t offset{0}; /* uncompressed offset inside the folder */
+  uint16_t folder{0};
+  uint16_t attributes{0};
+  bela::Time time;
+  bool IsNameUTF8() const { return (attributes & 0x80) != 0; }
+};
+
+// Folder: one compressed stream, every folder starts with a fresh decoder
+struct Folder {
+  uint32_t data_offset{0};
+  uint16_t blocks{0};
+  uint16_t compression{0};
+  std::vector<size_t> files; // indexes into Reader::Files(), sorted by offset
+  uint16_t Method() const { return compression & compressMask; }
+  uint32_t WindowBits() const { return (compression >> 8) & 0x1F; }
+};
+
+class Reader {
+public:
+  // FolderHandler: begin and end surround the data of every file of a folder
+  struct FolderHandler {
+    std::function<bool(const File &file, bela::error_code &ec)> begin;
+    std::function<bool(const File &file, const void *data, size_t len, bela::error_code &ec)> write;
+    std::function<bool(const File &file, bela::error_code &ec)> end;
+  };
+  Reader() = default;
+  Reader(const Reader &) = delete;
+  Reader &operator=(const Reader &) = delete;
+  bool OpenReader(std::shared_ptr<Source> source_, bela::error_code &ec);
+  const auto &Files() const { return files; }
+  const auto &Folders() const { return folders; }
+  uint64_t UncompressedSize() const { return uncompressed_size; }
+  // CheckMethods: ErrUnimplemented for Quantum, spanned cabinets and overlapping entries
+  bool CheckMethods(bela::error_code &ec) const;
+  // DecompressFolder: safe to call for different folders from several threads
+  bool DecompressFolder(size_t index, const FolderHandler &h, bela::error_code &ec) const;
+
+private:
+  std::shared_ptr<Source> source;
+  std::vector<File> files;
+  std::vector<Folder> folders;
+  uint64_t uncompressed_size{0};
+  uint16_t flags{0};
+  uint8_t data_reserve{0};
+  bool overlapped{false};
+};
+} // namespace baulk::archive::cab
+
+#endif
@@ -0,0 +1,13 @@
+///
+#ifndef BAULK_ARCHIVE_DELTA_HPP
+#define BAULK_ARCHIVE_DELTA_HPP
+#include <baulk/archive.hpp>
+
+namespace baulk::archive::delta {
+// ApplyPatch: rebuild target from a zstd patch made against base, 'zstd -d --patch-from=base patch -o target'
+bool ApplyPatch(const fs::path &base, const fs::path &patch, const fs::path &target, bela::error_code &ec);
+// MakePatch: 'zstd --patch-from=base target -o patch', used by tests and bucket tooling
+bool MakePatch(const fs::path &base, const fs::path &target, const fs::path &patch, int level, bela::error_code &ec);
+} // namespace baulk::archive::delta
+
+#endif
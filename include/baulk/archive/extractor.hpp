@@ -6,7 +6,10 @@
 #include <baulk/archive.hpp>
 #include <baulk/archive/zip.hpp>
 #include <baulk/archive/tar.hpp>
+#include <baulk/archive/7z.hpp>
 #include <functional>
+#include <atomic>
+#include <mutex>
 
 namespace baulk::archive {
 namespace fs = std::filesystem;
@@ -26,6 +29,7 @@ public:
   Extractor &operator=(const Extractor &) = delete;
   auto UncompressedSize() const { return reader.UncompressedSize(); }
   auto CompressedSize() const { return reader.CompressedSize(); }
+  const DirectoryCache &Directories() const { return dirs; }
   bool OpenReader(const fs::path &file, const fs::path &dest, bela::error_code &ec) {
     std::error_code e;
     if (destination = fs::absolute(dest, e); e) {
@@ -48,9 +52,7 @@ public:
     return reader.OpenReader(fd.NativeFD(), size, offset, ec);
   }
   bool Extract(const Filter &filter, const OnProgress &progress, bela::error_code &ec) {
-    std::error_code e;
-    if (fs::create_directories(destination, e); e) {
-      ec = bela::make_error_code_from_std(e, bela::StringCat(L"fs::create_directories() '", destination, L"' "));
+    if (!dirs.Ensure(destination, ec)) {
       return false;
     }
     for (const auto &file : reader.Files()) {
@@ -60,15 +62,18 @@ public:
         }
       }
     }
-    return true;
+    return times.Apply(opts.ignore_error, ec);
   }
 
 private:
   ExtractorOptions opts;
   Reader reader;
   fs::path destination;
+  DirectoryCache dirs;
+  DeferredTimes times;
+  NameDecoder decoder;
   bool create_symlink(const fs::path &_New_symlink, std::string_view linkname, bool always_utf8, bela::error_code &ec) {
-    auto nativeLinkName = baulk::archive::EncodeToNativePath(linkname, always_utf8);
+    auto nativeLinkName = decoder.Decode(linkname, always_utf8);
     std::error_code e;
     auto linkPath = fs::absolute(_New_symlink.parent_path() / nativeLinkName, e);
     if (e) {
@@ -89,7 +94,7 @@ private:
 
   bool extract_entry(const File &file, const Filter &filter, const OnProgress &progress, bela::error_code &ec) {
     std::wstring encoded_path;
-    auto out = baulk::archive::JoinSanitizeFsPath(destination, file.name, file.IsFileNameUTF8(), encoded_path);
+    auto out = baulk::archive::JoinSanitizeFsPath(destination, file.name, file.IsFileNameUTF8(), decoder, encoded_path);
     if (!out) {
       ec = bela::make_error_code(bela::ErrGeneral, L"harmful path <s>: ", bela::encode_into<char, wchar_t>(file.name));
       return false;
@@ -100,26 +105,30 @@ private:
     }
     std::error_code e;
     if (file.IsDir()) {
-      return MakeDirectories(*out, file.time, ec);
+      return MakeDirectories(*out, file.time, dirs, times, ec);
     }
     if (file.IsSymlink()) {
       return create_symlink(*out, reader.ResolveLinkName(file, ec), file.IsFileNameUTF8(), ec);
     }
-    auto fd = baulk::archive::File::NewFile(*out, file.time, opts.overwrite_mode, ec);
+    auto fd = baulk::archive::File::NewFile(*out, file.time, static_cast<int64_t>(file.uncompressed_size),
+                                            opts.overwrite_mode, &dirs, ec);
     if (!fd) {
       return false;
     }
     bela::error_code writeEc;
-    return reader.Decompress(
-        file,
-        [&](const void *data, size_t len) {
-          if (progress && !progress(len)) {
-            // canceled
-            return false;
-          }
-          return fd->WriteFull(data, len, writeEc);
-        },
-        ec);
+    if (!reader.Decompress(
+            file,
+            [&](const void *data, size_t len) {
+              if (progress && !progress(len)) {
+                // canceled
+                return false;
+              }
+              return fd->WriteFull(data, len, writeEc);
+            },
+            ec)) {
+      return false;
+    }
+    return fd->Flush(ec);
   }
 };
 } // namespace zip
@@ -132,6 +141,7 @@ public:
   Extractor(ExtractReader *r, const ExtractorOptions &opts_) noexcept : reader(r), opts(opts_) {}
   Extractor(const Extractor &) = delete;
   Extractor &operator=(const Extractor &) = delete;
+  const DirectoryCache &Directories() const { return dirs; }
   bool InitializeExtractor(const fs::path &dest, bela::error_code &ec) {
     std::error_code e;
     if (destination = fs::absolute(dest, e); e) {
@@ -145,9 +155,7 @@ public:
     return true;
   }
   bool Extract(const Filter &filter, const OnProgress &progress, bela::error_code &ec) {
-    std::error_code e;
-    if (fs::create_directories(destination, e); e) {
-      ec = bela::make_error_code_from_std(e, bela::StringCat(L"fs::create_directories() '", destination, L"' "));
+    if (!dirs.Ensure(destination, ec)) {
       return false;
     }
     auto tr = std::make_shared<baulk::archive::tar::Reader>(reader);
@@ -175,13 +183,15 @@ public:
       return false;
     }
     ec.clear();
-    return true;
+    return times.Apply(opts.ignore_error, ec);
   }
 
 private:
   ExtractReader *reader{nullptr};
   ExtractorOptions opts;
   fs::path destination;
+  DirectoryCache dirs;
+  DeferredTimes times;
   bool create_symlink(const fs::path &_New_symlink, std::string_view linkname, bela::error_code &ec) {
     auto nativeLinkName = baulk::archive::EncodeToNativePath(linkname, true);
     std::error_code e;
@@ -215,7 +225,7 @@ private:
       return false;
     }
     if (fh.IsDir()) {
-      return MakeDirectories(*out, fh.ModTime, ec);
+      return MakeDirectories(*out, fh.ModTime, dirs, times, ec);
     }
     if (fh.IsSymlink()) {
       return create_symlink(*out, fh.LinkName, ec);
@@ -224,7 +234,7 @@ private:
     if (!fh.IsRegular()) {
       return true;
     }
-    auto fd = baulk::archive::File::NewFile(*out, fh.ModTime, true, ec);
+    auto fd = baulk::archive::File::NewFile(*out, fh.ModTime, fh.Size, true, &dirs, ec);
     if (!fd) {
       return false;
     }
@@ -236,7 +246,8 @@ private:
               }
               return fd->WriteFull(data, len, ec);
             },
-            fh.Size, ec)) {
+            fh.Size, ec) ||
+        !fd->Flush(ec)) {
       fd->Discard();
       return false;
     }
@@ -244,6 +255,58 @@ private:
   }
 };
 } // namespace tar
+namespace n7z {
+using Filter = std::function<bool(const File &file, const std::wstring &relative_name)>;
+using OnProgress = std::function<bool(size_t bytes)>;
+// Extractor: folders (solid blocks) are independent, they are decoded on several threads. Directories and empty files
+// are created up front so workers never touch the directory cache
+class Extractor {
+public:
+  Extractor(const ExtractorOptions &opts_) noexcept : opts(opts_) {}
+  Extractor(const Extractor &) = delete;
+  Extractor &operator=(const Extractor &) = delete;
+  auto UncompressedSize() const { return reader.UncompressedSize(); }
+  auto CompressedSize() const { return reader.CompressedSize(); }
+  const DirectoryCache &Directories() const { return dirs; }
+  size_t Workers() const { return workers; }
+  bool CheckMethods(bela::error_code &ec) const { return reader.CheckMethods(ec); }
+  bool OpenReader(const fs::path &file, const fs::path &dest, bela::error_code &ec) {
+    std::error_code e;
+    if (destination = fs::absolute(dest, e); e) {
+      ec = bela::make_error_code_from_std(e, L"fs::absolute() ");
+      return false;
+    }
+    auto archive = fs::canonical(file, e);
+    if (e) {
+      ec = bela::make_error_code_from_std(e, L"fs::canonical() ");
+      return false;
+    }
+    return reader.OpenReader(archive.c_str(), ec);
+  }
+  bool OpenReader(bela::io::FD &fd, const fs::path &dest, int64_t size, int64_t offset, bela::error_code &ec) {
+    std::error_code e;
+    if (destination = fs::absolute(dest, e); e) {
+      ec = bela::make_error_code_from_std(e, L"fs::absolute() ");
+      return false;
+    }
+    return reader.OpenReader(fd.NativeFD(), size, offset, ec);
+  }
+  bool Extract(const Filter &filter, const OnProgress &progress, bela::error_code &ec);
+
+private:
+  ExtractorOptions opts;
+  Reader reader;
+  fs::path destination;
+  DirectoryCache dirs;
+  DeferredTimes times;
+  std::vector<std::optional<fs::path>> targets; // per file, empty when the data is discarded
+  size_t workers{1};
+  bool prepare(const Filter &filter, bela::error_code &ec);
+  bool create_symlink(const fs::path &_New_symlink, std::string_view linkname, bela::error_code &ec);
+  bool extract_folder(size_t index, const OnProgress &progress, std::mutex &mu, std::atomic_bool &stop,
+                      bela::error_code &ec);
+};
+} // namespace n7z
 } // namespace baulk::archive
 
 #endif
\ No newline at end of file
@@ -6,7 +6,11 @@
 #include <functional>
 #include <filesystem>
 #include <baulk/fs.hpp>
+#include <baulk/archive.hpp>
+#include <baulk/archive/cab.hpp>
 #include <bela/terminal.hpp>
+#include <atomic>
+#include <mutex>
 
 namespace baulk::archive::msi {
 enum MessageLevel { MessageFatal = 0, MessageError = 1, MessageWarn = 2 };
@@ -277,6 +281,69 @@ inline int Extractor::extract_callback(UINT iMessageType, LPCWSTR szMessage) {
   return IDOK;
 }
 
+class compoundFile;
+// PackageFile: one row of the File table, placed where an administrative install would put it
+struct PackageFile {
+  std::string key;  // File table key, also the entry name inside the cabinet
+  std::string path; // UTF-8 and '/' separated, relative to the administrative image
+  uint64_t size{0};
+  uint32_t sequence{0};
+  uint16_t attributes{0};
+};
+
+// Package: the File, Component, Directory and Media tables of an installer database, read without Windows Installer
+class Package {
+public:
+  Package() = default;
+  Package(const Package &) = delete;
+  Package &operator=(const Package &) = delete;
+  bool Open(const std::filesystem::path &file, bela::error_code &ec);
+  const auto &Files() const { return files; }
+  // Cabinets: Media.Cabinet values, a leading '#' marks a stream inside the package
+  const auto &Cabinets() const { return cabinets; }
+  std::shared_ptr<cab::Source> OpenCabinet(std::string_view name, bela::error_code &ec) const;
+
+private:
+  std::filesystem::path archive_file;
+  std::shared_ptr<compoundFile> cf;
+  std::vector<PackageFile> files;
+  std::vector<std::string> cabinets;
+};
+
+// Unpacker: writes the flattened administrative image directly, cabinet folders are decoded on several threads.
+// ErrUnimplemented means the package needs Windows Installer, Extractor remains the fallback
+class Unpacker {
+public:
+  using OnProgress = std::function<bool(int64_t extracted, int64_t total)>;
+  Unpacker() = default;
+  Unpacker(const Unpacker &) = delete;
+  Unpacker &operator=(const Unpacker &) = delete;
+  bool OpenReader(const std::filesystem::path &file, const std::filesystem::path &dest, bela::error_code &ec);
+  const auto &Files() const { return package.Files(); }
+  // Targets: per package file, empty when another row writes the same path
+  const auto &Targets() const { return targets; }
+  int64_t UncompressedSize() const { return uncompressed_size; }
+  size_t Workers() const { return workers; }
+  bool Extract(const OnProgress &progress, bela::error_code &ec);
+
+private:
+  struct cabinet {
+    std::shared_ptr<cab::Source> source;
+    std::unique_ptr<cab::Reader> reader;
+    std::vector<std::optional<size_t>> files; // per cabinet entry, index into Files()
+  };
+  Package package;
+  std::filesystem::path destination;
+  std::vector<std::optional<std::filesystem::path>> targets;
+  std::vector<cabinet> cabinets;
+  DirectoryCache dirs;
+  int64_t uncompressed_size{0};
+  size_t workers{1};
+  static void flatten(std::vector<std::string> &paths);
+  bool extract_folder(const cabinet &c, size_t folder, const OnProgress &progress, std::mutex &mu,
+                      std::atomic_bool &stop, int64_t &extracted, bela::error_code &ec);
+};
+
 } // namespace baulk::archive::msi
 
 #endif
\ No newline at end of file
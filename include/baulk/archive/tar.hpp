@@ -5,6 +5,8 @@
 #include <bela/time.hpp>
 #include <gtl/phmap.hpp>
 #include <memory>
+#include <span>
+#include <filesystem>
 #include "format.hpp"
 
 namespace baulk::archive::tar {
@@ -307,6 +309,41 @@ private:
   int64_t paddingSize{0};
   int index{0};
 };
+
+struct WriterOptions {
+  int level{3};   // zstd compression level
+  int workers{0}; // zstd worker threads, 0: all processors
+};
+
+class Compressor;
+// ArchiveWriter: write tar.zst, long names, link names and sizes beyond USTAR limits are stored as PAX records
+class ArchiveWriter {
+public:
+  ArchiveWriter();
+  ArchiveWriter(const ArchiveWriter &) = delete;
+  ArchiveWriter &operator=(const ArchiveWriter &) = delete;
+  ~ArchiveWriter();
+  bool OpenWriter(std::wstring_view file, const WriterOptions &opts, bela::error_code &ec);
+  bool AddFile(std::string_view name, const std::filesystem::path &source, bela::error_code &ec);
+  bool AddBuffer(std::string_view name, std::span<const uint8_t> data, bela::Time modified, bela::error_code &ec);
+  bool AddDirectory(std::string_view name, bela::Time modified, bela::error_code &ec);
+  bool AddSymlink(std::string_view name, std::string_view target, bela::Time modified, bela::error_code &ec);
+  // AddTree: add everything under root, entry names are relative to root and joined with prefix
+  bool AddTree(const std::filesystem::path &root, std::string_view prefix, bela::error_code &ec);
+  // Close: write end-of-archive blocks and finish zstd frame
+  bool Close(bela::error_code &ec);
+  int Entries() const { return entries; }
+
+private:
+  bool writeHeader(const Header &h, bela::error_code &ec);
+  bool write(const void *data, size_t len, bela::error_code &ec);
+  bool pad(int64_t size, bela::error_code &ec);
+  bela::io::FD fd;
+  std::unique_ptr<Compressor> compressor;
+  std::vector<uint8_t> ibuf;
+  int entries{0};
+  bool closed{false};
+};
 } // namespace baulk::archive::tar
 
 #endif
\ No newline at end of file
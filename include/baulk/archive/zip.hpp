@@ -5,6 +5,13 @@
 #include <bela/io.hpp>
 #include <bela/time.hpp>
 #include <functional>
+#include <filesystem>
+#include <memory>
+#include <span>
+
+namespace baulk::archive {
+struct Source;
+}
 
 namespace baulk::archive::zip {
 using bela::os::FileMode;
@@ -164,6 +171,53 @@ inline std::optional<Reader> NewReader(HANDLE fd, int64_t size, int64_t offset,
   return std::make_optional(std::move(r));
 }
 
+struct WriterOptions {
+  zip_method_t method{ZIP_DEFLATE}; // ZIP_STORE, ZIP_DEFLATE or ZIP_ZSTD
+  int level{-1};                    // -1: method default
+  int workers{0};                   // compression threads, 0: all processors
+};
+
+class Compressor;
+// ArchiveWriter: streaming zip writer, entries are followed by data descriptors so the output is never rewritten,
+// Zip64 records are emitted when sizes, offsets or entry count overflow
+class ArchiveWriter {
+public:
+  ArchiveWriter();
+  ArchiveWriter(const ArchiveWriter &) = delete;
+  ArchiveWriter &operator=(const ArchiveWriter &) = delete;
+  ~ArchiveWriter();
+  bool OpenWriter(std::wstring_view file, const WriterOptions &opts, bela::error_code &ec);
+  bool AddFile(std::string_view name, const std::filesystem::path &source, bela::error_code &ec);
+  bool AddBuffer(std::string_view name, std::span<const uint8_t> data, bela::Time modified, bela::error_code &ec);
+  bool AddDirectory(std::string_view name, bela::Time modified, bela::error_code &ec);
+  bool AddSymlink(std::string_view name, std::string_view target, bela::Time modified, bela::error_code &ec);
+  // AddTree: add everything under root, entry names are relative to root and joined with prefix
+  bool AddTree(const std::filesystem::path &root, std::string_view prefix, bela::error_code &ec);
+  // Close: write central directory, the archive is incomplete until Close succeeds
+  bool Close(bela::error_code &ec);
+  const auto &Files() const { return files; }
+  int64_t Size() const { return offset; }
+
+private:
+  using entry_reader = std::function<bela::ssize_t(uint8_t *buffer, size_t len, bela::error_code &ec)>;
+  bool writeLocalHeader(File &file, bool descriptor, bela::error_code &ec);
+  bool writeEntry(File &file, const entry_reader &reader, bela::error_code &ec);
+  bool addSource(const Source &src, bela::error_code &ec);
+  bool addParallel(const std::vector<Source> &sources, bela::error_code &ec);
+  bool writeDirectory(bela::error_code &ec);
+  bool write(const void *data, size_t len, bela::error_code &ec);
+  bool flush(bela::error_code &ec);
+  bela::io::FD fd;
+  std::unique_ptr<Compressor> compressor;
+  std::vector<uint8_t> obuf;
+  std::vector<uint8_t> ibuf;
+  std::vector<File> files;
+  WriterOptions options;
+  int64_t offset{0};
+  int workers{1};
+  bool closed{false};
+};
+
 } // namespace baulk::archive::zip
 
 #endif
\ No newline at end of file
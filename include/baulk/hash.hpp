@@ -3,6 +3,8 @@
 #define BAULK_HASH_HPP
 #include <bela/base.hpp>
 #include <filesystem>
+#include <functional>
+#include <vector>
 
 namespace baulk::hash {
 enum class hash_t {
@@ -19,11 +21,25 @@ enum class hash_t {
 };
 bool HashEqual(const std::filesystem::path &file, std::wstring_view hash_value, bela::error_code &ec);
 std::optional<std::wstring> FileHash(const std::filesystem::path &file, hash_t method, bela::error_code &ec);
+using OnFileHash = std::function<void(const std::filesystem::path &file, const std::optional<std::wstring> &hv,
+                                      const bela::error_code &ec)>;
+// FileHashes: hash files on up to 'workers' threads, fn sees the results in input order
+void FileHashes(const std::vector<std::filesystem::path> &files, hash_t method, int workers, const OnFileHash &fn);
 struct file_hash_sums {
   std::wstring sha256sum;
   std::wstring blake3sum;
 };
 std::optional<file_hash_sums> HashSums(const std::filesystem::path &file, bela::error_code &ec);
+
+namespace blake3 {
+constexpr size_t outLength = 32;
+// SubtreeChainingValue: input starts at chunkCounter (1 KiB chunks), a range that is not the end of the message
+// must be a power of 2 number of whole chunks aligned to its size
+void SubtreeChainingValue(const void *input, size_t len, uint64_t chunkCounter, uint8_t out[outLength]);
+// ParentChainingValue: joins the chaining values of a left and right subtree, the root node yields the hash
+void ParentChainingValue(const uint8_t left[outLength], const uint8_t right[outLength], bool isRoot,
+                         uint8_t out[outLength]);
+} // namespace blake3
 } // namespace baulk::hash
 
 #endif
\ No newline at end of file
@@ -0,0 +1,80 @@
+//
+#ifndef BAULK_NET_CHUNKS_HPP
+#define BAULK_NET_CHUNKS_HPP
+#include <bela/base.hpp>
+#include <array>
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+namespace baulk::net {
+// sidecar manifest next to an artifact or a .part file: '<file>.b3chunks'
+constexpr std::wstring_view chunks_suffix = L".b3chunks";
+// 1 MiB, 1024 BLAKE3 chunks per block
+constexpr int64_t chunks_block_size = 1024 * 1024;
+
+// ChunkManifest: BLAKE3 chaining values of a file cut into blocks of a power of 2 number of 1 KiB chunks. Joined
+// the way BLAKE3 builds its tree they give the hash of the whole file, so a manifest published by a mirror is
+// checked against the package hash before any block is trusted.
+class ChunkManifest {
+public:
+  using cv_t = std::array<uint8_t, 32>;
+  ChunkManifest() = default;
+  ChunkManifest(int64_t blockSize_, int64_t totalSize_) : blockSize(blockSize_), totalSize(totalSize_) {}
+  // text form: 'blake3-chunks <block size> <total size>' followed by one hex chaining value per line
+  bool Decode(std::string_view text, bela::error_code &ec);
+  std::string Encode() const;
+  bool Load(const std::filesystem::path &file, bela::error_code &ec);
+  bool Save(const std::filesystem::path &file, bela::error_code &ec) const;
+  auto BlockSize() const { return blockSize; }
+  auto TotalSize() const { return totalSize; }
+  size_t Blocks() const {
+    return blockSize == 0 ? 0 : static_cast<size_t>((totalSize + blockSize - 1) / blockSize);
+  }
+  // Covered: bytes from the start of the file with a known chaining value
+  int64_t Covered() const { return (std::min)(static_cast<int64_t>(cvs.size()) * blockSize, totalSize); }
+  bool Complete() const { return Blocks() > 1 && cvs.size() == Blocks(); }
+  // Matches: a complete manifest whose tree ends in the BLAKE3 hash 'hash'
+  bool Matches(const uint8_t *hash, size_t len) const;
+  // BlockMatches: data is block 'index' of the file
+  bool BlockMatches(size_t index, const uint8_t *data, size_t len) const;
+  // VerifiedPrefix: length of the run of leading blocks in fd that match, never more than length
+  int64_t VerifiedPrefix(HANDLE fd, int64_t length, bela::error_code &ec) const;
+  // BadBlocks: blocks of a complete file that do not match
+  std::optional<std::vector<size_t>> BadBlocks(HANDLE fd, bela::error_code &ec) const;
+  // Compute: chaining values of the blocks of fd, the last one only when it ends the file
+  bool Compute(HANDLE fd, int64_t length, bela::error_code &ec);
+  // Append: the next block, block data must start where Covered() ends
+  void Append(const uint8_t *data, size_t len);
+  // Truncate: keep the first 'blocks' chaining values
+  void Truncate(size_t blocks) {
+    if (blocks < cvs.size()) {
+      cvs.resize(blocks);
+    }
+  }
+
+private:
+  int64_t blockSize{chunks_block_size};
+  int64_t totalSize{0};
+  std::vector<cv_t> cvs;
+  cv_t subtree(size_t first, size_t count, int64_t bytes, bool root) const;
+};
+
+// ChunkBuilder: chaining values of a byte stream as it is written out
+class ChunkBuilder {
+public:
+  explicit ChunkBuilder(ChunkManifest &m_) : m(m_) {}
+  ChunkBuilder(const ChunkBuilder &) = delete;
+  ChunkBuilder &operator=(const ChunkBuilder &) = delete;
+  void Update(const void *data, size_t len);
+  // Finish: records the trailing partial block once the stream has reached the total size
+  void Finish();
+
+private:
+  ChunkManifest &m;
+  std::vector<uint8_t> block;
+};
+
+} // namespace baulk::net
+
+#endif
@@ -1,7 +1,9 @@
 #ifndef BAULK_NET_CLIENT_HPP
 #define BAULK_NET_CLIENT_HPP
 #include "types.hpp"
+#include "scheduler.hpp"
 #include <filesystem>
+#include <functional>
 #include <bela/terminal.hpp>
 
 namespace baulk::net {
@@ -31,7 +33,10 @@ struct download_options {
   std::wstring hash_value;
   std::filesystem::path cwd;
   std::filesystem::path destination;
+  transfer_priority priority{transfer_priority::archive};
   bool force_overwrite{false};
+  // progress: received and total bytes (0 when unknown) from the receiving thread, no progress bar is drawn when set
+  std::function<void(int64_t, int64_t)> progress;
   bool OverwriteExists() const { return force_overwrite || !destination.empty(); }
 };
 
@@ -0,0 +1,93 @@
+//
+#ifndef BAULK_NET_SCHEDULER_HPP
+#define BAULK_NET_SCHEDULER_HPP
+#include <bela/base.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <set>
+
+namespace baulk::net {
+// metadata: bucket feeds and api responses, served before archives when bandwidth or connections run out
+enum class transfer_priority : int { archive = 0, metadata = 1 };
+
+// ParseBytes: '4G', '512M', '1024K' or plain bytes
+std::optional<uint64_t> ParseBytes(std::wstring_view sv);
+
+// Scheduler: shared by every transfer of the process, a token bucket bounds the bytes per second of all of them
+// and a per-host cap bounds the connections opened to one mirror
+class Scheduler {
+public:
+  // Slot: connection to a host, released on destruction
+  class Slot {
+  public:
+    Slot() = default;
+    Slot(Scheduler *s_, std::wstring host_) : s(s_), host(std::move(host_)) {}
+    Slot(Slot &&other) noexcept : s(other.s), host(std::move(other.host)) { other.s = nullptr; }
+    Slot &operator=(Slot &&other) noexcept {
+      release();
+      s = other.s;
+      host = std::move(other.host);
+      other.s = nullptr;
+      return *this;
+    }
+    Slot(const Slot &) = delete;
+    Slot &operator=(const Slot &) = delete;
+    ~Slot() { release(); }
+
+  private:
+    void release() {
+      if (s != nullptr) {
+        s->release(host);
+        s = nullptr;
+      }
+    }
+    Scheduler *s{nullptr};
+    std::wstring host;
+  };
+  Scheduler() = default;
+  Scheduler(const Scheduler &) = delete;
+  Scheduler &operator=(const Scheduler &) = delete;
+  static Scheduler &Default() {
+    static Scheduler scheduler;
+    return scheduler;
+  }
+  // bytes per second of all transfers, 0 is unlimited
+  void SetRateLimit(uint64_t bytesPerSecond);
+  // connections per host, 0 is unlimited
+  void SetHostConnections(size_t n);
+  uint64_t RateLimit() const { return rate; }
+  size_t HostConnections() const { return hostConnections; }
+  // BAULK_RATE_LIMIT and BAULK_HOST_CONNECTIONS
+  bool InitializeFromEnv();
+  // Acquire: wait for a connection to host, waiters of higher priority go first
+  Slot Acquire(std::wstring_view host, transfer_priority priority);
+  // Consume: wait until len bytes may be received, waiters of higher priority go first
+  void Consume(size_t len, transfer_priority priority);
+  // ReadSize: largest read that keeps the limiter smooth
+  size_t ReadSize(size_t available) const;
+
+private:
+  // ticket: priority descending, then arrival
+  using ticket = std::pair<int, uint64_t>;
+  struct host_state {
+    size_t active{0};
+    std::set<ticket> waiters;
+  };
+  void release(const std::wstring &host);
+  void refill(std::chrono::steady_clock::time_point now);
+  std::mutex mu;
+  std::condition_variable cv;
+  std::map<std::wstring, host_state, std::less<>> hosts;
+  std::set<ticket> consumers;
+  std::chrono::steady_clock::time_point last{std::chrono::steady_clock::now()};
+  double tokens{0};
+  uint64_t sequence{0};
+  std::atomic_uint64_t rate{0};
+  std::atomic_size_t hostConnections{6};
+};
+} // namespace baulk::net
+
+#endif
@@ -3,6 +3,8 @@
 #define BAULK_TCP_HPP
 #include <bela/base.hpp>
 #include <chrono>
+#include <string>
+#include <vector>
 
 namespace baulk::net {
 using BAULKSOCK = UINT_PTR;
@@ -33,6 +35,18 @@ private:
     other.sock = BAULK_INVALID_SOCKET;
   }
 };
+struct resolver_stats {
+  uint64_t lookups{0};    // names a connection asked for
+  uint64_t hits{0};       // answered by the process cache
+  uint64_t prefetched{0}; // resolved ahead in the background
+  int64_t elapsed{0};     // microseconds connections waited for names
+};
+// ResolveHost: resolve through the process cache, entries live as long as the record TTL (at most 5 minutes),
+// WinHTTP then finds the name in the system resolver cache as well
+bool ResolveHost(std::wstring_view host, bela::error_code &ec);
+// PrefetchHosts: resolve the hosts of urls in the background as soon as they are known
+void PrefetchHosts(const std::vector<std::wstring> &urls);
+resolver_stats ResolverStats();
 // timeout milliseconds
 std::optional<Conn> DialTimeout(std::wstring_view address, int port, int timeout,
                                 bela::error_code &ec); // second
@@ -127,6 +127,8 @@ struct minimal_response {
 };
 
 std::string url_decode(std::wstring_view url);
+// url_encode: percent-encode everything but unreserved characters, for query values
+std::wstring url_encode(std::wstring_view value);
 
 inline std::wstring url_path_name(std::wstring_view urlpath) {
   std::vector<std::wstring_view> pv = bela::SplitPath(urlpath);
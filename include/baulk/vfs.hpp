@@ -77,6 +77,8 @@ std::wstring_view AppLinks();
 std::wstring AppPackageFolder(std::wstring_view packageName);
 // AppPackageVFS
 std::wstring AppPackageVFS(std::wstring_view packageName);
+// AppStore: content-addressed file store, beside packages so hardlinks stay on one volume
+std::wstring AppStore();
 // AppFsMutexPath: return FsMutex file path
 std::wstring AppFsMutexPath();
 std::wstring AppDefaultProfile();
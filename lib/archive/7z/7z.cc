@@ -0,0 +1,679 @@
+///
+#include "7zinternal.hpp"
+
+namespace baulk::archive::n7z {
+
+FileMode File::Mode() const {
+  // p7zip and 7-Zip 21+ store the unix mode in the high 16 bits, flagged by FILE_ATTRIBUTE_UNIX_EXTENSION
+  if ((attributes & 0x8000) != 0) {
+    auto m = attributes >> 16;
+    uint32_t mode = m & 0777;
+    switch (m & 0xF000) {
+    case 0x4000:
+      mode |= FileMode::ModeDir;
+      break;
+    case 0xA000:
+      mode |= FileMode::ModeSymlink;
+      break;
+    default:
+      break;
+    }
+    return static_cast<FileMode>(mode);
+  }
+  if (is_dir || (attributes & FILE_ATTRIBUTE_DIRECTORY) != 0) {
+    return static_cast<FileMode>(FileMode::ModeDir | 0777);
+  }
+  if ((attributes & FILE_ATTRIBUTE_READONLY) != 0) {
+    return static_cast<FileMode>(0444);
+  }
+  return static_cast<FileMode>(0666);
+}
+
+uint64_t Folder::UnpackSize() const {
+  if (unpack_sizes.empty()) {
+    return 0;
+  }
+  // the main out stream is the one not bound to any coder input
+  for (size_t i = unpack_sizes.size(); i > 0; i--) {
+    auto index = i - 1;
+    auto bound = std::any_of(bind_pairs.begin(), bind_pairs.end(),
+                             [&](const BindPair &bp) { return bp.out_index == index; });
+    if (!bound) {
+      return unpack_sizes[index];
+    }
+  }
+  return 0;
+}
+
+uint64_t Folder::DictionarySize() const {
+  uint64_t total = 0;
+  for (const auto &c : coders) {
+    if (c.method == methodLZMA && c.props.size() >= 5) {
+      total += bela::cast_fromle<uint32_t>(c.props.data() + 1);
+      continue;
+    }
+    if (c.method == methodLZMA2 && !c.props.empty()) {
+      auto p = c.props[0];
+      total += p >= 40 ? 0xFFFFFFFFULL : static_cast<uint64_t>(2 | (p & 1)) << (p / 2 + 11);
+    }
+  }
+  return total;
+}
+
+bool IsSupportedMethod(uint64_t method) {
+  switch (method) {
+  case methodCopy:
+  case methodDelta:
+  case methodARM64:
+  case methodRISCV:
+  case methodLZMA2:
+  case methodLZMA:
+  case methodBCJ:
+  case methodBCJ2:
+  case methodPPC:
+  case methodIA64:
+  case methodARM:
+  case methodARMT:
+  case methodSPARC:
+    return true;
+  default:
+    break;
+  }
+  return false;
+}
+
+inline bool headerCorrupted(bela::error_code &ec) {
+  ec = bela::make_error_code(ErrGeneral, L"7z: header corrupted");
+  return false;
+}
+
+// readDigests: AllAreDefined byte, optional bit vector, then a crc32 for every defined item
+bool readDigests(ByteReader &r, size_t n, std::vector<bool> &defined, std::vector<uint32_t> &crcs) {
+  defined = r.OptionalBitVector(n);
+  crcs.assign(n, 0);
+  for (size_t i = 0; i < n; i++) {
+    if (defined[i]) {
+      crcs[i] = r.UInt32();
+    }
+  }
+  return !r.Bad();
+}
+
+bool readPackInfo(ByteReader &r, streams_info &si, bela::error_code &ec) {
+  si.pack_pos = r.Number();
+  auto numPackStreams = r.Number();
+  if (numPackStreams > r.Remaining()) {
+    return headerCorrupted(ec);
+  }
+  si.pack_sizes.assign(static_cast<size_t>(numPackStreams), 0);
+  for (;;) {
+    auto id = r.Number();
+    if (id == kEnd || r.Bad()) {
+      break;
+    }
+    if (id == kSize) {
+      for (auto &s : si.pack_sizes) {
+        s = r.Number();
+      }
+      continue;
+    }
+    if (id == kCRC) {
+      std::vector<bool> defined;
+      std::vector<uint32_t> crcs;
+      readDigests(r, si.pack_sizes.size(), defined, crcs);
+      continue;
+    }
+    r.Bytes(r.Number());
+  }
+  return r.Bad() ? headerCorrupted(ec) : true;
+}
+
+bool readFolder(ByteReader &r, Folder &folder, bela::error_code &ec) {
+  auto numCoders = r.Number();
+  if (numCoders == 0 || numCoders > 64) {
+    ec = bela::make_error_code(ErrGeneral, L"7z: unsupported number of coders ", numCoders);
+    return false;
+  }
+  uint64_t numInTotal = 0;
+  uint64_t numOutTotal = 0;
+  for (uint64_t i = 0; i < numCoders; i++) {
+    auto flags = r.Byte();
+    if ((flags & 0x80) != 0) {
+      ec = bela::make_error_code(ErrUnimplemented, L"7z: alternative coder methods are not supported");
+      return false;
+    }
+    Coder c;
+    for (auto b : r.Bytes(flags & 0x0F)) {
+      c.method = (c.method << 8) | b;
+    }
+    if ((flags & 0x10) != 0) {
+      c.num_in = r.Number();
+      c.num_out = r.Number();
+      if (c.num_in > 64 || c.num_out > 64) {
+        return headerCorrupted(ec);
+      }
+    }
+    if ((flags & 0x20) != 0) {
+      auto props = r.Bytes(r.Number());
+      c.props.assign(props.begin(), props.end());
+    }
+    numInTotal += c.num_in;
+    numOutTotal += c.num_out;
+    folder.coders.emplace_back(std::move(c));
+  }
+  if (numOutTotal == 0 || numInTotal < numOutTotal - 1) {
+    return headerCorrupted(ec);
+  }
+  for (uint64_t i = 0; i < numOutTotal - 1; i++) {
+    BindPair bp{.in_index = r.Number(), .out_index = r.Number()};
+    if (bp.in_index >= numInTotal || bp.out_index >= numOutTotal) {
+      return headerCorrupted(ec);
+    }
+    folder.bind_pairs.emplace_back(bp);
+  }
+  auto numPackedStreams = numInTotal - folder.bind_pairs.size();
+  if (numPackedStreams == 1) {
+    for (uint64_t i = 0; i < numInTotal; i++) {
+      auto bound = std::any_of(folder.bind_pairs.begin(), folder.bind_pairs.end(),
+                               [&](const BindPair &bp) { return bp.in_index == i; });
+      if (!bound) {
+        folder.packed_streams.emplace_back(i);
+        break;
+      }
+    }
+  } else {
+    for (uint64_t i = 0; i < numPackedStreams; i++) {
+      folder.packed_streams.emplace_back(r.Number());
+    }
+  }
+  folder.unpack_sizes.assign(static_cast<size_t>(numOutTotal), 0);
+  return r.Bad() ? headerCorrupted(ec) : true;
+}
+
+bool readUnpackInfo(ByteReader &r, streams_info &si, bela::error_code &ec) {
+  if (r.Number() != kFolder) {
+    return headerCorrupted(ec);
+  }
+  auto numFolders = r.Number();
+  if (numFolders > r.Remaining()) {
+    return headerCorrupted(ec);
+  }
+  if (r.Byte() != 0) {
+    ec = bela::make_error_code(ErrUnimplemented, L"7z: external folders are not supported");
+    return false;
+  }
+  si.folders.resize(static_cast<size_t>(numFolders));
+  for (auto &folder : si.folders) {
+    if (!readFolder(r, folder, ec)) {
+      return false;
+    }
+  }
+  if (r.Number() != kCodersUnPackSize) {
+    return headerCorrupted(ec);
+  }
+  for (auto &folder : si.folders) {
+    for (auto &s : folder.unpack_sizes) {
+      s = r.Number();
+    }
+  }
+  for (;;) {
+    auto id = r.Number();
+    if (id == kEnd || r.Bad()) {
+      break;
+    }
+    if (id == kCRC) {
+      std::vector<bool> defined;
+      std::vector<uint32_t> crcs;
+      readDigests(r, si.folders.size(), defined, crcs);
+      for (size_t i = 0; i < si.folders.size(); i++) {
+        si.folders[i].has_crc = defined[i];
+        si.folders[i].crc32_value = crcs[i];
+      }
+      continue;
+    }
+    r.Bytes(r.Number());
+  }
+  return r.Bad() ? headerCorrupted(ec) : true;
+}
+
+bool readSubStreamsInfo(ByteReader &r, streams_info &si, bela::error_code &ec) {
+  si.num_unpack_streams.assign(si.folders.size(), 1);
+  auto id = r.Number();
+  if (id == kNumUnPackStream) {
+    for (auto &n : si.num_unpack_streams) {
+      if (n = r.Number(); n > r.Remaining() + 1) {
+        return headerCorrupted(ec);
+      }
+    }
+    id = r.Number();
+  }
+  si.unpack_sizes.clear();
+  for (size_t i = 0; i < si.folders.size(); i++) {
+    auto n = si.num_unpack_streams[i];
+    if (n == 0) {
+      continue;
+    }
+    uint64_t sum = 0;
+    if (id == kSize) {
+      for (uint64_t j = 1; j < n; j++) {
+        auto s = r.Number();
+        si.unpack_sizes.emplace_back(s);
+        sum += s;
+      }
+    }
+    auto total = si.folders[i].UnpackSize();
+    if (sum > total) {
+      return headerCorrupted(ec);
+    }
+    si.unpack_sizes.emplace_back(total - sum);
+  }
+  if (id == kSize) {
+    id = r.Number();
+  }
+  // streams without a known crc32: every stream except single stream folders carrying a folder crc32
+  size_t unknown = 0;
+  for (size_t i = 0; i < si.folders.size(); i++) {
+    auto n = si.num_unpack_streams[i];
+    if (n != 1 || !si.folders[i].has_crc) {
+      unknown += static_cast<size_t>(n);
+    }
+  }
+  si.crc_defined.assign(si.unpack_sizes.size(), false);
+  si.crcs.assign(si.unpack_sizes.size(), 0);
+  auto fillFolderCrcs = [&]() {
+    size_t k = 0;
+    for (size_t i = 0; i < si.folders.size(); i++) {
+      auto n = si.num_unpack_streams[i];
+      if (n == 1 && si.folders[i].has_crc) {
+        si.crc_defined[k] = true;
+        si.crcs[k] = si.folders[i].crc32_value;
+      }
+      k += static_cast<size_t>(n);
+    }
+  };
+  for (; id != kEnd && !r.Bad(); id = r.Number()) {
+    if (id != kCRC) {
+      r.Bytes(r.Number());
+      continue;
+    }
+    std::vector<bool> defined;
+    std::vector<uint32_t> crcs;
+    if (!readDigests(r, unknown, defined, crcs)) {
+      return headerCorrupted(ec);
+    }
+    size_t k = 0;
+    size_t d = 0;
+    for (size_t i = 0; i < si.folders.size(); i++) {
+      auto n = static_cast<size_t>(si.num_unpack_streams[i]);
+      if (n == 1 && si.folders[i].has_crc) {
+        k++;
+        continue;
+      }
+      for (size_t j = 0; j < n; j++, k++, d++) {
+        si.crc_defined[k] = defined[d];
+        si.crcs[k] = crcs[d];
+      }
+    }
+  }
+  fillFolderCrcs();
+  return r.Bad() ? headerCorrupted(ec) : true;
+}
+
+bool readStreamsInfo(ByteReader &r, streams_info &si, bela::error_code &ec) {
+  bool subStreams = false;
+  for (;;) {
+    auto id = r.Number();
+    if (r.Bad()) {
+      return headerCorrupted(ec);
+    }
+    switch (id) {
+    case kEnd:
+      break;
+    case kPackInfo:
+      if (!readPackInfo(r, si, ec)) {
+        return false;
+      }
+      continue;
+    case kUnPackInfo:
+      if (!readUnpackInfo(r, si, ec)) {
+        return false;
+      }
+      continue;
+    case kSubStreamsInfo:
+      if (!readSubStreamsInfo(r, si, ec)) {
+        return false;
+      }
+      subStreams = true;
+      continue;
+    default:
+      return headerCorrupted(ec);
+    }
+    break;
+  }
+  if (!subStreams) {
+    // one stream per folder
+    si.num_unpack_streams.assign(si.folders.size(), 1);
+    si.unpack_sizes.clear();
+    si.crc_defined.clear();
+    si.crcs.clear();
+    for (const auto &folder : si.folders) {
+      si.unpack_sizes.emplace_back(folder.UnpackSize());
+      si.crc_defined.emplace_back(folder.has_crc);
+      si.crcs.emplace_back(folder.crc32_value);
+    }
+  }
+  size_t packIndex = 0;
+  for (auto &folder : si.folders) {
+    folder.pack_index = packIndex;
+    packIndex += folder.packed_streams.size();
+  }
+  if (packIndex > si.pack_sizes.size()) {
+    return headerCorrupted(ec);
+  }
+  return true;
+}
+
+bool Reader::Initialize(bela::error_code &ec) {
+  if (size == bela::SizeUnInitialized) {
+    if (size = fd.Size(ec); size == bela::SizeUnInitialized) {
+      return false;
+    }
+  }
+  uint8_t sh[signatureHeaderSize];
+  if (!fd.ReadAt({sh, signatureHeaderSize}, startPosition, ec)) {
+    return false;
+  }
+  if (memcmp(sh, signature, sizeof(signature)) != 0) {
+    ec = bela::make_error_code(ErrGeneral, L"7z: not a valid 7z file");
+    return false;
+  }
+  if (crc32_fast(sh + 12, 20, 0) != bela::cast_fromle<uint32_t>(sh + 8)) {
+    ec = bela::make_error_code(ErrGeneral, L"7z: start header crc32 not match");
+    return false;
+  }
+  auto nextHeaderOffset = bela::cast_fromle<uint64_t>(sh + 12);
+  auto nextHeaderSize = bela::cast_fromle<uint64_t>(sh + 20);
+  auto nextHeaderCRC = bela::cast_fromle<uint32_t>(sh + 28);
+  auto headerBase = startPosition + static_cast<int64_t>(signatureHeaderSize);
+  if (nextHeaderSize == 0) {
+    // empty archive
+    return true;
+  }
+  if (nextHeaderSize > maxHeaderSize || nextHeaderOffset > static_cast<uint64_t>(size) ||
+      headerBase + nextHeaderOffset + nextHeaderSize > static_cast<uint64_t>(size)) {
+    ec = bela::make_error_code(ErrGeneral, L"7z: next header out of range");
+    return false;
+  }
+  Buffer header(static_cast<size_t>(nextHeaderSize));
+  if (!fd.ReadAt({header.data(), static_cast<size_t>(nextHeaderSize)},
+                 headerBase + static_cast<int64_t>(nextHeaderOffset), ec)) {
+    return false;
+  }
+  header.size() = static_cast<size_t>(nextHeaderSize);
+  if (crc32_fast(header.data(), header.size(), 0) != nextHeaderCRC) {
+    ec = bela::make_error_code(ErrGeneral, L"7z: next header crc32 not match");
+    return false;
+  }
+  for (;;) {
+    ByteReader r(header.make_span());
+    auto id = r.Number();
+    if (id == kHeader) {
+      return readHeader(r, headerBase, ec);
+    }
+    if (id != kEncodedHeader) {
+      return headerCorrupted(ec);
+    }
+    // packed header: usually one LZMA folder, decode it and parse again
+    streams_info si;
+    if (!readStreamsInfo(r, si, ec)) {
+      return false;
+    }
+    std::vector<int64_t> offsets;
+    auto offset = headerBase + static_cast<int64_t>(si.pack_pos);
+    for (auto s : si.pack_sizes) {
+      offsets.emplace_back(offset);
+      offset += static_cast<int64_t>(s);
+    }
+    Buffer decoded;
+    for (const auto &folder : si.folders) {
+      for (const auto &c : folder.coders) {
+        if (!IsSupportedMethod(c.method)) {
+          ec = bela::make_error_code(ErrUnimplemented, L"7z: header uses unsupported method ", c.method);
+          return false;
+        }
+      }
+      if (decoded.size() + folder.UnpackSize() > maxHeaderSize) {
+        return headerCorrupted(ec);
+      }
+      auto begin = decoded.size();
+      if (!DecodeToMemory(fd.NativeFD(), folder,
+                          std::span<const int64_t>(offsets).subspan(folder.pack_index, folder.packed_streams.size()),
+                          std::span<const uint64_t>(si.pack_sizes).subspan(folder.pack_index), decoded, ec)) {
+        return false;
+      }
+      if (folder.has_crc && crc32_fast(decoded.data() + begin, decoded.size() - begin, 0) != folder.crc32_value) {
+        ec = bela::make_error_code(ErrGeneral, L"7z: encoded header crc32 not match");
+        return false;
+      }
+    }
+    header = std::move(decoded);
+  }
+}
+
+bool readFilesInfo(ByteReader &r, std::vector<File> &files, bela::error_code &ec) {
+  auto numFiles = r.Number();
+  if (numFiles > r.Remaining()) {
+    return headerCorrupted(ec);
+  }
+  files.resize(static_cast<size_t>(numFiles));
+  std::vector<bool> emptyStreams(files.size(), false);
+  std::vector<bool> emptyFiles;
+  std::vector<bool> antiFiles;
+  size_t numEmptyStreams = 0;
+  for (;;) {
+    auto id = r.Number();
+    if (id == kEnd || r.Bad()) {
+      break;
+    }
+    ByteReader pr(r.Bytes(r.Number()));
+    switch (id) {
+    case kEmptyStream:
+      emptyStreams = pr.BitVector(files.size());
+      numEmptyStreams = static_cast<size_t>(std::count(emptyStreams.begin(), emptyStreams.end(), true));
+      emptyFiles.assign(numEmptyStreams, false);
+      antiFiles.assign(numEmptyStreams, false);
+      break;
+    case kEmptyFile:
+      emptyFiles = pr.BitVector(numEmptyStreams);
+      break;
+    case kAnti:
+      antiFiles = pr.BitVector(numEmptyStreams);
+      break;
+    case kName: {
+      if (pr.Byte() != 0) {
+        ec = bela::make_error_code(ErrUnimplemented, L"7z: external names are not supported");
+        return false;
+      }
+      for (auto &file : files) {
+        std::wstring name;
+        for (;;) {
+          auto lo = pr.Byte();
+          auto hi = pr.Byte();
+          auto ch = static_cast<wchar_t>(lo | (hi << 8));
+          if (ch == 0 || pr.Bad()) {
+            break;
+          }
+          name.push_back(ch == L'\\' ? L'/' : ch);
+        }
+        file.name = bela::encode_into<wchar_t, char>(name);
+      }
+    } break;
+    case kMTime: {
+      auto defined = pr.OptionalBitVector(files.size());
+      if (pr.Byte() != 0) {
+        break;
+      }
+      for (size_t i = 0; i < files.size(); i++) {
+        if (defined[i]) {
+          files[i].time = bela::FromWindowsPreciseTime(pr.UInt64());
+        }
+      }
+    } break;
+    case kWinAttributes: {
+      auto defined = pr.OptionalBitVector(files.size());
+      if (pr.Byte() != 0) {
+        break;
+      }
+      for (size_t i = 0; i < files.size(); i++) {
+        if (defined[i]) {
+          files[i].attributes = pr.UInt32();
+        }
+      }
+    } break;
+    default:
+      // kCTime, kATime, kStartPos, kDummy and unknown properties are skipped
+      break;
+    }
+    if (pr.Bad()) {
+      return headerCorrupted(ec);
+    }
+  }
+  size_t emptyIndex = 0;
+  for (size_t i = 0; i < files.size(); i++) {
+    auto &file = files[i];
+    file.has_stream = !emptyStreams[i];
+    if (file.has_stream) {
+      continue;
+    }
+    file.is_dir = emptyIndex >= emptyFiles.size() || !emptyFiles[emptyIndex];
+    file.is_anti = emptyIndex < antiFiles.size() && antiFiles[emptyIndex];
+    emptyIndex++;
+  }
+  return r.Bad() ? headerCorrupted(ec) : true;
+}
+
+bool Reader::readHeader(ByteReader &r, int64_t headerBase, bela::error_code &ec) {
+  streams_info si;
+  for (;;) {
+    auto id = r.Number();
+    if (r.Bad()) {
+      return headerCorrupted(ec);
+    }
+    if (id == kEnd) {
+      break;
+    }
+    switch (id) {
+    case kArchiveProperties:
+      for (;;) {
+        if (auto t = r.Number(); t == kEnd || r.Bad()) {
+          break;
+        }
+        r.Bytes(r.Number());
+      }
+      continue;
+    case kAdditionalStreamsInfo:
+      if (streams_info additional; !readStreamsInfo(r, additional, ec)) {
+        return false;
+      }
+      continue;
+    case kMainStreamsInfo:
+      if (!readStreamsInfo(r, si, ec)) {
+        return false;
+      }
+      continue;
+    case kFilesInfo:
+      if (!readFilesInfo(r, files, ec)) {
+        return false;
+      }
+      continue;
+    default:
+      return headerCorrupted(ec);
+    }
+  }
+  folders = std::move(si.folders);
+  pack_sizes = std::move(si.pack_sizes);
+  auto offset = headerBase + static_cast<int64_t>(si.pack_pos);
+  for (auto s : pack_sizes) {
+    if (offset + s > static_cast<uint64_t>(size)) {
+      ec = bela::make_error_code(ErrGeneral, L"7z: packed stream out of range");
+      return false;
+    }
+    pack_offsets.emplace_back(offset);
+    offset += static_cast<int64_t>(s);
+    compressed_size += static_cast<int64_t>(s);
+  }
+  // assign streams to files in order, folders without streams are skipped
+  size_t folderIndex = 0;
+  size_t streamIndex = 0;
+  uint64_t indexInFolder = 0;
+  for (size_t i = 0; i < files.size(); i++) {
+    auto &file = files[i];
+    if (!file.has_stream) {
+      continue;
+    }
+    while (indexInFolder == 0 && folderIndex < folders.size() && si.num_unpack_streams[folderIndex] == 0) {
+      folderIndex++;
+    }
+    if (folderIndex >= folders.size() || streamIndex >= si.unpack_sizes.size()) {
+      return headerCorrupted(ec);
+    }
+    file.folder = static_cast<int64_t>(folderIndex);
+    file.size = si.unpack_sizes[streamIndex];
+    file.has_crc = si.crc_defined[streamIndex];
+    file.crc32_value = si.crcs[streamIndex];
+    uncompressed_size += static_cast<int64_t>(file.size);
+    streamIndex++;
+    folders[folderIndex].files.emplace_back(i);
+    if (++indexInFolder >= si.num_unpack_streams[folderIndex]) {
+      folderIndex++;
+      indexInFolder = 0;
+    }
+  }
+  return true;
+}
+
+bool Reader::CheckMethods(bela::error_code &ec) const {
+  for (const auto &folder : folders) {
+    for (const auto &c : folder.coders) {
+      if (!IsSupportedMethod(c.method)) {
+        ec = bela::make_error_code(ErrUnimplemented, L"7z: unsupported method ", c.method);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool Reader::OpenReader(std::wstring_view file, bela::error_code &ec) {
+  if (fd) {
+    ec = bela::make_error_code(L"The file has been opened, the function cannot be called repeatedly");
+    return false;
+  }
+  auto fd_ = bela::io::NewFile(file, ec);
+  if (!fd_) {
+    return false;
+  }
+  fd = std::move(*fd_);
+  file_format_t afmt{file_format_t::none};
+  if (!CheckFormat(fd, afmt, startPosition, ec)) {
+    return false;
+  }
+  if (afmt != file_format_t::_7z) {
+    ec = bela::make_error_code(ErrGeneral, L"7z: not a valid 7z file");
+    return false;
+  }
+  return Initialize(ec);
+}
+
+bool Reader::OpenReader(HANDLE nfd, int64_t size_, int64_t offset_, bela::error_code &ec) {
+  if (fd) {
+    ec = bela::make_error_code(L"The file has been opened, the function cannot be called repeatedly");
+    return false;
+  }
+  fd.Assgin(nfd, false);
+  size = size_;
+  startPosition = offset_;
+  return Initialize(ec);
+}
+
+} // namespace baulk::archive::n7z
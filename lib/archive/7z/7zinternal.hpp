@@ -0,0 +1,179 @@
+//
+#ifndef BAULK_ARCHIVE_7Z_INTERNAL_HPP
+#define BAULK_ARCHIVE_7Z_INTERNAL_HPP
+#include <baulk/archive/7z.hpp>
+#include <baulk/archive.hpp>
+#include <baulk/allocate.hpp>
+#include <baulk/archive/crc32.hpp>
+#include <bela/endian.hpp>
+#include <algorithm>
+#include <span>
+
+namespace baulk::archive::n7z {
+using baulk::mem::Buffer;
+constexpr uint8_t signature[] = {'7', 'z', 0xBC, 0xAF, 0x27, 0x1C};
+constexpr size_t signatureHeaderSize = 32;
+constexpr uint64_t maxHeaderSize = 256ULL * 1024 * 1024;
+
+// Property IDs
+enum property_id : uint64_t {
+  kEnd = 0x00,
+  kHeader = 0x01,
+  kArchiveProperties = 0x02,
+  kAdditionalStreamsInfo = 0x03,
+  kMainStreamsInfo = 0x04,
+  kFilesInfo = 0x05,
+  kPackInfo = 0x06,
+  kUnPackInfo = 0x07,
+  kSubStreamsInfo = 0x08,
+  kSize = 0x09,
+  kCRC = 0x0A,
+  kFolder = 0x0B,
+  kCodersUnPackSize = 0x0C,
+  kNumUnPackStream = 0x0D,
+  kEmptyStream = 0x0E,
+  kEmptyFile = 0x0F,
+  kAnti = 0x10,
+  kName = 0x11,
+  kCTime = 0x12,
+  kATime = 0x13,
+  kMTime = 0x14,
+  kWinAttributes = 0x15,
+  kComment = 0x16,
+  kEncodedHeader = 0x17,
+  kStartPos = 0x18,
+  kDummy = 0x19,
+};
+
+// ByteReader: bounds checked reader over a decoded header, reads past the end return zero and mark it bad
+class ByteReader {
+public:
+  ByteReader(std::span<const uint8_t> data_) : data(data_) {}
+  bool Bad() const { return bad; }
+  size_t Remaining() const { return data.size() - pos; }
+  uint8_t Byte() {
+    if (pos >= data.size()) {
+      bad = true;
+      return 0;
+    }
+    return data[pos++];
+  }
+  uint32_t UInt32() {
+    if (Remaining() < 4) {
+      bad = true;
+      pos = data.size();
+      return 0;
+    }
+    auto v = bela::cast_fromle<uint32_t>(data.data() + pos);
+    pos += 4;
+    return v;
+  }
+  uint64_t UInt64() {
+    if (Remaining() < 8) {
+      bad = true;
+      pos = data.size();
+      return 0;
+    }
+    auto v = bela::cast_fromle<uint64_t>(data.data() + pos);
+    pos += 8;
+    return v;
+  }
+  // Number: the count of leading one bits in the first byte is the number of extra bytes
+  uint64_t Number() {
+    auto first = Byte();
+    uint8_t mask = 0x80;
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+      if ((first & mask) == 0) {
+        auto high = static_cast<uint64_t>(first & (mask - 1));
+        return value | (high << (8 * i));
+      }
+      value |= static_cast<uint64_t>(Byte()) << (8 * i);
+      mask >>= 1;
+    }
+    return value;
+  }
+  std::span<const uint8_t> Bytes(uint64_t n) {
+    if (n > Remaining()) {
+      bad = true;
+      pos = data.size();
+      return {};
+    }
+    auto s = data.subspan(pos, static_cast<size_t>(n));
+    pos += static_cast<size_t>(n);
+    return s;
+  }
+  // BitVector: most significant bit first
+  std::vector<bool> BitVector(size_t n) {
+    std::vector<bool> v(n, false);
+    uint8_t b = 0;
+    uint8_t mask = 0;
+    for (size_t i = 0; i < n; i++) {
+      if (mask == 0) {
+        b = Byte();
+        mask = 0x80;
+      }
+      v[i] = (b & mask) != 0;
+      mask >>= 1;
+    }
+    return v;
+  }
+  // OptionalBitVector: a leading 'all defined' byte, followed by a BitVector when it is zero
+  std::vector<bool> OptionalBitVector(size_t n) {
+    if (Byte() != 0) {
+      return std::vector<bool>(n, true);
+    }
+    return BitVector(n);
+  }
+
+private:
+  std::span<const uint8_t> data;
+  size_t pos{0};
+  bool bad{false};
+};
+
+struct streams_info {
+  uint64_t pack_pos{0};
+  std::vector<uint64_t> pack_sizes;
+  std::vector<Folder> folders;
+  std::vector<uint64_t> num_unpack_streams; // per folder
+  std::vector<uint64_t> unpack_sizes;       // per substream
+  std::vector<bool> crc_defined;            // per substream
+  std::vector<uint32_t> crcs;               // per substream
+};
+
+// InStream: one decoded or packed stream of a folder
+class InStream {
+public:
+  virtual ~InStream() = default;
+  // Read: bytes read, 0 at the end of the stream, -1 on error
+  virtual bela::ssize_t Read(uint8_t *buffer, size_t len, bela::error_code &ec) = 0;
+};
+
+class folderDecoder {
+public:
+  folderDecoder(HANDLE fd_, const Folder &folder_, std::span<const int64_t> pack_offsets_,
+                std::span<const uint64_t> pack_sizes_)
+      : fd(fd_), folder(folder_), pack_offsets(pack_offsets_), pack_sizes(pack_sizes_) {}
+  std::unique_ptr<InStream> Open(bela::error_code &ec);
+
+private:
+  HANDLE fd;
+  const Folder &folder;
+  std::span<const int64_t> pack_offsets;
+  std::span<const uint64_t> pack_sizes;
+  size_t depth{0};
+  std::unique_ptr<InStream> outStream(uint64_t outIndex, bela::error_code &ec);
+  std::unique_ptr<InStream> inStream(uint64_t inIndex, bela::error_code &ec);
+  std::unique_ptr<InStream> lzmaChain(size_t coderIndex, uint64_t outIndex, bela::error_code &ec);
+  std::unique_ptr<InStream> bcj2(size_t coderIndex, uint64_t outIndex, bela::error_code &ec);
+  bool coderStreams(size_t coderIndex, uint64_t &inBase, uint64_t &outBase) const;
+};
+
+bool IsSupportedMethod(uint64_t method);
+// DecodeToMemory: append the whole folder to out, used for packed headers
+bool DecodeToMemory(HANDLE fd, const Folder &folder, std::span<const int64_t> pack_offsets,
+                    std::span<const uint64_t> pack_sizes, Buffer &out, bela::error_code &ec);
+} // namespace baulk::archive::n7z
+
+#endif
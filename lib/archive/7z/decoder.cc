@@ -0,0 +1,572 @@
+///
+#ifndef LZMA_API_STATIC
+#define LZMA_API_STATIC 1
+#endif
+#include "7zinternal.hpp"
+#include <lzma.h>
+
+namespace baulk::archive::n7z {
+constexpr size_t lzmainsize = 128 * 1024;
+constexpr size_t sourcesize = 64 * 1024;
+constexpr size_t extractsize = 1024 * 1024;
+// LZMA allocator
+static lzma_allocator allocator{                                  // allocater
+                                .alloc = baulk::mem::allocate_xz, //
+                                .free = baulk::mem::deallocate_simple,
+                                .opaque = nullptr};
+
+// packStream: positioned reads, several folders can share one handle from different threads
+class packStream : public InStream {
+public:
+  packStream(HANDLE fd_, int64_t offset_, uint64_t size_) : fd(fd_), offset(offset_), remaining(size_) {}
+  bela::ssize_t Read(uint8_t *buffer, size_t len, bela::error_code &ec) override {
+    if (remaining == 0) {
+      return 0;
+    }
+    auto n = static_cast<DWORD>((std::min)({static_cast<uint64_t>(len), remaining, static_cast<uint64_t>(1) << 30}));
+    OVERLAPPED ov{};
+    ov.Offset = static_cast<DWORD>(offset);
+    ov.OffsetHigh = static_cast<DWORD>(offset >> 32);
+    DWORD dwSize = 0;
+    if (ReadFile(fd, buffer, n, &dwSize, &ov) != TRUE && GetLastError() != ERROR_HANDLE_EOF) {
+      ec = bela::make_system_error_code(L"ReadFile() ");
+      return -1;
+    }
+    if (dwSize == 0) {
+      ec = bela::make_error_code(ErrGeneral, L"7z: packed stream truncated");
+      return -1;
+    }
+    offset += dwSize;
+    remaining -= dwSize;
+    return static_cast<bela::ssize_t>(dwSize);
+  }
+
+private:
+  HANDLE fd;
+  int64_t offset;
+  uint64_t remaining;
+};
+
+// copyStream: Copy coder, the output is its input capped at the unpack size
+class copyStream : public InStream {
+public:
+  copyStream(std::unique_ptr<InStream> &&in_, uint64_t size_) : in(std::move(in_)), remaining(size_) {}
+  bela::ssize_t Read(uint8_t *buffer, size_t len, bela::error_code &ec) override {
+    if (remaining == 0) {
+      return 0;
+    }
+    auto n = in->Read(buffer, static_cast<size_t>((std::min)(static_cast<uint64_t>(len), remaining)), ec);
+    if (n > 0) {
+      remaining -= static_cast<uint64_t>(n);
+    }
+    return n;
+  }
+
+private:
+  std::unique_ptr<InStream> in;
+  uint64_t remaining;
+};
+
+// lzmaStream: LZMA or LZMA2 with the BCJ/Delta filters stacked on it merged into one liblzma raw decoder
+class lzmaStream : public InStream {
+public:
+  lzmaStream(std::unique_ptr<InStream> &&in_, uint64_t size_) : in(std::move(in_)), remaining(size_) {}
+  lzmaStream(const lzmaStream &) = delete;
+  lzmaStream &operator=(const lzmaStream &) = delete;
+  ~lzmaStream() { lzma_end(&zs); }
+  bool Initialize(lzma_filter *filters, bela::error_code &ec) {
+    zs.allocator = &allocator;
+    if (auto ret = lzma_raw_decoder(&zs, filters); ret != LZMA_OK) {
+      ec = bela::make_error_code(ret, L"lzma_raw_decoder error ", static_cast<int>(ret));
+      return false;
+    }
+    inbuf.grow(lzmainsize);
+    return true;
+  }
+  bela::ssize_t Read(uint8_t *buffer, size_t len, bela::error_code &ec) override {
+    if (remaining == 0 || len == 0) {
+      return 0;
+    }
+    auto want = static_cast<size_t>((std::min)(static_cast<uint64_t>(len), remaining));
+    zs.next_out = buffer;
+    zs.avail_out = want;
+    while (zs.avail_out != 0) {
+      if (zs.avail_in == 0 && !eof) {
+        auto n = in->Read(inbuf.data(), lzmainsize, ec);
+        if (n < 0) {
+          return -1;
+        }
+        eof = n == 0;
+        zs.next_in = inbuf.data();
+        zs.avail_in = static_cast<size_t>(n);
+      }
+      auto ret = lzma_code(&zs, eof ? LZMA_FINISH : LZMA_RUN);
+      if (ret == LZMA_STREAM_END) {
+        break;
+      }
+      if (ret != LZMA_OK) {
+        ec = bela::make_error_code(ErrGeneral, L"7z: lzma decode error ", static_cast<int>(ret));
+        return -1;
+      }
+      if (eof && zs.avail_in == 0 && zs.avail_out == want) {
+        break;
+      }
+    }
+    auto have = want - zs.avail_out;
+    if (have == 0) {
+      ec = bela::make_error_code(ErrGeneral, L"7z: unexpected end of lzma stream");
+      return -1;
+    }
+    remaining -= have;
+    return static_cast<bela::ssize_t>(have);
+  }
+
+private:
+  std::unique_ptr<InStream> in;
+  lzma_stream zs = LZMA_STREAM_INIT;
+  Buffer inbuf;
+  uint64_t remaining;
+  bool eof{false};
+};
+
+// byteSource: buffered byte access over an InStream
+class byteSource {
+public:
+  byteSource(std::unique_ptr<InStream> &&in_) : in(std::move(in_)), buffer(sourcesize) {}
+  bool Byte(uint8_t &b, bela::error_code &ec) {
+    if (pos == buffer.size() && !fill(ec)) {
+      return false;
+    }
+    b = buffer[pos++];
+    return true;
+  }
+  // Peek: buffered bytes, at least one unless the stream ended
+  std::span<const uint8_t> Peek(bela::error_code &ec) {
+    if (pos == buffer.size() && !fill(ec)) {
+      return {};
+    }
+    return {buffer.data() + pos, buffer.size() - pos};
+  }
+  void Skip(size_t n) { pos += n; }
+
+private:
+  bool fill(bela::error_code &ec) {
+    auto n = in->Read(buffer.data(), sourcesize, ec);
+    if (n <= 0) {
+      if (n == 0) {
+        ec = bela::make_error_code(ErrGeneral, L"7z: unexpected end of stream");
+      }
+      return false;
+    }
+    buffer.size() = static_cast<size_t>(n);
+    pos = 0;
+    return true;
+  }
+  std::unique_ptr<InStream> in;
+  Buffer buffer;
+  size_t pos{0};
+};
+
+// bcj2Stream: x86 BCJ2, call and jump targets are stored big-endian in their own streams and selected by a range
+// coded bit after every E8/E9/0F8x opcode
+class bcj2Stream : public InStream {
+public:
+  bcj2Stream(std::unique_ptr<InStream> &&main_, std::unique_ptr<InStream> &&call_, std::unique_ptr<InStream> &&jump_,
+             std::unique_ptr<InStream> &&rc_, uint64_t size_)
+      : main(std::move(main_)), call(std::move(call_)), jump(std::move(jump_)), rc(std::move(rc_)), outSize(size_) {
+    std::fill(std::begin(probs), std::end(probs), static_cast<uint16_t>(kBitModelTotal >> 1));
+  }
+  bela::ssize_t Read(uint8_t *buffer, size_t len, bela::error_code &ec) override {
+    if (!initialized) {
+      for (int i = 0; i < 5; i++) {
+        uint8_t b = 0;
+        if (!rc.Byte(b, ec)) {
+          return -1;
+        }
+        code = (code << 8) | b;
+      }
+      initialized = true;
+    }
+    size_t w = 0;
+    auto limit = static_cast<size_t>((std::min)(static_cast<uint64_t>(len), outSize - outPos));
+    while (w < limit) {
+      if (pendingPos < pendingSize) {
+        auto n = (std::min)(limit - w, pendingSize - pendingPos);
+        memcpy(buffer + w, pending + pendingPos, n);
+        pendingPos += n;
+        w += n;
+        outPos += n;
+        continue;
+      }
+      auto s = main.Peek(ec);
+      if (s.empty()) {
+        return -1;
+      }
+      // copy plain bytes up to the next branch opcode
+      size_t i = 0;
+      auto n = (std::min)(s.size(), limit - w);
+      bool branch = false;
+      for (; i < n; i++) {
+        auto b = s[i];
+        buffer[w + i] = b;
+        if (isJ(prevByte, b)) {
+          branch = true;
+          i++;
+          break;
+        }
+        prevByte = b;
+      }
+      main.Skip(i);
+      w += i;
+      outPos += i;
+      if (!branch || outPos == outSize) {
+        continue;
+      }
+      auto b = buffer[w - 1];
+      auto prob = b == 0xE8 ? &probs[prevByte] : (b == 0xE9 ? &probs[256] : &probs[257]);
+      int bit = 0;
+      if (!decodeBit(prob, bit, ec)) {
+        return -1;
+      }
+      if (bit == 0) {
+        prevByte = b;
+        continue;
+      }
+      auto &src = b == 0xE8 ? call : jump;
+      uint32_t v = 0;
+      for (int k = 0; k < 4; k++) {
+        uint8_t c = 0;
+        if (!src.Byte(c, ec)) {
+          return -1;
+        }
+        v = (v << 8) | c;
+      }
+      auto dest = v - static_cast<uint32_t>(outPos + 4);
+      pending[0] = static_cast<uint8_t>(dest);
+      pending[1] = static_cast<uint8_t>(dest >> 8);
+      pending[2] = static_cast<uint8_t>(dest >> 16);
+      pending[3] = static_cast<uint8_t>(dest >> 24);
+      pendingPos = 0;
+      pendingSize = static_cast<size_t>((std::min)(static_cast<uint64_t>(4), outSize - outPos));
+      prevByte = static_cast<uint8_t>(dest >> 24);
+    }
+    return static_cast<bela::ssize_t>(w);
+  }
+
+private:
+  static constexpr uint32_t kTopValue = 1U << 24;
+  static constexpr uint32_t kNumBitModelTotalBits = 11;
+  static constexpr uint32_t kBitModelTotal = 1U << kNumBitModelTotalBits;
+  static constexpr uint32_t kNumMoveBits = 5;
+  static bool isJ(uint8_t b0, uint8_t b1) { return (b1 & 0xFE) == 0xE8 || (b0 == 0x0F && (b1 & 0xF0) == 0x80); }
+  bool decodeBit(uint16_t *prob, int &bit, bela::error_code &ec) {
+    auto ttt = static_cast<uint32_t>(*prob);
+    auto bound = (range >> kNumBitModelTotalBits) * ttt;
+    if (code < bound) {
+      range = bound;
+      *prob = static_cast<uint16_t>(ttt + ((kBitModelTotal - ttt) >> kNumMoveBits));
+      bit = 0;
+    } else {
+      range -= bound;
+      code -= bound;
+      *prob = static_cast<uint16_t>(ttt - (ttt >> kNumMoveBits));
+      bit = 1;
+    }
+    if (range < kTopValue) {
+      uint8_t b = 0;
+      if (!rc.Byte(b, ec)) {
+        return false;
+      }
+      range <<= 8;
+      code = (code << 8) | b;
+    }
+    return true;
+  }
+  byteSource main;
+  byteSource call;
+  byteSource jump;
+  byteSource rc;
+  uint64_t outSize;
+  uint64_t outPos{0};
+  uint16_t probs[2 + 256];
+  uint32_t range{0xFFFFFFFF};
+  uint32_t code{0};
+  uint8_t prevByte{0};
+  uint8_t pending[4];
+  size_t pendingPos{0};
+  size_t pendingSize{0};
+  bool initialized{false};
+};
+
+inline lzma_vli filterID(uint64_t method) {
+  switch (method) {
+  case methodLZMA:
+    return LZMA_FILTER_LZMA1EXT;
+  case methodLZMA2:
+    return LZMA_FILTER_LZMA2;
+  case methodDelta:
+    return LZMA_FILTER_DELTA;
+  case methodBCJ:
+    return LZMA_FILTER_X86;
+  case methodPPC:
+    return LZMA_FILTER_POWERPC;
+  case methodIA64:
+    return LZMA_FILTER_IA64;
+  case methodARM:
+    return LZMA_FILTER_ARM;
+  case methodARMT:
+    return LZMA_FILTER_ARMTHUMB;
+  case methodSPARC:
+    return LZMA_FILTER_SPARC;
+  case methodARM64:
+    return LZMA_FILTER_ARM64;
+  case methodRISCV:
+    return LZMA_FILTER_RISCV;
+  default:
+    break;
+  }
+  return LZMA_VLI_UNKNOWN;
+}
+
+bool folderDecoder::coderStreams(size_t coderIndex, uint64_t &inBase, uint64_t &outBase) const {
+  inBase = 0;
+  outBase = 0;
+  for (size_t i = 0; i < coderIndex; i++) {
+    inBase += folder.coders[i].num_in;
+    outBase += folder.coders[i].num_out;
+  }
+  return coderIndex < folder.coders.size();
+}
+
+std::unique_ptr<InStream> folderDecoder::inStream(uint64_t inIndex, bela::error_code &ec) {
+  for (const auto &bp : folder.bind_pairs) {
+    if (bp.in_index == inIndex) {
+      return outStream(bp.out_index, ec);
+    }
+  }
+  for (size_t k = 0; k < folder.packed_streams.size(); k++) {
+    if (folder.packed_streams[k] == inIndex && k < pack_offsets.size() && k < pack_sizes.size()) {
+      return std::make_unique<packStream>(fd, pack_offsets[k], pack_sizes[k]);
+    }
+  }
+  ec = bela::make_error_code(ErrGeneral, L"7z: folder in stream ", inIndex, L" is not bound");
+  return nullptr;
+}
+
+std::unique_ptr<InStream> folderDecoder::outStream(uint64_t outIndex, bela::error_code &ec) {
+  if (++depth > folder.coders.size() * 4 + 8) {
+    ec = bela::make_error_code(ErrGeneral, L"7z: folder coders form a cycle");
+    return nullptr;
+  }
+  uint64_t inBase = 0;
+  uint64_t outBase = 0;
+  for (size_t i = 0; i < folder.coders.size(); i++) {
+    const auto &c = folder.coders[i];
+    if (outIndex < outBase || outIndex >= outBase + c.num_out) {
+      inBase += c.num_in;
+      outBase += c.num_out;
+      continue;
+    }
+    if (outIndex >= folder.unpack_sizes.size()) {
+      break;
+    }
+    switch (c.method) {
+    case methodCopy:
+      if (auto in = inStream(inBase, ec); in) {
+        return std::make_unique<copyStream>(std::move(in), folder.unpack_sizes[outIndex]);
+      }
+      return nullptr;
+    case methodBCJ2:
+      return bcj2(i, outIndex, ec);
+    default:
+      break;
+    }
+    if (filterID(c.method) == LZMA_VLI_UNKNOWN) {
+      ec = bela::make_error_code(ErrUnimplemented, L"7z: unsupported method ", c.method);
+      return nullptr;
+    }
+    return lzmaChain(i, outIndex, ec);
+  }
+  ec = bela::make_error_code(ErrGeneral, L"7z: folder out stream ", outIndex, L" not found");
+  return nullptr;
+}
+
+std::unique_ptr<InStream> folderDecoder::lzmaChain(size_t coderIndex, uint64_t outIndex, bela::error_code &ec) {
+  lzma_filter filters[LZMA_FILTERS_MAX + 1];
+  size_t count = 0;
+  auto closer = bela::finally([&] {
+    for (size_t i = 0; i < count; i++) {
+      if (filters[i].options != nullptr) {
+        allocator.free(allocator.opaque, filters[i].options);
+      }
+    }
+  });
+  // filters are applied top down, walk from the coder producing outIndex to the LZMA coder feeding it
+  for (auto index = coderIndex;;) {
+    const auto &c = folder.coders[index];
+    uint64_t inBase = 0;
+    uint64_t outBase = 0;
+    coderStreams(index, inBase, outBase);
+    auto id = filterID(c.method);
+    if (id == LZMA_VLI_UNKNOWN || c.num_in != 1 || c.num_out != 1 || count == LZMA_FILTERS_MAX) {
+      ec = bela::make_error_code(ErrUnimplemented, L"7z: unsupported coder chain, method ", c.method);
+      return nullptr;
+    }
+    filters[count].id = id;
+    filters[count].options = nullptr;
+    if (auto ret = lzma_properties_decode(&filters[count], &allocator, c.props.data(), c.props.size());
+        ret != LZMA_OK) {
+      ec = bela::make_error_code(ErrGeneral, L"7z: invalid properties for method ", c.method);
+      return nullptr;
+    }
+    count++;
+    if (id == LZMA_FILTER_LZMA1EXT || id == LZMA_FILTER_LZMA2) {
+      if (id == LZMA_FILTER_LZMA1EXT) {
+        // 7z streams usually have no end marker, the size comes from the folder and the marker is still accepted
+        auto opt = reinterpret_cast<lzma_options_lzma *>(filters[count - 1].options);
+        opt->ext_flags = LZMA_LZMA1EXT_ALLOW_EOPM;
+        lzma_set_ext_size(*opt, folder.unpack_sizes[outBase]);
+      }
+      filters[count].id = LZMA_VLI_UNKNOWN;
+      filters[count].options = nullptr;
+      auto in = inStream(inBase, ec);
+      if (!in) {
+        return nullptr;
+      }
+      auto s = std::make_unique<lzmaStream>(std::move(in), folder.unpack_sizes[outIndex]);
+      if (!s->Initialize(filters, ec)) {
+        return nullptr;
+      }
+      return s;
+    }
+    // a filter, its single input has to be the output of the next coder in the chain
+    auto next = std::find_if(folder.bind_pairs.begin(), folder.bind_pairs.end(),
+                             [&](const BindPair &bp) { return bp.in_index == inBase; });
+    if (next == folder.bind_pairs.end()) {
+      ec = bela::make_error_code(ErrUnimplemented, L"7z: filter ", c.method, L" without a LZMA coder");
+      return nullptr;
+    }
+    uint64_t nextOut = 0;
+    for (index = 0; index < folder.coders.size(); index++) {
+      if (next->out_index < nextOut + folder.coders[index].num_out) {
+        break;
+      }
+      nextOut += folder.coders[index].num_out;
+    }
+    if (index >= folder.coders.size()) {
+      ec = bela::make_error_code(ErrGeneral, L"7z: bind pair out of range");
+      return nullptr;
+    }
+  }
+}
+
+std::unique_ptr<InStream> folderDecoder::bcj2(size_t coderIndex, uint64_t outIndex, bela::error_code &ec) {
+  const auto &c = folder.coders[coderIndex];
+  if (c.num_in != 4 || c.num_out != 1) {
+    ec = bela::make_error_code(ErrGeneral, L"7z: BCJ2 coder needs 4 in streams");
+    return nullptr;
+  }
+  uint64_t inBase = 0;
+  uint64_t outBase = 0;
+  coderStreams(coderIndex, inBase, outBase);
+  std::unique_ptr<InStream> in[4];
+  for (uint64_t i = 0; i < 4; i++) {
+    if (in[i] = inStream(inBase + i, ec); !in[i]) {
+      return nullptr;
+    }
+  }
+  return std::make_unique<bcj2Stream>(std::move(in[0]), std::move(in[1]), std::move(in[2]), std::move(in[3]),
+                                      folder.unpack_sizes[outIndex]);
+}
+
+std::unique_ptr<InStream> folderDecoder::Open(bela::error_code &ec) {
+  // the main out stream is the one no bind pair consumes
+  for (uint64_t i = 0; i < folder.unpack_sizes.size(); i++) {
+    auto bound = std::any_of(folder.bind_pairs.begin(), folder.bind_pairs.end(),
+                             [&](const BindPair &bp) { return bp.out_index == i; });
+    if (!bound) {
+      return outStream(i, ec);
+    }
+  }
+  ec = bela::make_error_code(ErrGeneral, L"7z: folder has no main stream");
+  return nullptr;
+}
+
+// readFull: fill buffer completely, an early end of the folder is an error
+inline bool readFull(InStream *in, uint8_t *buffer, size_t len, bela::error_code &ec) {
+  while (len != 0) {
+    auto n = in->Read(buffer, len, ec);
+    if (n < 0) {
+      return false;
+    }
+    if (n == 0) {
+      ec = bela::make_error_code(ErrGeneral, L"7z: unexpected end of folder");
+      return false;
+    }
+    buffer += n;
+    len -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+bool DecodeToMemory(HANDLE fd, const Folder &folder, std::span<const int64_t> pack_offsets,
+                    std::span<const uint64_t> pack_sizes, Buffer &out, bela::error_code &ec) {
+  folderDecoder d(fd, folder, pack_offsets, pack_sizes);
+  auto in = d.Open(ec);
+  if (!in) {
+    return false;
+  }
+  auto size = static_cast<size_t>(folder.UnpackSize());
+  out.grow(out.size() + size);
+  if (!readFull(in.get(), out.data() + out.size(), size, ec)) {
+    return false;
+  }
+  out.size() += size;
+  return true;
+}
+
+bool Reader::DecompressFolder(size_t index, const FolderHandler &h, bela::error_code &ec) const {
+  if (index >= folders.size()) {
+    ec = bela::make_error_code(ErrGeneral, L"7z: folder index out of range");
+    return false;
+  }
+  const auto &folder = folders[index];
+  auto packCount = folder.packed_streams.size();
+  folderDecoder d(fd.NativeFD(), folder, std::span<const int64_t>(pack_offsets).subspan(folder.pack_index, packCount),
+                  std::span<const uint64_t>(pack_sizes).subspan(folder.pack_index, packCount));
+  auto in = d.Open(ec);
+  if (!in) {
+    return false;
+  }
+  Buffer buffer(extractsize);
+  for (auto fi : folder.files) {
+    const auto &file = files[fi];
+    if (!h.begin(file, ec)) {
+      return false;
+    }
+    uint32_t crc = 0;
+    for (auto remaining = file.size; remaining != 0;) {
+      auto n = static_cast<size_t>((std::min)(remaining, static_cast<uint64_t>(extractsize)));
+      if (!readFull(in.get(), buffer.data(), n, ec)) {
+        return false;
+      }
+      if (file.has_crc) {
+        crc = crc32_fast(buffer.data(), n, crc);
+      }
+      if (!h.write(file, buffer.data(), n, ec)) {
+        return false;
+      }
+      remaining -= n;
+    }
+    if (file.has_crc && crc != file.crc32_value) {
+      ec = bela::make_error_code(ErrGeneral, L"crc32 want ", file.crc32_value, L" got ", crc, L" not match");
+      return false;
+    }
+    if (!h.end(file, ec)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace baulk::archive::n7z
@@ -0,0 +1,210 @@
+///
+#include "7zinternal.hpp"
+#include <baulk/archive/extractor.hpp>
+#include <bela/match.hpp>
+#include <thread>
+
+namespace baulk::archive::n7z {
+// decoders running at the same time share this much dictionary memory
+constexpr uint64_t dictionaryBudget = 1ULL << 30;
+
+bool Extractor::create_symlink(const fs::path &_New_symlink, std::string_view linkname, bela::error_code &ec) {
+  auto nativeLinkName = baulk::archive::EncodeToNativePath(linkname, true);
+  std::error_code e;
+  auto linkPath = fs::absolute(_New_symlink.parent_path() / nativeLinkName, e);
+  if (e) {
+    ec = bela::make_error_code_from_std(e, L"absolute() ");
+    return false;
+  }
+  auto relativePath = fs::relative(linkPath, destination, e);
+  if (e) {
+    ec = bela::make_error_code_from_std(e, L"relative() ");
+    return false;
+  }
+  if (bela::StrContains(relativePath.c_str(), L"..\\")) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"harmful path <s>: ", nativeLinkName);
+    return false;
+  }
+  return baulk::archive::NewSymlink(_New_symlink, nativeLinkName, opts.overwrite_mode, ec);
+}
+
+// prepare: sanitize every name, create directories and empty files, remember where the folder data goes
+bool Extractor::prepare(const Filter &filter, bela::error_code &ec) {
+  const auto &files = reader.Files();
+  targets.assign(files.size(), std::nullopt);
+  for (size_t i = 0; i < files.size(); i++) {
+    const auto &file = files[i];
+    if (file.is_anti) {
+      continue;
+    }
+    std::wstring encoded_path;
+    auto out = baulk::archive::JoinSanitizeFsPath(destination, file.name, true, encoded_path);
+    if (!out) {
+      ec = bela::make_error_code(bela::ErrGeneral, L"harmful path <s>: ", bela::encode_into<char, wchar_t>(file.name));
+      if (!opts.ignore_error) {
+        return false;
+      }
+      continue;
+    }
+    if (filter && !filter(file, encoded_path)) {
+      ec = bela::make_error_code(bela::ErrCanceled, L"canceled");
+      return false;
+    }
+    if (file.IsDir()) {
+      if (!MakeDirectories(*out, file.time, dirs, times, ec) && !opts.ignore_error) {
+        return false;
+      }
+      continue;
+    }
+    if (!dirs.Ensure(out->parent_path(), ec)) {
+      if (!opts.ignore_error) {
+        return false;
+      }
+      continue;
+    }
+    if (file.has_stream) {
+      targets[i] = std::move(*out);
+      continue;
+    }
+    if (auto fd = baulk::archive::File::NewFile(*out, file.time, 0, opts.overwrite_mode, nullptr, ec);
+        (!fd || !fd->Flush(ec)) && !opts.ignore_error) {
+      return false;
+    }
+  }
+  ec.clear();
+  return true;
+}
+
+bool Extractor::extract_folder(size_t index, const OnProgress &progress, std::mutex &mu, std::atomic_bool &stop,
+                               bela::error_code &ec) {
+  std::optional<baulk::archive::File> fd;
+  std::string linkname;
+  bool skip = false;
+  Reader::FolderHandler h{
+      .begin =
+          [&](const File &file, bela::error_code &ec) {
+            const auto &target = targets[&file - reader.Files().data()];
+            skip = !target;
+            if (skip || file.IsSymlink()) {
+              linkname.clear();
+              return true;
+            }
+            if (fd = baulk::archive::File::NewFile(*target, file.time, static_cast<int64_t>(file.size),
+                                                   opts.overwrite_mode, nullptr, ec);
+                !fd) {
+              // keep decoding the folder, the following files do not depend on this one
+              skip = opts.ignore_error;
+              return skip;
+            }
+            return true;
+          },
+      .write =
+          [&](const File &file, const void *data, size_t len, bela::error_code &ec) {
+            if (stop.load(std::memory_order_relaxed)) {
+              ec = bela::make_error_code(bela::ErrCanceled, L"canceled");
+              return false;
+            }
+            if (progress) {
+              std::lock_guard lock(mu);
+              if (!progress(len)) {
+                ec = bela::make_error_code(bela::ErrCanceled, L"canceled");
+                return false;
+              }
+            }
+            if (skip) {
+              return true;
+            }
+            if (!fd) {
+              linkname.append(static_cast<const char *>(data), len);
+              return true;
+            }
+            return fd->WriteFull(data, len, ec);
+          },
+      .end =
+          [&](const File &file, bela::error_code &ec) {
+            if (skip) {
+              return true;
+            }
+            if (!fd) {
+              auto target = targets[&file - reader.Files().data()];
+              return create_symlink(*target, linkname, ec) || opts.ignore_error;
+            }
+            auto ok = fd->Flush(ec);
+            fd.reset();
+            return ok || opts.ignore_error;
+          },
+  };
+  if (!reader.DecompressFolder(index, h, ec)) {
+    if (fd) {
+      fd->Discard();
+    }
+    return false;
+  }
+  return true;
+}
+
+bool Extractor::Extract(const Filter &filter, const OnProgress &progress, bela::error_code &ec) {
+  if (!reader.CheckMethods(ec)) {
+    return false;
+  }
+  if (!dirs.Ensure(destination, ec)) {
+    return false;
+  }
+  if (!prepare(filter, ec)) {
+    return false;
+  }
+  // largest folders first so one big solid block does not finish last on a single thread
+  std::vector<size_t> order;
+  uint64_t maxDictionary = 1;
+  const auto &folders = reader.Folders();
+  for (size_t i = 0; i < folders.size(); i++) {
+    auto &folder = folders[i];
+    if (std::none_of(folder.files.begin(), folder.files.end(), [&](size_t fi) { return targets[fi].has_value(); })) {
+      continue;
+    }
+    order.emplace_back(i);
+    maxDictionary = (std::max)(maxDictionary, folder.DictionarySize());
+  }
+  std::sort(order.begin(), order.end(),
+            [&](size_t a, size_t b) { return folders[a].UnpackSize() > folders[b].UnpackSize(); });
+  auto concurrency = static_cast<uint64_t>((std::max)(std::thread::hardware_concurrency(), 1U));
+  auto budget = (std::max)(dictionaryBudget / maxDictionary, static_cast<uint64_t>(1));
+  workers = static_cast<size_t>((std::min)({concurrency, static_cast<uint64_t>(order.size()), budget}));
+  std::atomic_size_t next{0};
+  std::atomic_bool stop{false};
+  std::mutex mu;
+  bela::error_code firstEc;
+  auto worker = [&] {
+    while (!stop.load(std::memory_order_relaxed)) {
+      auto k = next.fetch_add(1);
+      if (k >= order.size()) {
+        break;
+      }
+      bela::error_code wec;
+      if (extract_folder(order[k], progress, mu, stop, wec)) {
+        continue;
+      }
+      std::lock_guard lock(mu);
+      if (wec == bela::ErrCanceled || !opts.ignore_error) {
+        stop = true;
+      }
+      if (!firstEc) {
+        firstEc = std::move(wec);
+      }
+    }
+  };
+  {
+    std::vector<std::jthread> threads;
+    for (size_t i = 1; i < workers; i++) {
+      threads.emplace_back(worker);
+    }
+    worker();
+  }
+  if (stop) {
+    ec = std::move(firstEc);
+    return false;
+  }
+  return times.Apply(opts.ignore_error, ec);
+}
+
+} // namespace baulk::archive::n7z
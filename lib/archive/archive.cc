@@ -2,6 +2,7 @@
 #include <bela/path.hpp>
 #include <baulk/archive.hpp>
 #include <filesystem>
+#include <algorithm>
 
 namespace baulk::archive {
 inline void close_file(HANDLE &hFile) {
@@ -55,23 +56,186 @@ inline bool discard_fd(HANDLE &fd) {
   return false;
 }
 
-File::~File() { close_file(fd); }
+// entries at least this large are written with overlapped I/O, smaller ones finish before a write could overlap
+constexpr int64_t overlapped_threshold = 4 * 1024 * 1024;
+constexpr size_t overlapped_chunk = 1024 * 1024;
+
+// OverlappedWriter: double buffered writer, one chunk is written by the system while the caller fills the other
+class OverlappedWriter {
+public:
+  OverlappedWriter() = default;
+  OverlappedWriter(const OverlappedWriter &) = delete;
+  OverlappedWriter &operator=(const OverlappedWriter &) = delete;
+  ~OverlappedWriter() {
+    for (auto &s : slots) {
+      if (s.ov.hEvent != nullptr) {
+        CloseHandle(s.ov.hEvent);
+      }
+    }
+  }
+  bool Initialize(bela::error_code &ec) {
+    for (auto &s : slots) {
+      if (s.ov.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr); s.ov.hEvent == nullptr) {
+        ec = bela::make_system_error_code(L"CreateEventW() ");
+        return false;
+      }
+      s.data = std::make_unique<uint8_t[]>(overlapped_chunk);
+    }
+    return true;
+  }
+  bool Write(HANDLE fd, const void *data, size_t bytes, bela::error_code &ec) {
+    auto p = reinterpret_cast<const uint8_t *>(data);
+    while (bytes != 0) {
+      auto &s = slots[current];
+      auto n = (std::min)(bytes, overlapped_chunk - s.size);
+      memcpy(s.data.get() + s.size, p, n);
+      s.size += n;
+      p += n;
+      bytes -= n;
+      if (s.size < overlapped_chunk) {
+        continue;
+      }
+      if (!submit(fd, s, ec)) {
+        return false;
+      }
+      current ^= 1;
+      // the other chunk must be on disk before it is reused
+      if (!wait(fd, slots[current], ec)) {
+        return false;
+      }
+    }
+    return true;
+  }
+  bool Flush(HANDLE fd, bela::error_code &ec) {
+    if (slots[current].size != 0 && !submit(fd, slots[current], ec)) {
+      return false;
+    }
+    auto ok = true;
+    for (auto &s : slots) {
+      ok = wait(fd, s, ec) && ok;
+    }
+    return ok;
+  }
+
+private:
+  struct slot {
+    std::unique_ptr<uint8_t[]> data;
+    size_t size{0};
+    OVERLAPPED ov{};
+    bool pending{false};
+  };
+  bool submit(HANDLE fd, slot &s, bela::error_code &ec) {
+    s.ov.Offset = static_cast<DWORD>(offset);
+    s.ov.OffsetHigh = static_cast<DWORD>(offset >> 32);
+    ResetEvent(s.ov.hEvent);
+    if (WriteFile(fd, s.data.get(), static_cast<DWORD>(s.size), nullptr, &s.ov) != TRUE &&
+        GetLastError() != ERROR_IO_PENDING) {
+      ec = bela::make_system_error_code(L"WriteFile() ");
+      return false;
+    }
+    offset += static_cast<int64_t>(s.size);
+    s.pending = true;
+    return true;
+  }
+  bool wait(HANDLE fd, slot &s, bela::error_code &ec) {
+    if (!s.pending) {
+      return true;
+    }
+    s.pending = false;
+    DWORD written = 0;
+    auto size = static_cast<DWORD>(s.size);
+    s.size = 0;
+    if (GetOverlappedResult(fd, &s.ov, &written, TRUE) != TRUE) {
+      ec = bela::make_system_error_code(L"GetOverlappedResult() ");
+      return false;
+    }
+    if (written != size) {
+      ec = bela::make_error_code(ErrGeneral, L"short write ", written, L" of ", size, L" bytes");
+      return false;
+    }
+    return true;
+  }
+  slot slots[2];
+  size_t current{0};
+  int64_t offset{0};
+};
+
+File::File(HANDLE fd_) : fd(fd_) {}
+File::File(HANDLE fd_, std::unique_ptr<OverlappedWriter> &&ow_) : fd(fd_), ow(std::move(ow_)) {}
+File::~File() {
+  bela::error_code ec;
+  Flush(ec);
+  close_file(fd);
+}
 File::File(File &&o) noexcept {
   close_file(fd);
   fd = o.fd;
   o.fd = INVALID_HANDLE_VALUE;
+  ow = std::move(o.ow);
+  modified = o.modified;
+  reserved = std::exchange(o.reserved, 0);
+  written = std::exchange(o.written, 0);
+  pending_times = std::exchange(o.pending_times, false);
 }
 File &File::operator=(File &&o) noexcept {
   close_file(fd);
   fd = o.fd;
   o.fd = INVALID_HANDLE_VALUE;
+  ow = std::move(o.ow);
+  modified = o.modified;
+  reserved = std::exchange(o.reserved, 0);
+  written = std::exchange(o.written, 0);
+  pending_times = std::exchange(o.pending_times, false);
   return *this;
 }
-bool File::Chtimes(bela::Time t, bela::error_code &ec) { return chtimes(fd, t, ec); }
-bool File::Discard() { return discard_fd(fd); }
+bool File::Chtimes(bela::Time t, bela::error_code &ec) {
+  pending_times = false;
+  return chtimes(fd, t, ec);
+}
+bool File::Discard() {
+  if (ow) {
+    bela::error_code ec;
+    ow->Flush(fd, ec);
+    ow.reset();
+  }
+  pending_times = false;
+  return discard_fd(fd);
+}
+
+bool File::Flush(bela::error_code &ec) {
+  if (fd == INVALID_HANDLE_VALUE) {
+    return true;
+  }
+  if (ow && !ow->Flush(fd, ec)) {
+    return false;
+  }
+  // a short entry must not look complete, the rest of the preallocated end of file is cut
+  if (reserved > written) {
+    reserved = written;
+    FILE_END_OF_FILE_INFO eof;
+    eof.EndOfFile.QuadPart = written;
+    if (SetFileInformationByHandle(fd, FileEndOfFileInfo, &eof, sizeof(eof)) != TRUE) {
+      ec = bela::make_system_error_code(L"SetFileInformationByHandle() ");
+      return false;
+    }
+  }
+  // times are set once on the open handle after the last write, later writes would not change them either
+  if (pending_times) {
+    pending_times = false;
+    return chtimes(fd, modified, ec);
+  }
+  return true;
+}
 
 /// WriteFull
 bool File::WriteFull(const void *data, size_t bytes, bela::error_code &ec) {
+  if (ow) {
+    if (!ow->Write(fd, data, bytes, ec)) {
+      return false;
+    }
+    written += static_cast<int64_t>(bytes);
+    return true;
+  }
   auto len = static_cast<DWORD>(bytes);
   auto u8d = reinterpret_cast<const uint8_t *>(data);
   DWORD writtenBytes = 0;
@@ -83,34 +247,111 @@ bool File::WriteFull(const void *data, size_t bytes, bela::error_code &ec) {
     }
     writtenBytes += dwSize;
   } while (writtenBytes < len);
+  written += static_cast<int64_t>(bytes);
   return true;
 }
 
-std::optional<File> File::NewFile(const fs::path &path, bela::Time modified, bool overwrite_mode,
-                                  bela::error_code &ec) {
+// preallocate: clusters and end of file are set up front, Flush cuts a short entry back to the bytes written. The
+// valid data length still grows with the writes, unwritten ranges read as zeros
+inline void preallocate(HANDLE fd, int64_t size) {
+  FILE_ALLOCATION_INFO ai;
+  ai.AllocationSize.QuadPart = size;
+  SetFileInformationByHandle(fd, FileAllocationInfo, &ai, sizeof(ai));
+  FILE_END_OF_FILE_INFO eof;
+  eof.EndOfFile.QuadPart = size;
+  SetFileInformationByHandle(fd, FileEndOfFileInfo, &eof, sizeof(eof));
+}
+
+bool DirectoryCache::Ensure(const fs::path &dir, bela::error_code &ec) {
+  if (dirs.contains(dir.native())) {
+    avoided++;
+    return true;
+  }
   std::error_code e;
-  if (fs::exists(path, e)) {
-    if (!overwrite_mode) {
-      ec = bela::make_error_code(ErrGeneral, L"file '", path.native(), L"' exists");
+  if (fs::create_directories(dir, e); e) {
+    ec = bela::make_error_code_from_std(e, bela::StringCat(L"fs::create_directories() '", dir.native(), L"' "));
+    return false;
+  }
+  created++;
+  // ancestors exist as well, stop at the first one already known
+  for (auto p = dir; p.has_relative_path(); p = p.parent_path()) {
+    if (!dirs.emplace(p.native()).second) {
+      break;
+    }
+  }
+  return true;
+}
+
+std::optional<File> File::NewFile(const fs::path &path, bela::Time modified, int64_t size, bool overwrite_mode,
+                                  DirectoryCache *dirs, bela::error_code &ec) {
+  if (dirs != nullptr) {
+    if (!dirs->Ensure(path.parent_path(), ec)) {
       return std::nullopt;
     }
   } else {
+    std::error_code e;
     if (fs::create_directories(path.parent_path(), e); e) {
       ec = bela::make_error_code_from_std(e, L"create_directories() ");
       return std::nullopt;
     }
   }
+  auto overlapped = size >= overlapped_threshold;
+  // CREATE_NEW reports an existing file without a separate stat
   auto fd = CreateFileW(path.c_str(), FILE_GENERIC_READ | FILE_GENERIC_WRITE | GENERIC_READ | GENERIC_WRITE | DELETE,
-                        FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+                        FILE_SHARE_READ, nullptr, overwrite_mode ? CREATE_ALWAYS : CREATE_NEW,
+                        FILE_ATTRIBUTE_NORMAL | (overlapped ? FILE_FLAG_OVERLAPPED : 0), nullptr);
   if (fd == INVALID_HANDLE_VALUE) {
+    if (auto le = GetLastError(); le == ERROR_FILE_EXISTS) {
+      ec = bela::make_error_code(ErrGeneral, L"file '", path.native(), L"' exists");
+      return std::nullopt;
+    }
     ec = bela::make_system_error_code(L"CreateFileW ");
     return std::nullopt;
   }
-  if (!chtimes(fd, modified, ec)) {
-    discard_fd(fd);
-    return std::nullopt;
+  if (size > 0) {
+    preallocate(fd, size);
   }
-  return std::make_optional<File>(fd);
+  std::optional<File> file;
+  if (!overlapped) {
+    file.emplace(fd);
+  } else {
+    auto ow = std::make_unique<OverlappedWriter>();
+    if (!ow->Initialize(ec)) {
+      discard_fd(fd);
+      return std::nullopt;
+    }
+    file.emplace(fd, std::move(ow));
+  }
+  file->modified = modified;
+  file->reserved = (std::max)(size, int64_t{0});
+  file->pending_times = true;
+  return file;
+}
+
+bool DeferredTimes::Apply(bool ignore_error, bela::error_code &ec) {
+  // a child path is always longer than its parent
+  std::stable_sort(entries.begin(), entries.end(),
+                   [](const auto &a, const auto &b) { return a.first.size() > b.first.size(); });
+  for (const auto &[dir, modified] : entries) {
+    auto fd = CreateFileW(dir.data(), FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                          nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+    if (fd == INVALID_HANDLE_VALUE) {
+      ec = bela::make_system_error_code(L"CreateFileW() ");
+    } else {
+      auto ok = chtimes(fd, modified, ec);
+      CloseHandle(fd);
+      if (ok) {
+        continue;
+      }
+    }
+    if (!ignore_error) {
+      entries.clear();
+      return false;
+    }
+  }
+  entries.clear();
+  ec.clear();
+  return true;
 }
 
 bool NewSymlink(const fs::path &path, const fs::path &source, bool overwrite_mode, bela::error_code &ec) {
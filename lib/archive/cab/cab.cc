@@ -0,0 +1,355 @@
+///
+#include "cabinternal.hpp"
+
+namespace baulk::archive::cab {
+
+// fileSource: positioned reads on a synchronous handle do not move a shared file pointer
+class fileSource : public Source {
+public:
+  fileSource(bela::io::FD &&fd_, int64_t size_) : fd(std::move(fd_)), size(size_) {}
+  bool ReadAt(void *buffer, size_t len, int64_t offset, bela::error_code &ec) const override {
+    auto p = static_cast<uint8_t *>(buffer);
+    while (len > 0) {
+      OVERLAPPED ov{};
+      ov.Offset = static_cast<DWORD>(offset);
+      ov.OffsetHigh = static_cast<DWORD>(offset >> 32);
+      DWORD dwSize = 0;
+      auto n = static_cast<DWORD>((std::min)(len, static_cast<size_t>(UINT32_MAX)));
+      if (ReadFile(fd.NativeFD(), p, n, &dwSize, &ov) != TRUE && GetLastError() != ERROR_HANDLE_EOF) {
+        ec = bela::make_system_error_code(L"ReadFile() ");
+        return false;
+      }
+      if (dwSize == 0) {
+        ec = bela::make_error_code(ErrGeneral, L"cab: unexpected end of file");
+        return false;
+      }
+      p += dwSize;
+      len -= dwSize;
+      offset += dwSize;
+    }
+    return true;
+  }
+  int64_t Size() const override { return size; }
+
+private:
+  bela::io::FD fd;
+  int64_t size{0};
+};
+
+std::shared_ptr<Source> NewFileSource(std::wstring_view file, bela::error_code &ec) {
+  auto fd = bela::io::NewFile(file, ec);
+  if (!fd) {
+    return nullptr;
+  }
+  auto size = fd->Size(ec);
+  if (size < 0) {
+    return nullptr;
+  }
+  return std::make_shared<fileSource>(std::move(*fd), size);
+}
+
+bool blockReader::Next(Buffer &payload, uint32_t &uncompressed, bela::error_code &ec) {
+  if (remaining == 0) {
+    ec = bela::make_error_code(ErrEnded, L"cab: no more data blocks");
+    return false;
+  }
+  uint8_t hdr[dataSize];
+  if (!source.ReadAt(hdr, sizeof(hdr), offset, ec)) {
+    return false;
+  }
+  auto cbData = bela::cast_fromle<uint16_t>(hdr + 4);
+  uncompressed = bela::cast_fromle<uint16_t>(hdr + 6);
+  if (cbData > maxBlockSize || uncompressed > frameSize) {
+    ec = bela::make_error_code(ErrGeneral, L"cab: bad data block, packed ", cbData, L" unpacked ", uncompressed);
+    return false;
+  }
+  offset += dataSize + reserve;
+  payload.grow(cbData);
+  if (cbData != 0 && !source.ReadAt(payload.data(), cbData, offset, ec)) {
+    return false;
+  }
+  payload.size() = cbData;
+  offset += cbData;
+  remaining--;
+  return true;
+}
+
+// storedDecoder: compressNone, every block is already a frame
+class storedDecoder : public folderDecoder {
+public:
+  storedDecoder(blockReader &br_) : br(br_) {}
+  bool Next(const uint8_t *&data, size_t &len, bela::error_code &ec) override {
+    uint32_t uncompressed = 0;
+    if (!br.Next(block, uncompressed, ec)) {
+      if (ec == ErrEnded) {
+        ec.clear();
+        len = 0;
+        return true;
+      }
+      return false;
+    }
+    if (block.size() != uncompressed) {
+      ec = bela::make_error_code(ErrGeneral, L"cab: stored block size mismatch");
+      return false;
+    }
+    data = block.data();
+    len = block.size();
+    return true;
+  }
+
+private:
+  blockReader &br;
+  Buffer block;
+};
+
+std::unique_ptr<folderDecoder> NewStoredDecoder(blockReader &br) { return std::make_unique<storedDecoder>(br); }
+
+bool Reader::OpenReader(std::shared_ptr<Source> source_, bela::error_code &ec) {
+  if (source) {
+    ec = bela::make_error_code(L"The file has been opened, the function cannot be called repeatedly");
+    return false;
+  }
+  source = std::move(source_);
+  uint8_t hdr[headerSize + 4];
+  if (source->Size() < static_cast<int64_t>(headerSize) || !source->ReadAt(hdr, headerSize, 0, ec)) {
+    ec = bela::make_error_code(ErrGeneral, L"cab: not a valid cabinet file");
+    return false;
+  }
+  if (memcmp(hdr, signature, sizeof(signature)) != 0) {
+    ec = bela::make_error_code(ErrGeneral, L"cab: not a valid cabinet file");
+    return false;
+  }
+  auto coffFiles = bela::cast_fromle<uint32_t>(hdr + 16);
+  auto cFolders = bela::cast_fromle<uint16_t>(hdr + 26);
+  auto cFiles = bela::cast_fromle<uint16_t>(hdr + 28);
+  flags = bela::cast_fromle<uint16_t>(hdr + 30);
+  int64_t offset = headerSize;
+  uint8_t folderReserve = 0;
+  if ((flags & flagReservePresent) != 0) {
+    if (!source->ReadAt(hdr + headerSize, 4, offset, ec)) {
+      return false;
+    }
+    offset += 4 + bela::cast_fromle<uint16_t>(hdr + headerSize);
+    folderReserve = hdr[headerSize + 2];
+    data_reserve = hdr[headerSize + 3];
+  }
+  // szCabinetPrev/szDiskPrev and szCabinetNext/szDiskNext, only skipped: spanned sets are rejected by CheckMethods
+  auto skipString = [&]() -> bool {
+    for (;;) {
+      uint8_t c = 0;
+      if (offset >= source->Size() || !source->ReadAt(&c, 1, offset++, ec)) {
+        ec = bela::make_error_code(ErrGeneral, L"cab: truncated header");
+        return false;
+      }
+      if (c == 0) {
+        return true;
+      }
+    }
+  };
+  auto stringCount = ((flags & flagPrevCabinet) != 0 ? 2 : 0) + ((flags & flagNextCabinet) != 0 ? 2 : 0);
+  for (int i = 0; i < stringCount; i++) {
+    if (!skipString()) {
+      return false;
+    }
+  }
+  folders.resize(cFolders);
+  for (auto &folder : folders) {
+    uint8_t fb[folderSize];
+    if (!source->ReadAt(fb, sizeof(fb), offset, ec)) {
+      return false;
+    }
+    folder.data_offset = bela::cast_fromle<uint32_t>(fb);
+    folder.blocks = bela::cast_fromle<uint16_t>(fb + 4);
+    folder.compression = bela::cast_fromle<uint16_t>(fb + 6);
+    offset += folderSize + folderReserve;
+  }
+  // names are at most 256 bytes, read the file table in one go
+  auto tableSize = (std::min)(source->Size() - static_cast<int64_t>(coffFiles),
+                              static_cast<int64_t>(cFiles * (fileSize + 257)));
+  if (tableSize < 0) {
+    ec = bela::make_error_code(ErrGeneral, L"cab: bad file table offset");
+    return false;
+  }
+  Buffer table(static_cast<size_t>(tableSize));
+  if (tableSize != 0 && !source->ReadAt(table.data(), static_cast<size_t>(tableSize), coffFiles, ec)) {
+    return false;
+  }
+  auto tv = std::string_view(reinterpret_cast<const char *>(table.data()), static_cast<size_t>(tableSize));
+  size_t pos = 0;
+  files.resize(cFiles);
+  for (auto &file : files) {
+    if (tv.size() - pos < fileSize) {
+      ec = bela::make_error_code(ErrGeneral, L"cab: truncated file table");
+      return false;
+    }
+    auto p = table.data() + pos;
+    file.size = bela::cast_fromle<uint32_t>(p);
+    file.offset = bela::cast_fromle<uint32_t>(p + 4);
+    file.folder = bela::cast_fromle<uint16_t>(p + 8);
+    file.time = bela::FromDosDateTime(bela::cast_fromle<uint16_t>(p + 10), bela::cast_fromle<uint16_t>(p + 12));
+    file.attributes = bela::cast_fromle<uint16_t>(p + 14);
+    pos += fileSize;
+    auto end = tv.find('\0', pos);
+    if (end == std::string_view::npos) {
+      ec = bela::make_error_code(ErrGeneral, L"cab: truncated file name");
+      return false;
+    }
+    file.name.assign(tv.substr(pos, end - pos));
+    pos = end + 1;
+  }
+  for (size_t i = 0; i < files.size(); i++) {
+    const auto &file = files[i];
+    // 0xFFFD/0xFFFE/0xFFFF continue from or into another cabinet of a spanned set
+    if (file.folder >= folders.size()) {
+      overlapped = true;
+      continue;
+    }
+    folders[file.folder].files.emplace_back(i);
+    uncompressed_size += file.size;
+  }
+  for (auto &folder : folders) {
+    std::stable_sort(folder.files.begin(), folder.files.end(),
+                     [&](size_t a, size_t b) { return files[a].offset < files[b].offset; });
+    uint64_t end = 0;
+    for (auto fi : folder.files) {
+      if (files[fi].offset < end) {
+        overlapped = true;
+      }
+      end = (std::max)(end, static_cast<uint64_t>(files[fi].offset) + files[fi].size);
+    }
+  }
+  return true;
+}
+
+bool Reader::CheckMethods(bela::error_code &ec) const {
+  if ((flags & (flagPrevCabinet | flagNextCabinet)) != 0) {
+    ec = bela::make_error_code(ErrUnimplemented, L"cab: spanned cabinets are not supported");
+    return false;
+  }
+  if (overlapped) {
+    ec = bela::make_error_code(ErrUnimplemented, L"cab: overlapping or foreign file entries are not supported");
+    return false;
+  }
+  for (const auto &folder : folders) {
+    switch (folder.Method()) {
+    case compressNone:
+      [[fallthrough]];
+    case compressMSZIP:
+      break;
+    case compressLZX:
+      if (auto wb = folder.WindowBits(); wb < 15 || wb > 21) {
+        ec = bela::make_error_code(ErrGeneral, L"cab: bad LZX window bits ", wb);
+        return false;
+      }
+      break;
+    default:
+      ec = bela::make_error_code(ErrUnimplemented, L"cab: unsupported compression ", folder.Method());
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Reader::DecompressFolder(size_t index, const FolderHandler &h, bela::error_code &ec) const {
+  if (index >= folders.size()) {
+    ec = bela::make_error_code(ErrGeneral, L"cab: folder index out of range");
+    return false;
+  }
+  const auto &folder = folders[index];
+  if (folder.files.empty()) {
+    return true;
+  }
+  uint64_t outputLength = 0;
+  for (auto fi : folder.files) {
+    outputLength = (std::max)(outputLength, static_cast<uint64_t>(files[fi].offset) + files[fi].size);
+  }
+  blockReader br(*source, folder.data_offset, folder.blocks, data_reserve);
+  std::unique_ptr<folderDecoder> decoder;
+  switch (folder.Method()) {
+  case compressNone:
+    decoder = NewStoredDecoder(br);
+    break;
+  case compressMSZIP:
+    decoder = NewMSZIPDecoder(br, ec);
+    break;
+  case compressLZX:
+    decoder = NewLZXDecoder(br, folder.WindowBits(), outputLength, ec);
+    break;
+  default:
+    ec = bela::make_error_code(ErrUnimplemented, L"cab: unsupported compression ", folder.Method());
+    return false;
+  }
+  if (!decoder) {
+    return false;
+  }
+  // files are sorted by offset and do not overlap, so the folder is walked once from front to back
+  size_t k = 0;
+  bool inFile = false;
+  uint64_t pos = 0;
+  auto flushEmpty = [&]() -> bool {
+    while (!inFile && k < folder.files.size()) {
+      const auto &file = files[folder.files[k]];
+      if (file.size != 0 || file.offset > pos) {
+        return true;
+      }
+      if (!h.begin(file, ec) || !h.end(file, ec)) {
+        return false;
+      }
+      k++;
+    }
+    return true;
+  };
+  while (k < folder.files.size()) {
+    if (!flushEmpty()) {
+      return false;
+    }
+    if (k >= folder.files.size()) {
+      break;
+    }
+    const uint8_t *data = nullptr;
+    size_t len = 0;
+    if (!decoder->Next(data, len, ec)) {
+      return false;
+    }
+    if (len == 0) {
+      ec = bela::make_error_code(ErrGeneral, L"cab: folder data ends before ", files[folder.files[k]].name);
+      return false;
+    }
+    while (len > 0 && k < folder.files.size()) {
+      const auto &file = files[folder.files[k]];
+      if (pos < file.offset) {
+        auto skip = static_cast<size_t>((std::min)(static_cast<uint64_t>(len), file.offset - pos));
+        data += skip;
+        len -= skip;
+        pos += skip;
+        continue;
+      }
+      if (!inFile) {
+        if (!h.begin(file, ec)) {
+          return false;
+        }
+        inFile = true;
+      }
+      auto n = static_cast<size_t>((std::min)(static_cast<uint64_t>(len), file.offset + file.size - pos));
+      if (n != 0 && !h.write(file, data, n, ec)) {
+        return false;
+      }
+      data += n;
+      len -= n;
+      pos += n;
+      if (pos == static_cast<uint64_t>(file.offset) + file.size) {
+        inFile = false;
+        if (!h.end(file, ec)) {
+          return false;
+        }
+        k++;
+        if (!flushEmpty()) {
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+} // namespace baulk::archive::cab
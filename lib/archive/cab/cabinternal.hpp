@@ -0,0 +1,53 @@
+//
+#ifndef BAULK_ARCHIVE_CAB_INTERNAL_HPP
+#define BAULK_ARCHIVE_CAB_INTERNAL_HPP
+#include <baulk/archive/cab.hpp>
+#include <baulk/archive.hpp>
+#include <baulk/allocate.hpp>
+#include <bela/endian.hpp>
+#include <algorithm>
+
+namespace baulk::archive::cab {
+using baulk::mem::Buffer;
+constexpr uint8_t signature[] = {'M', 'S', 'C', 'F'};
+constexpr size_t headerSize = 36;
+constexpr size_t folderSize = 8;
+constexpr size_t fileSize = 16;
+constexpr size_t dataSize = 8;
+constexpr uint16_t flagPrevCabinet = 0x0001;
+constexpr uint16_t flagNextCabinet = 0x0002;
+constexpr uint16_t flagReservePresent = 0x0004;
+// MSZIP and LZX never expand a frame by more than this, larger CFDATA blocks are corrupt
+constexpr size_t maxBlockSize = frameSize + 6144;
+
+// blockReader: the CFDATA blocks of one folder, read in order with positioned reads
+class blockReader {
+public:
+  blockReader(const Source &source_, int64_t offset_, uint16_t blocks_, uint8_t reserve_)
+      : source(source_), offset(offset_), remaining(blocks_), reserve(reserve_) {}
+  // Next: payload of the next block and its uncompressed size, ErrEnded after the last block
+  bool Next(Buffer &payload, uint32_t &uncompressed, bela::error_code &ec);
+
+private:
+  const Source &source;
+  int64_t offset;
+  uint16_t remaining;
+  uint8_t reserve;
+};
+
+// folderDecoder: produces the uncompressed bytes of one folder, one frame at a time
+class folderDecoder {
+public:
+  virtual ~folderDecoder() = default;
+  // Next: len is 0 once the folder is exhausted, data stays valid until the next call
+  virtual bool Next(const uint8_t *&data, size_t &len, bela::error_code &ec) = 0;
+};
+
+std::unique_ptr<folderDecoder> NewStoredDecoder(blockReader &br);
+std::unique_ptr<folderDecoder> NewMSZIPDecoder(blockReader &br, bela::error_code &ec);
+// NewLZXDecoder: the LZX bit stream runs across CFDATA blocks, output is split into frames of outputLength
+std::unique_ptr<folderDecoder> NewLZXDecoder(blockReader &br, uint32_t windowBits, uint64_t outputLength,
+                                             bela::error_code &ec);
+} // namespace baulk::archive::cab
+
+#endif
@@ -0,0 +1,580 @@
+///
+#include "cabinternal.hpp"
+
+namespace baulk::archive::cab {
+// LZX as used by cabinets:
+// https://learn.microsoft.com/en-us/openspecs/exchange_server_protocols/ms-patch/cc78752a-b4af-4eee-88cb-01f4d8a4c2bf
+namespace {
+constexpr int blockVerbatim = 1;
+constexpr int blockAligned = 2;
+constexpr int blockUncompressed = 3;
+constexpr int minMatch = 2;
+constexpr int numChars = 256;
+constexpr int pretreeSymbols = 20;
+constexpr int alignedSymbols = 8;
+constexpr int lengthSymbols = 249;
+constexpr int maxPositionSlots = 50;
+constexpr int maintreeMaxSymbols = numChars + maxPositionSlots * 8;
+constexpr int maxCodeLength = 16;
+// the bit stream may run this many bytes past the last block before it is treated as truncated
+constexpr int maxOverread = 16;
+
+struct positionTables {
+  uint32_t base[maxPositionSlots + 1];
+  uint8_t extra[maxPositionSlots + 1];
+  constexpr positionTables() : base{}, extra{} {
+    for (int i = 0, j = 0; i <= maxPositionSlots; i += 2) {
+      extra[i] = static_cast<uint8_t>(j);
+      if (i + 1 <= maxPositionSlots) {
+        extra[i + 1] = static_cast<uint8_t>(j);
+      }
+      if (i != 0 && j < 17) {
+        j++;
+      }
+    }
+    for (int i = 0, j = 0; i <= maxPositionSlots; i++) {
+      base[i] = static_cast<uint32_t>(j);
+      j += 1 << extra[i];
+    }
+  }
+};
+constexpr positionTables positions;
+
+constexpr int positionSlots(uint32_t windowBits) {
+  switch (windowBits) {
+  case 20:
+    return 42;
+  case 21:
+    return 50;
+  default:
+    break;
+  }
+  return static_cast<int>(windowBits) * 2;
+}
+} // namespace
+
+class lzxDecoder;
+
+// huffmanTable: canonical codes, a direct lookup for short codes and a bit by bit walk for the rest
+class huffmanTable {
+public:
+  bool Build(const uint8_t *lens, int n, int tableBits_) {
+    tableBits = tableBits_;
+    std::fill(std::begin(counts), std::end(counts), 0);
+    for (int i = 0; i < n; i++) {
+      counts[lens[i]]++;
+    }
+    counts[0] = 0;
+    int left = 1;
+    for (int len = 1; len <= maxCodeLength; len++) {
+      left <<= 1;
+      left -= counts[len];
+      if (left < 0) {
+        return false; // over-subscribed
+      }
+    }
+    uint16_t offsets[maxCodeLength + 2];
+    offsets[1] = 0;
+    for (int len = 1; len <= maxCodeLength; len++) {
+      offsets[len + 1] = offsets[len] + counts[len];
+    }
+    symbols.resize(n);
+    for (int i = 0; i < n; i++) {
+      if (lens[i] != 0) {
+        symbols[offsets[lens[i]]++] = static_cast<uint16_t>(i);
+      }
+    }
+    table.assign(static_cast<size_t>(1) << tableBits, 0);
+    uint32_t code = 0;
+    int index = 0;
+    for (int len = 1; len <= tableBits; len++) {
+      for (int i = 0; i < counts[len]; i++, code++) {
+        auto sym = symbols[index++];
+        auto shift = tableBits - len;
+        auto first = static_cast<size_t>(code) << shift;
+        auto entry = static_cast<uint16_t>(sym | (len << 11));
+        std::fill(table.begin() + first, table.begin() + first + (static_cast<size_t>(1) << shift), entry);
+      }
+      code <<= 1;
+    }
+    return true;
+  }
+  // Decode: -1 when the bits do not form a code of this tree
+  int Decode(lzxDecoder &d);
+
+private:
+  std::vector<uint16_t> table;
+  std::vector<uint16_t> symbols;
+  uint16_t counts[maxCodeLength + 1]{0};
+  int tableBits{0};
+};
+
+class lzxDecoder : public folderDecoder {
+public:
+  lzxDecoder(blockReader &br_, uint32_t windowBits_, uint64_t outputLength_)
+      : br(br_), windowBits(windowBits_), outputLength(outputLength_) {}
+  bool Initialize(bela::error_code &ec) {
+    if (windowBits < 15 || windowBits > 21) {
+      ec = bela::make_error_code(ErrGeneral, L"cab: bad LZX window bits ", windowBits);
+      return false;
+    }
+    windowSize = 1U << windowBits;
+    window.grow(windowSize);
+    memset(window.data(), 0, windowSize);
+    frame.grow(frameSize);
+    numPositionSlots = positionSlots(windowBits);
+    return true;
+  }
+  bool Next(const uint8_t *&data, size_t &len, bela::error_code &ec) override;
+
+  // bit input: 16-bit little endian words, consumed from the most significant bit
+  bool ensure(int n) {
+    while (bitsLeft < n) {
+      uint8_t lo = 0;
+      uint8_t hi = 0;
+      if (!readByte(lo) || !readByte(hi)) {
+        return false;
+      }
+      bitbuf |= static_cast<uint32_t>((hi << 8) | lo) << (16 - bitsLeft);
+      bitsLeft += 16;
+    }
+    return true;
+  }
+  uint32_t peek(int n) const { return bitbuf >> (32 - n); }
+  void remove(int n) {
+    bitbuf <<= n;
+    bitsLeft -= n;
+  }
+  bool readBits(int n, uint32_t &v) {
+    if (n == 0) {
+      v = 0;
+      return true;
+    }
+    if (!ensure(n)) {
+      return false;
+    }
+    v = peek(n);
+    remove(n);
+    return true;
+  }
+
+private:
+  blockReader &br;
+  bela::error_code readEc;
+  Buffer in;
+  size_t inPos{0};
+  int overread{0};
+  uint32_t bitbuf{0};
+  int bitsLeft{0};
+
+  Buffer window;
+  Buffer frame;
+  uint32_t windowBits{0};
+  uint32_t windowSize{0};
+  int numPositionSlots{0};
+  uint64_t outputLength{0};
+  uint64_t produced{0};   // bytes decoded into the window, may run ahead of the frame
+  uint64_t frameStart{0}; // folder offset of the next frame to hand out
+  uint32_t frameIndex{0};
+  bool headerRead{false};
+  int32_t intelFileSize{0};
+  bool intelStarted{false};
+
+  int blockType{0};
+  uint32_t blockLength{0};
+  uint32_t blockRemaining{0};
+  uint32_t R0{1};
+  uint32_t R1{1};
+  uint32_t R2{1};
+  uint8_t mainLens[maintreeMaxSymbols]{0};
+  uint8_t lengthLens[lengthSymbols]{0};
+  uint8_t alignedLens[alignedSymbols]{0};
+  huffmanTable mainTree;
+  huffmanTable lengthTree;
+  huffmanTable alignedTree;
+
+  bool readByte(uint8_t &b) {
+    while (inPos >= in.size()) {
+      uint32_t uncompressed = 0;
+      inPos = 0;
+      if (!br.Next(in, uncompressed, readEc)) {
+        if (readEc != ErrEnded || ++overread > maxOverread) {
+          return false;
+        }
+        // the last word may be only partially present, pad with zeros as the encoder did
+        readEc.clear();
+        in.size() = 0;
+        b = 0;
+        return true;
+      }
+    }
+    b = in[inPos++];
+    return true;
+  }
+  bool fail(bela::error_code &ec, std::wstring_view msg) {
+    if (readEc && readEc != ErrEnded) {
+      ec = std::move(readEc);
+      return false;
+    }
+    ec = bela::make_error_code(ErrGeneral, L"cab: LZX ", msg);
+    return false;
+  }
+  bool readLengths(uint8_t *lens, int first, int last, bela::error_code &ec);
+  bool readBlockHeader(bela::error_code &ec);
+  bool decodeBlock(uint64_t target, bela::error_code &ec);
+  bool copyUncompressed(uint64_t target, bela::error_code &ec);
+  void putByte(uint8_t b) { window.data()[static_cast<uint32_t>(produced++) & (windowSize - 1)] = b; }
+};
+
+int huffmanTable::Decode(lzxDecoder &d) {
+  if (!d.ensure(maxCodeLength)) {
+    return -1;
+  }
+  auto entry = table[d.peek(tableBits)];
+  if (auto len = entry >> 11; len != 0) {
+    d.remove(len);
+    return entry & 0x7FF;
+  }
+  // codes longer than the table, walk the canonical code one bit at a time
+  auto bits = d.peek(maxCodeLength);
+  int code = 0;
+  int first = 0;
+  int index = 0;
+  for (int len = 1; len <= maxCodeLength; len++) {
+    code |= (bits >> (maxCodeLength - len)) & 1;
+    int count = counts[len];
+    if (code - count < first) {
+      d.remove(len);
+      return symbols[index + (code - first)];
+    }
+    index += count;
+    first += count;
+    first <<= 1;
+    code <<= 1;
+  }
+  return -1;
+}
+
+// readLengths: code lengths are sent as deltas from the previous tree through a 20 symbol pretree
+bool lzxDecoder::readLengths(uint8_t *lens, int first, int last, bela::error_code &ec) {
+  uint8_t preLens[pretreeSymbols];
+  for (auto &l : preLens) {
+    uint32_t v = 0;
+    if (!readBits(4, v)) {
+      return fail(ec, L"truncated pretree");
+    }
+    l = static_cast<uint8_t>(v);
+  }
+  huffmanTable pretree;
+  if (!pretree.Build(preLens, pretreeSymbols, 6)) {
+    return fail(ec, L"bad pretree");
+  }
+  auto delta = [&](int x, int z) { return static_cast<uint8_t>((lens[x] + 17 - z) % 17); };
+  for (int x = first; x < last;) {
+    auto z = pretree.Decode(*this);
+    uint32_t run = 0;
+    switch (z) {
+    case 17:
+      if (!readBits(4, run)) {
+        return fail(ec, L"truncated lengths");
+      }
+      for (run += 4; run > 0 && x < last; run--) {
+        lens[x++] = 0;
+      }
+      break;
+    case 18:
+      if (!readBits(5, run)) {
+        return fail(ec, L"truncated lengths");
+      }
+      for (run += 20; run > 0 && x < last; run--) {
+        lens[x++] = 0;
+      }
+      break;
+    case 19: {
+      if (!readBits(1, run)) {
+        return fail(ec, L"truncated lengths");
+      }
+      auto v = pretree.Decode(*this);
+      if (v < 0 || v > 16) {
+        return fail(ec, L"bad length run");
+      }
+      // the whole run repeats the delta against the first length
+      auto l = delta(x, v);
+      for (run += 4; run > 0 && x < last; run--) {
+        lens[x++] = l;
+      }
+    } break;
+    default:
+      if (z < 0 || z > 16) {
+        return fail(ec, L"bad pretree symbol");
+      }
+      lens[x] = delta(x, z);
+      x++;
+      break;
+    }
+  }
+  return true;
+}
+
+bool lzxDecoder::readBlockHeader(bela::error_code &ec) {
+  // an odd sized uncompressed block is followed by one byte of padding
+  if (blockType == blockUncompressed && (blockLength & 1) != 0) {
+    uint8_t pad = 0;
+    if (!readByte(pad)) {
+      return fail(ec, L"truncated padding");
+    }
+  }
+  uint32_t type = 0;
+  uint32_t hi = 0;
+  uint32_t lo = 0;
+  if (!readBits(3, type) || !readBits(16, hi) || !readBits(8, lo)) {
+    return fail(ec, L"truncated block header");
+  }
+  blockType = static_cast<int>(type);
+  blockLength = blockRemaining = (hi << 8) | lo;
+  switch (blockType) {
+  case blockAligned:
+    for (auto &l : alignedLens) {
+      uint32_t v = 0;
+      if (!readBits(3, v)) {
+        return fail(ec, L"truncated aligned tree");
+      }
+      l = static_cast<uint8_t>(v);
+    }
+    if (!alignedTree.Build(alignedLens, alignedSymbols, 7)) {
+      return fail(ec, L"bad aligned tree");
+    }
+    [[fallthrough]];
+  case blockVerbatim: {
+    auto mainSymbols = numChars + numPositionSlots * 8;
+    if (!readLengths(mainLens, 0, numChars, ec) || !readLengths(mainLens, numChars, mainSymbols, ec)) {
+      return false;
+    }
+    if (!mainTree.Build(mainLens, mainSymbols, 12)) {
+      return fail(ec, L"bad main tree");
+    }
+    if (mainLens[0xE8] != 0) {
+      intelStarted = true;
+    }
+    if (!readLengths(lengthLens, 0, lengthSymbols, ec)) {
+      return false;
+    }
+    // an all zero length tree is legal when no match is longer than 8
+    if (!lengthTree.Build(lengthLens, lengthSymbols, 12)) {
+      return fail(ec, L"bad length tree");
+    }
+  } break;
+  case blockUncompressed: {
+    intelStarted = true;
+    // 1 to 16 bits of padding up to the next 16-bit boundary, the header never leaves a whole word buffered
+    if (bitsLeft == 0) {
+      if (!ensure(16)) {
+        return fail(ec, L"truncated block header");
+      }
+    }
+    bitsLeft = 0;
+    bitbuf = 0;
+    uint8_t r[12];
+    for (auto &b : r) {
+      if (!readByte(b)) {
+        return fail(ec, L"truncated block header");
+      }
+    }
+    R0 = bela::cast_fromle<uint32_t>(r);
+    R1 = bela::cast_fromle<uint32_t>(r + 4);
+    R2 = bela::cast_fromle<uint32_t>(r + 8);
+  } break;
+  default:
+    return fail(ec, L"bad block type");
+  }
+  return true;
+}
+
+bool lzxDecoder::copyUncompressed(uint64_t target, bela::error_code &ec) {
+  auto end = (std::min)(target, produced + blockRemaining);
+  while (produced < end) {
+    if (inPos >= in.size()) {
+      uint8_t b = 0;
+      if (!readByte(b) || overread != 0) {
+        return fail(ec, L"truncated uncompressed block");
+      }
+      putByte(b);
+      continue;
+    }
+    auto pos = static_cast<uint32_t>(produced) & (windowSize - 1);
+    auto n = (std::min)({static_cast<uint64_t>(in.size() - inPos), end - produced,
+                         static_cast<uint64_t>(windowSize - pos)});
+    memcpy(window.data() + pos, in.data() + inPos, static_cast<size_t>(n));
+    inPos += static_cast<size_t>(n);
+    produced += n;
+  }
+  return true;
+}
+
+// decodeBlock: decode tokens until target is reached, the last match may run past it into the next frame
+bool lzxDecoder::decodeBlock(uint64_t target, bela::error_code &ec) {
+  auto mask = windowSize - 1;
+  auto w = window.data();
+  auto blockEnd = produced + blockRemaining;
+  auto end = (std::min)(target, blockEnd);
+  while (produced < end) {
+    auto sym = mainTree.Decode(*this);
+    if (sym < 0) {
+      return fail(ec, L"bad main tree symbol");
+    }
+    if (sym < numChars) {
+      putByte(static_cast<uint8_t>(sym));
+      continue;
+    }
+    sym -= numChars;
+    uint32_t matchLength = sym & 7;
+    if (matchLength == 7) {
+      auto extra = lengthTree.Decode(*this);
+      if (extra < 0) {
+        return fail(ec, L"bad length tree symbol");
+      }
+      matchLength += static_cast<uint32_t>(extra);
+    }
+    matchLength += minMatch;
+    auto slot = sym >> 3;
+    uint32_t offset = 0;
+    switch (slot) {
+    case 0:
+      offset = R0;
+      break;
+    case 1:
+      offset = R1;
+      R1 = R0;
+      R0 = offset;
+      break;
+    case 2:
+      offset = R2;
+      R2 = R0;
+      R0 = offset;
+      break;
+    default: {
+      auto extra = positions.extra[slot];
+      offset = positions.base[slot] - 2;
+      uint32_t v = 0;
+      if (blockType == blockAligned && extra >= 3) {
+        if (!readBits(extra - 3, v)) {
+          return fail(ec, L"truncated offset");
+        }
+        auto aligned = alignedTree.Decode(*this);
+        if (aligned < 0) {
+          return fail(ec, L"bad aligned tree symbol");
+        }
+        offset += (v << 3) + static_cast<uint32_t>(aligned);
+      } else {
+        if (!readBits(extra, v)) {
+          return fail(ec, L"truncated offset");
+        }
+        offset += v;
+      }
+      R2 = R1;
+      R1 = R0;
+      R0 = offset;
+    } break;
+    }
+    if (offset == 0 || offset > windowSize || offset > produced) {
+      return fail(ec, L"match offset out of range");
+    }
+    if (produced + matchLength > blockEnd) {
+      return fail(ec, L"match runs past the block");
+    }
+    auto dst = static_cast<uint32_t>(produced) & mask;
+    auto src = (dst - offset) & mask;
+    auto disjoint = src + matchLength <= dst || dst + matchLength <= src;
+    if (disjoint && dst + matchLength <= windowSize && src + matchLength <= windowSize) {
+      memcpy(w + dst, w + src, matchLength);
+    } else {
+      // overlapping or wrapping copies repeat the pattern byte by byte
+      for (uint32_t i = 0; i < matchLength; i++) {
+        w[(dst + i) & mask] = w[(src + i) & mask];
+      }
+    }
+    produced += matchLength;
+  }
+  return true;
+}
+
+bool lzxDecoder::Next(const uint8_t *&data, size_t &len, bela::error_code &ec) {
+  if (frameStart >= outputLength) {
+    len = 0;
+    return true;
+  }
+  if (!headerRead) {
+    uint32_t v = 0;
+    if (!readBits(1, v)) {
+      return fail(ec, L"truncated header");
+    }
+    if (v != 0) {
+      uint32_t hi = 0;
+      uint32_t lo = 0;
+      if (!readBits(16, hi) || !readBits(16, lo)) {
+        return fail(ec, L"truncated header");
+      }
+      intelFileSize = static_cast<int32_t>((hi << 16) | lo);
+    }
+    headerRead = true;
+  }
+  auto frameLength = static_cast<uint32_t>((std::min)(static_cast<uint64_t>(frameSize), outputLength - frameStart));
+  auto target = frameStart + frameLength;
+  while (produced < target) {
+    if (blockRemaining == 0 && !readBlockHeader(ec)) {
+      return false;
+    }
+    auto before = produced;
+    if (!(blockType == blockUncompressed ? copyUncompressed(target, ec) : decodeBlock(target, ec))) {
+      return false;
+    }
+    blockRemaining -= static_cast<uint32_t>(produced - before);
+  }
+  // every frame ends on a 16-bit boundary of the bit stream
+  if (bitsLeft > 0 && !ensure(16)) {
+    return fail(ec, L"truncated frame");
+  }
+  if ((bitsLeft & 15) != 0) {
+    remove(bitsLeft & 15);
+  }
+  auto f = frame.data();
+  memcpy(f, window.data() + (static_cast<uint32_t>(frameStart) & (windowSize - 1)), frameLength);
+  // undo the E8 call translation, only applied to the first 32768 frames and never the last 10 bytes
+  if (intelStarted && intelFileSize != 0 && frameIndex < 32768 && frameLength > 10) {
+    auto curpos = static_cast<int32_t>(frameStart);
+    for (uint32_t i = 0; i < frameLength - 10;) {
+      if (f[i] != 0xE8) {
+        i++;
+        curpos++;
+        continue;
+      }
+      auto absOffset = bela::cast_fromle<int32_t>(f + i + 1);
+      if (absOffset >= -curpos && absOffset < intelFileSize) {
+        auto relOffset = absOffset >= 0 ? absOffset - curpos : absOffset + intelFileSize;
+        auto u = static_cast<uint32_t>(relOffset);
+        f[i + 1] = static_cast<uint8_t>(u);
+        f[i + 2] = static_cast<uint8_t>(u >> 8);
+        f[i + 3] = static_cast<uint8_t>(u >> 16);
+        f[i + 4] = static_cast<uint8_t>(u >> 24);
+      }
+      i += 5;
+      curpos += 5;
+    }
+  }
+  frameStart += frameLength;
+  frameIndex++;
+  data = f;
+  len = frameLength;
+  return true;
+}
+
+std::unique_ptr<folderDecoder> NewLZXDecoder(blockReader &br, uint32_t windowBits, uint64_t outputLength,
+                                             bela::error_code &ec) {
+  auto d = std::make_unique<lzxDecoder>(br, windowBits, outputLength);
+  if (!d->Initialize(ec)) {
+    return nullptr;
+  }
+  return d;
+}
+
+} // namespace baulk::archive::cab
@@ -0,0 +1,91 @@
+///
+#include "cabinternal.hpp"
+#include <zlib-ng.h>
+
+namespace baulk::archive::cab {
+// MSZIP: every block is 'CK' followed by a raw deflate stream whose history is the previous block
+class mszipDecoder : public folderDecoder {
+public:
+  mszipDecoder(blockReader &br_) : br(br_) {}
+  ~mszipDecoder() override {
+    if (initialized) {
+      zng_inflateEnd(&zs);
+    }
+  }
+  bool Initialize(bela::error_code &ec) {
+    memset(&zs, 0, sizeof(zs));
+    if (auto zerr = zng_inflateInit2(&zs, -MAX_WBITS); zerr != Z_OK) {
+      ec = bela::make_error_code(ErrGeneral, bela::encode_into<char, wchar_t>(zng_zError(zerr)));
+      return false;
+    }
+    initialized = true;
+    frames[0].grow(frameSize);
+    frames[1].grow(frameSize);
+    return true;
+  }
+  bool Next(const uint8_t *&data, size_t &len, bela::error_code &ec) override {
+    uint32_t uncompressed = 0;
+    if (!br.Next(block, uncompressed, ec)) {
+      if (ec == ErrEnded) {
+        ec.clear();
+        len = 0;
+        return true;
+      }
+      return false;
+    }
+    if (block.size() < 2 || block[0] != 'C' || block[1] != 'K') {
+      ec = bela::make_error_code(ErrGeneral, L"cab: bad MSZIP block signature");
+      return false;
+    }
+    auto &out = frames[current];
+    const auto &prev = frames[current ^ 1];
+    zng_inflateReset(&zs);
+    if (prev.size() != 0) {
+      if (auto zerr = zng_inflateSetDictionary(&zs, prev.data(), static_cast<uint32_t>(prev.size())); zerr != Z_OK) {
+        ec = bela::make_error_code(ErrGeneral, L"cab: MSZIP dictionary ",
+                                   bela::encode_into<char, wchar_t>(zng_zError(zerr)));
+        return false;
+      }
+    }
+    zs.next_in = block.data() + 2;
+    zs.avail_in = static_cast<uint32_t>(block.size() - 2);
+    zs.next_out = out.data();
+    zs.avail_out = frameSize;
+    auto zerr = zng_inflate(&zs, Z_FINISH);
+    if (zerr == Z_OK || zerr == Z_BUF_ERROR) {
+      ec = bela::make_error_code(ErrGeneral, L"cab: MSZIP block truncated");
+      return false;
+    }
+    if (zerr != Z_STREAM_END) {
+      ec = bela::make_error_code(ErrGeneral, L"cab: MSZIP ", bela::encode_into<char, wchar_t>(zng_zError(zerr)));
+      return false;
+    }
+    out.size() = frameSize - zs.avail_out;
+    if (out.size() != uncompressed) {
+      ec = bela::make_error_code(ErrGeneral, L"cab: MSZIP block size mismatch");
+      return false;
+    }
+    data = out.data();
+    len = out.size();
+    current ^= 1;
+    return true;
+  }
+
+private:
+  blockReader &br;
+  zng_stream zs;
+  Buffer block;
+  Buffer frames[2];
+  size_t current{0};
+  bool initialized{false};
+};
+
+std::unique_ptr<folderDecoder> NewMSZIPDecoder(blockReader &br, bela::error_code &ec) {
+  auto d = std::make_unique<mszipDecoder>(br);
+  if (!d->Initialize(ec)) {
+    return nullptr;
+  }
+  return d;
+}
+
+} // namespace baulk::archive::cab
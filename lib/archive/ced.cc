@@ -69,16 +69,88 @@ inline std::wstring encode_from_codepage(std::string_view name, int codePage = C
   return output;
 }
 
-inline std::wstring encode_into_native(std::string_view filename, bool always_utf8) {
-  if (always_utf8) {
-    return bela::encode_into<char, wchar_t>(filename);
+// encode_from_codepage_strict: false when name is not valid in codePage
+inline bool encode_from_codepage_strict(std::string_view name, uint32_t codePage, std::wstring &output) {
+  auto sz = MultiByteToWideChar(codePage, MB_ERR_INVALID_CHARS, name.data(), (int)name.size(), nullptr, 0);
+  if (sz == 0) {
+    if (GetLastError() != ERROR_INVALID_FLAGS) {
+      return false;
+    }
+    // ISO-2022, HZ and a few others do not accept MB_ERR_INVALID_CHARS
+    output = encode_from_codepage(name, codePage);
+    return true;
+  }
+  output.resize(sz);
+  MultiByteToWideChar(codePage, MB_ERR_INVALID_CHARS, name.data(), (int)name.size(), output.data(), sz);
+  return true;
+}
+
+inline bool is_ascii(std::string_view name) {
+  for (const auto c : name) {
+    if (static_cast<uint8_t>(c) >= 0x80) {
+      return false;
+    }
   }
+  return true;
+}
+
+// HZ and ISO-2022 code pages are 7-bit, their escape sequences switch an ASCII looking name into double bytes
+constexpr bool is_7bit_codepage(uint32_t codePage) {
+  return codePage == 52936 || codePage == 50225 || codePage == 50227;
+}
+
+inline bool has_shift_sequence(std::string_view name) {
+  return name.find('\x1b') != std::string_view::npos || name.find("~{") != std::string_view::npos;
+}
+
+// reliable detections that must agree before a code page is trusted for the whole archive
+constexpr int codePageAgreements = 3;
+
+std::wstring NameDecoder::detect(std::string_view name) {
+  detections++;
   bool is_reliable = false;
   int bytes_consumed = 0;
-  auto e = CompactEncDet::DetectEncoding(filename.data(), static_cast<int>(filename.size()), nullptr, nullptr, nullptr,
+  auto e = CompactEncDet::DetectEncoding(name.data(), static_cast<int>(name.size()), nullptr, nullptr, nullptr,
                                          UNKNOWN_ENCODING, UNKNOWN_LANGUAGE, CompactEncDet::WEB_CORPUS, false,
                                          &bytes_consumed, &is_reliable);
-  return encode_from_codepage(filename, codePageSearch(e));
+  auto cp = codePageSearch(e);
+  if (is_reliable && cp != CP_ACP) {
+    if (cp == candidate) {
+      agreements++;
+    } else {
+      candidate = cp;
+      agreements = 1;
+    }
+    if (agreements >= codePageAgreements) {
+      codePage = candidate;
+    }
+  }
+  return encode_from_codepage(name, cp);
+}
+
+std::wstring NameDecoder::Decode(std::string_view name, bool always_utf8) {
+  if (always_utf8) {
+    return bela::encode_into<char, wchar_t>(name);
+  }
+  // every 8-bit code page agrees on ASCII
+  if (is_ascii(name) && !is_7bit_codepage(codePage) && !is_7bit_codepage(candidate) && !has_shift_sequence(name)) {
+    return std::wstring(name.begin(), name.end());
+  }
+  if (codePage != 0) {
+    std::wstring output;
+    if (encode_from_codepage_strict(name, codePage, output)) {
+      return output;
+    }
+    // the archive is not as uniform as it looked, detect again
+    codePage = 0;
+    agreements = 0;
+  }
+  return detect(name);
+}
+
+inline std::wstring encode_into_native(std::string_view filename, bool always_utf8) {
+  NameDecoder decoder;
+  return decoder.Decode(filename, always_utf8);
 }
 
 std::wstring EncodeToNativePath(std::string_view filename, bool always_utf8) {
@@ -138,10 +210,17 @@ bool IsHarmfulPath(std::string_view child_path) { return is_harmful_path(child_p
 
 std::optional<std::filesystem::path> JoinSanitizeFsPath(const std::filesystem::path &root, std::string_view child_path,
                                                         bool always_utf8, std::wstring &encoded_path) {
+  NameDecoder decoder;
+  return JoinSanitizeFsPath(root, child_path, always_utf8, decoder, encoded_path);
+}
+
+std::optional<std::filesystem::path> JoinSanitizeFsPath(const std::filesystem::path &root, std::string_view child_path,
+                                                        bool always_utf8, NameDecoder &decoder,
+                                                        std::wstring &encoded_path) {
   if (is_harmful_path(child_path)) {
     return std::nullopt;
   }
-  encoded_path = encode_into_native(child_path, always_utf8);
+  encoded_path = decoder.Decode(child_path, always_utf8);
   constexpr std::wstring_view excludeChars = L"\r\n<>:\"|*?";
   if (encoded_path.find_first_of(excludeChars) != std::wstring::npos) {
     bela::StrReplaceAll(
@@ -0,0 +1,255 @@
+///
+#include <bela/io.hpp>
+#include <bela/str_cat.hpp>
+#include <baulk/allocate.hpp>
+#include <baulk/archive/delta.hpp>
+#define ZSTD_STATIC_LINKING_ONLY 1
+#include <zstd.h>
+
+namespace baulk::archive::delta {
+namespace {
+// MappedFile: read only view of a whole file, the base of a patch is referenced at any offset
+class MappedFile {
+public:
+  MappedFile() = default;
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  ~MappedFile() {
+    if (view != nullptr) {
+      UnmapViewOfFile(view);
+    }
+    if (mapping != nullptr) {
+      CloseHandle(mapping);
+    }
+    if (fd != INVALID_HANDLE_VALUE) {
+      CloseHandle(fd);
+    }
+  }
+  bool Open(const fs::path &file, bela::error_code &ec) {
+    fd = CreateFileW(file.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                     nullptr);
+    if (fd == INVALID_HANDLE_VALUE) {
+      ec = bela::make_system_error_code(L"CreateFileW() ");
+      return false;
+    }
+    auto n = bela::io::Size(fd, ec);
+    if (n < 0) {
+      return false;
+    }
+    if (n == 0) {
+      return true;
+    }
+    if ((mapping = CreateFileMappingW(fd, nullptr, PAGE_READONLY, 0, 0, nullptr)) == nullptr) {
+      ec = bela::make_system_error_code(L"CreateFileMappingW() ");
+      return false;
+    }
+    if ((view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) == nullptr) {
+      ec = bela::make_system_error_code(L"MapViewOfFile() ");
+      return false;
+    }
+    size = static_cast<size_t>(n);
+    return true;
+  }
+  const void *data() const { return view; }
+  auto Size() const { return size; }
+
+private:
+  HANDLE fd{INVALID_HANDLE_VALUE};
+  HANDLE mapping{nullptr};
+  void *view{nullptr};
+  size_t size{0};
+};
+
+// OutputFile: removed unless Keep is called, a half written target is never left behind
+class OutputFile {
+public:
+  OutputFile(const OutputFile &) = delete;
+  OutputFile &operator=(const OutputFile &) = delete;
+  OutputFile(const fs::path &file_) : file(file_) {}
+  ~OutputFile() {
+    if (fd == INVALID_HANDLE_VALUE) {
+      return;
+    }
+    CloseHandle(fd);
+    if (!kept) {
+      DeleteFileW(file.c_str());
+    }
+  }
+  bool Open(bela::error_code &ec) {
+    fd = CreateFileW(file.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fd == INVALID_HANDLE_VALUE) {
+      ec = bela::make_system_error_code(L"CreateFileW() ");
+      return false;
+    }
+    return true;
+  }
+  bool Write(const void *data, size_t len, bela::error_code &ec) {
+    return len == 0 || bela::io::WriteFull(fd, {static_cast<const uint8_t *>(data), len}, ec);
+  }
+  void Keep() { kept = true; }
+
+private:
+  fs::path file;
+  HANDLE fd{INVALID_HANDLE_VALUE};
+  bool kept{false};
+};
+
+inline bela::error_code zstd_error_code(std::wstring_view fn, size_t r) {
+  return bela::make_error_code(ErrExtractGeneral, fn, L": ", bela::encode_into<char, wchar_t>(ZSTD_getErrorName(r)));
+}
+
+// pages of a mapped file are read on first touch, a read error there arrives as EXCEPTION_IN_PAGE_ERROR
+inline int view_fault(DWORD code) {
+  return code == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH;
+}
+
+bool decompress_stream(ZSTD_DCtx *dctx, ZSTD_outBuffer *o, ZSTD_inBuffer *in, size_t &r) {
+  __try {
+    r = ZSTD_decompressStream(dctx, o, in);
+  } __except (view_fault(GetExceptionCode())) {
+    return false;
+  }
+  return true;
+}
+
+bool compress_stream(ZSTD_CCtx *cctx, ZSTD_outBuffer *o, ZSTD_inBuffer *in, size_t &r) {
+  __try {
+    r = ZSTD_compressStream2(cctx, o, in, ZSTD_e_end);
+  } __except (view_fault(GetExceptionCode())) {
+    return false;
+  }
+  return true;
+}
+
+// window_log: the window reaches from the end of target back to the start of base
+inline int window_log(size_t base, size_t target) {
+  auto n = static_cast<uint64_t>(base) + target;
+  int log = ZSTD_WINDOWLOG_MIN;
+  while (log < ZSTD_WINDOWLOG_MAX && (1ULL << log) < n) {
+    log++;
+  }
+  return log;
+}
+} // namespace
+
+bool ApplyPatch(const fs::path &base, const fs::path &patch, const fs::path &target, bela::error_code &ec) {
+  MappedFile b;
+  if (!b.Open(base, ec)) {
+    return false;
+  }
+  auto fd = CreateFileW(patch.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                        nullptr);
+  if (fd == INVALID_HANDLE_VALUE) {
+    ec = bela::make_system_error_code(L"CreateFileW() ");
+    return false;
+  }
+  auto closer = bela::finally([&] { CloseHandle(fd); });
+  OutputFile out(target);
+  if (!out.Open(ec)) {
+    return false;
+  }
+  auto dctx = ZSTD_createDCtx_advanced(ZSTD_customMem{
+      .customAlloc = baulk::mem::allocate_simple, .customFree = baulk::mem::deallocate_simple, .opaque = nullptr});
+  if (dctx == nullptr) {
+    ec = bela::make_error_code(ErrExtractGeneral, L"ZSTD_createDCtx() out of memory");
+    return false;
+  }
+  auto freer = bela::finally([&] { ZSTD_freeDCtx(dctx); });
+  ZSTD_DCtx_setParameter(dctx, ZSTD_d_windowLogMax, ZSTD_WINDOWLOG_MAX);
+  if (auto r = ZSTD_DCtx_refPrefix(dctx, b.data(), b.Size()); ZSTD_isError(r) != 0) {
+    ec = zstd_error_code(L"ZSTD_DCtx_refPrefix", r);
+    return false;
+  }
+  std::vector<uint8_t> inb(ZSTD_DStreamInSize());
+  std::vector<uint8_t> outb(ZSTD_DStreamOutSize());
+  size_t remaining = 1;
+  for (;;) {
+    DWORD dwread = 0;
+    if (ReadFile(fd, inb.data(), static_cast<DWORD>(inb.size()), &dwread, nullptr) != TRUE) {
+      ec = bela::make_system_error_code(L"ReadFile() ");
+      return false;
+    }
+    if (dwread == 0) {
+      break;
+    }
+    ZSTD_inBuffer in{inb.data(), dwread, 0};
+    for (;;) {
+      ZSTD_outBuffer o{outb.data(), outb.size(), 0};
+      if (!decompress_stream(dctx, &o, &in, remaining)) {
+        ec = bela::make_error_code(ErrExtractGeneral, L"read error in mapped view of '", base.filename().native(),
+                                   L"'");
+        return false;
+      }
+      if (ZSTD_isError(remaining) != 0) {
+        ec = zstd_error_code(L"ZSTD_decompressStream", remaining);
+        return false;
+      }
+      if (!out.Write(outb.data(), o.pos, ec)) {
+        return false;
+      }
+      // a full output buffer may leave decoded data behind
+      if (in.pos == in.size && o.pos < o.size) {
+        break;
+      }
+    }
+  }
+  if (remaining != 0) {
+    ec = bela::make_error_code(ErrExtractGeneral, L"patch '", patch.filename().native(), L"' is truncated");
+    return false;
+  }
+  out.Keep();
+  return true;
+}
+
+bool MakePatch(const fs::path &base, const fs::path &target, const fs::path &patch, int level, bela::error_code &ec) {
+  MappedFile b;
+  MappedFile t;
+  if (!b.Open(base, ec) || !t.Open(target, ec)) {
+    return false;
+  }
+  OutputFile out(patch);
+  if (!out.Open(ec)) {
+    return false;
+  }
+  auto cctx = ZSTD_createCCtx_advanced(ZSTD_customMem{
+      .customAlloc = baulk::mem::allocate_simple, .customFree = baulk::mem::deallocate_simple, .opaque = nullptr});
+  if (cctx == nullptr) {
+    ec = bela::make_error_code(ErrExtractGeneral, L"ZSTD_createCCtx() out of memory");
+    return false;
+  }
+  auto freer = bela::finally([&] { ZSTD_freeCCtx(cctx); });
+  ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, level);
+  ZSTD_CCtx_setParameter(cctx, ZSTD_c_checksumFlag, 1);
+  ZSTD_CCtx_setParameter(cctx, ZSTD_c_windowLog, window_log(b.Size(), t.Size()));
+  // long distance matching finds the base content again however far it moved
+  ZSTD_CCtx_setParameter(cctx, ZSTD_c_enableLongDistanceMatching, 1);
+  ZSTD_CCtx_setPledgedSrcSize(cctx, t.Size());
+  if (auto r = ZSTD_CCtx_refPrefix(cctx, b.data(), b.Size()); ZSTD_isError(r) != 0) {
+    ec = zstd_error_code(L"ZSTD_CCtx_refPrefix", r);
+    return false;
+  }
+  std::vector<uint8_t> outb(ZSTD_CStreamOutSize());
+  ZSTD_inBuffer in{t.data(), t.Size(), 0};
+  for (;;) {
+    ZSTD_outBuffer o{outb.data(), outb.size(), 0};
+    size_t remaining = 0;
+    if (!compress_stream(cctx, &o, &in, remaining)) {
+      ec = bela::make_error_code(ErrExtractGeneral, L"read error in mapped view of '", base.filename().native(),
+                                 L"' or '", target.filename().native(), L"'");
+      return false;
+    }
+    if (ZSTD_isError(remaining) != 0) {
+      ec = zstd_error_code(L"ZSTD_compressStream2", remaining);
+      return false;
+    }
+    if (!out.Write(outb.data(), o.pos, ec)) {
+      return false;
+    }
+    if (remaining == 0) {
+      break;
+    }
+  }
+  out.Keep();
+  return true;
+}
+} // namespace baulk::archive::delta
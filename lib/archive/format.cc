@@ -3,6 +3,8 @@
 #include <bela/pe.hpp>
 #include <baulk/archive.hpp>
 #include <utility>
+#include <array>
+#include <bit>
 #include "tar/tarinternal.hpp"
 
 namespace baulk::archive {
@@ -122,64 +124,107 @@ bool is_msi_archive(const bela::bytes_view &bv) {
   return true;
 }
 
-file_format_t analyze_format_internal(const bela::bytes_view &bv) {
-  if (is_zip_magic(bv.data(), bv.size())) {
-    return file_format_t::zip;
-  }
-  if (bv.starts_bytes_with(xzMagic)) {
-    return file_format_t::xz;
-  }
-  if (bv.starts_bytes_with(gzMagic)) {
-    return file_format_t::gz;
-  }
-  if (bv.starts_bytes_with(bz2Magic)) {
-    return file_format_t::bz2;
-  }
-  if (bv.starts_bytes_with(lzMagic)) {
-    return file_format_t::lz;
-  }
-  auto zstdmagic = bv.cast_fromle<uint32_t>(0);
-  if (zstdmagic == 0xFD2FB528U || (zstdmagic & 0xFFFFFFF0) == 0x184D2A50) {
-    return file_format_t::zstd;
-  }
-  if (bv.starts_with("MZ") && bv.size() >= 0x3c + 4) {
-    if (auto off = bela::cast_fromle<uint32_t>(bv.data() + 0x3c); bv.subview(off).starts_bytes_with(PEMagic)) {
-      return file_format_t::exe;
+constexpr const uint8_t rpmMagic[] = {0xED, 0xAB, 0xEE, 0xDB};
+constexpr const uint8_t zMagic[] = {0x1F, 0x9D};
+
+using sniff_match_t = bool (*)(const bela::bytes_view &bv);
+// sniff_rule: lead_lo-lead_hi is the range of first bytes the rule can match, rules without a fixed lead byte use
+// 0x00-0xFF
+struct sniff_rule {
+  file_format_t t;
+  uint8_t lead_lo;
+  uint8_t lead_hi;
+  sniff_match_t match;
+};
+
+// rules are tried in table order, the first match wins
+constexpr sniff_rule sniff_rules[] = {
+    {file_format_t::zip, 0x50, 0x50, [](const bela::bytes_view &bv) { return is_zip_magic(bv.data(), bv.size()); }},
+    {file_format_t::xz, 0xFD, 0xFD, [](const bela::bytes_view &bv) { return bv.starts_bytes_with(xzMagic); }},
+    {file_format_t::gz, 0x1F, 0x1F, [](const bela::bytes_view &bv) { return bv.starts_bytes_with(gzMagic); }},
+    {file_format_t::z, 0x1F, 0x1F, [](const bela::bytes_view &bv) { return bv.starts_bytes_with(zMagic); }},
+    {file_format_t::bz2, 0x42, 0x42, [](const bela::bytes_view &bv) { return bv.starts_bytes_with(bz2Magic); }},
+    {file_format_t::lz, 0x4C, 0x4C, [](const bela::bytes_view &bv) { return bv.starts_bytes_with(lzMagic); }},
+    {file_format_t::zstd, 0x28, 0x28,
+     [](const bela::bytes_view &bv) { return bv.cast_fromle<uint32_t>(0) == 0xFD2FB528U; }},
+    // Zstandard/LZ4 skippable frames
+    {file_format_t::zstd, 0x50, 0x5F,
+     [](const bela::bytes_view &bv) { return (bv.cast_fromle<uint32_t>(0) & 0xFFFFFFF0) == 0x184D2A50; }},
+    {file_format_t::exe, 'M', 'M',
+     [](const bela::bytes_view &bv) {
+       return bv.starts_with("MZ") && bv.size() >= 0x3c + 4 &&
+              bv.subview(bela::cast_fromle<uint32_t>(bv.data() + 0x3c)).starts_bytes_with(PEMagic);
+     }},
+    {file_format_t::_7z, '7', '7', [](const bela::bytes_view &bv) { return bv.starts_bytes_with(k7zSignature); }},
+    {file_format_t::rar, 'R', 'R',
+     [](const bela::bytes_view &bv) {
+       return bv.starts_bytes_with(rarSignature) || bv.starts_bytes_with(rar4Signature);
+     }},
+    {file_format_t::wim, 'M', 'M', [](const bela::bytes_view &bv) { return bv.starts_bytes_with(wimMagic); }},
+    {file_format_t::cab, 'M', 'M', [](const bela::bytes_view &bv) { return bv.starts_bytes_with(cabMagic); }},
+    {file_format_t::dmg, 'k', 'k', [](const bela::bytes_view &bv) { return bv.starts_bytes_with(dmgSignature); }},
+    {file_format_t::deb, '!', '!', [](const bela::bytes_view &bv) { return bv.starts_bytes_with(debMagic); }},
+    {file_format_t::rpm, 0xED, 0xED, [](const bela::bytes_view &bv) { return bv.starts_bytes_with(rpmMagic); }},
+    {file_format_t::xar, 'x', 'x', [](const bela::bytes_view &bv) { return bv.starts_bytes_with(xarSignature); }},
+    {file_format_t::nsis, 0x00, 0xFF,
+     [](const bela::bytes_view &bv) { return bv.match_with(4, nsisSignature, std::size(nsisSignature)); }},
+    {file_format_t::tar, 0x00, 0xFF,
+     [](const bela::bytes_view &bv) {
+       return bv.size() >= 512 && tar::getFormat(*bv.unchecked_cast<tar::ustar_header>()) != tar::FormatUnknown;
+     }},
+    {file_format_t::msi, 0xD0, 0xD0, is_msi_archive},
+};
+static_assert(std::size(sniff_rules) <= 64, "sniff rule masks are 64 bits wide");
+
+// sniff_masks: for every first byte, the rules that can match it
+constexpr auto sniff_masks = [] {
+  std::array<uint64_t, 256> masks{};
+  for (size_t i = 0; i < std::size(sniff_rules); i++) {
+    for (auto b = static_cast<size_t>(sniff_rules[i].lead_lo); b <= sniff_rules[i].lead_hi; b++) {
+      masks[b] |= 1ULL << i;
     }
   }
-  if (bv.starts_bytes_with(k7zSignature)) {
-    return file_format_t::_7z;
-  }
-  if (bv.starts_bytes_with(rarSignature) || bv.starts_bytes_with(rar4Signature)) {
-    return file_format_t::rar;
-  }
-  if (bv.starts_bytes_with(wimMagic)) {
-    return file_format_t::wim;
-  }
-  if (bv.starts_bytes_with(cabMagic)) {
-    return file_format_t::cab;
-  }
-  if (bv.starts_bytes_with(dmgSignature)) {
-    return file_format_t::dmg;
-  }
-  if (bv.starts_bytes_with(debMagic)) {
-    return file_format_t::deb;
-  }
-  if (bv.match_with(4, nsisSignature, std::size(nsisSignature))) {
-    return file_format_t::nsis;
+  return masks;
+}();
+
+file_format_t analyze_format_internal(const bela::bytes_view &bv) {
+  if (bv.size() == 0) {
+    return file_format_t::none;
   }
-  if (bv.size() >= 512) {
-    if (auto uh = bv.unchecked_cast<tar::ustar_header>(); getFormat(*uh) != tar::FormatUnknown) {
-      return file_format_t::tar;
+  for (auto m = sniff_masks[bv[0]]; m != 0; m &= m - 1) {
+    if (const auto &r = sniff_rules[std::countr_zero(m)]; r.match(bv)) {
+      return r.t;
     }
   }
-  if (is_msi_archive(bv)) {
-    return file_format_t::msi;
-  }
   return file_format_t::none;
 }
 
-constexpr size_t magic_size = 1024;
+// headers, COFF file header and section table of common PE files fit in the first read
+constexpr size_t magic_size = 4096;
+// bytes needed to identify an overlay archive
+constexpr size_t overlay_magic_size = 1024;
+
+// pe_overlay_offset: end of the last section's raw data, read from the section table only. Returns -1 when the table
+// is not fully inside bv
+int64_t pe_overlay_offset(const bela::bytes_view &bv) {
+  auto signoff = static_cast<size_t>(bv.cast_fromle<uint32_t>(0x3c));
+  auto fh = signoff + 4; // IMAGE_FILE_HEADER
+  if (fh + 20 > bv.size()) {
+    return -1;
+  }
+  auto sections = bv.cast_fromle<uint16_t>(fh + 2);
+  auto table = fh + 20 + bv.cast_fromle<uint16_t>(fh + 16);
+  if (table + static_cast<size_t>(sections) * 40 > bv.size()) {
+    return -1;
+  }
+  int64_t overlay = 0;
+  for (size_t i = 0; i < sections; i++) {
+    auto sh = table + i * 40; // IMAGE_SECTION_HEADER
+    auto end = static_cast<int64_t>(bv.cast_fromle<uint32_t>(sh + 20)) + bv.cast_fromle<uint32_t>(sh + 16);
+    overlay = (std::max)(overlay, end);
+  }
+  return overlay;
+}
 
 bool CheckFormat(bela::io::FD &fd, file_format_t &afmt, int64_t &offset, bela::error_code &ec) {
   uint8_t magicBytes[magic_size] = {0};
@@ -187,20 +232,36 @@ bool CheckFormat(bela::io::FD &fd, file_format_t &afmt, int64_t &offset, bela::e
   if (!fd.ReadAt(magicBytes, 0, outlen, ec)) {
     return false;
   }
-  if (afmt = analyze_format_internal(bela::bytes_view(magicBytes, static_cast<size_t>(outlen)));
-      afmt != file_format_t::exe) {
+  bela::bytes_view bv(magicBytes, static_cast<size_t>(outlen));
+  if (afmt = analyze_format_internal(bv); afmt != file_format_t::exe) {
     return true;
   }
-  bela::pe::File pefile;
-  if (!pefile.NewFile(fd.NativeFD(), bela::SizeUnInitialized, ec)) {
+  auto overlay = pe_overlay_offset(bv);
+  if (overlay < 0) {
+    // unusually large section table, take the slow path
+    bela::pe::File pefile;
+    if (!pefile.NewFile(fd.NativeFD(), bela::SizeUnInitialized, ec)) {
+      return false;
+    }
+    overlay = pefile.OverlayOffset();
+  }
+  auto size = fd.Size(ec);
+  if (size == bela::SizeUnInitialized) {
     return false;
   }
-  if (std::cmp_less(pefile.OverlayLength(), magic_size)) {
+  if (std::cmp_less(size - overlay, overlay_magic_size)) {
     // EXE
     return true;
   }
-  offset = pefile.OverlayOffset();
-  if (!fd.ReadAt(magicBytes, offset, outlen, ec)) {
+  offset = overlay;
+  // small stubs: the overlay head is already in the first read
+  if (std::cmp_less_equal(overlay + static_cast<int64_t>(overlay_magic_size), outlen)) {
+    if (auto nfmt = analyze_format_internal(bv.subview(static_cast<size_t>(overlay))); nfmt != file_format_t::none) {
+      afmt = nfmt;
+    }
+    return true;
+  }
+  if (!fd.ReadAt({magicBytes, overlay_magic_size}, offset, outlen, ec)) {
     return false;
   }
   if (auto nfmt = analyze_format_internal(bela::bytes_view(magicBytes, static_cast<size_t>(outlen)));
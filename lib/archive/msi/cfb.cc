@@ -0,0 +1,310 @@
+///
+#include "msiinternal.hpp"
+
+namespace baulk::archive::msi {
+namespace {
+constexpr wchar_t mimeChar(uint32_t x) {
+  if (x < 10) {
+    return static_cast<wchar_t>(L'0' + x);
+  }
+  if (x < 36) {
+    return static_cast<wchar_t>(L'A' + x - 10);
+  }
+  if (x < 62) {
+    return static_cast<wchar_t>(L'a' + x - 36);
+  }
+  return x == 62 ? L'.' : L'_';
+}
+
+// memorySource: streams below the mini stream cutoff are copied out of the mini stream
+class memorySource : public cab::Source {
+public:
+  memorySource(std::vector<uint8_t> &&data_) : data(std::move(data_)) {}
+  bool ReadAt(void *buffer, size_t len, int64_t offset, bela::error_code &ec) const override {
+    if (offset < 0 || static_cast<uint64_t>(offset) + len > data.size()) {
+      ec = bela::make_error_code(ErrGeneral, L"msi: read past the end of stream");
+      return false;
+    }
+    memcpy(buffer, data.data() + offset, len);
+    return true;
+  }
+  int64_t Size() const override { return static_cast<int64_t>(data.size()); }
+
+private:
+  std::vector<uint8_t> data;
+};
+
+// streamSource: maps stream offsets to package offsets through the sector chain, contiguous sectors are read at once
+class streamSource : public cab::Source {
+public:
+  streamSource(std::shared_ptr<cab::Source> source_, std::vector<uint32_t> &&sectors_, uint32_t shift_,
+               uint64_t size_)
+      : source(std::move(source_)), sectors(std::move(sectors_)), shift(shift_), size(size_) {}
+  bool ReadAt(void *buffer, size_t len, int64_t offset, bela::error_code &ec) const override {
+    if (offset < 0 || static_cast<uint64_t>(offset) + len > size) {
+      ec = bela::make_error_code(ErrGeneral, L"msi: read past the end of stream");
+      return false;
+    }
+    auto p = static_cast<uint8_t *>(buffer);
+    auto sectorSize = static_cast<uint64_t>(1) << shift;
+    auto pos = static_cast<uint64_t>(offset);
+    while (len > 0) {
+      auto index = static_cast<size_t>(pos >> shift);
+      auto inner = pos & (sectorSize - 1);
+      auto run = static_cast<size_t>(1);
+      while (index + run < sectors.size() && sectors[index + run] == sectors[index] + run &&
+             run * sectorSize - inner < len) {
+        run++;
+      }
+      auto n = static_cast<size_t>((std::min)(static_cast<uint64_t>(len), run * sectorSize - inner));
+      auto at = (static_cast<int64_t>(sectors[index]) + 1) * static_cast<int64_t>(sectorSize) +
+                static_cast<int64_t>(inner);
+      if (!source->ReadAt(p, n, at, ec)) {
+        return false;
+      }
+      p += n;
+      pos += n;
+      len -= n;
+    }
+    return true;
+  }
+  int64_t Size() const override { return static_cast<int64_t>(size); }
+
+private:
+  std::shared_ptr<cab::Source> source;
+  std::vector<uint32_t> sectors;
+  uint32_t shift;
+  uint64_t size;
+};
+} // namespace
+
+std::wstring DecodeStreamName(std::wstring_view name) {
+  std::wstring decoded;
+  decoded.reserve(name.size() * 2);
+  for (auto c : name) {
+    uint32_t ch = c;
+    if (ch == 0x4840) {
+      decoded.push_back(L'!');
+      continue;
+    }
+    if (ch >= 0x3800 && ch < 0x4800) {
+      ch -= 0x3800;
+      decoded.push_back(mimeChar(ch & 0x3F));
+      decoded.push_back(mimeChar((ch >> 6) & 0x3F));
+      continue;
+    }
+    if (ch >= 0x4800 && ch < 0x4840) {
+      decoded.push_back(mimeChar(ch - 0x4800));
+      continue;
+    }
+    decoded.push_back(c);
+  }
+  return decoded;
+}
+
+bool compoundFile::chain(uint32_t start, const std::vector<uint32_t> &table, std::vector<uint32_t> &sectors,
+                         bela::error_code &ec) const {
+  sectors.clear();
+  for (auto s = start; s != endOfChain;) {
+    if (s > maxRegularSector || s >= table.size() || sectors.size() >= table.size()) {
+      ec = bela::make_error_code(ErrGeneral, L"msi: broken sector chain at ", s);
+      return false;
+    }
+    sectors.emplace_back(s);
+    s = table[s];
+  }
+  return true;
+}
+
+bool compoundFile::readChain(uint32_t start, uint64_t size, std::vector<uint8_t> &data, bela::error_code &ec) const {
+  std::vector<uint32_t> sectors;
+  if (!chain(start, fat, sectors, ec)) {
+    return false;
+  }
+  if ((static_cast<uint64_t>(sectors.size()) << sectorShift) < size) {
+    ec = bela::make_error_code(ErrGeneral, L"msi: stream is longer than its sector chain");
+    return false;
+  }
+  data.resize(static_cast<size_t>(size));
+  streamSource ss(source, std::move(sectors), sectorShift, size);
+  return size == 0 || ss.ReadAt(data.data(), data.size(), 0, ec);
+}
+
+bool compoundFile::Open(std::shared_ptr<cab::Source> source_, bela::error_code &ec) {
+  source = std::move(source_);
+  uint8_t hdr[cfbHeaderSize];
+  if (source->Size() < static_cast<int64_t>(cfbHeaderSize) || !source->ReadAt(hdr, sizeof(hdr), 0, ec) ||
+      memcmp(hdr, cfbSignature, sizeof(cfbSignature)) != 0 || bela::cast_fromle<uint16_t>(hdr + 0x1C) != 0xFFFE) {
+    ec = bela::make_error_code(ErrGeneral, L"msi: not a compound file");
+    return false;
+  }
+  auto major = bela::cast_fromle<uint16_t>(hdr + 0x1A);
+  sectorShift = bela::cast_fromle<uint16_t>(hdr + 0x1E);
+  miniSectorShift = bela::cast_fromle<uint16_t>(hdr + 0x20);
+  if ((sectorShift != 9 && sectorShift != 12) || miniSectorShift != 6) {
+    ec = bela::make_error_code(ErrGeneral, L"msi: bad sector size 2^", sectorShift);
+    return false;
+  }
+  auto numFat = bela::cast_fromle<uint32_t>(hdr + 0x2C);
+  auto firstDir = bela::cast_fromle<uint32_t>(hdr + 0x30);
+  miniCutoff = bela::cast_fromle<uint32_t>(hdr + 0x38);
+  auto firstMiniFat = bela::cast_fromle<uint32_t>(hdr + 0x3C);
+  auto numMiniFat = bela::cast_fromle<uint32_t>(hdr + 0x40);
+  auto difat = bela::cast_fromle<uint32_t>(hdr + 0x44);
+  auto numDifat = bela::cast_fromle<uint32_t>(hdr + 0x48);
+  auto sectorSize = static_cast<size_t>(1) << sectorShift;
+  auto maxSectors = static_cast<uint64_t>(source->Size()) >> sectorShift;
+  if (numFat > maxSectors || numMiniFat > maxSectors || numDifat > maxSectors) {
+    ec = bela::make_error_code(ErrGeneral, L"msi: bad compound file header");
+    return false;
+  }
+  std::vector<uint32_t> fatSectors;
+  for (size_t i = 0; i < 109 && fatSectors.size() < numFat; i++) {
+    fatSectors.emplace_back(bela::cast_fromle<uint32_t>(hdr + 0x4C + i * 4));
+  }
+  std::vector<uint8_t> sector(sectorSize);
+  for (uint32_t i = 0; i < numDifat && fatSectors.size() < numFat && difat <= maxRegularSector; i++) {
+    if (!source->ReadAt(sector.data(), sectorSize, sectorOffset(difat), ec)) {
+      return false;
+    }
+    auto n = sectorSize / 4 - 1;
+    for (size_t j = 0; j < n && fatSectors.size() < numFat; j++) {
+      fatSectors.emplace_back(bela::cast_fromle<uint32_t>(sector.data() + j * 4));
+    }
+    difat = bela::cast_fromle<uint32_t>(sector.data() + n * 4);
+  }
+  if (fatSectors.size() != numFat) {
+    ec = bela::make_error_code(ErrGeneral, L"msi: incomplete sector allocation table");
+    return false;
+  }
+  std::vector<uint8_t> fatData(static_cast<size_t>(numFat) * sectorSize);
+  {
+    streamSource fs(source, std::move(fatSectors), sectorShift, fatData.size());
+    if (!fatData.empty() && !fs.ReadAt(fatData.data(), fatData.size(), 0, ec)) {
+      return false;
+    }
+  }
+  fat.resize(fatData.size() / 4);
+  for (size_t i = 0; i < fat.size(); i++) {
+    fat[i] = bela::cast_fromle<uint32_t>(fatData.data() + i * 4);
+  }
+  std::vector<uint32_t> dirSectors;
+  if (!chain(firstDir, fat, dirSectors, ec)) {
+    return false;
+  }
+  std::vector<uint8_t> dir;
+  if (!readChain(firstDir, static_cast<uint64_t>(dirSectors.size()) << sectorShift, dir, ec)) {
+    return false;
+  }
+  auto entries = dir.size() / cfbDirectoryEntrySize;
+  if (entries == 0 || dir[0x42] != objectRoot) {
+    ec = bela::make_error_code(ErrGeneral, L"msi: missing root storage");
+    return false;
+  }
+  auto entrySize = [&](const uint8_t *e) {
+    auto size = bela::cast_fromle<uint64_t>(e + 0x78);
+    // version 3 writers may leave garbage in the high half
+    return major == 3 ? (size & 0xFFFFFFFF) : size;
+  };
+  if (numMiniFat != 0) {
+    std::vector<uint8_t> miniFatData;
+    if (!readChain(firstMiniFat, static_cast<uint64_t>(numMiniFat) << sectorShift, miniFatData, ec)) {
+      return false;
+    }
+    miniFat.resize(miniFatData.size() / 4);
+    for (size_t i = 0; i < miniFat.size(); i++) {
+      miniFat[i] = bela::cast_fromle<uint32_t>(miniFatData.data() + i * 4);
+    }
+    if (!readChain(bela::cast_fromle<uint32_t>(dir.data() + 0x74), entrySize(dir.data()), miniStream, ec)) {
+      return false;
+    }
+  }
+  // the root storage children form a red-black tree, every stream of an installer database lives there
+  std::vector<bool> visited(entries, false);
+  std::vector<uint32_t> pending{bela::cast_fromle<uint32_t>(dir.data() + 0x4C)};
+  while (!pending.empty()) {
+    auto id = pending.back();
+    pending.pop_back();
+    if (id == noStream || id >= entries || visited[id]) {
+      continue;
+    }
+    visited[id] = true;
+    auto e = dir.data() + static_cast<size_t>(id) * cfbDirectoryEntrySize;
+    pending.emplace_back(bela::cast_fromle<uint32_t>(e + 0x44));
+    pending.emplace_back(bela::cast_fromle<uint32_t>(e + 0x48));
+    if (e[0x42] != objectStream) {
+      continue;
+    }
+    auto nameLength = (std::min)(static_cast<size_t>(bela::cast_fromle<uint16_t>(e + 0x40)), static_cast<size_t>(64));
+    std::wstring name;
+    for (size_t i = 0; i + 1 < nameLength; i += 2) {
+      if (auto c = static_cast<wchar_t>(bela::cast_fromle<uint16_t>(e + i)); c != 0) {
+        name.push_back(c);
+      }
+    }
+    streams.emplace_back(streamEntry{
+        .name = DecodeStreamName(name), .start = bela::cast_fromle<uint32_t>(e + 0x74), .size = entrySize(e)});
+  }
+  return true;
+}
+
+const streamEntry *compoundFile::Find(std::wstring_view name) const {
+  for (const auto &e : streams) {
+    if (e.name == name) {
+      return &e;
+    }
+  }
+  return nullptr;
+}
+
+bool compoundFile::ReadStream(const streamEntry &e, std::vector<uint8_t> &data, bela::error_code &ec) const {
+  if (e.size >= miniCutoff) {
+    return readChain(e.start, e.size, data, ec);
+  }
+  std::vector<uint32_t> sectors;
+  if (!chain(e.start, miniFat, sectors, ec)) {
+    return false;
+  }
+  auto miniSize = static_cast<size_t>(1) << miniSectorShift;
+  if (sectors.size() * miniSize < e.size) {
+    ec = bela::make_error_code(ErrGeneral, L"msi: stream is longer than its sector chain");
+    return false;
+  }
+  data.resize(static_cast<size_t>(e.size));
+  size_t pos = 0;
+  for (auto s : sectors) {
+    auto n = (std::min)(miniSize, data.size() - pos);
+    if (n == 0) {
+      break;
+    }
+    auto at = static_cast<size_t>(s) << miniSectorShift;
+    if (at + n > miniStream.size()) {
+      ec = bela::make_error_code(ErrGeneral, L"msi: mini sector out of range");
+      return false;
+    }
+    memcpy(data.data() + pos, miniStream.data() + at, n);
+    pos += n;
+  }
+  return true;
+}
+
+std::shared_ptr<cab::Source> compoundFile::OpenStream(const streamEntry &e, bela::error_code &ec) const {
+  if (e.size < miniCutoff) {
+    std::vector<uint8_t> data;
+    if (!ReadStream(e, data, ec)) {
+      return nullptr;
+    }
+    return std::make_shared<memorySource>(std::move(data));
+  }
+  std::vector<uint32_t> sectors;
+  if (!chain(e.start, fat, sectors, ec)) {
+    return nullptr;
+  }
+  if ((static_cast<uint64_t>(sectors.size()) << sectorShift) < e.size) {
+    ec = bela::make_error_code(ErrGeneral, L"msi: stream is longer than its sector chain");
+    return nullptr;
+  }
+  return std::make_shared<streamSource>(source, std::move(sectors), sectorShift, e.size);
+}
+
+} // namespace baulk::archive::msi
@@ -0,0 +1,199 @@
+///
+#include "msiinternal.hpp"
+
+namespace baulk::archive::msi {
+// https://github.com/wine-mirror/wine/blob/master/dlls/msi/string.c
+bool database::loadStrings(bela::error_code &ec) {
+  auto pe = cf->Find(L"!_StringPool");
+  auto de = cf->Find(L"!_StringData");
+  if (pe == nullptr || de == nullptr) {
+    ec = bela::make_error_code(ErrGeneral, L"msi: missing string pool");
+    return false;
+  }
+  std::vector<uint8_t> pool;
+  std::vector<uint8_t> data;
+  if (!cf->ReadStream(*pe, pool, ec) || !cf->ReadStream(*de, data, ec)) {
+    return false;
+  }
+  auto word = [&](size_t i) { return static_cast<uint32_t>(bela::cast_fromle<uint16_t>(pool.data() + i * 2)); };
+  auto entries = pool.size() / 4;
+  if (entries != 0) {
+    codePage = word(0) | ((word(1) & 0x7FFF) << 16);
+    strrefBytes = (word(1) & 0x8000) != 0 ? 3 : 2;
+  }
+  strings.reserve(entries);
+  strings.emplace_back(); // id 0 is null
+  size_t offset = 0;
+  for (size_t i = 1; i < entries;) {
+    auto len = word(i * 2);
+    auto refs = word(i * 2 + 1);
+    if (len == 0 && refs == 0) {
+      strings.emplace_back();
+      i++;
+      continue;
+    }
+    if (len == 0) {
+      // strings of 64K and more: the next entry holds the length, its reference count field the high word
+      if (i + 1 >= entries) {
+        ec = bela::make_error_code(ErrGeneral, L"msi: truncated string pool");
+        return false;
+      }
+      len = (word(i * 2 + 3) << 16) | word(i * 2 + 2);
+      i += 2;
+    } else {
+      i++;
+    }
+    if (offset + len > data.size()) {
+      ec = bela::make_error_code(ErrGeneral, L"msi: string pool runs past the string data");
+      return false;
+    }
+    strings.emplace_back(reinterpret_cast<const char *>(data.data()) + offset, len);
+    offset += len;
+  }
+  return true;
+}
+
+inline size_t columnWidth(uint16_t type, size_t strrefBytes) {
+  if ((type & columnString) != 0) {
+    // binary columns hold a 2 byte stream reference instead of a string id
+    return (type & 0x0400) == 0 && (type & 0xFF) == 0 ? 2 : strrefBytes;
+  }
+  return (type & 0xFF) <= 2 ? 2 : 4;
+}
+
+bool database::loadColumns(bela::error_code &ec) {
+  auto ce = cf->Find(L"!_Columns");
+  if (ce == nullptr) {
+    ec = bela::make_error_code(ErrGeneral, L"msi: missing _Columns table");
+    return false;
+  }
+  std::vector<uint8_t> data;
+  if (!cf->ReadStream(*ce, data, ec)) {
+    return false;
+  }
+  // _Columns(Table s64, Number i2, Name s64, Type i2)
+  auto rowSize = strrefBytes * 2 + 4;
+  auto rows = data.size() / rowSize;
+  auto ref = [&](size_t at) -> uint32_t {
+    uint32_t v = data[at] | (data[at + 1] << 8);
+    return strrefBytes == 3 ? v | (data[at + 2] << 16) : v;
+  };
+  auto i2 = [&](size_t at) { return static_cast<uint16_t>(bela::cast_fromle<uint16_t>(data.data() + at) ^ 0x8000); };
+  for (size_t r = 0; r < rows; r++) {
+    auto tableName = String(ref(r * strrefBytes));
+    auto number = i2(rows * strrefBytes + r * 2);
+    auto name = String(ref(rows * (strrefBytes + 2) + r * strrefBytes));
+    auto type = i2(rows * (strrefBytes * 2 + 2) + r * 2);
+    if (number == 0 || number > 32) {
+      ec = bela::make_error_code(ErrGeneral, L"msi: bad column number ", number);
+      return false;
+    }
+    auto it = std::find_if(schemas.begin(), schemas.end(), [&](const auto &s) { return s.first == tableName; });
+    if (it == schemas.end()) {
+      it = schemas.emplace(schemas.end(), std::string(tableName), std::vector<column>{});
+    }
+    auto &cols = it->second;
+    if (cols.size() < number) {
+      cols.resize(number);
+    }
+    cols[number - 1] = column{.name = std::string(name), .type = type};
+  }
+  for (auto &[_, cols] : schemas) {
+    size_t offset = 0;
+    for (auto &c : cols) {
+      c.offset = offset;
+      c.width = columnWidth(c.type, strrefBytes);
+      offset += c.width;
+    }
+  }
+  return true;
+}
+
+bool database::Open(const compoundFile &cf_, bela::error_code &ec) {
+  cf = &cf_;
+  return loadStrings(ec) && loadColumns(ec);
+}
+
+bool database::LoadTable(std::string_view name, table &t, bela::error_code &ec) const {
+  auto it = std::find_if(schemas.begin(), schemas.end(), [&](const auto &s) { return s.first == name; });
+  if (it == schemas.end()) {
+    ec = bela::make_error_code(ErrGeneral, L"msi: missing table ", bela::encode_into<char, wchar_t>(name));
+    return false;
+  }
+  t.db = this;
+  t.columns = it->second;
+  t.rows = 0;
+  t.data.clear();
+  auto e = cf->Find(bela::StringCat(L"!", bela::encode_into<char, wchar_t>(name)));
+  if (e == nullptr) {
+    return true;
+  }
+  if (!cf->ReadStream(*e, t.data, ec)) {
+    return false;
+  }
+  size_t rowSize = 0;
+  for (const auto &c : t.columns) {
+    rowSize += c.width;
+  }
+  if (rowSize == 0 || t.data.size() % rowSize != 0) {
+    ec = bela::make_error_code(ErrGeneral, L"msi: table ", bela::encode_into<char, wchar_t>(name),
+                               L" does not match its columns");
+    return false;
+  }
+  t.rows = t.data.size() / rowSize;
+  return true;
+}
+
+std::wstring database::Wide(std::string_view s) const {
+  if (s.empty()) {
+    return L"";
+  }
+  auto cp = codePage == 0 ? CP_ACP : codePage;
+  auto sz = MultiByteToWideChar(cp, 0, s.data(), static_cast<int>(s.size()), nullptr, 0);
+  std::wstring w;
+  w.resize(sz);
+  MultiByteToWideChar(cp, 0, s.data(), static_cast<int>(s.size()), w.data(), sz);
+  return w;
+}
+
+std::optional<size_t> table::Column(std::string_view name) const {
+  for (size_t i = 0; i < columns.size(); i++) {
+    if (columns[i].name == name) {
+      return i;
+    }
+  }
+  return std::nullopt;
+}
+
+uint32_t table::cell(size_t row, size_t col) const {
+  const auto &c = columns[col];
+  auto p = data.data() + c.offset * rows + row * c.width;
+  uint32_t v = 0;
+  for (size_t i = 0; i < c.width; i++) {
+    v |= static_cast<uint32_t>(p[i]) << (i * 8);
+  }
+  return v;
+}
+
+std::string_view table::String(size_t row, size_t col) const {
+  if (row >= rows || col >= columns.size() || (columns[col].type & columnString) == 0) {
+    return {};
+  }
+  return db->String(cell(row, col));
+}
+
+std::optional<int32_t> table::Integer(size_t row, size_t col) const {
+  if (row >= rows || col >= columns.size() || (columns[col].type & columnString) != 0) {
+    return std::nullopt;
+  }
+  auto v = cell(row, col);
+  if (v == 0) {
+    return std::nullopt;
+  }
+  if (columns[col].width == 2) {
+    return static_cast<int32_t>(v) - 0x8000;
+  }
+  return static_cast<int32_t>(v ^ 0x80000000U);
+}
+
+} // namespace baulk::archive::msi
@@ -0,0 +1,115 @@
+//
+#ifndef BAULK_ARCHIVE_MSI_INTERNAL_HPP
+#define BAULK_ARCHIVE_MSI_INTERNAL_HPP
+#include <baulk/archive/msi.hpp>
+#include <baulk/archive.hpp>
+#include <bela/endian.hpp>
+#include <algorithm>
+#include <optional>
+
+namespace baulk::archive::msi {
+// [MS-CFB] https://learn.microsoft.com/en-us/openspecs/windows_protocols/ms-cfb/
+constexpr uint8_t cfbSignature[] = {0xD0, 0xCF, 0x11, 0xE0, 0xA1, 0xB1, 0x1A, 0xE1};
+constexpr size_t cfbHeaderSize = 512;
+constexpr size_t cfbDirectoryEntrySize = 128;
+constexpr uint32_t maxRegularSector = 0xFFFFFFFA;
+constexpr uint32_t endOfChain = 0xFFFFFFFE;
+constexpr uint32_t noStream = 0xFFFFFFFF;
+constexpr uint8_t objectStorage = 1;
+constexpr uint8_t objectStream = 2;
+constexpr uint8_t objectRoot = 5;
+
+struct streamEntry {
+  std::wstring name; // with the MSI name compression undone, tables start with '!'
+  uint32_t start{0};
+  uint64_t size{0};
+};
+
+// DecodeStreamName: MSI packs two characters of [0-9A-Za-z._] into one UTF-16 unit above 0x3800
+std::wstring DecodeStreamName(std::wstring_view name);
+
+// compoundFile: the root storage of an OLE compound file, installer databases keep every stream there
+class compoundFile {
+public:
+  compoundFile() = default;
+  compoundFile(const compoundFile &) = delete;
+  compoundFile &operator=(const compoundFile &) = delete;
+  bool Open(std::shared_ptr<cab::Source> source_, bela::error_code &ec);
+  const streamEntry *Find(std::wstring_view name) const;
+  // ReadStream: whole stream in memory, for tables and small streams
+  bool ReadStream(const streamEntry &e, std::vector<uint8_t> &data, bela::error_code &ec) const;
+  // OpenStream: positioned reads straight from the package file, for embedded cabinets
+  std::shared_ptr<cab::Source> OpenStream(const streamEntry &e, bela::error_code &ec) const;
+
+private:
+  std::shared_ptr<cab::Source> source;
+  std::vector<uint32_t> fat;
+  std::vector<uint32_t> miniFat;
+  std::vector<uint8_t> miniStream;
+  std::vector<streamEntry> streams;
+  uint32_t sectorShift{9};
+  uint32_t miniSectorShift{6};
+  uint32_t miniCutoff{4096};
+  int64_t sectorOffset(uint32_t sector) const { return static_cast<int64_t>(sector + 1) << sectorShift; }
+  bool chain(uint32_t start, const std::vector<uint32_t> &table, std::vector<uint32_t> &sectors,
+             bela::error_code &ec) const;
+  bool readChain(uint32_t start, uint64_t size, std::vector<uint8_t> &data, bela::error_code &ec) const;
+};
+
+// https://learn.microsoft.com/en-us/windows/win32/msi/column-definition-format
+constexpr uint16_t columnValid = 0x0100;
+constexpr uint16_t columnString = 0x0800;
+constexpr uint16_t columnNullable = 0x1000;
+constexpr uint16_t columnKey = 0x2000;
+
+struct column {
+  std::string name;
+  uint16_t type{0};
+  size_t offset{0}; // bytes before this column in one row
+  size_t width{0};
+};
+
+class database;
+// table: rows are stored column by column, every cell is a string id or an offset encoded integer
+class table {
+public:
+  size_t Rows() const { return rows; }
+  std::optional<size_t> Column(std::string_view name) const;
+  // String: empty for null cells
+  std::string_view String(size_t row, size_t col) const;
+  std::optional<int32_t> Integer(size_t row, size_t col) const;
+
+private:
+  friend class database;
+  const database *db{nullptr};
+  std::vector<column> columns;
+  std::vector<uint8_t> data;
+  size_t rows{0};
+  uint32_t cell(size_t row, size_t col) const;
+};
+
+// database: string pool and table schemas of an installer database
+class database {
+public:
+  database() = default;
+  database(const database &) = delete;
+  database &operator=(const database &) = delete;
+  bool Open(const compoundFile &cf_, bela::error_code &ec);
+  // LoadTable: a table without rows has no stream, it loads as empty
+  bool LoadTable(std::string_view name, table &t, bela::error_code &ec) const;
+  std::string_view String(uint32_t id) const { return id < strings.size() ? strings[id] : std::string_view{}; }
+  // Wide: strings are stored in the database code page
+  std::wstring Wide(std::string_view s) const;
+
+private:
+  const compoundFile *cf{nullptr};
+  std::vector<std::string> strings;
+  std::vector<std::pair<std::string, std::vector<column>>> schemas;
+  uint32_t codePage{0};
+  size_t strrefBytes{2};
+  bool loadStrings(bela::error_code &ec);
+  bool loadColumns(bela::error_code &ec);
+};
+} // namespace baulk::archive::msi
+
+#endif
@@ -0,0 +1,203 @@
+///
+#include "msiinternal.hpp"
+
+namespace baulk::archive::msi {
+namespace {
+// longName: "short|long" names keep the long part
+inline std::wstring_view longName(std::wstring_view name) {
+  if (auto pos = name.find(L'|'); pos != std::wstring_view::npos) {
+    return name.substr(pos + 1);
+  }
+  return name;
+}
+
+// sourceName: DefaultDir is "target:source", an administrative image is laid out by the source names
+inline std::wstring_view sourceName(std::wstring_view defaultDir) {
+  if (auto pos = defaultDir.find(L':'); pos != std::wstring_view::npos) {
+    defaultDir = defaultDir.substr(pos + 1);
+  }
+  auto name = longName(defaultDir);
+  return name == L"." ? std::wstring_view{} : name;
+}
+
+struct columnIndex {
+  const char *name;
+  size_t &index;
+};
+
+bool lookupColumns(const table &t, std::string_view tableName, std::initializer_list<columnIndex> cols,
+                   bela::error_code &ec) {
+  for (const auto &c : cols) {
+    auto i = t.Column(c.name);
+    if (!i) {
+      ec = bela::make_error_code(ErrGeneral, L"msi: table ", bela::encode_into<char, wchar_t>(tableName),
+                                 L" has no column ", bela::encode_into<char, wchar_t>(c.name));
+      return false;
+    }
+    c.index = *i;
+  }
+  return true;
+}
+
+class directoryResolver {
+public:
+  directoryResolver(const database &db_, const table &t_, size_t keyCol, size_t parentCol, size_t defaultCol)
+      : db(db_), t(t_), parent(parentCol), defaultDir(defaultCol) {
+    for (size_t r = 0; r < t.Rows(); r++) {
+      rows.emplace(t.String(r, keyCol), r);
+    }
+  }
+  // Resolve: path relative to the image root, the root directory itself contributes no component
+  std::optional<std::wstring> Resolve(std::string_view key, bela::error_code &ec) {
+    if (auto it = resolved.find(key); it != resolved.end()) {
+      return it->second;
+    }
+    std::vector<std::string_view> chain;
+    for (auto k = key; !k.empty();) {
+      if (chain.size() > rows.size() || resolved.contains(k)) {
+        break;
+      }
+      auto it = rows.find(k);
+      if (it == rows.end()) {
+        ec = bela::make_error_code(ErrGeneral, L"msi: unknown directory ", bela::encode_into<char, wchar_t>(k));
+        return std::nullopt;
+      }
+      chain.emplace_back(k);
+      auto p = t.String(it->second, parent);
+      k = p == k ? std::string_view{} : p;
+    }
+    if (chain.size() > rows.size()) {
+      ec = bela::make_error_code(ErrGeneral, L"msi: directory cycle at ", bela::encode_into<char, wchar_t>(key));
+      return std::nullopt;
+    }
+    // walk back down from the outermost known ancestor
+    for (auto i = chain.size(); i > 0; i--) {
+      auto k = chain[i - 1];
+      auto r = rows.find(k)->second;
+      auto p = t.String(r, parent);
+      if (p.empty() || p == k) {
+        resolved.emplace(k, std::wstring{});
+        continue;
+      }
+      auto base = resolved.find(p)->second;
+      auto name = db.Wide(t.String(r, defaultDir));
+      auto component = sourceName(name);
+      if (component.empty()) {
+        resolved.emplace(k, std::move(base));
+        continue;
+      }
+      resolved.emplace(k, base.empty() ? std::wstring(component) : bela::StringCat(base, L"/", component));
+    }
+    return resolved.find(key)->second;
+  }
+
+private:
+  const database &db;
+  const table &t;
+  size_t parent;
+  size_t defaultDir;
+  gtl::flat_hash_map<std::string_view, size_t> rows;
+  gtl::flat_hash_map<std::string_view, std::wstring> resolved;
+};
+} // namespace
+
+bool Package::Open(const std::filesystem::path &file, bela::error_code &ec) {
+  if (cf) {
+    ec = bela::make_error_code(L"The file has been opened, the function cannot be called repeatedly");
+    return false;
+  }
+  archive_file = file;
+  auto source = cab::NewFileSource(file.native(), ec);
+  if (!source) {
+    return false;
+  }
+  cf = std::make_shared<compoundFile>();
+  if (!cf->Open(std::move(source), ec)) {
+    return false;
+  }
+  database db;
+  if (!db.Open(*cf, ec)) {
+    return false;
+  }
+  table fileTable;
+  table componentTable;
+  table directoryTable;
+  table mediaTable;
+  if (!db.LoadTable("File", fileTable, ec) || !db.LoadTable("Component", componentTable, ec) ||
+      !db.LoadTable("Directory", directoryTable, ec) || !db.LoadTable("Media", mediaTable, ec)) {
+    return false;
+  }
+  size_t fKey = 0, fComponent = 0, fName = 0, fSize = 0, fAttributes = 0, fSequence = 0;
+  size_t cKey = 0, cDirectory = 0;
+  size_t dKey = 0, dParent = 0, dDefault = 0;
+  size_t mDisk = 0, mCabinet = 0;
+  if (!lookupColumns(fileTable, "File",
+                     {{"File", fKey},
+                      {"Component_", fComponent},
+                      {"FileName", fName},
+                      {"FileSize", fSize},
+                      {"Attributes", fAttributes},
+                      {"Sequence", fSequence}},
+                     ec) ||
+      !lookupColumns(componentTable, "Component", {{"Component", cKey}, {"Directory_", cDirectory}}, ec) ||
+      !lookupColumns(directoryTable, "Directory",
+                     {{"Directory", dKey}, {"Directory_Parent", dParent}, {"DefaultDir", dDefault}}, ec) ||
+      !lookupColumns(mediaTable, "Media", {{"DiskId", mDisk}, {"Cabinet", mCabinet}}, ec)) {
+    return false;
+  }
+  gtl::flat_hash_map<std::string_view, std::string_view> components;
+  for (size_t r = 0; r < componentTable.Rows(); r++) {
+    components.emplace(componentTable.String(r, cKey), componentTable.String(r, cDirectory));
+  }
+  directoryResolver resolver(db, directoryTable, dKey, dParent, dDefault);
+  files.reserve(fileTable.Rows());
+  for (size_t r = 0; r < fileTable.Rows(); r++) {
+    auto key = fileTable.String(r, fKey);
+    auto it = components.find(fileTable.String(r, fComponent));
+    if (it == components.end()) {
+      ec = bela::make_error_code(ErrGeneral, L"msi: file ", bela::encode_into<char, wchar_t>(key),
+                                 L" has no component");
+      return false;
+    }
+    auto dir = resolver.Resolve(it->second, ec);
+    if (!dir) {
+      return false;
+    }
+    auto name = db.Wide(fileTable.String(r, fName));
+    auto fileName = longName(name);
+    auto path = dir->empty() ? std::wstring(fileName) : bela::StringCat(*dir, L"/", fileName);
+    files.emplace_back(PackageFile{
+        .key = std::string(key),
+        .path = bela::encode_into<wchar_t, char>(path),
+        .size = static_cast<uint32_t>(fileTable.Integer(r, fSize).value_or(0)),
+        .sequence = static_cast<uint32_t>(fileTable.Integer(r, fSequence).value_or(0)),
+        .attributes = static_cast<uint16_t>(fileTable.Integer(r, fAttributes).value_or(0)),
+    });
+  }
+  std::vector<std::pair<int32_t, std::string>> media;
+  for (size_t r = 0; r < mediaTable.Rows(); r++) {
+    if (auto c = mediaTable.String(r, mCabinet); !c.empty()) {
+      media.emplace_back(mediaTable.Integer(r, mDisk).value_or(0), std::string(c));
+    }
+  }
+  std::sort(media.begin(), media.end());
+  for (auto &[_, c] : media) {
+    cabinets.emplace_back(std::move(c));
+  }
+  return true;
+}
+
+std::shared_ptr<cab::Source> Package::OpenCabinet(std::string_view name, bela::error_code &ec) const {
+  if (name.starts_with('#')) {
+    auto e = cf->Find(bela::encode_into<char, wchar_t>(name.substr(1)));
+    if (e == nullptr) {
+      ec = bela::make_error_code(ErrGeneral, L"msi: missing cabinet stream ", bela::encode_into<char, wchar_t>(name));
+      return nullptr;
+    }
+    return cf->OpenStream(*e, ec);
+  }
+  // external cabinets sit next to the package
+  return cab::NewFileSource((archive_file.parent_path() / bela::encode_into<char, wchar_t>(name)).native(), ec);
+}
+
+} // namespace baulk::archive::msi
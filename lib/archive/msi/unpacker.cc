@@ -0,0 +1,261 @@
+///
+#include "msiinternal.hpp"
+#include <bela/ascii.hpp>
+#include <thread>
+
+namespace baulk::archive::msi {
+namespace {
+inline std::string_view firstComponent(std::string_view path) {
+  if (auto pos = path.find('/'); pos != std::string_view::npos) {
+    return path.substr(0, pos);
+  }
+  return path;
+}
+
+inline std::string pathKey(std::string_view path) {
+  auto key = std::string(path);
+  for (auto &c : key) {
+    c = bela::ascii_tolower(c);
+  }
+  return key;
+}
+} // namespace
+
+// flatten: the layout Extractor::MakeFlattened produces after an administrative install, computed from the paths
+void Unpacker::flatten(std::vector<std::string> &paths) {
+  constexpr std::string_view childLists[] = {"Program Files", "ProgramFiles64", "PFiles", "Files"};
+  for (auto &p : paths) {
+    auto first = firstComponent(p);
+    if (first.size() == p.size()) {
+      continue;
+    }
+    for (auto c : childLists) {
+      if (bela::EqualsIgnoreCase(first, c)) {
+        p.erase(0, first.size() + 1);
+        break;
+      }
+    }
+  }
+  // descend while the root holds exactly one directory that is not bin, files stop the walk
+  for (int depth = 0; depth < 20 && !paths.empty(); depth++) {
+    auto first = firstComponent(paths.front());
+    if (bela::EqualsIgnoreCase(first, "bin")) {
+      return;
+    }
+    for (const auto &p : paths) {
+      if (p.size() == first.size() || !bela::EqualsIgnoreCase(firstComponent(p), first)) {
+        return;
+      }
+    }
+    auto n = first.size() + 1;
+    for (auto &p : paths) {
+      p.erase(0, n);
+    }
+  }
+}
+
+bool Unpacker::OpenReader(const std::filesystem::path &file, const std::filesystem::path &dest, bela::error_code &ec) {
+  std::error_code e;
+  if (destination = std::filesystem::absolute(dest, e); e) {
+    ec = bela::make_error_code_from_std(e, L"fs::absolute() ");
+    return false;
+  }
+  auto msifile = std::filesystem::canonical(file, e);
+  if (e) {
+    ec = bela::make_error_code_from_std(e, L"fs::canonical() ");
+    return false;
+  }
+  if (!package.Open(msifile, ec)) {
+    return false;
+  }
+  const auto &files = package.Files();
+  std::vector<std::string> paths;
+  paths.reserve(files.size());
+  for (const auto &f : files) {
+    paths.emplace_back(f.path);
+  }
+  flatten(paths);
+  // rows of different components may install the same path, an administrative install keeps the last one
+  gtl::flat_hash_map<std::string, size_t> owners;
+  targets.assign(files.size(), std::nullopt);
+  for (size_t i = 0; i < files.size(); i++) {
+    auto [it, inserted] = owners.try_emplace(pathKey(paths[i]), i);
+    if (!inserted) {
+      if (files[it->second].sequence > files[i].sequence) {
+        continue;
+      }
+      targets[it->second].reset();
+      it->second = i;
+    }
+    std::wstring encoded_path;
+    auto out = baulk::archive::JoinSanitizeFsPath(destination, paths[i], true, encoded_path);
+    if (!out) {
+      ec = bela::make_error_code(ErrGeneral, L"harmful path <s>: ", bela::encode_into<char, wchar_t>(paths[i]));
+      return false;
+    }
+    targets[i] = std::move(*out);
+  }
+  gtl::flat_hash_map<std::string_view, size_t> keys;
+  for (size_t i = 0; i < files.size(); i++) {
+    keys.emplace(files[i].key, i);
+  }
+  std::vector<bool> found(files.size(), false);
+  for (const auto &name : package.Cabinets()) {
+    auto &c = cabinets.emplace_back();
+    if (c.source = package.OpenCabinet(name, ec); !c.source) {
+      return false;
+    }
+    c.reader = std::make_unique<cab::Reader>();
+    if (!c.reader->OpenReader(c.source, ec) || !c.reader->CheckMethods(ec)) {
+      return false;
+    }
+    const auto &entries = c.reader->Files();
+    c.files.assign(entries.size(), std::nullopt);
+    for (size_t i = 0; i < entries.size(); i++) {
+      auto it = keys.find(entries[i].name);
+      if (it == keys.end() || found[it->second]) {
+        continue;
+      }
+      found[it->second] = true;
+      if (targets[it->second]) {
+        c.files[i] = it->second;
+        uncompressed_size += entries[i].size;
+      }
+    }
+  }
+  for (size_t i = 0; i < files.size(); i++) {
+    if (!found[i] && targets[i]) {
+      // uncompressed source files or media without a cabinet, only Windows Installer knows where they are
+      ec = bela::make_error_code(ErrUnimplemented, L"msi: ", bela::encode_into<char, wchar_t>(files[i].key),
+                                 L" is not stored in a cabinet");
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Unpacker::extract_folder(const cabinet &c, size_t folder, const OnProgress &progress, std::mutex &mu,
+                              std::atomic_bool &stop, int64_t &extracted, bela::error_code &ec) {
+  std::optional<baulk::archive::File> fd;
+  cab::Reader::FolderHandler h{
+      .begin =
+          [&](const cab::File &file, bela::error_code &ec) {
+            auto index = c.files[&file - c.reader->Files().data()];
+            if (!index) {
+              return true;
+            }
+            fd = baulk::archive::File::NewFile(*targets[*index], file.time, static_cast<int64_t>(file.size), true,
+                                               nullptr, ec);
+            return fd.has_value();
+          },
+      .write =
+          [&](const cab::File &file, const void *data, size_t len, bela::error_code &ec) {
+            if (stop.load(std::memory_order_relaxed)) {
+              ec = bela::make_error_code(ErrCanceled, L"canceled");
+              return false;
+            }
+            if (!fd) {
+              return true;
+            }
+            if (progress) {
+              std::lock_guard lock(mu);
+              extracted += static_cast<int64_t>(len);
+              if (!progress(extracted, uncompressed_size)) {
+                ec = bela::make_error_code(ErrCanceled, L"canceled");
+                return false;
+              }
+            }
+            return fd->WriteFull(data, len, ec);
+          },
+      .end =
+          [&](const cab::File &file, bela::error_code &ec) {
+            if (!fd) {
+              return true;
+            }
+            auto ok = fd->Flush(ec);
+            fd.reset();
+            return ok;
+          },
+  };
+  if (!c.reader->DecompressFolder(folder, h, ec)) {
+    if (fd) {
+      fd->Discard();
+    }
+    return false;
+  }
+  return true;
+}
+
+bool Unpacker::Extract(const OnProgress &progress, bela::error_code &ec) {
+  if (!dirs.Ensure(destination, ec)) {
+    return false;
+  }
+  // parents are created up front so workers never touch the directory cache
+  for (const auto &t : targets) {
+    if (t && !dirs.Ensure(t->parent_path(), ec)) {
+      return false;
+    }
+  }
+  struct task {
+    const cabinet *c;
+    size_t folder;
+    uint64_t size;
+  };
+  std::vector<task> tasks;
+  for (const auto &c : cabinets) {
+    const auto &folders = c.reader->Folders();
+    for (size_t i = 0; i < folders.size(); i++) {
+      uint64_t size = 0;
+      bool wanted = false;
+      for (auto fi : folders[i].files) {
+        if (c.files[fi]) {
+          size += c.reader->Files()[fi].size;
+          wanted = true;
+        }
+      }
+      if (wanted) {
+        tasks.emplace_back(task{.c = &c, .folder = i, .size = size});
+      }
+    }
+  }
+  // largest folders first, an LZX folder is a single stream and cannot be split
+  std::sort(tasks.begin(), tasks.end(), [](const task &a, const task &b) { return a.size > b.size; });
+  auto concurrency = static_cast<size_t>((std::max)(std::thread::hardware_concurrency(), 1U));
+  workers = (std::max)((std::min)(concurrency, tasks.size()), static_cast<size_t>(1));
+  std::atomic_size_t next{0};
+  std::atomic_bool stop{false};
+  std::mutex mu;
+  int64_t extracted = 0;
+  bela::error_code firstEc;
+  auto worker = [&] {
+    while (!stop.load(std::memory_order_relaxed)) {
+      auto k = next.fetch_add(1);
+      if (k >= tasks.size()) {
+        break;
+      }
+      bela::error_code wec;
+      if (extract_folder(*tasks[k].c, tasks[k].folder, progress, mu, stop, extracted, wec)) {
+        continue;
+      }
+      std::lock_guard lock(mu);
+      stop = true;
+      if (!firstEc) {
+        firstEc = std::move(wec);
+      }
+    }
+  };
+  {
+    std::vector<std::jthread> threads;
+    for (size_t i = 1; i < workers; i++) {
+      threads.emplace_back(worker);
+    }
+    worker();
+  }
+  if (stop) {
+    ec = std::move(firstEc);
+    return false;
+  }
+  return true;
+}
+
+} // namespace baulk::archive::msi
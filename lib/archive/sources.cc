@@ -0,0 +1,71 @@
+// archive writer sources
+#include <bela/path.hpp>
+#include <bela/codecvt.hpp>
+#include <bela/str_cat.hpp>
+#include <algorithm>
+#include <baulk/archive.hpp>
+
+namespace baulk::archive {
+
+inline std::string encode_archive_name(std::wstring_view name) {
+  auto u8name = bela::encode_into<wchar_t, char>(name);
+  std::replace(u8name.begin(), u8name.end(), '\\', '/');
+  return u8name;
+}
+
+std::optional<Source> StatSource(const fs::path &file, std::string_view name, bela::error_code &ec) {
+  WIN32_FILE_ATTRIBUTE_DATA wfd;
+  if (GetFileAttributesExW(file.c_str(), GetFileExInfoStandard, &wfd) != TRUE) {
+    ec = bela::make_system_error_code(L"GetFileAttributesExW() ");
+    return std::nullopt;
+  }
+  Source src{.path = file, .name = std::string(name), .time = bela::FromFileTime(wfd.ftLastWriteTime)};
+  if ((wfd.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0) {
+    std::error_code e;
+    if (auto target = fs::read_symlink(file, e); !e) {
+      src.linkname = encode_archive_name(target.native());
+      src.mode = bela::os::ModeSymlink | static_cast<bela::os::FileMode>(0777);
+      return std::make_optional(std::move(src));
+    }
+    // junctions and other reparse points are archived as what they point to
+  }
+  if ((wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0) {
+    src.mode = bela::os::ModeDir | static_cast<bela::os::FileMode>(0755);
+    if (!src.name.empty() && !src.name.ends_with('/')) {
+      src.name.push_back('/');
+    }
+    return std::make_optional(std::move(src));
+  }
+  src.size = (static_cast<uint64_t>(wfd.nFileSizeHigh) << 32) | wfd.nFileSizeLow;
+  src.mode = static_cast<bela::os::FileMode>((wfd.dwFileAttributes & FILE_ATTRIBUTE_READONLY) != 0 ? 0444 : 0644);
+  return std::make_optional(std::move(src));
+}
+
+bool WalkSources(const fs::path &root, std::string_view prefix, const SourceVisitor &visitor, bela::error_code &ec) {
+  std::string base(prefix);
+  if (!base.empty() && !base.ends_with('/')) {
+    base.push_back('/');
+  }
+  std::error_code e;
+  // directory symlinks are not followed, they are archived as symlinks
+  for (auto it = fs::recursive_directory_iterator(root, e); !e && it != fs::end(it); it.increment(e)) {
+    auto rel = fs::relative(it->path(), root, e);
+    if (e) {
+      break;
+    }
+    auto src = StatSource(it->path(), bela::StringNarrowCat(base, encode_archive_name(rel.native())), ec);
+    if (!src) {
+      return false;
+    }
+    if (!visitor(*src, ec)) {
+      return false;
+    }
+  }
+  if (e) {
+    ec = bela::make_error_code_from_std(e, bela::StringCat(L"walk '", root.native(), L"' "));
+    return false;
+  }
+  return true;
+}
+
+} // namespace baulk::archive
@@ -1,9 +1,69 @@
 ///
 #include <charconv>
 #include <utility>
+#include <bit>
 #include "tarinternal.hpp"
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <emmintrin.h>
+#define BAULK_TAR_SSE2 1
+#endif
 
 namespace baulk::archive::tar {
+constexpr size_t chksumOffset = 148;
+constexpr size_t chksumSize = 8;
+
+blockChecksum checksumBlock(const ustar_header &hdr) {
+  auto p = reinterpret_cast<const uint8_t *>(&hdr);
+  int64_t sum = 0;
+  int64_t high = 0; // bytes >= 0x80, each one is 256 less when summed as signed
+#ifdef BAULK_TAR_SSE2
+  auto zero = _mm_setzero_si128();
+  auto acc = _mm_setzero_si128();
+  for (size_t i = 0; i < blockSize; i += 16) {
+    auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+    acc = _mm_add_epi64(acc, _mm_sad_epu8(v, zero));
+    high += std::popcount(static_cast<uint32_t>(_mm_movemask_epi8(v)));
+  }
+  sum = _mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+#else
+  // SWAR: bytes are summed into 16-bit lanes, 64 words add at most 32640 per lane
+  uint64_t acc = 0;
+  for (size_t i = 0; i < blockSize; i += sizeof(uint64_t)) {
+    uint64_t w;
+    memcpy(&w, p + i, sizeof(w));
+    acc += (w & 0x00FF00FF00FF00FFULL) + ((w >> 8) & 0x00FF00FF00FF00FFULL);
+    high += std::popcount(w & 0x8080808080808080ULL);
+  }
+  // lanes are added without wrapping, a header full of high bytes sums past 65535
+  sum = static_cast<int64_t>((acc & 0xFFFF) + ((acc >> 16) & 0xFFFF) + ((acc >> 32) & 0xFFFF) + (acc >> 48));
+#endif
+  // Treat the checksum field itself as all spaces.
+  for (size_t i = chksumOffset; i < chksumOffset + chksumSize; i++) {
+    sum += ' ' - p[i];
+    high -= p[i] >> 7;
+  }
+  return blockChecksum{.unsigned_sum = sum, .signed_sum = sum - 256 * high};
+}
+
+bool isZeroBlock(const ustar_header &hdr) {
+  auto p = reinterpret_cast<const uint8_t *>(&hdr);
+#ifdef BAULK_TAR_SSE2
+  auto acc = _mm_setzero_si128();
+  for (size_t i = 0; i < blockSize; i += 16) {
+    acc = _mm_or_si128(acc, _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i)));
+  }
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(acc, _mm_setzero_si128())) == 0xFFFF;
+#else
+  uint64_t acc = 0;
+  for (size_t i = 0; i < blockSize; i += sizeof(uint64_t)) {
+    uint64_t w;
+    memcpy(&w, p + i, sizeof(w));
+    acc |= w;
+  }
+  return acc == 0;
+#endif
+}
+
 inline bool IsChecksumEqual(const ustar_header &hdr) {
   /* Checksum field must hold an octal number */
   for (const auto c : hdr.chksum) {
@@ -16,18 +76,8 @@ inline bool IsChecksumEqual(const ustar_header &hdr) {
    * bytes for this calculation.
    */
   auto sum = parseNumeric(hdr.chksum);
-  int64_t check = 0;
-  int64_t scheck = 0;
-  auto p = reinterpret_cast<const int8_t *>(&hdr);
-  for (int i = 0; i < 512; i++) {
-    auto c = p[i];
-    if (148 <= i && i < 156) {
-      c = ' '; // Treat the checksum field itself as all spaces.
-    }
-    check += static_cast<uint8_t>(c);
-    scheck += c;
-  }
-  return (check == sum || scheck == sum);
+  auto check = checksumBlock(hdr);
+  return (check.unsigned_sum == sum || check.signed_sum == sum);
 }
 
 tar_format_t getFormat(const ustar_header &hdr) {
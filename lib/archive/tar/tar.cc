@@ -57,11 +57,6 @@ bool FileReader::WriteTo(const Writer &w, int64_t filesize, int64_t &extracted,
   return true;
 }
 
-inline bool isZeroBlock(const ustar_header &th) {
-  static ustar_header zeroth = {0};
-  return memcmp(&th, &zeroth, sizeof(ustar_header)) == 0;
-}
-
 // blockPadding computes the number of bytes needed to pad offset up to the
 // nearest block edge where 0 <= n < blockSize.
 constexpr int64_t blockPadding(int64_t offset) { return -offset & (blockSize - 1); }
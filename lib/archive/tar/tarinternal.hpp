@@ -5,6 +5,7 @@
 #include <baulk/allocate.hpp>
 #include <baulk/archive.hpp>
 #include <charconv>
+#include <bit>
 
 namespace baulk::archive::tar {
 using baulk::mem::Buffer;
@@ -85,6 +86,13 @@ bool mergePAX(Header &h, pax_records_t &paxHdrs, bela::error_code &ec);
 bool parsePAXRecord(std::string_view *sv, std::string_view *k, std::string_view *v, bela::error_code &ec);
 bool validateSparseEntries(sparseDatas &spd, int64_t size);
 tar_format_t getFormat(const ustar_header &hdr);
+// blockChecksum: POSIX unsigned and historic signed byte sums of a header, the checksum field counted as spaces
+struct blockChecksum {
+  int64_t unsigned_sum{0};
+  int64_t signed_sum{0};
+};
+blockChecksum checksumBlock(const ustar_header &hdr);
+bool isZeroBlock(const ustar_header &hdr);
 inline std::string parseString(const void *data, size_t N) {
   auto p = reinterpret_cast<const char *>(data);
   auto pos = memchr(p, 0, N);
@@ -97,10 +105,43 @@ inline std::string parseString(const void *data, size_t N) {
 
 template <size_t N> std::string parseString(const char (&aArr)[N]) { return parseString(aArr, N); }
 
+// octalRun: number of leading octal digits in the eight bytes of x (little-endian load)
+inline int octalRun(uint64_t x) {
+  // bytes 0x30-0x37 become zero, anything else keeps a bit set
+  auto m = (x & 0xF8F8F8F8F8F8F8F8ULL) ^ 0x3030303030303030ULL;
+  auto nonzero = (((m & 0x7F7F7F7F7F7F7F7FULL) + 0x7F7F7F7F7F7F7F7FULL) | m) & 0x8080808080808080ULL;
+  return std::countr_zero(nonzero) >> 3;
+}
+
+// octalValue: value of the first n (1-8) octal digits of x, digits are right aligned and combined pairwise
+inline uint64_t octalValue(uint64_t x, int n) {
+  x = (x & 0x0707070707070707ULL) << ((8 - n) * 8);
+  x = ((x * 8) + (x >> 8)) & 0x00FF00FF00FF00FFULL;
+  x = ((x * 64) + (x >> 16)) & 0x0000FFFF0000FFFFULL;
+  return ((x * 4096) + (x >> 32)) & 0xFFFFFFFFULL;
+}
+
+// parseNumeric8: leading spaces are skipped, parsing stops at the first byte that is not an octal digit
 inline int64_t parseNumeric8(const char *p, size_t char_cnt) {
-  int64_t val = 0;
-  auto res = std::from_chars(p, p + char_cnt, val, 8);
-  return val;
+  size_t i = 0;
+  while (i < char_cnt && p[i] == ' ') {
+    i++;
+  }
+  uint64_t val = 0;
+  while (i < char_cnt) {
+    uint64_t x = 0;
+    memcpy(&x, p + i, (std::min)(char_cnt - i, sizeof(x)));
+    auto n = octalRun(x);
+    if (n == 0) {
+      break;
+    }
+    val = (val << (3 * n)) | octalValue(x, n);
+    if (n < 8) {
+      break;
+    }
+    i += sizeof(x);
+  }
+  return static_cast<int64_t>(val);
 }
 
 inline int64_t parseNumeric10(const char *p, size_t char_cnt) {
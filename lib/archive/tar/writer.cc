@@ -0,0 +1,341 @@
+///
+#include "tarinternal.hpp"
+#include <bela/str_cat.hpp>
+#include <thread>
+#define ZSTD_STATIC_LINKING_ONLY 1
+#include <zstd.h>
+
+namespace baulk::archive::tar {
+// Thanks golang.org/src/archive/tar/writer.go
+constexpr size_t readBufferSize = 256 * 1024;
+
+class Compressor {
+public:
+  Compressor(HANDLE fd_) : fd(fd_) {}
+  Compressor(const Compressor &) = delete;
+  Compressor &operator=(const Compressor &) = delete;
+  ~Compressor() {
+    if (cctx != nullptr) {
+      ZSTD_freeCCtx(cctx);
+    }
+  }
+  bool Initialize(const WriterOptions &opts, bela::error_code &ec) {
+    cctx = ZSTD_createCCtx_advanced(ZSTD_customMem{
+        .customAlloc = baulk::mem::allocate_simple, .customFree = baulk::mem::deallocate_simple, .opaque = nullptr});
+    if (cctx == nullptr) {
+      ec = bela::make_error_code(ErrExtractGeneral, L"ZSTD_createCCtx() out of memory");
+      return false;
+    }
+    ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, opts.level);
+    ZSTD_CCtx_setParameter(cctx, ZSTD_c_checksumFlag, 1);
+    auto workers = opts.workers > 0 ? opts.workers
+                                    : static_cast<int>((std::max)(std::thread::hardware_concurrency(), 1U));
+    if (workers > 1) {
+      // tar stream is split into jobs compressed by zstd worker threads, output is still a single frame
+      if (auto r = ZSTD_CCtx_setParameter(cctx, ZSTD_c_nbWorkers, workers); ZSTD_isError(r) != 0) {
+        ec = bela::make_error_code(ErrExtractGeneral, L"ZSTD_c_nbWorkers: ",
+                                   bela::encode_into<char, wchar_t>(ZSTD_getErrorName(r)));
+        return false;
+      }
+    }
+    out.grow(ZSTD_CStreamOutSize());
+    return true;
+  }
+  bool Write(const void *data, size_t len, bool end, bela::error_code &ec) {
+    ZSTD_inBuffer in{data, len, 0};
+    auto mode = end ? ZSTD_e_end : ZSTD_e_continue;
+    for (;;) {
+      ZSTD_outBuffer o{out.data(), out.capacity(), 0};
+      auto remaining = ZSTD_compressStream2(cctx, &o, &in, mode);
+      if (ZSTD_isError(remaining) != 0) {
+        ec = bela::make_error_code(ErrExtractGeneral, L"ZSTD_compressStream2: ",
+                                   bela::encode_into<char, wchar_t>(ZSTD_getErrorName(remaining)));
+        return false;
+      }
+      if (o.pos != 0 && !bela::io::WriteFull(fd, {out.data(), o.pos}, ec)) {
+        return false;
+      }
+      if (end ? remaining == 0 : in.pos == in.size) {
+        break;
+      }
+    }
+    return true;
+  }
+
+private:
+  HANDLE fd{INVALID_HANDLE_VALUE};
+  ZSTD_CCtx *cctx{nullptr};
+  Buffer out;
+};
+
+// formatOctal: zero padded octal terminated by NUL, false if value does not fit
+template <size_t N> bool formatOctal(char (&field)[N], int64_t v) {
+  if (v < 0) {
+    return false;
+  }
+  memset(field, '0', N - 1);
+  field[N - 1] = 0;
+  for (auto i = static_cast<int>(N) - 2; i >= 0 && v != 0; i--) {
+    field[i] = static_cast<char>('0' + (v & 7));
+    v >>= 3;
+  }
+  return v == 0;
+}
+
+template <size_t N> bool formatString(char (&field)[N], std::string_view s) {
+  if (s.size() > N) {
+    return false;
+  }
+  memcpy(field, s.data(), s.size());
+  return true;
+}
+
+// splitUSTARPath: split name into prefix and suffix at a path separator, so name fits in USTAR header
+inline bool splitUSTARPath(std::string_view name, std::string_view &prefix, std::string_view &suffix) {
+  if (name.size() <= nameSize) {
+    prefix = {};
+    suffix = name;
+    return true;
+  }
+  auto length = name.size();
+  if (length > prefixSize + 1) {
+    length = prefixSize + 1;
+  } else if (name.back() == '/') {
+    length--;
+  }
+  auto i = name.substr(0, length).rfind('/');
+  if (i == std::string_view::npos || i == 0 || name.size() - i - 1 > nameSize || name.size() - i - 1 == 0) {
+    return false;
+  }
+  prefix = name.substr(0, i);
+  suffix = name.substr(i + 1);
+  return true;
+}
+
+// formatPAXRecord: "%d %s=%s\n" where the length includes itself
+inline void formatPAXRecord(std::string &records, std::string_view k, std::string_view v) {
+  auto base = k.size() + v.size() + 3; // space, '=' and '\n'
+  auto size = base + bela::AlphaNumNarrow(base).Piece().size();
+  // adding the digits may carry the length into one more digit
+  size = base + bela::AlphaNumNarrow(size).Piece().size();
+  bela::StrAppend(&records, size, " ", k);
+  bela::StrAppend(&records, "=", v, "\n");
+}
+
+// formatChecksum: computed with the checksum field filled with spaces, stored as six digits, NUL and space
+inline void formatChecksum(ustar_header &hdr) {
+  memset(hdr.chksum, ' ', sizeof(hdr.chksum));
+  char field[7];
+  formatOctal(field, checksumBlock(hdr).unsigned_sum);
+  memcpy(hdr.chksum, field, sizeof(field));
+}
+
+ArchiveWriter::ArchiveWriter() = default;
+
+ArchiveWriter::~ArchiveWriter() = default;
+
+bool ArchiveWriter::OpenWriter(std::wstring_view file, const WriterOptions &opts, bela::error_code &ec) {
+  if (fd) {
+    ec = bela::make_error_code(L"The file has been opened, the function cannot be called repeatedly");
+    return false;
+  }
+  auto fd_ = bela::io::NewFile(file, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS,
+                               FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr, ec);
+  if (!fd_) {
+    return false;
+  }
+  fd = std::move(*fd_);
+  compressor = std::make_unique<Compressor>(fd.NativeFD());
+  if (!compressor->Initialize(opts, ec)) {
+    return false;
+  }
+  ibuf.resize(readBufferSize);
+  return true;
+}
+
+bool ArchiveWriter::write(const void *data, size_t len, bela::error_code &ec) {
+  if (closed || !fd) {
+    ec = bela::make_error_code(ErrExtractGeneral, L"tar: write to closed archive");
+    return false;
+  }
+  return compressor->Write(data, len, false, ec);
+}
+
+bool ArchiveWriter::pad(int64_t size, bela::error_code &ec) {
+  static const uint8_t zeros[blockSize] = {0};
+  if (auto n = static_cast<size_t>(size % blockSize); n != 0) {
+    return write(zeros, blockSize - n, ec);
+  }
+  return true;
+}
+
+bool ArchiveWriter::writeHeader(const Header &h, bela::error_code &ec) {
+  ustar_header hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  std::string records;
+  std::string_view prefix;
+  std::string_view suffix;
+  if (!splitUSTARPath(h.Name, prefix, suffix)) {
+    formatPAXRecord(records, paxPath, h.Name);
+    suffix = std::string_view(h.Name).substr(0, nameSize);
+    prefix = {};
+  }
+  formatString(hdr.name, suffix);
+  formatString(hdr.prefix, prefix);
+  if (!formatString(hdr.linkname, h.LinkName)) {
+    formatPAXRecord(records, paxLinkpath, h.LinkName);
+  }
+  if (!formatOctal(hdr.size, h.Size)) {
+    formatPAXRecord(records, paxSize, bela::AlphaNumNarrow(h.Size).Piece());
+    formatOctal(hdr.size, 0);
+  }
+  formatOctal(hdr.mode, h.Mode & 07777);
+  formatOctal(hdr.uid, h.UID);
+  formatOctal(hdr.gid, h.GID);
+  formatOctal(hdr.mtime, (std::max)(bela::ToUnixSeconds(h.ModTime), static_cast<int64_t>(0)));
+  formatOctal(hdr.devmajor, 0);
+  formatOctal(hdr.devminor, 0);
+  hdr.typeflag = h.Typeflag;
+  memcpy(hdr.magic, magicUSTAR, sizeof(hdr.magic));
+  memcpy(hdr.version, versionUSTAR, sizeof(hdr.version));
+  if (!records.empty()) {
+    ustar_header xh;
+    memset(&xh, 0, sizeof(xh));
+    auto base = suffix.substr(0, nameSize - 11);
+    formatString(xh.name, bela::StringNarrowCat("PaxHeaders/", base));
+    formatOctal(xh.mode, 0644);
+    formatOctal(xh.uid, 0);
+    formatOctal(xh.gid, 0);
+    formatOctal(xh.size, static_cast<int64_t>(records.size()));
+    formatOctal(xh.mtime, 0);
+    xh.typeflag = TypeXHeader;
+    memcpy(xh.magic, magicUSTAR, sizeof(xh.magic));
+    memcpy(xh.version, versionUSTAR, sizeof(xh.version));
+    formatChecksum(xh);
+    if (!write(&xh, blockSize, ec) || !write(records.data(), records.size(), ec) ||
+        !pad(static_cast<int64_t>(records.size()), ec)) {
+      return false;
+    }
+  }
+  formatChecksum(hdr);
+  if (!write(&hdr, blockSize, ec)) {
+    return false;
+  }
+  entries++;
+  return true;
+}
+
+bool ArchiveWriter::AddBuffer(std::string_view name, std::span<const uint8_t> data, bela::Time modified,
+                              bela::error_code &ec) {
+  Header h{.Name = std::string(name), .Size = static_cast<int64_t>(data.size()), .Mode = c_ISREG | 0644};
+  h.ModTime = modified;
+  h.Typeflag = TypeReg;
+  if (!writeHeader(h, ec)) {
+    return false;
+  }
+  if (data.size() != 0 && !write(data.data(), data.size(), ec)) {
+    return false;
+  }
+  return pad(h.Size, ec);
+}
+
+bool ArchiveWriter::AddDirectory(std::string_view name, bela::Time modified, bela::error_code &ec) {
+  Header h{.Name = std::string(name), .Mode = c_ISDIR | 0755};
+  if (!h.Name.ends_with('/')) {
+    h.Name.push_back('/');
+  }
+  h.ModTime = modified;
+  h.Typeflag = TypeDir;
+  return writeHeader(h, ec);
+}
+
+bool ArchiveWriter::AddSymlink(std::string_view name, std::string_view target, bela::Time modified,
+                               bela::error_code &ec) {
+  Header h{.Name = std::string(name), .LinkName = std::string(target), .Mode = c_ISLNK | 0777};
+  h.ModTime = modified;
+  h.Typeflag = TypeSymlink;
+  return writeHeader(h, ec);
+}
+
+bool ArchiveWriter::AddFile(std::string_view name, const std::filesystem::path &source, bela::error_code &ec) {
+  auto src = StatSource(source, name, ec);
+  if (!src) {
+    return false;
+  }
+  if (src->IsDir()) {
+    return AddDirectory(src->name, src->time, ec);
+  }
+  if (src->IsSymlink()) {
+    return AddSymlink(src->name, src->linkname, src->time, ec);
+  }
+  auto FileHandle = CreateFileW(source.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                                OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (FileHandle == INVALID_HANDLE_VALUE) {
+    ec = bela::make_system_error_code(L"CreateFileW() ");
+    return false;
+  }
+  auto closer = bela::finally([&] { CloseHandle(FileHandle); });
+  Header h{.Name = std::move(src->name),
+           .Size = static_cast<int64_t>(src->size),
+           .Mode = c_ISREG | static_cast<int64_t>(src->mode & bela::os::ModePerm)};
+  h.ModTime = src->time;
+  h.Typeflag = TypeReg;
+  if (!writeHeader(h, ec)) {
+    return false;
+  }
+  // tar header has the size, the file must not change while it is being archived
+  auto remaining = h.Size;
+  while (remaining > 0) {
+    auto len = static_cast<DWORD>((std::min)(static_cast<int64_t>(ibuf.size()), remaining));
+    DWORD dwRead = 0;
+    if (::ReadFile(FileHandle, ibuf.data(), len, &dwRead, nullptr) != TRUE) {
+      ec = bela::make_system_error_code(L"ReadFile() ");
+      return false;
+    }
+    if (dwRead == 0) {
+      ec = bela::make_error_code(ErrExtractGeneral, L"tar: '", source.native(), L"' changed while being archived");
+      return false;
+    }
+    if (!write(ibuf.data(), dwRead, ec)) {
+      return false;
+    }
+    remaining -= dwRead;
+  }
+  return pad(h.Size, ec);
+}
+
+bool ArchiveWriter::AddTree(const std::filesystem::path &root, std::string_view prefix, bela::error_code &ec) {
+  return WalkSources(
+      root, prefix,
+      [&](const Source &src, bela::error_code &ec) -> bool {
+        if (src.IsDir()) {
+          return AddDirectory(src.name, src.time, ec);
+        }
+        if (src.IsSymlink()) {
+          return AddSymlink(src.name, src.linkname, src.time, ec);
+        }
+        return AddFile(src.name, src.path, ec);
+      },
+      ec);
+}
+
+bool ArchiveWriter::Close(bela::error_code &ec) {
+  if (closed) {
+    return true;
+  }
+  if (!fd) {
+    ec = bela::make_error_code(ErrExtractGeneral, L"tar: archive not opened");
+    return false;
+  }
+  // two zero blocks mark the end of archive
+  static const uint8_t zeros[blockSize * 2] = {0};
+  if (!compressor->Write(zeros, sizeof(zeros), true, ec)) {
+    return false;
+  }
+  closed = true;
+  compressor.reset();
+  fd.Assgin(INVALID_HANDLE_VALUE, false);
+  return true;
+}
+
+} // namespace baulk::archive::tar
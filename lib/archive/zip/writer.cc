@@ -0,0 +1,732 @@
+///
+#include "zipinternal.hpp"
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <zlib-ng.h>
+#define ZSTD_STATIC_LINKING_ONLY 1
+#include <zstd.h>
+
+namespace baulk::archive::zip {
+// Thanks golang.org/src/archive/zip/writer.go
+constexpr size_t flushThreshold = 1024 * 1024;
+constexpr size_t readBufferSize = 256 * 1024;
+constexpr uint16_t flagDataDescriptor = 0x8;
+constexpr uint16_t flagUTF8 = 0x800;
+
+class writeBuf {
+public:
+  writeBuf(uint8_t *p_) : p(p_), b(p_) {}
+  template <typename T>
+    requires std::integral<T>
+  void Put(T v) {
+    for (size_t i = 0; i < sizeof(T); i++) {
+      *p++ = static_cast<uint8_t>(static_cast<std::make_unsigned_t<T>>(v) >> (i * 8));
+    }
+  }
+  size_t Size() const { return static_cast<size_t>(p - b); }
+  const uint8_t *Data() const { return b; }
+
+private:
+  uint8_t *p{nullptr};
+  uint8_t *b{nullptr};
+};
+
+using output_sink = std::function<bool(const void *data, size_t len, bela::error_code &ec)>;
+using entry_reader = std::function<bela::ssize_t(uint8_t *buffer, size_t len, bela::error_code &ec)>;
+
+class Compressor {
+public:
+  Compressor(const WriterOptions &opts, int nbWorkers_) : options(opts), nbWorkers(nbWorkers_) {}
+  Compressor(const Compressor &) = delete;
+  Compressor &operator=(const Compressor &) = delete;
+  ~Compressor() {
+    if (deflateInitialized) {
+      zng_deflateEnd(&zs);
+    }
+    if (cctx != nullptr) {
+      ZSTD_freeCCtx(cctx);
+    }
+  }
+  bool Reset(uint16_t method, bela::error_code &ec);
+  bool Write(uint16_t method, const uint8_t *data, size_t len, bool end, const output_sink &sink,
+             bela::error_code &ec);
+
+private:
+  bool deflateWrite(const uint8_t *data, size_t len, bool end, const output_sink &sink, bela::error_code &ec);
+  bool zstdWrite(const uint8_t *data, size_t len, bool end, const output_sink &sink, bela::error_code &ec);
+  WriterOptions options;
+  int nbWorkers{1};
+  zng_stream zs;
+  ZSTD_CCtx *cctx{nullptr};
+  Buffer out;
+  bool deflateInitialized{false};
+};
+
+bool Compressor::Reset(uint16_t method, bela::error_code &ec) {
+  if (out.capacity() == 0) {
+    out.grow(outsize);
+  }
+  switch (method) {
+  case ZIP_STORE:
+    return true;
+  case ZIP_DEFLATE:
+    if (deflateInitialized) {
+      zng_deflateReset(&zs);
+      return true;
+    }
+    memset(&zs, 0, sizeof(zs));
+    zs.zalloc = baulk::mem::allocate_zlib;
+    zs.zfree = baulk::mem::deallocate_simple;
+    if (auto zerr = zng_deflateInit2(&zs, options.level < 0 ? Z_DEFAULT_COMPRESSION : options.level, Z_DEFLATED,
+                                     -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+        zerr != Z_OK) {
+      ec = bela::make_error_code(ErrGeneral, bela::encode_into<char, wchar_t>(zng_zError(zerr)));
+      return false;
+    }
+    deflateInitialized = true;
+    return true;
+  case ZIP_ZSTD:
+    if (cctx != nullptr) {
+      ZSTD_CCtx_reset(cctx, ZSTD_reset_session_only);
+      return true;
+    }
+    cctx = ZSTD_createCCtx_advanced(ZSTD_customMem{
+        .customAlloc = baulk::mem::allocate_simple, .customFree = baulk::mem::deallocate_simple, .opaque = nullptr});
+    if (cctx == nullptr) {
+      ec = bela::make_error_code(L"ZSTD_createCCtx() out of memory");
+      return false;
+    }
+    ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, options.level < 0 ? ZSTD_CLEVEL_DEFAULT : options.level);
+    if (nbWorkers > 1) {
+      // large entries are split into jobs compressed by zstd worker threads, output is still a single frame
+      ZSTD_CCtx_setParameter(cctx, ZSTD_c_nbWorkers, nbWorkers);
+    }
+    return true;
+  default:
+    break;
+  }
+  ec = bela::make_error_code(ErrUnimplemented, L"zip: unsupport compression method ", method);
+  return false;
+}
+
+bool Compressor::Write(uint16_t method, const uint8_t *data, size_t len, bool end, const output_sink &sink,
+                       bela::error_code &ec) {
+  switch (method) {
+  case ZIP_STORE:
+    return len == 0 || sink(data, len, ec);
+  case ZIP_DEFLATE:
+    return deflateWrite(data, len, end, sink, ec);
+  case ZIP_ZSTD:
+    return zstdWrite(data, len, end, sink, ec);
+  default:
+    break;
+  }
+  ec = bela::make_error_code(ErrUnimplemented, L"zip: unsupport compression method ", method);
+  return false;
+}
+
+bool Compressor::deflateWrite(const uint8_t *data, size_t len, bool end, const output_sink &sink,
+                              bela::error_code &ec) {
+  zs.next_in = data;
+  zs.avail_in = static_cast<uint32_t>(len);
+  auto flush = end ? Z_FINISH : Z_NO_FLUSH;
+  for (;;) {
+    zs.next_out = out.data();
+    zs.avail_out = static_cast<uint32_t>(out.capacity());
+    auto ret = zng_deflate(&zs, flush);
+    if (ret == Z_STREAM_ERROR) {
+      ec = bela::make_error_code(ret, bela::encode_into<char, wchar_t>(zng_zError(ret)));
+      return false;
+    }
+    auto have = out.capacity() - zs.avail_out;
+    if (have != 0 && !sink(out.data(), have, ec)) {
+      return false;
+    }
+    if (end ? ret == Z_STREAM_END : (zs.avail_in == 0 && zs.avail_out != 0)) {
+      break;
+    }
+  }
+  return true;
+}
+
+bool Compressor::zstdWrite(const uint8_t *data, size_t len, bool end, const output_sink &sink, bela::error_code &ec) {
+  ZSTD_inBuffer in{data, len, 0};
+  auto mode = end ? ZSTD_e_end : ZSTD_e_continue;
+  for (;;) {
+    ZSTD_outBuffer o{out.data(), out.capacity(), 0};
+    auto remaining = ZSTD_compressStream2(cctx, &o, &in, mode);
+    if (ZSTD_isError(remaining) != 0) {
+      ec = bela::make_error_code(ErrGeneral, L"ZSTD_compressStream2: ",
+                                 bela::encode_into<char, wchar_t>(ZSTD_getErrorName(remaining)));
+      return false;
+    }
+    if (o.pos != 0 && !sink(out.data(), o.pos, ec)) {
+      return false;
+    }
+    if (end ? remaining == 0 : in.pos == in.size) {
+      break;
+    }
+  }
+  return true;
+}
+
+inline bool hasNonASCII(std::string_view name) {
+  return std::any_of(name.begin(), name.end(), [](char c) { return static_cast<uint8_t>(c) >= 0x80; });
+}
+
+inline uint32_t fileModeToUnixMode(FileMode mode) {
+  uint32_t m = 0;
+  if ((mode & FileMode::ModeDir) != 0) {
+    m = s_IFDIR;
+  } else if ((mode & FileMode::ModeSymlink) != 0) {
+    m = s_IFLNK;
+  } else {
+    m = s_IFREG;
+  }
+  return m | (static_cast<uint32_t>(mode) & 0777);
+}
+
+inline void toDosDateTime(bela::Time t, uint16_t &dosDate, uint16_t &dosTime) {
+  auto ft = bela::ToFileTime(t);
+  if (FileTimeToDosDateTime(&ft, &dosDate, &dosTime) != TRUE) {
+    // before 1980: use the minimum dos time
+    dosDate = (1 << 5) | 1;
+    dosTime = 0;
+  }
+}
+
+ArchiveWriter::ArchiveWriter() = default;
+
+ArchiveWriter::~ArchiveWriter() = default;
+
+bool ArchiveWriter::OpenWriter(std::wstring_view file, const WriterOptions &opts, bela::error_code &ec) {
+  if (fd) {
+    ec = bela::make_error_code(L"The file has been opened, the function cannot be called repeatedly");
+    return false;
+  }
+  if (opts.method != ZIP_STORE && opts.method != ZIP_DEFLATE && opts.method != ZIP_ZSTD) {
+    ec = bela::make_error_code(ErrUnimplemented, L"zip: unsupport compression method ", static_cast<int>(opts.method));
+    return false;
+  }
+  auto fd_ = bela::io::NewFile(file, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS,
+                               FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr, ec);
+  if (!fd_) {
+    return false;
+  }
+  fd = std::move(*fd_);
+  options = opts;
+  workers = options.workers > 0 ? options.workers
+                                : static_cast<int>((std::max)(std::thread::hardware_concurrency(), 1U));
+  compressor = std::make_unique<Compressor>(options, workers);
+  obuf.reserve(flushThreshold + outsize);
+  ibuf.resize(readBufferSize);
+  return true;
+}
+
+bool ArchiveWriter::flush(bela::error_code &ec) {
+  if (obuf.empty()) {
+    return true;
+  }
+  if (!bela::io::WriteFull(fd.NativeFD(), {obuf.data(), obuf.size()}, ec)) {
+    return false;
+  }
+  obuf.clear();
+  return true;
+}
+
+bool ArchiveWriter::write(const void *data, size_t len, bela::error_code &ec) {
+  auto p = reinterpret_cast<const uint8_t *>(data);
+  obuf.insert(obuf.end(), p, p + len);
+  offset += static_cast<int64_t>(len);
+  if (obuf.size() >= flushThreshold) {
+    return flush(ec);
+  }
+  return true;
+}
+
+/*
+        local file header signature     4 bytes  (0x04034b50)
+        version needed to extract       2 bytes
+        general purpose bit flag        2 bytes
+        compression method              2 bytes
+        last mod file time              2 bytes
+        last mod file date              2 bytes
+        crc-32                          4 bytes
+        compressed size                 4 bytes
+        uncompressed size               4 bytes
+        file name length                2 bytes
+        extra field length              2 bytes
+
+        file name (variable size)
+        extra field (variable size)
+*/
+bool ArchiveWriter::writeLocalHeader(File &file, bool descriptor, bela::error_code &ec) {
+  if (closed || !fd) {
+    ec = bela::make_error_code(L"zip: write to closed archive");
+    return false;
+  }
+  if (file.name.size() > uint16max) {
+    ec = bela::make_error_code(L"zip: file name too long");
+    return false;
+  }
+  file.position = static_cast<uint64_t>(offset);
+  file.version_needed = zipVersion20;
+  if (hasNonASCII(file.name)) {
+    file.flags |= flagUTF8;
+  }
+  if (descriptor) {
+    file.flags |= flagDataDescriptor;
+  }
+  uint16_t dosDate = 0;
+  uint16_t dosTime = 0;
+  toDosDateTime(file.time, dosDate, dosTime);
+  uint8_t header[fileHeaderLen + 9];
+  writeBuf b(header);
+  b.Put(static_cast<uint32_t>(fileHeaderSignature));
+  b.Put(file.version_needed);
+  b.Put(file.flags);
+  b.Put(file.method);
+  b.Put(dosTime);
+  b.Put(dosDate);
+  // with data descriptor, crc32 and sizes follow the data
+  b.Put(descriptor ? 0 : file.crc32_value);
+  b.Put(descriptor ? 0 : static_cast<uint32_t>(file.compressed_size));
+  b.Put(descriptor ? 0 : static_cast<uint32_t>(file.uncompressed_size));
+  b.Put(static_cast<uint16_t>(file.name.size()));
+  b.Put(static_cast<uint16_t>(9));
+  if (!write(b.Data(), fileHeaderLen, ec) || !write(file.name.data(), file.name.size(), ec)) {
+    return false;
+  }
+  writeBuf eb(header + fileHeaderLen);
+  eb.Put(static_cast<uint16_t>(extTimeExtraID));
+  eb.Put(static_cast<uint16_t>(5));
+  eb.Put(static_cast<uint8_t>(1)); // modification time only
+  eb.Put(static_cast<uint32_t>(bela::ToUnixSeconds(file.time)));
+  return write(eb.Data(), eb.Size(), ec);
+}
+
+// compressStream: compress everything from reader into sink, crc32 and sizes of file are updated
+bool compressStream(Compressor &c, File &file, const entry_reader &reader, std::span<uint8_t> buffer,
+                    const output_sink &sink, bela::error_code &ec) {
+  if (!c.Reset(file.method, ec)) {
+    return false;
+  }
+  uint32_t crc = 0;
+  uint64_t usize = 0;
+  uint64_t csize = 0;
+  output_sink counter = [&](const void *data, size_t len, bela::error_code &ec) -> bool {
+    csize += len;
+    return sink(data, len, ec);
+  };
+  for (;;) {
+    auto n = reader(buffer.data(), buffer.size(), ec);
+    if (n < 0) {
+      return false;
+    }
+    auto end = n == 0;
+    if (!end) {
+      crc = crc32_fast(buffer.data(), static_cast<size_t>(n), crc);
+      usize += static_cast<uint64_t>(n);
+    }
+    if (!c.Write(file.method, buffer.data(), static_cast<size_t>(n), end, counter, ec)) {
+      return false;
+    }
+    if (end) {
+      break;
+    }
+  }
+  file.crc32_value = crc;
+  file.uncompressed_size = usize;
+  file.compressed_size = csize;
+  return true;
+}
+
+bool ArchiveWriter::writeEntry(File &file, const entry_reader &reader, bela::error_code &ec) {
+  // directories have no content, everything else reports sizes and crc32 in a data descriptor
+  auto streaming = !file.IsDir();
+  if (!writeLocalHeader(file, streaming, ec)) {
+    return false;
+  }
+  if (!streaming) {
+    return true;
+  }
+  auto sink = [this](const void *data, size_t len, bela::error_code &ec) -> bool { return write(data, len, ec); };
+  if (!compressStream(*compressor, file, reader, ibuf, sink, ec)) {
+    return false;
+  }
+  uint8_t descriptor[dataDescriptor64Len];
+  writeBuf db(descriptor);
+  db.Put(dataDescriptorSignature);
+  db.Put(file.crc32_value);
+  if (file.uncompressed_size >= uint32max || file.compressed_size >= uint32max) {
+    file.version_needed = zipVersion45;
+    db.Put(file.compressed_size);
+    db.Put(file.uncompressed_size);
+  } else {
+    db.Put(static_cast<uint32_t>(file.compressed_size));
+    db.Put(static_cast<uint32_t>(file.uncompressed_size));
+  }
+  return write(db.Data(), db.Size(), ec);
+}
+
+bool ArchiveWriter::AddBuffer(std::string_view name, std::span<const uint8_t> data, bela::Time modified,
+                              bela::error_code &ec) {
+  File file{.name = std::string(name), .time = modified, .mode = static_cast<FileMode>(0644)};
+  file.method = data.size() == 0 ? ZIP_STORE : static_cast<uint16_t>(options.method);
+  size_t pos = 0;
+  auto ok = writeEntry(
+      file,
+      [&](uint8_t *buffer, size_t len, bela::error_code &) -> bela::ssize_t {
+        auto n = (std::min)(len, data.size() - pos);
+        memcpy(buffer, data.data() + pos, n);
+        pos += n;
+        return static_cast<bela::ssize_t>(n);
+      },
+      ec);
+  if (!ok) {
+    return false;
+  }
+  files.emplace_back(std::move(file));
+  return true;
+}
+
+bool ArchiveWriter::AddDirectory(std::string_view name, bela::Time modified, bela::error_code &ec) {
+  File file{.name = std::string(name), .time = modified, .mode = FileMode::ModeDir | static_cast<FileMode>(0755)};
+  if (!file.name.ends_with('/')) {
+    file.name.push_back('/');
+  }
+  file.method = ZIP_STORE;
+  if (!writeEntry(file, nullptr, ec)) {
+    return false;
+  }
+  files.emplace_back(std::move(file));
+  return true;
+}
+
+bool ArchiveWriter::AddSymlink(std::string_view name, std::string_view target, bela::Time modified,
+                               bela::error_code &ec) {
+  File file{.name = std::string(name),
+            .linkname = std::string(target),
+            .time = modified,
+            .mode = FileMode::ModeSymlink | static_cast<FileMode>(0777)};
+  file.method = ZIP_STORE;
+  size_t pos = 0;
+  auto ok = writeEntry(
+      file,
+      [&](uint8_t *buffer, size_t len, bela::error_code &) -> bela::ssize_t {
+        auto n = (std::min)(len, target.size() - pos);
+        memcpy(buffer, target.data() + pos, n);
+        pos += n;
+        return static_cast<bela::ssize_t>(n);
+      },
+      ec);
+  if (!ok) {
+    return false;
+  }
+  file.linkname.clear(); // zip stores link target as content
+  files.emplace_back(std::move(file));
+  return true;
+}
+
+class sourceFile {
+public:
+  sourceFile() = default;
+  sourceFile(const sourceFile &) = delete;
+  sourceFile &operator=(const sourceFile &) = delete;
+  ~sourceFile() {
+    if (FileHandle != INVALID_HANDLE_VALUE) {
+      CloseHandle(FileHandle);
+    }
+  }
+  bool Open(const std::filesystem::path &source, bela::error_code &ec) {
+    FileHandle = CreateFileW(source.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                             FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (FileHandle == INVALID_HANDLE_VALUE) {
+      ec = bela::make_system_error_code(L"CreateFileW() ");
+      return false;
+    }
+    return true;
+  }
+  bela::ssize_t Read(uint8_t *buffer, size_t len, bela::error_code &ec) {
+    DWORD dwRead = 0;
+    if (::ReadFile(FileHandle, buffer, static_cast<DWORD>(len), &dwRead, nullptr) != TRUE) {
+      ec = bela::make_system_error_code(L"ReadFile() ");
+      return -1;
+    }
+    return static_cast<bela::ssize_t>(dwRead);
+  }
+
+private:
+  HANDLE FileHandle{INVALID_HANDLE_VALUE};
+};
+
+bool ArchiveWriter::addSource(const Source &src, bela::error_code &ec) {
+  if (src.IsDir()) {
+    return AddDirectory(src.name, src.time, ec);
+  }
+  if (src.IsSymlink()) {
+    return AddSymlink(src.name, src.linkname, src.time, ec);
+  }
+  sourceFile sf;
+  if (!sf.Open(src.path, ec)) {
+    return false;
+  }
+  File file{.name = src.name, .time = src.time, .mode = src.mode};
+  file.method = src.size == 0 ? ZIP_STORE : static_cast<uint16_t>(options.method);
+  auto ok = writeEntry(
+      file, [&](uint8_t *buffer, size_t len, bela::error_code &ec) { return sf.Read(buffer, len, ec); }, ec);
+  if (!ok) {
+    return false;
+  }
+  files.emplace_back(std::move(file));
+  return true;
+}
+
+bool ArchiveWriter::AddFile(std::string_view name, const std::filesystem::path &source, bela::error_code &ec) {
+  auto src = StatSource(source, name, ec);
+  if (!src) {
+    return false;
+  }
+  return addSource(*src, ec);
+}
+
+// entries up to this size are compressed in memory by workers, larger ones are streamed by the writer thread
+constexpr uint64_t parallelEntryLimit = 16 * 1024 * 1024;
+
+struct pending_entry {
+  File file;
+  std::vector<uint8_t> data;
+  bela::error_code ec;
+  bool ready{false};
+  bool compressed{false};
+};
+
+bool compressSource(Compressor &c, const Source &src, zip_method_t method, std::span<uint8_t> buffer,
+                    pending_entry &e, bela::error_code &ec) {
+  sourceFile sf;
+  if (!sf.Open(src.path, ec)) {
+    return false;
+  }
+  e.file = File{.name = src.name, .time = src.time, .mode = src.mode};
+  e.file.method = static_cast<uint16_t>(method);
+  e.data.reserve(static_cast<size_t>(src.size));
+  return compressStream(
+      c, e.file, [&](uint8_t *b, size_t len, bela::error_code &ec) { return sf.Read(b, len, ec); }, buffer,
+      [&](const void *data, size_t len, bela::error_code &) -> bool {
+        auto p = reinterpret_cast<const uint8_t *>(data);
+        e.data.insert(e.data.end(), p, p + len);
+        return true;
+      },
+      ec);
+}
+
+// addParallel: workers compress entries ahead of the writer thread, output keeps the order of sources so the
+// central directory is assembled in walk order
+bool ArchiveWriter::addParallel(const std::vector<Source> &sources, bela::error_code &ec) {
+  std::vector<pending_entry> entries(sources.size());
+  std::mutex mu;
+  std::condition_variable cv;
+  size_t next = 0;
+  size_t written = 0;
+  bool canceled = false;
+  // bounds memory held by compressed entries not yet written
+  const auto window = static_cast<size_t>(workers) * 4;
+  auto worker = [&]() {
+    Compressor c(options, 1);
+    std::vector<uint8_t> buffer(readBufferSize);
+    for (;;) {
+      size_t i = 0;
+      {
+        std::unique_lock lock(mu);
+        cv.wait(lock, [&] { return canceled || next >= sources.size() || next < written + window; });
+        if (canceled || next >= sources.size()) {
+          return;
+        }
+        i = next++;
+      }
+      auto &e = entries[i];
+      const auto &src = sources[i];
+      if (!src.IsDir() && !src.IsSymlink() && src.size != 0 && src.size <= parallelEntryLimit) {
+        e.compressed = compressSource(c, src, options.method, buffer, e, e.ec);
+      }
+      {
+        std::lock_guard lock(mu);
+        e.ready = true;
+      }
+      cv.notify_all();
+    }
+  };
+  std::vector<std::jthread> threads;
+  auto stop = bela::finally([&] {
+    {
+      std::lock_guard lock(mu);
+      canceled = true;
+    }
+    cv.notify_all();
+    threads.clear();
+  });
+  for (int i = 0; i < workers; i++) {
+    threads.emplace_back(worker);
+  }
+  for (size_t i = 0; i < sources.size(); i++) {
+    {
+      std::unique_lock lock(mu);
+      cv.wait(lock, [&] { return entries[i].ready; });
+    }
+    auto &e = entries[i];
+    if (e.ec) {
+      ec = std::move(e.ec);
+      return false;
+    }
+    if (e.compressed) {
+      // sizes are known, no data descriptor is needed
+      if (!writeLocalHeader(e.file, false, ec) || !write(e.data.data(), e.data.size(), ec)) {
+        return false;
+      }
+      files.emplace_back(std::move(e.file));
+      std::vector<uint8_t>().swap(e.data);
+    } else if (!addSource(sources[i], ec)) {
+      return false;
+    }
+    {
+      std::lock_guard lock(mu);
+      written = i + 1;
+    }
+    cv.notify_all();
+  }
+  return true;
+}
+
+bool ArchiveWriter::AddTree(const std::filesystem::path &root, std::string_view prefix, bela::error_code &ec) {
+  if (workers <= 1) {
+    return WalkSources(
+        root, prefix, [&](const Source &src, bela::error_code &ec) -> bool { return addSource(src, ec); }, ec);
+  }
+  std::vector<Source> sources;
+  if (!WalkSources(
+          root, prefix,
+          [&](const Source &src, bela::error_code &) -> bool {
+            sources.emplace_back(src);
+            return true;
+          },
+          ec)) {
+    return false;
+  }
+  return addParallel(sources, ec);
+}
+
+bool ArchiveWriter::writeDirectory(bela::error_code &ec) {
+  auto start = offset;
+  std::vector<uint8_t> header(directoryHeaderLen + 28 + 9);
+  for (const auto &file : files) {
+    uint16_t dosDate = 0;
+    uint16_t dosTime = 0;
+    toDosDateTime(file.time, dosDate, dosTime);
+    auto zip64 = file.compressed_size >= uint32max || file.uncompressed_size >= uint32max || file.position >= uint32max;
+    auto version = static_cast<uint16_t>(zip64 ? zipVersion45 : file.version_needed);
+    uint32_t externalAttrs = fileModeToUnixMode(file.mode) << 16;
+    if (file.IsDir()) {
+      externalAttrs |= msdosDir;
+    }
+    if ((file.mode & 0222) == 0) {
+      externalAttrs |= msdosReadOnly;
+    }
+    writeBuf eb(header.data() + directoryHeaderLen);
+    if (zip64) {
+      // the file needs a zip64 header. store maxint in both 32 bit size fields (and offset) to signal that the
+      // zip64 extra header should be used.
+      eb.Put(static_cast<uint16_t>(zip64ExtraID));
+      eb.Put(static_cast<uint16_t>(24));
+      eb.Put(file.uncompressed_size);
+      eb.Put(file.compressed_size);
+      eb.Put(file.position);
+    }
+    eb.Put(static_cast<uint16_t>(extTimeExtraID));
+    eb.Put(static_cast<uint16_t>(5));
+    eb.Put(static_cast<uint8_t>(1));
+    eb.Put(static_cast<uint32_t>(bela::ToUnixSeconds(file.time)));
+    writeBuf b(header.data());
+    b.Put(static_cast<uint32_t>(directoryHeaderSignature));
+    b.Put(static_cast<uint16_t>((creatorUnix << 8) | version));
+    b.Put(version);
+    b.Put(file.flags);
+    b.Put(file.method);
+    b.Put(dosTime);
+    b.Put(dosDate);
+    b.Put(file.crc32_value);
+    b.Put(zip64 ? uint32max : static_cast<uint32_t>(file.compressed_size));
+    b.Put(zip64 ? uint32max : static_cast<uint32_t>(file.uncompressed_size));
+    b.Put(static_cast<uint16_t>(file.name.size()));
+    b.Put(static_cast<uint16_t>(eb.Size()));
+    b.Put(static_cast<uint16_t>(0)); // comment length
+    b.Put(static_cast<uint16_t>(0)); // disk number start
+    b.Put(static_cast<uint16_t>(0)); // internal file attributes
+    b.Put(externalAttrs);
+    b.Put(zip64 ? uint32max : static_cast<uint32_t>(file.position));
+    if (!write(header.data(), directoryHeaderLen, ec) || !write(file.name.data(), file.name.size(), ec) ||
+        !write(eb.Data(), eb.Size(), ec)) {
+      return false;
+    }
+  }
+  auto end = offset;
+  auto records = static_cast<uint64_t>(files.size());
+  auto size = static_cast<uint64_t>(end - start);
+  auto dirOffset = static_cast<uint64_t>(start);
+  if (records >= uint16max || size >= uint32max || dirOffset >= uint32max) {
+    uint8_t buf[directory64EndLen + directory64LocLen];
+    writeBuf b(buf);
+    // zip64 end of central directory record
+    b.Put(static_cast<uint32_t>(directory64EndSignature));
+    b.Put(static_cast<uint64_t>(directory64EndLen - 12)); // length minus signature (uint32) and length fields (uint64)
+    b.Put(static_cast<uint16_t>(zipVersion45));           // version made by
+    b.Put(static_cast<uint16_t>(zipVersion45));           // version needed to extract
+    b.Put(static_cast<uint32_t>(0));                      // number of this disk
+    b.Put(static_cast<uint32_t>(0));                      // number of the disk with the start of the central directory
+    b.Put(records);                                       // total number of entries in the central directory on this disk
+    b.Put(records);                                       // total number of entries in the central directory
+    b.Put(size);                                          // size of the central directory
+    b.Put(dirOffset);                                     // offset of start of central directory
+    // zip64 end of central directory locator
+    b.Put(static_cast<uint32_t>(directory64LocSignature));
+    b.Put(static_cast<uint32_t>(0)); // number of the disk with the start of the zip64 end of central directory
+    b.Put(static_cast<uint64_t>(end));
+    b.Put(static_cast<uint32_t>(1)); // total number of disks
+    if (!write(b.Data(), b.Size(), ec)) {
+      return false;
+    }
+    // store max values in the regular end record to signal that the zip64 values should be used instead
+    records = uint16max;
+    size = uint32max;
+    dirOffset = uint32max;
+  }
+  uint8_t buf[directoryEndLen];
+  writeBuf b(buf);
+  b.Put(static_cast<uint32_t>(directoryEndSignature));
+  b.Put(static_cast<uint16_t>(0)); // number of this disk
+  b.Put(static_cast<uint16_t>(0)); // number of the disk with the start of the central directory
+  b.Put(static_cast<uint16_t>(records));
+  b.Put(static_cast<uint16_t>(records));
+  b.Put(static_cast<uint32_t>(size));
+  b.Put(static_cast<uint32_t>(dirOffset));
+  b.Put(static_cast<uint16_t>(0)); // comment length
+  return write(b.Data(), b.Size(), ec);
+}
+
+bool ArchiveWriter::Close(bela::error_code &ec) {
+  if (closed) {
+    return true;
+  }
+  if (!fd) {
+    ec = bela::make_error_code(L"zip: archive not opened");
+    return false;
+  }
+  if (!writeDirectory(ec) || !flush(ec)) {
+    return false;
+  }
+  closed = true;
+  fd.Assgin(INVALID_HANDLE_VALUE, false);
+  return true;
+}
+
+} // namespace baulk::archive::zip
@@ -0,0 +1,174 @@
+//
+#include "blake3.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <thread>
+#include <bela/base.hpp>
+// belahash internals, bela's public header declares blake3_hasher too and stays out of this file
+#include <blake3_impl.h>
+
+namespace baulk::hash::blake3 {
+namespace {
+constexpr size_t unitSize = 1024 * 1024;
+constexpr uint64_t unitChunks = unitSize / BLAKE3_CHUNK_LEN;
+static_assert(std::has_single_bit(unitChunks));
+
+// helper threads alive across every TreeHasher, files hashed side by side share the cores
+std::atomic_int helpers{0};
+
+bool acquireHelper() {
+  static const int limit = static_cast<int>(std::thread::hardware_concurrency()) - 1;
+  auto n = helpers.load(std::memory_order_relaxed);
+  while (n < limit) {
+    if (helpers.compare_exchange_weak(n, n + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void parentCV(const uint8_t *left, const uint8_t *right, uint8_t flags, uint8_t *out) {
+  uint8_t block[BLAKE3_BLOCK_LEN];
+  memcpy(block, left, BLAKE3_OUT_LEN);
+  memcpy(block + BLAKE3_OUT_LEN, right, BLAKE3_OUT_LEN);
+  uint32_t cv[8];
+  memcpy(cv, IV, sizeof(cv));
+  blake3_compress_in_place(cv, block, BLAKE3_BLOCK_LEN, 0, flags | PARENT);
+  store_cv_words(out, cv);
+}
+
+// subtreeCV: a range that is not the end of the input is a power of 2 number of chunks aligned to its size
+void subtreeCV(const uint8_t *input, size_t len, uint64_t chunkCounter, uint8_t *out) {
+  auto chunks = len / BLAKE3_CHUNK_LEN;
+  if (len <= BLAKE3_CHUNK_LEN || (len % BLAKE3_CHUNK_LEN == 0 && std::has_single_bit(chunks))) {
+    // a complete subtree comes back as a row of equal sized subtrees, join them pairwise
+    uint8_t cvs[MAX_SIMD_DEGREE_OR_2 * BLAKE3_OUT_LEN];
+    auto n = blake3_compress_subtree_wide(input, len, IV, chunkCounter, 0, cvs, false);
+    for (; n > 1; n /= 2) {
+      for (size_t i = 0; i < n / 2; i++) {
+        parentCV(cvs + 2 * i * BLAKE3_OUT_LEN, cvs + (2 * i + 1) * BLAKE3_OUT_LEN, 0, cvs + i * BLAKE3_OUT_LEN);
+      }
+    }
+    memcpy(out, cvs, BLAKE3_OUT_LEN);
+    return;
+  }
+  // the largest power of 2 number of chunks that leaves the right side non-empty
+  auto leftLen = static_cast<size_t>(round_down_to_power_of_2((len - 1) / BLAKE3_CHUNK_LEN)) * BLAKE3_CHUNK_LEN;
+  uint8_t left[BLAKE3_OUT_LEN];
+  uint8_t right[BLAKE3_OUT_LEN];
+  subtreeCV(input, leftLen, chunkCounter, left);
+  subtreeCV(input + leftLen, len - leftLen, chunkCounter + leftLen / BLAKE3_CHUNK_LEN, right);
+  parentCV(left, right, 0, out);
+}
+
+// guardedSubtreeCV: the input may be a mapped view, a failed page-in must not unwind a helper thread
+bool guardedSubtreeCV(const uint8_t *input, size_t len, uint64_t chunkCounter, uint8_t *out) {
+  __try {
+    subtreeCV(input, len, chunkCounter, out);
+  } __except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH) {
+    return false;
+  }
+  return true;
+}
+} // namespace
+
+void SubtreeChainingValue(const void *input, size_t len, uint64_t chunkCounter, uint8_t out[outLength]) {
+  subtreeCV(static_cast<const uint8_t *>(input), len, chunkCounter, out);
+}
+
+void ParentChainingValue(const uint8_t left[outLength], const uint8_t right[outLength], bool isRoot,
+                         uint8_t out[outLength]) {
+  parentCV(left, right, isRoot ? ROOT : 0, out);
+}
+
+void TreeHasher::Update(const uint8_t *data, size_t len) {
+  if (!update(data, len)) {
+    // the helpers are joined and this frame holds nothing, the caller sees the fault as if it touched the page
+    RaiseException(EXCEPTION_IN_PAGE_ERROR, EXCEPTION_NONCONTINUABLE, 0, nullptr);
+  }
+}
+
+bool TreeHasher::update(const uint8_t *data, size_t len) {
+  std::vector<const uint8_t *> inputs;
+  if (!pending.empty()) {
+    auto n = (std::min)(len, unitSize - pending.size());
+    pending.insert(pending.end(), data, data + n);
+    data += n;
+    len -= n;
+    if (len == 0) {
+      return true;
+    }
+    inputs.emplace_back(pending.data());
+  }
+  // at least one byte is held back, a unit followed by more input is never the root
+  for (; len > unitSize; data += unitSize, len -= unitSize) {
+    inputs.emplace_back(data);
+  }
+  if (!hashUnits(inputs)) {
+    return false;
+  }
+  pending.assign(data, data + len);
+  return true;
+}
+
+void TreeHasher::Finalize(uint8_t out[outLength]) {
+  if (stack.empty()) {
+    blake3_hasher h;
+    blake3_hasher_init(&h);
+    blake3_hasher_update(&h, pending.data(), pending.size());
+    blake3_hasher_finalize(&h, out, outLength);
+    return;
+  }
+  uint8_t cv[BLAKE3_OUT_LEN];
+  subtreeCV(pending.data(), pending.size(), units * unitChunks, cv);
+  for (auto i = stack.size(); i > 0; i--) {
+    parentCV(stack[i - 1].data(), cv, i == 1 ? ROOT : 0, i == 1 ? out : cv);
+  }
+}
+
+bool TreeHasher::hashUnits(const std::vector<const uint8_t *> &inputs) {
+  std::vector<chainingValue> cvs(inputs.size());
+  std::atomic_size_t next{0};
+  std::atomic_bool faulted{false};
+  auto worker = [&] {
+    for (auto i = next++; i < inputs.size(); i = next++) {
+      if (!guardedSubtreeCV(inputs[i], unitSize, (units + i) * unitChunks, cvs[i].data())) {
+        faulted = true;
+        next = inputs.size();
+        return;
+      }
+    }
+  };
+  {
+    std::vector<std::jthread> threads;
+    for (size_t i = 1; i < inputs.size() && acquireHelper(); i++) {
+      threads.emplace_back([&] {
+        worker();
+        helpers.fetch_sub(1, std::memory_order_release);
+      });
+    }
+    worker();
+  }
+  if (faulted) {
+    return false;
+  }
+  for (const auto &cv : cvs) {
+    push(cv);
+  }
+  return true;
+}
+
+void TreeHasher::push(const chainingValue &cv) {
+  stack.emplace_back(cv);
+  units++;
+  // one entry per set bit of the unit count, equal neighbours are joined as soon as both are complete
+  while (stack.size() > static_cast<size_t>(std::popcount(units))) {
+    auto right = stack.back();
+    stack.pop_back();
+    parentCV(stack.back().data(), right.data(), 0, stack.back().data());
+  }
+}
+
+} // namespace baulk::hash::blake3
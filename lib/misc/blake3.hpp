@@ -0,0 +1,31 @@
+//
+#ifndef BAULK_MISC_BLAKE3_HPP
+#define BAULK_MISC_BLAKE3_HPP
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <baulk/hash.hpp>
+
+namespace baulk::hash::blake3 {
+using chainingValue = std::array<uint8_t, outLength>;
+
+// TreeHasher: whole 1 MiB subtrees are hashed on several threads and joined the way BLAKE3 joins them, the digest
+// is the one bela::hash::blake3::Hasher gives. Input after the last whole subtree waits for Finalize, it may be the
+// right edge of the root. A failed page-in of mapped input is raised again on the calling thread
+class TreeHasher {
+public:
+  void Update(const uint8_t *data, size_t len);
+  void Finalize(uint8_t out[outLength]);
+
+private:
+  std::vector<uint8_t> pending;
+  std::vector<chainingValue> stack;
+  uint64_t units{0};
+  bool update(const uint8_t *data, size_t len);
+  bool hashUnits(const std::vector<const uint8_t *> &inputs);
+  void push(const chainingValue &cv);
+};
+} // namespace baulk::hash::blake3
+
+#endif
@@ -5,31 +5,140 @@
 #include <bela/hash.hpp>
 #include <bela/ascii.hpp>
 #include <baulk/hash.hpp>
+#include "blake3.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 namespace baulk::hash {
+namespace {
+// small files are read in one call, larger ones on local disks mapped as a single view, and the rest is
+// streamed with FILE_FLAG_SEQUENTIAL_SCAN so the cache manager drops what was hashed
+constexpr int64_t singleReadLimit = 1024 * 1024;
+constexpr DWORD streamChunk = 4 * 1024 * 1024;
 
-template <typename Hasher> struct Sumizer {
-  Hasher hasher;
-  bool filechecksum(const std::filesystem::path &file, std::wstring &hv, bela::error_code &ec) {
-    HANDLE FileHandle = CreateFileW(file.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
-                                    OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
-    if (FileHandle == INVALID_HANDLE_VALUE) {
-      ec = bela::make_system_error_code();
-      return false;
-    }
-    auto closer = bela::finally([&] { CloseHandle(FileHandle); });
-    uint8_t bytes[32678];
+int64_t mappedLimit() {
+  constexpr int64_t lower = 64LL * 1024 * 1024;
+  constexpr int64_t upper = 1024LL * 1024 * 1024;
+  MEMORYSTATUSEX ms{.dwLength = sizeof(MEMORYSTATUSEX)};
+  if (GlobalMemoryStatusEx(&ms) != TRUE) {
+    return lower;
+  }
+  return std::clamp(static_cast<int64_t>(ms.ullAvailPhys / 4), lower, upper);
+}
+
+// localVolume: only files on fixed local disks are mapped, a network or removable volume can fail a page-in at any time
+bool localVolume(const std::filesystem::path &file) {
+  wchar_t root[MAX_PATH + 1];
+  return GetVolumePathNameW(file.c_str(), root, MAX_PATH) == TRUE && GetDriveTypeW(root) == DRIVE_FIXED;
+}
+
+// viewCall: pages of a mapped view are read on first touch, a read error there arrives as EXCEPTION_IN_PAGE_ERROR
+template <typename Fn> bool viewCall(Fn &fn, const uint8_t *view, size_t len) {
+  __try {
+    fn(view, len);
+  } __except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH) {
+    return false;
+  }
+  return true;
+}
+
+// readFile: hand the whole file to fn, in as few calls as the chosen strategy allows
+template <typename Fn> bool readFile(const std::filesystem::path &file, Fn &&fn, bela::error_code &ec) {
+  WIN32_FILE_ATTRIBUTE_DATA fa;
+  if (GetFileAttributesExW(file.c_str(), GetFileExInfoStandard, &fa) != TRUE) {
+    ec = bela::make_system_error_code();
+    return false;
+  }
+  auto size = static_cast<int64_t>((static_cast<uint64_t>(fa.nFileSizeHigh) << 32) | fa.nFileSizeLow);
+  auto streamed = size > mappedLimit() || !localVolume(file);
+  HANDLE FileHandle = CreateFileW(file.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                                  OPEN_EXISTING,
+                                  streamed ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (FileHandle == INVALID_HANDLE_VALUE) {
+    ec = bela::make_system_error_code();
+    return false;
+  }
+  auto closer = bela::finally([&] { CloseHandle(FileHandle); });
+  auto readChunks = [&](uint8_t *buffer, DWORD chunk) {
     for (;;) {
       DWORD dwread = 0;
-      if (ReadFile(FileHandle, bytes, sizeof(bytes), &dwread, nullptr) != TRUE) {
+      if (ReadFile(FileHandle, buffer, chunk, &dwread, nullptr) != TRUE) {
         ec = bela::make_system_error_code();
         return false;
       }
-      hasher.Update(bytes, static_cast<size_t>(dwread));
-      if (dwread < sizeof(bytes)) {
-        break;
+      fn(buffer, static_cast<size_t>(dwread));
+      if (dwread < chunk) {
+        return true;
       }
     }
+  };
+  if (size == 0) {
+    return true;
+  }
+  if (size <= singleReadLimit) {
+    // read one byte more than expected so a file that grew meanwhile is still hashed to its end
+    std::vector<uint8_t> buffer(static_cast<size_t>(size) + 1);
+    return readChunks(buffer.data(), static_cast<DWORD>(buffer.size()));
+  }
+  if (streamed) {
+    // page aligned buffer, whole pages are copied out of the cache
+    auto buffer = static_cast<uint8_t *>(VirtualAlloc(nullptr, streamChunk, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+    if (buffer == nullptr) {
+      ec = bela::make_system_error_code();
+      return false;
+    }
+    auto release = bela::finally([&] { VirtualFree(buffer, 0, MEM_RELEASE); });
+    return readChunks(buffer, streamChunk);
+  }
+  // the mapping is sized explicitly, a file that changed since it was measured fails here instead of faulting
+  LARGE_INTEGER li;
+  if (GetFileSizeEx(FileHandle, &li) != TRUE) {
+    ec = bela::make_system_error_code();
+    return false;
+  }
+  HANDLE mapping =
+      CreateFileMappingW(FileHandle, nullptr, PAGE_READONLY, static_cast<DWORD>(li.QuadPart >> 32),
+                         static_cast<DWORD>(li.QuadPart & 0xFFFFFFFF), nullptr);
+  if (mapping == nullptr) {
+    ec = bela::make_system_error_code();
+    return false;
+  }
+  auto unmap = bela::finally([&] { CloseHandle(mapping); });
+  auto view = static_cast<const uint8_t *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+  if (view == nullptr) {
+    ec = bela::make_system_error_code();
+    return false;
+  }
+  auto unview = bela::finally([&] { UnmapViewOfFile(view); });
+  if (!viewCall(fn, view, static_cast<size_t>(li.QuadPart))) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"read error in mapped view of ", file.native());
+    return false;
+  }
+  return true;
+}
+
+// treeHasher: BLAKE3 with whole subtrees hashed on several threads, same digest as bela::hash::blake3::Hasher
+struct treeHasher {
+  blake3::TreeHasher tree;
+  void Update(const void *input, size_t len) { tree.Update(static_cast<const uint8_t *>(input), len); }
+  std::wstring Finalize() {
+    uint8_t buf[blake3::outLength];
+    tree.Finalize(buf);
+    std::wstring s;
+    bela::hash::HashEncode(buf, sizeof(buf), s);
+    return s;
+  }
+};
+} // namespace
+
+template <typename Hasher> struct Sumizer {
+  Hasher hasher;
+  bool filechecksum(const std::filesystem::path &file, std::wstring &hv, bela::error_code &ec) {
+    if (!readFile(file, [&](const uint8_t *data, size_t len) { hasher.Update(data, len); }, ec)) {
+      return false;
+    }
     hv = hasher.Finalize();
     return true;
   }
@@ -87,8 +196,7 @@ std::optional<std::wstring> FileHash(const std::filesystem::path &file, hash_t m
     return sumizer(file, ec);
   }
   case hash_t::BLAKE3: {
-    Sumizer<bela::hash::blake3::Hasher> sumizer;
-    sumizer.hasher.Initialize();
+    Sumizer<treeHasher> sumizer;
     return sumizer(file, ec);
   }
   default:
@@ -98,6 +206,68 @@ std::optional<std::wstring> FileHash(const std::filesystem::path &file, hash_t m
   return std::nullopt;
 }
 
+void FileHashes(const std::vector<std::filesystem::path> &files, hash_t method, int workers, const OnFileHash &fn) {
+  auto n = files.size();
+  auto jobs = workers > 0 ? static_cast<size_t>(workers)
+                          : static_cast<size_t>((std::max)(std::thread::hardware_concurrency(), 1U));
+  jobs = (std::min)(jobs, n);
+  if (jobs <= 1) {
+    for (const auto &file : files) {
+      bela::error_code ec;
+      auto hv = FileHash(file, method, ec);
+      fn(file, hv, ec);
+    }
+    return;
+  }
+  struct result {
+    std::optional<std::wstring> hv;
+    bela::error_code ec;
+    bool done{false};
+  };
+  // workers run at most this many files ahead of the one waiting to be reported
+  const auto readAhead = jobs * 4;
+  std::vector<result> results(n);
+  std::mutex mu;
+  std::condition_variable cv;
+  size_t next = 0;
+  size_t reported = 0;
+  auto worker = [&] {
+    for (;;) {
+      size_t i = 0;
+      {
+        std::unique_lock lock(mu);
+        cv.wait(lock, [&] { return next >= n || next < reported + readAhead; });
+        if (next >= n) {
+          return;
+        }
+        i = next++;
+      }
+      bela::error_code ec;
+      auto hv = FileHash(files[i], method, ec);
+      {
+        std::lock_guard lock(mu);
+        results[i] = result{.hv = std::move(hv), .ec = std::move(ec), .done = true};
+      }
+      cv.notify_all();
+    }
+  };
+  std::vector<std::jthread> threads;
+  for (size_t i = 0; i < jobs; i++) {
+    threads.emplace_back(worker);
+  }
+  for (size_t i = 0; i < n; i++) {
+    result r;
+    {
+      std::unique_lock lock(mu);
+      cv.wait(lock, [&] { return results[i].done; });
+      r = std::move(results[i]);
+      reported = i + 1;
+    }
+    cv.notify_all();
+    fn(files[i], r.hv, r.ec);
+  }
+}
+
 struct HashPrefix {
   const std::wstring_view prefix;
   hash_t method;
@@ -146,29 +316,16 @@ bool HashEqual(const std::filesystem::path &file, std::wstring_view hash_value,
 }
 
 std::optional<file_hash_sums> HashSums(const std::filesystem::path &file, bela::error_code &ec) {
-  HANDLE FileHandle = CreateFileW(file.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
-                                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
-  if (FileHandle == INVALID_HANDLE_VALUE) {
-    ec = bela::make_system_error_code();
-    return std::nullopt;
-  }
   bela::hash::sha256::Hasher s;
   bela::hash::blake3::Hasher b;
   s.Initialize();
   b.Initialize();
-  auto closer = bela::finally([&] { CloseHandle(FileHandle); });
-  uint8_t bytes[32678];
-  for (;;) {
-    DWORD dwread = 0;
-    if (ReadFile(FileHandle, bytes, sizeof(bytes), &dwread, nullptr) != TRUE) {
-      ec = bela::make_system_error_code();
-      return std::nullopt;
-    }
-    s.Update(bytes, static_cast<size_t>(dwread));
-    b.Update(bytes, static_cast<size_t>(dwread));
-    if (dwread < sizeof(bytes)) {
-      break;
-    }
+  auto update = [&](const uint8_t *data, size_t len) {
+    s.Update(data, len);
+    b.Update(data, len);
+  };
+  if (!readFile(file, update, ec)) {
+    return std::nullopt;
   }
   return std::make_optional(file_hash_sums{.sha256sum = s.Finalize(), .blake3sum = b.Finalize()});
 }
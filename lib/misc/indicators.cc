@@ -149,7 +149,8 @@ bool ProgressBar::Execute() {
   return true;
 }
 void ProgressBar::Finish() {
-  if (state == ProgressState::Uninitialized) {
+  // not a terminal: Execute never started the worker, yet MarkFault may have changed the state
+  if (!worker) {
     return;
   }
   {
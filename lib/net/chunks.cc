@@ -0,0 +1,219 @@
+//
+#include <bela/hash.hpp>
+#include <bela/io.hpp>
+#include <bela/numbers.hpp>
+#include <bela/str_split.hpp>
+#include <bela/ascii.hpp>
+#include <bela/str_cat.hpp>
+#include <baulk/net/types.hpp>
+#include <baulk/net/chunks.hpp>
+#include <baulk/hash.hpp>
+
+namespace baulk::net {
+namespace {
+constexpr std::string_view chunks_magic = "blake3-chunks";
+
+inline bool power_of_2_chunks(int64_t blockSize) {
+  auto chunks = blockSize / BLAKE3_CHUNK_LEN;
+  return blockSize % BLAKE3_CHUNK_LEN == 0 && chunks != 0 && (chunks & (chunks - 1)) == 0;
+}
+
+inline uint64_t round_down_to_power_of_2(uint64_t x) {
+  uint64_t p = 1;
+  while (p <= x / 2) {
+    p *= 2;
+  }
+  return p;
+}
+
+ChunkManifest::cv_t chaining_value(const uint8_t *data, size_t len, size_t index, int64_t blockSize) {
+  ChunkManifest::cv_t cv;
+  auto counter = static_cast<uint64_t>(index) * static_cast<uint64_t>(blockSize / BLAKE3_CHUNK_LEN);
+  baulk::hash::blake3::SubtreeChainingValue(data, len, counter, cv.data());
+  return cv;
+}
+} // namespace
+
+bool ChunkManifest::Decode(std::string_view text, bela::error_code &ec) {
+  std::vector<std::string_view> lines = bela::StrSplit(text, bela::ByChar('\n'), bela::SkipEmpty());
+  if (lines.empty()) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"empty chunk manifest");
+    return false;
+  }
+  std::vector<std::string_view> fields = bela::StrSplit(lines[0], bela::ByChar(' '), bela::SkipEmpty());
+  if (fields.size() != 3 || fields[0] != chunks_magic || !bela::SimpleAtoi(fields[1], &blockSize) ||
+      !bela::SimpleAtoi(bela::StripTrailingAsciiWhitespace(fields[2]), &totalSize)) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"bad chunk manifest header");
+    return false;
+  }
+  if (!power_of_2_chunks(blockSize) || totalSize <= 0) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"bad chunk manifest block size ", blockSize);
+    return false;
+  }
+  cvs.clear();
+  for (size_t i = 1; i < lines.size(); i++) {
+    auto line = bela::StripTrailingAsciiWhitespace(lines[i]);
+    cv_t cv;
+    if (line.size() != cv.size() * 2 || !hash_decode(line, cv.data(), cv.size())) {
+      ec = bela::make_error_code(bela::ErrGeneral, L"bad chunk manifest line ", i + 1);
+      return false;
+    }
+    cvs.emplace_back(cv);
+  }
+  if (cvs.size() > Blocks()) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"chunk manifest has more blocks than the file");
+    return false;
+  }
+  return true;
+}
+
+std::string ChunkManifest::Encode() const {
+  constexpr char hex[] = "0123456789abcdef";
+  auto text = bela::StringCat(chunks_magic, " ", blockSize, " ", totalSize, "\n");
+  text.reserve(text.size() + cvs.size() * 65);
+  for (const auto &cv : cvs) {
+    for (auto b : cv) {
+      text.push_back(hex[b >> 4]);
+      text.push_back(hex[b & 0xF]);
+    }
+    text.push_back('\n');
+  }
+  return text;
+}
+
+bool ChunkManifest::Load(const std::filesystem::path &file, bela::error_code &ec) {
+  std::string text;
+  if (!bela::io::ReadFile(file.native(), text, ec)) {
+    return false;
+  }
+  return Decode(text, ec);
+}
+
+bool ChunkManifest::Save(const std::filesystem::path &file, bela::error_code &ec) const {
+  auto text = Encode();
+  return bela::io::AtomicWriteText(file.native(), {reinterpret_cast<const uint8_t *>(text.data()), text.size()},
+                                   ec);
+}
+
+// subtree: the node above blocks [first, first+count), split like BLAKE3's left_subtree_len
+ChunkManifest::cv_t ChunkManifest::subtree(size_t first, size_t count, int64_t bytes, bool root) const {
+  if (count == 1) {
+    return cvs[first];
+  }
+  auto leftChunks = round_down_to_power_of_2(static_cast<uint64_t>(bytes - 1) / BLAKE3_CHUNK_LEN);
+  auto leftBlocks = static_cast<size_t>(leftChunks * BLAKE3_CHUNK_LEN / static_cast<uint64_t>(blockSize));
+  auto leftBytes = static_cast<int64_t>(leftBlocks) * blockSize;
+  auto left = subtree(first, leftBlocks, leftBytes, false);
+  auto right = subtree(first + leftBlocks, count - leftBlocks, bytes - leftBytes, false);
+  cv_t cv;
+  baulk::hash::blake3::ParentChainingValue(left.data(), right.data(), root, cv.data());
+  return cv;
+}
+
+bool ChunkManifest::Matches(const uint8_t *hash, size_t len) const {
+  if (!Complete() || len != BLAKE3_OUT_LEN) {
+    // a single block is its own root, its chaining value is not the hash
+    return false;
+  }
+  auto root = subtree(0, cvs.size(), totalSize, true);
+  return memcmp(root.data(), hash, len) == 0;
+}
+
+bool ChunkManifest::BlockMatches(size_t index, const uint8_t *data, size_t len) const {
+  if (index >= cvs.size()) {
+    return false;
+  }
+  auto expected = (std::min)(blockSize, totalSize - static_cast<int64_t>(index) * blockSize);
+  if (static_cast<int64_t>(len) != expected) {
+    return false;
+  }
+  return chaining_value(data, len, index, blockSize) == cvs[index];
+}
+
+int64_t ChunkManifest::VerifiedPrefix(HANDLE fd, int64_t length, bela::error_code &ec) const {
+  std::vector<uint8_t> buffer(static_cast<size_t>(blockSize));
+  int64_t verified = 0;
+  for (size_t i = 0; i < cvs.size(); i++) {
+    auto n = (std::min)(blockSize, totalSize - verified);
+    if (verified + n > length) {
+      break;
+    }
+    if (!bela::io::Seek(fd, verified, ec) || !bela::io::ReadFull(fd, {buffer.data(), static_cast<size_t>(n)}, ec)) {
+      return -1;
+    }
+    if (!BlockMatches(i, buffer.data(), static_cast<size_t>(n))) {
+      break;
+    }
+    verified += n;
+  }
+  return verified;
+}
+
+std::optional<std::vector<size_t>> ChunkManifest::BadBlocks(HANDLE fd, bela::error_code &ec) const {
+  std::vector<uint8_t> buffer(static_cast<size_t>(blockSize));
+  std::vector<size_t> bad;
+  for (size_t i = 0; i < cvs.size(); i++) {
+    auto offset = static_cast<int64_t>(i) * blockSize;
+    auto n = static_cast<size_t>((std::min)(blockSize, totalSize - offset));
+    if (!bela::io::Seek(fd, offset, ec) || !bela::io::ReadFull(fd, {buffer.data(), n}, ec)) {
+      return std::nullopt;
+    }
+    if (!BlockMatches(i, buffer.data(), n)) {
+      bad.emplace_back(i);
+    }
+  }
+  return std::make_optional(std::move(bad));
+}
+
+bool ChunkManifest::Compute(HANDLE fd, int64_t length, bela::error_code &ec) {
+  cvs.clear();
+  if (!bela::io::Seek(fd, 0, ec)) {
+    return false;
+  }
+  std::vector<uint8_t> buffer(static_cast<size_t>(blockSize));
+  for (int64_t offset = 0; offset < length; offset += blockSize) {
+    auto n = (std::min)(blockSize, totalSize - offset);
+    if (offset + n > length) {
+      break;
+    }
+    if (!bela::io::ReadFull(fd, {buffer.data(), static_cast<size_t>(n)}, ec)) {
+      return false;
+    }
+    Append(buffer.data(), static_cast<size_t>(n));
+  }
+  return true;
+}
+
+void ChunkManifest::Append(const uint8_t *data, size_t len) {
+  cvs.emplace_back(chaining_value(data, len, cvs.size(), blockSize));
+}
+
+void ChunkBuilder::Update(const void *data, size_t len) {
+  auto p = static_cast<const uint8_t *>(data);
+  auto blockSize = static_cast<size_t>(m.BlockSize());
+  while (len > 0) {
+    if (block.empty() && len >= blockSize) {
+      m.Append(p, blockSize);
+      p += blockSize;
+      len -= blockSize;
+      continue;
+    }
+    auto n = (std::min)(len, blockSize - block.size());
+    block.insert(block.end(), p, p + n);
+    p += n;
+    len -= n;
+    if (block.size() == blockSize) {
+      m.Append(block.data(), block.size());
+      block.clear();
+    }
+  }
+}
+
+void ChunkBuilder::Finish() {
+  if (!block.empty() && m.Covered() + static_cast<int64_t>(block.size()) == m.TotalSize()) {
+    m.Append(block.data(), block.size());
+  }
+  block.clear();
+}
+
+} // namespace baulk::net
@@ -1,6 +1,8 @@
 //
 #include <bela/env.hpp>
 #include <baulk/net/client.hpp>
+#include <baulk/net/chunks.hpp>
+#include <baulk/net/tcp.hpp>
 #include <baulk/indicators.hpp>
 #include "native.hpp"
 #include "file.hpp"
@@ -113,6 +115,11 @@ std::optional<Response> HttpClient::WinRest(std::wstring_view method, std::wstri
   if (!IsNoProxy(u->host)) {
     session->set_proxy_url(proxyURL);
   }
+  if (proxyURL.empty() || IsNoProxy(u->host)) {
+    // the name comes from the process cache and lands in the system cache WinHTTP asks next
+    bela::error_code rec;
+    ResolveHost(u->host, rec);
+  }
   session->protocol_enable();
   auto conn = session->connect(u->host, u->nPort, ec);
   if (!conn) {
@@ -130,6 +137,7 @@ std::optional<Response> HttpClient::WinRest(std::wstring_view method, std::wstri
   if (insecureMode) {
     req->set_insecure_mode();
   }
+  auto slot = Scheduler::Default().Acquire(u->host, transfer_priority::metadata);
   if (!req->write_headers(hkv, cookies, 0, 0, ec)) {
     return std::nullopt;
   }
@@ -156,6 +164,8 @@ std::optional<Response> HttpClient::WinRest(std::wstring_view method, std::wstri
   if (recv_size = req->recv_completely(content_length, buffer, max_body_size, ec); recv_size < 0) {
     return std::nullopt;
   }
+  // small responses are counted once received, archives waiting for bandwidth make up for them
+  Scheduler::Default().Consume(static_cast<size_t>(recv_size), transfer_priority::metadata);
   return std::make_optional<Response>(std::move(*mr), std::move(buffer), static_cast<size_t>(recv_size));
 }
 
@@ -203,10 +213,11 @@ std::optional<std::filesystem::path> HttpClient::WinGet(std::wstring_view url, c
   if (!u) {
     return std::nullopt;
   }
+  std::wstring fetchURL(url);
   if (!ghProxy.empty() && bela::EqualsIgnoreCase(u->host, L"github.com")) {
-    auto newURL = bela::StringCat(ghProxy, url);
-    DbgPrint(L"github-proxy: %s", newURL);
-    u = native::crack_url(newURL, ec);
+    fetchURL = bela::StringCat(ghProxy, url);
+    DbgPrint(L"github-proxy: %s", fetchURL);
+    u = native::crack_url(fetchURL, ec);
     if (!u) {
       return std::nullopt;
     }
@@ -218,6 +229,11 @@ std::optional<std::filesystem::path> HttpClient::WinGet(std::wstring_view url, c
   if (!IsNoProxy(u->host)) {
     session->set_proxy_url(proxyURL);
   }
+  if (proxyURL.empty() || IsNoProxy(u->host)) {
+    // the name comes from the process cache and lands in the system cache WinHTTP asks next
+    bela::error_code rec;
+    ResolveHost(u->host, rec);
+  }
   session->protocol_enable();
   auto conn = session->connect(u->host, u->nPort, ec);
   if (!conn) {
@@ -240,6 +256,55 @@ std::optional<std::filesystem::path> HttpClient::WinGet(std::wstring_view url, c
   if (!filePart) {
     return std::nullopt;
   }
+  std::error_code e;
+  auto chunksPath =
+      bela::StringCat(std::filesystem::absolute(destination, e).native(), net_internal::part_suffix, chunks_suffix);
+  ChunkManifest chunks(chunks_block_size, filePart->FileSize());
+  std::optional<ChunkManifest> mirrorChunks;
+  if (filePart->CurrentBytes() > 0) {
+    // resume only after blocks that still match: the mirror's manifest is used when its tree ends in the expected
+    // BLAKE3 hash, otherwise the one saved when the download broke
+    net_internal::part_overlay_data expected;
+    bela::error_code cec;
+    if (net_internal::hash_construct(opts.hash_value, expected, cec) &&
+        expected.method == net_internal::hash_t::BLAKE3) {
+      if (auto resp = Get(bela::StringCat(fetchURL, chunks_suffix), cec); resp && resp->StatusCode() == 200) {
+        ChunkManifest m;
+        if (m.Decode(resp->Content(), cec) && m.TotalSize() == filePart->FileSize() &&
+            m.Matches(expected.hash, expected.hashsz)) {
+          DbgPrint(L"%s chunk manifest from mirror: %d blocks", u->filename, m.Blocks());
+          mirrorChunks = std::move(m);
+        }
+      }
+    }
+    int64_t verified = 0;
+    if (mirrorChunks) {
+      chunks = *mirrorChunks;
+      verified = chunks.VerifiedPrefix(filePart->NativeFD(), filePart->CurrentBytes(), ec);
+    } else if (chunks.Load(chunksPath, cec) && chunks.TotalSize() == filePart->FileSize()) {
+      verified = chunks.VerifiedPrefix(filePart->NativeFD(), filePart->CurrentBytes(), ec);
+    } else {
+      // no record of the blocks written before, keep them as they are
+      chunks = ChunkManifest(chunks_block_size, filePart->FileSize());
+      if (chunks.Compute(filePart->NativeFD(), filePart->CurrentBytes(), ec)) {
+        verified = chunks.Covered();
+      } else {
+        verified = -1;
+      }
+    }
+    if (verified < 0) {
+      return std::nullopt;
+    }
+    chunks.Truncate(static_cast<size_t>(verified / chunks.BlockSize()));
+    if (verified != filePart->CurrentBytes()) {
+      DbgPrint(L"%s resume from verified bytes: %d (part has %d)", u->filename, verified, filePart->CurrentBytes());
+    }
+    if (!filePart->TruncateTo(verified, ec)) {
+      return std::nullopt;
+    }
+  }
+  // the mirror manifest above is fetched before the slot is taken, a cap of one connection cannot deadlock
+  auto slot = Scheduler::Default().Acquire(u->host, opts.priority);
   // detect part download
   if (!req->write_headers(hkv, cookies, filePart->CurrentBytes(), filePart->FileSize(), ec)) {
     return std::nullopt;
@@ -287,6 +352,7 @@ std::optional<std::filesystem::path> HttpClient::WinGet(std::wstring_view url, c
     if (!filePart->Truncated(ec)) {
       return std::nullopt;
     }
+    chunks = ChunkManifest(chunks_block_size, total_size);
     // else:  // part download support
   } else {
     total_size += filePart->CurrentBytes();
@@ -298,18 +364,29 @@ std::optional<std::filesystem::path> HttpClient::WinGet(std::wstring_view url, c
     bar.Maximum(static_cast<uint64_t>(total_size));
   }
   bar.FileName(destination.filename().native());
-  bar.Execute();
+  if (!opts.progress) {
+    bar.Execute();
+  }
   auto finish = bela::finally([&] {
     // finish progressbar
     bar.Finish();
   });
   int64_t current_bytes = filePart->CurrentBytes();
+  auto update = [&] {
+    bar.Update(current_bytes);
+    if (opts.progress) {
+      opts.progress(current_bytes, total_size);
+    }
+  };
+  update();
+  ChunkBuilder builder(chunks);
 
   auto save_part_overlay = [&] {
     if (!part_support) {
       return;
     }
     bela::error_code discard_ec;
+    chunks.Save(chunksPath, discard_ec);
     filePart->SaveOverlayData(opts.hash_value, total_size, current_bytes, discard_ec);
     DbgPrint(L"%s download broken for bytes: %d-%d", u->filename, current_bytes, total_size);
   };
@@ -325,6 +402,8 @@ std::optional<std::filesystem::path> HttpClient::WinGet(std::wstring_view url, c
       bar.MarkFault();
       return std::nullopt;
     }
+    dwSize = static_cast<DWORD>(Scheduler::Default().ReadSize(dwSize));
+    Scheduler::Default().Consume(dwSize, opts.priority);
     if (buffer.size() < dwSize) {
       buffer.resize(static_cast<size_t>(dwSize) * 2);
     }
@@ -334,9 +413,16 @@ std::optional<std::filesystem::path> HttpClient::WinGet(std::wstring_view url, c
       bar.MarkFault();
       return std::nullopt;
     }
-    filePart->WriteFull(buffer.data(), static_cast<size_t>(downloaded_size), ec);
-    current_bytes += dwSize;
-    bar.Update(current_bytes);
+    if (!filePart->WriteFull(buffer.data(), static_cast<size_t>(downloaded_size), ec)) {
+      save_part_overlay();
+      bar.MarkFault();
+      return std::nullopt;
+    }
+    if (part_support) {
+      builder.Update(buffer.data(), static_cast<size_t>(downloaded_size));
+    }
+    current_bytes += downloaded_size;
+    update();
   } while (dwSize > 0);
 
   if (total_size != 0 && current_bytes < total_size) {
@@ -346,7 +432,59 @@ std::optional<std::filesystem::path> HttpClient::WinGet(std::wstring_view url, c
     save_part_overlay();
     return std::nullopt;
   }
+  builder.Finish();
+  // blocks of a resumed file that do not match the mirror's manifest are fetched again, not the whole file
+  auto repair_blocks = [&]() -> bool {
+    auto bad = mirrorChunks->BadBlocks(filePart->NativeFD(), ec);
+    if (!bad) {
+      return false;
+    }
+    for (auto index : *bad) {
+      auto offset = static_cast<int64_t>(index) * mirrorChunks->BlockSize();
+      auto length = (std::min)(mirrorChunks->BlockSize(), mirrorChunks->TotalSize() - offset);
+      DbgPrint(L"%s block %d mismatch, fetch bytes: %d-%d", u->filename, index, offset, offset + length - 1);
+      auto blockReq = conn->open_request(L"GET", u->uri, flags, ec);
+      if (!blockReq) {
+        return false;
+      }
+      if (insecureMode) {
+        blockReq->set_insecure_mode();
+      }
+      auto rangeHeaders = hkv;
+      rangeHeaders[L"Range"] = bela::StringCat(L"bytes=", offset, L"-", offset + length - 1);
+      if (!blockReq->write_headers(rangeHeaders, cookies, 0, 0, ec) || !blockReq->write_body(L"", L"", ec)) {
+        return false;
+      }
+      auto br = blockReq->recv_minimal_response(ec);
+      if (!br) {
+        return false;
+      }
+      if (br->status_code != 206) {
+        ec = bela::make_error_code(bela::ErrGeneral, L"block ", index, L" response: ", br->status_code);
+        return false;
+      }
+      std::vector<char> block;
+      if (blockReq->recv_completely(length, block, max_body_size, ec) != length) {
+        return false;
+      }
+      Scheduler::Default().Consume(block.size(), opts.priority);
+      if (!mirrorChunks->BlockMatches(index, reinterpret_cast<const uint8_t *>(block.data()), block.size())) {
+        ec = bela::make_error_code(bela::ErrGeneral, L"block ", index, L" still mismatch after refetch");
+        return false;
+      }
+      if (!filePart->WriteAt(offset, block.data(), block.size(), ec)) {
+        return false;
+      }
+    }
+    return true;
+  };
+  if (mirrorChunks && !repair_blocks()) {
+    bar.MarkFault();
+    bar.MarkCompleted();
+    return std::nullopt;
+  }
   filePart->Solidified(ec);
+  std::filesystem::remove(chunksPath, e);
   bar.MarkCompleted();
   return std::make_optional(std::move(destination));
 }
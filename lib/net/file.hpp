@@ -158,6 +158,21 @@ public:
     total_bytes = 0;
     return true;
   }
+  auto NativeFD() const { return fd; }
+  // TruncateTo: drop everything after pos and continue writing there
+  bool TruncateTo(int64_t pos, bela::error_code &ec) {
+    if (!truncated_file(fd, pos, ec)) {
+      return false;
+    }
+    current_bytes = pos;
+    return true;
+  }
+  bool WriteAt(int64_t pos, const void *data, size_t bytes, bela::error_code &ec) {
+    if (!bela::io::Seek(fd, pos, ec)) {
+      return false;
+    }
+    return WriteFull(data, bytes, ec);
+  }
   bool SaveOverlayData(std::wstring_view hash_value, int64_t total_bytes, int64_t current_bytes, bela::error_code &ec) {
     if (!discard_file_handle) {
       ec = bela::make_error_code(L"FilePart not a discard file");
@@ -258,7 +258,7 @@ public:
     // part download
     if (position > 0) {
       // https://developer.mozilla.org/zh-CN/docs/Web/HTTP/Headers/Range
-      bela::StrAppend(&flattened_headers, L"Range: bytes=", position, L"-");
+      bela::StrAppend(&flattened_headers, L"Range: bytes=", position, L"-\r\n");
     }
     if (!cookies.empty()) {
       bela::StrAppend(&flattened_headers, L"Cookie: ", bela::StrJoin(cookies, L"; "), L"\r\n");
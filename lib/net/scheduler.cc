@@ -0,0 +1,160 @@
+//
+#include <bela/env.hpp>
+#include <bela/ascii.hpp>
+#include <bela/match.hpp>
+#include <bela/numbers.hpp>
+#include <bela/terminal.hpp>
+#include <baulk/net/scheduler.hpp>
+
+namespace baulk::net {
+namespace {
+// a limited transfer never reads more than this at once, so it advances in small steps
+constexpr size_t limited_read_size = 64 * 1024;
+
+// burst: a tenth of a second of traffic, at least one read
+inline double burst(uint64_t rate) {
+  return (std::max)(static_cast<double>(rate) / 10, static_cast<double>(limited_read_size));
+}
+
+// rank: higher priority sorts first in a ticket set
+constexpr int rank(transfer_priority priority) { return -static_cast<int>(priority); }
+} // namespace
+
+std::optional<uint64_t> ParseBytes(std::wstring_view sv) {
+  sv = bela::StripAsciiWhitespace(sv);
+  if (bela::EndsWithIgnoreCase(sv, L"B")) {
+    sv.remove_suffix(1);
+  }
+  uint64_t unit = 1;
+  if (!sv.empty()) {
+    switch (bela::ascii_toupper(sv.back())) {
+    case 'K':
+      unit = 1024ULL;
+      break;
+    case 'M':
+      unit = 1024ULL * 1024;
+      break;
+    case 'G':
+      unit = 1024ULL * 1024 * 1024;
+      break;
+    default:
+      break;
+    }
+  }
+  if (unit != 1) {
+    sv.remove_suffix(1);
+  }
+  uint64_t n = 0;
+  if (!bela::SimpleAtoi(sv, &n) || n > UINT64_MAX / unit) {
+    // a wrapped product would turn a huge quota into a tiny one
+    return std::nullopt;
+  }
+  return std::make_optional(n * unit);
+}
+
+void Scheduler::SetRateLimit(uint64_t bytesPerSecond) {
+  std::lock_guard lock(mu);
+  rate = bytesPerSecond;
+  tokens = bytesPerSecond == 0 ? 0 : burst(bytesPerSecond);
+  last = std::chrono::steady_clock::now();
+  cv.notify_all();
+}
+
+void Scheduler::SetHostConnections(size_t n) {
+  std::lock_guard lock(mu);
+  hostConnections = n;
+  cv.notify_all();
+}
+
+bool Scheduler::InitializeFromEnv() {
+  if (auto limit = bela::GetEnv(L"BAULK_RATE_LIMIT"); !limit.empty()) {
+    auto n = ParseBytes(limit);
+    if (!n) {
+      bela::FPrintF(stderr, L"baulk: \x1b[33mignore bad BAULK_RATE_LIMIT '%s'\x1b[0m\n", limit);
+      return false;
+    }
+    SetRateLimit(*n);
+  }
+  if (auto connections = bela::GetEnv(L"BAULK_HOST_CONNECTIONS"); !connections.empty()) {
+    size_t n = 0;
+    if (!bela::SimpleAtoi(connections, &n)) {
+      bela::FPrintF(stderr, L"baulk: \x1b[33mignore bad BAULK_HOST_CONNECTIONS '%s'\x1b[0m\n", connections);
+      return false;
+    }
+    SetHostConnections(n);
+  }
+  return true;
+}
+
+Scheduler::Slot Scheduler::Acquire(std::wstring_view host, transfer_priority priority) {
+  std::unique_lock lock(mu);
+  auto it = hosts.find(host);
+  if (it == hosts.end()) {
+    it = hosts.emplace(std::wstring(host), host_state{}).first;
+  }
+  auto &hs = it->second;
+  ticket t{rank(priority), sequence++};
+  hs.waiters.emplace(t);
+  cv.wait(lock, [&] {
+    auto limit = hostConnections.load();
+    return *hs.waiters.begin() == t && (limit == 0 || hs.active < limit);
+  });
+  hs.waiters.erase(t);
+  hs.active++;
+  // the next waiter of this host may fit as well
+  cv.notify_all();
+  return Slot(this, it->first);
+}
+
+void Scheduler::release(const std::wstring &host) {
+  std::lock_guard lock(mu);
+  if (auto it = hosts.find(host); it != hosts.end()) {
+    it->second.active--;
+    if (it->second.active == 0 && it->second.waiters.empty()) {
+      hosts.erase(it);
+    }
+  }
+  cv.notify_all();
+}
+
+void Scheduler::refill(std::chrono::steady_clock::time_point now) {
+  auto elapsed = std::chrono::duration<double>(now - last).count();
+  last = now;
+  tokens = (std::min)(tokens + elapsed * static_cast<double>(rate), burst(rate));
+}
+
+void Scheduler::Consume(size_t len, transfer_priority priority) {
+  if (len == 0 || rate == 0) {
+    return;
+  }
+  std::unique_lock lock(mu);
+  ticket t{rank(priority), sequence++};
+  consumers.emplace(t);
+  for (;;) {
+    if (rate == 0) {
+      break;
+    }
+    refill(std::chrono::steady_clock::now());
+    // a read larger than the burst goes into debt instead of waiting forever
+    auto need = (std::min)(static_cast<double>(len), burst(rate));
+    if (*consumers.begin() == t) {
+      if (tokens >= need) {
+        tokens -= static_cast<double>(len);
+        break;
+      }
+      cv.wait_for(lock, std::chrono::duration<double>((need - tokens) / static_cast<double>(rate)));
+      continue;
+    }
+    cv.wait(lock);
+  }
+  consumers.erase(t);
+  cv.notify_all();
+}
+
+size_t Scheduler::ReadSize(size_t available) const {
+  if (rate == 0) {
+    return available;
+  }
+  return (std::min)(available, limited_read_size);
+}
+} // namespace baulk::net
@@ -39,7 +39,8 @@ std::wstring_view BestUrlInternal(const std::vector<std::wstring> &urls, std::ws
       return url;
     }
   }
-  // Second round of analysis of network connection establishment time
+  // Second round of analysis of network connection establishment time, names resolve side by side
+  PrefetchHosts(urls);
   for (size_t i = 0; i < urls.size(); i++) {
     // connect url to get elapsed timeout
     auto resptime = UrlResponseTime(urls[i]);
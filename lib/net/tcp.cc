@@ -1,39 +1,24 @@
 //
 #include <bela/base.hpp>
+#include <bela/ascii.hpp>
 #include <bela/terminal.hpp>
+#include <algorithm>
 #include <atomic>
+#include <condition_variable>
+#include <mutex>
 #include <thread>
+#include <unordered_map>
 #include <winsock2.h>
 #include <ws2tcpip.h>
+#include <windns.h>
 #include <baulk/net/tcp.hpp>
+#include "native.hpp"
 
 namespace baulk::net {
 // WSAConnectByName
 // https://docs.microsoft.com/zh-cn/windows/win32/api/winsock2/nf-winsock2-wsaconnectbynamew
 // RIO
 // https://docs.microsoft.com/zh-cn/windows/win32/api/mswsock/ns-mswsock-rio_extension_function_table
-class winsock_initializer {
-public:
-  winsock_initializer() {
-    WORD wVersionRequested = MAKEWORD(2, 2);
-    WSADATA wsaData;
-    if (auto err = WSAStartup(wVersionRequested, &wsaData); err != 0) {
-      auto ec = bela::make_system_error_code();
-      bela::FPrintF(stderr, L"BUGS WSAStartup %s\n", ec);
-      return;
-    }
-    initialized = true;
-  }
-  ~winsock_initializer() {
-    if (initialized) {
-      WSACleanup();
-    }
-  }
-
-private:
-  std::atomic_bool initialized{false};
-};
-
 constexpr bool InProgress(int rv) { return rv == WSAEWOULDBLOCK || rv == WSAEINPROGRESS; }
 
 inline bela::error_code make_wsa_error_code(int code, std::wstring_view prefix = L"") {
@@ -155,13 +140,13 @@ ssize_t Conn::ReadTimeout(char *buf, size_t len, int timeout) const {
   return -1;
 }
 
-bool DialTimeoutInternal(BAULKSOCK sock, const ADDRINFOEX4 *hi, int timeout, bela::error_code &ec) {
+bool DialTimeoutInternal(BAULKSOCK sock, const sockaddr *addr, int addrlen, int timeout, bela::error_code &ec) {
   ULONG flags = 1;
   if (ioctlsocket(sock, FIONBIO, &flags) == SOCKET_ERROR) {
     ec = make_wsa_error_code(WSAGetLastError(), L"ioctlsocket() ");
     return false;
   }
-  if (connect(sock, hi->ai_addr, static_cast<int>(hi->ai_addrlen)) != SOCKET_ERROR) {
+  if (connect(sock, addr, addrlen) != SOCKET_ERROR) {
     // success
     return true;
   }
@@ -184,36 +169,225 @@ bool DialTimeoutInternal(BAULKSOCK sock, const ADDRINFOEX4 *hi, int timeout, bel
   return true;
 }
 
-std::optional<Conn> DialTimeout(std::wstring_view address, int port, int timeout, bela::error_code &ec) {
-  static winsock_initializer initializer_;
+namespace {
+// GetAddrInfoExW does not tell the record TTL, the system resolver cache does
+constexpr auto fallback_ttl = std::chrono::seconds(60);
+constexpr auto maximum_ttl = std::chrono::minutes(5);
+
+struct resolved_address {
+  sockaddr_storage addr;
+  int len{0};
+};
+
+struct resolved_host {
+  std::vector<resolved_address> addresses;
+  std::chrono::steady_clock::time_point expires;
+  bool resolving{false};
+};
+
+std::chrono::seconds record_ttl(const std::wstring &host) {
+  uint32_t ttl = 0;
+  for (auto type : {DNS_TYPE_A, DNS_TYPE_AAAA}) {
+    PDNS_RECORD records = nullptr;
+    // no wire query: only what the lookup above left in the system cache
+    if (DnsQuery_W(host.data(), type, DNS_QUERY_NO_WIRE_QUERY, nullptr, &records, nullptr) != ERROR_SUCCESS) {
+      continue;
+    }
+    for (auto r = records; r != nullptr; r = r->pNext) {
+      if (r->wType == type && (ttl == 0 || r->dwTtl < ttl)) {
+        ttl = r->dwTtl;
+      }
+    }
+    DnsRecordListFree(records, DnsFreeRecordList);
+  }
+  if (ttl == 0) {
+    return fallback_ttl;
+  }
+  return (std::min)(std::chrono::seconds(ttl), std::chrono::duration_cast<std::chrono::seconds>(maximum_ttl));
+}
+
+class resolver {
+public:
+  static resolver &Default() {
+    // never destroyed: detached prefetches may still use it while statics are torn down
+    static auto r = new resolver;
+    return *r;
+  }
+  std::optional<std::vector<resolved_address>> Resolve(std::wstring_view host, bool prefetch, bela::error_code &ec);
+  bool Fresh(const std::wstring &key);
+  resolver_stats Stats() {
+    std::lock_guard lock(mu);
+    return stats;
+  }
+
+private:
+  std::mutex mu;
+  std::condition_variable cv;
+  std::unordered_map<std::wstring, resolved_host> hosts;
+  resolver_stats stats;
+};
+
+bool resolver::Fresh(const std::wstring &key) {
+  std::lock_guard lock(mu);
+  auto it = hosts.find(key);
+  return it != hosts.end() && (it->second.resolving || it->second.expires > std::chrono::steady_clock::now());
+}
+
+std::optional<std::vector<resolved_address>> resolver::Resolve(std::wstring_view host, bool prefetch,
+                                                               bela::error_code &ec) {
+  auto key = bela::AsciiStrToLower(host);
+  auto begin = std::chrono::steady_clock::now();
+  std::unique_lock lock(mu);
+  auto account = [&](bool hit) {
+    if (prefetch) {
+      stats.prefetched++;
+      return;
+    }
+    stats.lookups++;
+    stats.hits += hit ? 1 : 0;
+    stats.elapsed +=
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+  };
+  auto &e = hosts[key];
+  // a prefetch of the same host is in flight: wait for its answer instead of asking twice
+  cv.wait(lock, [&] { return !e.resolving; });
+  if (!e.addresses.empty() && e.expires > std::chrono::steady_clock::now()) {
+    account(true);
+    return std::make_optional(e.addresses);
+  }
+  e.resolving = true;
+  lock.unlock();
+  std::vector<resolved_address> addresses;
   PADDRINFOEX4 rhints = nullptr;
-  if (!ResolveName(address, port, &rhints, ec)) {
+  auto ok = ResolveName(key, 0, &rhints, ec);
+  if (ok) {
+    for (auto hi = rhints; hi != nullptr; hi = hi->ai_next) {
+      if (hi->ai_addr == nullptr || hi->ai_addrlen > sizeof(sockaddr_storage)) {
+        continue;
+      }
+      auto &a = addresses.emplace_back();
+      memcpy(&a.addr, hi->ai_addr, hi->ai_addrlen);
+      a.len = static_cast<int>(hi->ai_addrlen);
+    }
+    FreeAddrInfoExW(reinterpret_cast<ADDRINFOEXW *>(rhints)); /// Release
+  }
+  auto expires = std::chrono::steady_clock::now() + record_ttl(key);
+  lock.lock();
+  e.resolving = false;
+  if (ok && !addresses.empty()) {
+    e.addresses = addresses;
+    e.expires = expires;
+  }
+  cv.notify_all();
+  account(false);
+  if (!ok) {
+    return std::nullopt;
+  }
+  if (addresses.empty()) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"GetAddrInfoEx() ", host, L" no address");
+    return std::nullopt;
+  }
+  return std::make_optional(std::move(addresses));
+}
+
+// prefetches still resolving, their detached threads may outlive main
+std::atomic_int prefetching{0};
+
+class winsock_initializer {
+public:
+  winsock_initializer() {
+    WORD wVersionRequested = MAKEWORD(2, 2);
+    WSADATA wsaData;
+    if (auto err = WSAStartup(wVersionRequested, &wsaData); err != 0) {
+      auto ec = bela::make_system_error_code();
+      bela::FPrintF(stderr, L"BUGS WSAStartup %s\n", ec);
+      return;
+    }
+    initialized = true;
+  }
+  ~winsock_initializer() {
+    // a prefetch still in GetAddrInfoExW keeps winsock, the process is going away anyway
+    if (initialized && prefetching.load() == 0) {
+      WSACleanup();
+    }
+  }
+
+private:
+  std::atomic_bool initialized{false};
+};
+
+inline void initialize_winsock() { static winsock_initializer initializer_; }
+
+inline void set_port(resolved_address &a, int port) {
+  if (a.addr.ss_family == AF_INET) {
+    reinterpret_cast<sockaddr_in *>(&a.addr)->sin_port = htons(static_cast<u_short>(port));
+    return;
+  }
+  if (a.addr.ss_family == AF_INET6) {
+    reinterpret_cast<sockaddr_in6 *>(&a.addr)->sin6_port = htons(static_cast<u_short>(port));
+  }
+}
+} // namespace
+
+bool ResolveHost(std::wstring_view host, bela::error_code &ec) {
+  initialize_winsock();
+  return resolver::Default().Resolve(host, false, ec).has_value();
+}
+
+void PrefetchHosts(const std::vector<std::wstring> &urls) {
+  initialize_winsock();
+  std::vector<std::wstring> pending;
+  for (const auto &url : urls) {
+    bela::error_code ec;
+    auto u = native::crack_url(url, ec);
+    if (!u || u->host.empty()) {
+      continue;
+    }
+    auto key = bela::AsciiStrToLower(u->host);
+    if (std::find(pending.begin(), pending.end(), key) != pending.end() || resolver::Default().Fresh(key)) {
+      continue;
+    }
+    pending.emplace_back(std::move(key));
+  }
+  for (auto &host : pending) {
+    prefetching++;
+    std::thread([host = std::move(host)] {
+      bela::error_code ec;
+      resolver::Default().Resolve(host, true, ec);
+      prefetching--;
+    }).detach();
+  }
+}
+
+resolver_stats ResolverStats() { return resolver::Default().Stats(); }
+
+std::optional<Conn> DialTimeout(std::wstring_view address, int port, int timeout, bela::error_code &ec) {
+  initialize_winsock();
+  auto addresses = resolver::Default().Resolve(address, false, ec);
+  if (!addresses) {
     bela::FPrintF(stderr, L"GetAddrInfoExW %s\n", ec);
     return std::nullopt;
   }
-  auto hi = rhints;
   SOCKET sock{BAULK_INVALID_SOCKET};
-  do {
-    sock = socket(rhints->ai_family, SOCK_STREAM, 0);
+  for (auto &a : *addresses) {
+    set_port(a, port);
+    sock = socket(a.addr.ss_family, SOCK_STREAM, 0);
     if (sock == BAULK_INVALID_SOCKET) {
       ec = make_wsa_error_code(WSAGetLastError(), L"socket() ");
       continue;
     }
-    if (DialTimeoutInternal(sock, hi, timeout, ec)) {
+    if (DialTimeoutInternal(sock, reinterpret_cast<const sockaddr *>(&a.addr), a.len, timeout, ec)) {
       break;
     }
     closesocket(sock);
     sock = BAULK_INVALID_SOCKET;
-  } while ((hi = hi->ai_next) != nullptr);
-
+  }
   if (sock == BAULK_INVALID_SOCKET) {
     if (ec) {
       ec = bela::make_error_code(bela::ErrGeneral, L"connect to ", address, L" timeout");
     }
-    FreeAddrInfoExW(reinterpret_cast<ADDRINFOEXW *>(rhints)); /// Release
     return std::nullopt;
   }
-  FreeAddrInfoExW(reinterpret_cast<ADDRINFOEXW *>(rhints)); /// Release
   return std::make_optional<baulk::net::Conn>(sock);
 }
 } // namespace baulk::net
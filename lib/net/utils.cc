@@ -26,6 +26,23 @@ std::string url_decode(std::wstring_view url) {
   }
   return buf;
 }
+std::wstring url_encode(std::wstring_view value) {
+  constexpr std::string_view hex = "0123456789ABCDEF";
+  auto u8 = bela::encode_into<wchar_t, char>(value);
+  std::wstring buf;
+  buf.reserve(u8.size() * 3);
+  for (auto c : u8) {
+    auto ch = static_cast<uint8_t>(c);
+    if (bela::ascii_isalnum(static_cast<char8_t>(ch)) || ch == '-' || ch == '.' || ch == '_' || ch == '~') {
+      buf += static_cast<wchar_t>(ch);
+      continue;
+    }
+    buf += L'%';
+    buf += static_cast<wchar_t>(hex[ch >> 4]);
+    buf += static_cast<wchar_t>(hex[ch & 0xF]);
+  }
+  return buf;
+}
 #ifdef __AVX__
 #endif
 
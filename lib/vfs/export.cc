@@ -59,6 +59,9 @@ std::wstring AppPackageFolder(std::wstring_view packageName) {
 // AppPackageVFS
 std::wstring AppPackageVFS(std::wstring_view packageName) { return PathFs::Instance().PackageVFS(packageName); }
 
+// AppStore content-addressed file store
+std::wstring AppStore() { return bela::StringCat(PathFs::Instance().Table().packages, L"\\.store"); }
+
 // AppFsMutexPath pid file path
 std::wstring AppFsMutexPath() { return bela::StringCat(PathFs::Instance().Table().temp, L"\\baulk.pid"); }
 // AppDefaultProfile
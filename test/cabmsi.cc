@@ -0,0 +1,193 @@
+///
+#include <baulk/archive.hpp>
+#include <baulk/archive/cab.hpp>
+#include <baulk/archive/msi.hpp>
+#include <bela/terminal.hpp>
+#include <bela/io.hpp>
+#include <cstdio>
+#include <filesystem>
+#include <map>
+
+// sample.cab and sample.msi come from fixtures/mkfixtures.py, the contents below must match its generators
+namespace cab = baulk::archive::cab;
+namespace msi = baulk::archive::msi;
+
+std::string fixtureReadme() {
+  std::string s;
+  char line[96];
+  for (int i = 0; s.size() < 40000; i++) {
+    auto n = snprintf(line, sizeof(line), "%05d baulk cabinet fixture, deflate frames share a 32K history\n", i);
+    s.append(line, static_cast<size_t>(n));
+  }
+  s.resize(40000);
+  return s;
+}
+
+std::string fixtureLibrary() {
+  std::string s;
+  uint32_t x = 2463534242;
+  while (s.size() < 50001) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    if (!s.empty() && x % 4 != 0) {
+      auto off = 1 + (x >> 8) % (std::min)(static_cast<uint32_t>(s.size()), 4000U);
+      auto n = 3 + (x >> 20) % 60;
+      for (uint32_t i = 0; i < n; i++) {
+        s.push_back(s[s.size() - off]);
+      }
+      continue;
+    }
+    s.push_back(static_cast<char>(x >> 24));
+  }
+  s.resize(50001);
+  return s;
+}
+
+const std::map<std::string, std::string> &fixtureContent() {
+  static const std::map<std::string, std::string> contents{
+      {"readme.txt", fixtureReadme()},
+      {"empty.txt", ""},
+      {"notes.txt", "MSZIP and LZX folders\r\n"},
+      {"sample.dll", fixtureLibrary()},
+  };
+  return contents;
+}
+
+bool checkCabinet(const std::filesystem::path &dir) {
+  bela::error_code ec;
+  auto source = cab::NewFileSource((dir / L"sample.cab").native(), ec);
+  cab::Reader r;
+  if (!source || !r.OpenReader(source, ec) || !r.CheckMethods(ec)) {
+    bela::FPrintF(stderr, L"open sample.cab error: %s\n", ec);
+    return false;
+  }
+  if (r.Folders().size() != 2 || r.Folders()[0].Method() != cab::compressMSZIP ||
+      r.Folders()[1].Method() != cab::compressLZX || r.Folders()[1].WindowBits() != 16) {
+    bela::FPrintF(stderr, L"sample.cab: unexpected folders\n");
+    return false;
+  }
+  std::map<std::string, std::string> got;
+  cab::Reader::FolderHandler h{
+      .begin = [&](const cab::File &file, bela::error_code &) -> bool {
+        got[file.name].clear();
+        return true;
+      },
+      .write = [&](const cab::File &file, const void *data, size_t len, bela::error_code &) -> bool {
+        got[file.name].append(static_cast<const char *>(data), len);
+        return true;
+      },
+      .end = [](const cab::File &, bela::error_code &) -> bool { return true; },
+  };
+  for (size_t i = 0; i < r.Folders().size(); i++) {
+    if (!r.DecompressFolder(i, h, ec)) {
+      bela::FPrintF(stderr, L"sample.cab: folder %d error: %s\n", i, ec);
+      return false;
+    }
+  }
+  if (got != fixtureContent()) {
+    bela::FPrintF(stderr, L"sample.cab: decoded contents do not match\n");
+    return false;
+  }
+  return true;
+}
+
+// makecab-*.cab: cabinets built by Microsoft's makecab/cabarc from the files written by mkfixtures.py --sources, they
+// are checked when present next to sample.cab
+int checkMicrosoftCabinets(const std::filesystem::path &dir) {
+  int checked = 0;
+  for (const auto name : {L"makecab-mszip.cab", L"makecab-lzx.cab"}) {
+    std::error_code e;
+    if (!std::filesystem::exists(dir / name, e)) {
+      continue;
+    }
+    bela::error_code ec;
+    auto source = cab::NewFileSource((dir / name).native(), ec);
+    cab::Reader r;
+    if (!source || !r.OpenReader(source, ec) || !r.CheckMethods(ec)) {
+      bela::FPrintF(stderr, L"open %s error: %s\n", name, ec);
+      return -1;
+    }
+    std::map<std::string, std::string> got;
+    cab::Reader::FolderHandler h{
+        .begin = [&](const cab::File &file, bela::error_code &) -> bool {
+          got[file.name].clear();
+          return true;
+        },
+        .write = [&](const cab::File &file, const void *data, size_t len, bela::error_code &) -> bool {
+          got[file.name].append(static_cast<const char *>(data), len);
+          return true;
+        },
+        .end = [](const cab::File &, bela::error_code &) -> bool { return true; },
+    };
+    for (size_t i = 0; i < r.Folders().size(); i++) {
+      if (!r.DecompressFolder(i, h, ec)) {
+        bela::FPrintF(stderr, L"%s: folder %d error: %s\n", name, i, ec);
+        return -1;
+      }
+    }
+    for (const auto &[file, content] : got) {
+      if (auto it = fixtureContent().find(file); it == fixtureContent().end() || it->second != content) {
+        bela::FPrintF(stderr, L"%s: %s does not match\n", name, file);
+        return -1;
+      }
+    }
+    checked++;
+  }
+  return checked;
+}
+
+bool readAll(const std::filesystem::path &file, std::string &out, bela::error_code &ec) {
+  auto fd = bela::io::NewFile(file.native(), ec);
+  if (!fd) {
+    return false;
+  }
+  auto size = fd->Size(ec);
+  if (size < 0) {
+    return false;
+  }
+  out.resize(static_cast<size_t>(size));
+  return out.empty() || fd->ReadFull({reinterpret_cast<uint8_t *>(out.data()), out.size()}, ec);
+}
+
+bool checkPackage(const std::filesystem::path &dir) {
+  std::error_code e;
+  auto dest = std::filesystem::temp_directory_path(e) / L"baulk-cabmsi-test";
+  std::filesystem::remove_all(dest, e);
+  auto closer = bela::finally([&] { std::filesystem::remove_all(dest, e); });
+  bela::error_code ec;
+  msi::Unpacker unpacker;
+  if (!unpacker.OpenReader(dir / L"sample.msi", dest, ec) || !unpacker.Extract(nullptr, ec)) {
+    bela::FPrintF(stderr, L"extract sample.msi error: %s\n", ec);
+    return false;
+  }
+  // PFiles and the single 'Sample App' directory are flattened away, bin stays
+  const std::map<std::string, std::filesystem::path> layout{
+      {"readme.txt", dest / L"readme.txt"},
+      {"empty.txt", dest / L"empty.txt"},
+      {"notes.txt", dest / L"notes.txt"},
+      {"sample.dll", dest / L"bin" / L"sample.dll"},
+  };
+  for (const auto &[name, path] : layout) {
+    std::string content;
+    if (!readAll(path, content, ec)) {
+      bela::FPrintF(stderr, L"sample.msi: read %v error: %s\n", path, ec);
+      return false;
+    }
+    if (content != fixtureContent().at(name)) {
+      bela::FPrintF(stderr, L"sample.msi: %v does not match\n", path);
+      return false;
+    }
+  }
+  return true;
+}
+
+int wmain(int argc, wchar_t **argv) {
+  std::filesystem::path dir = argc > 1 ? std::filesystem::path(argv[1]) : std::filesystem::path(BAULK_FIXTURES_DIR);
+  auto cabOk = checkCabinet(dir);
+  auto msiOk = checkPackage(dir);
+  auto makecab = checkMicrosoftCabinets(dir);
+  bela::FPrintF(stderr, L"sample.cab: %s\nsample.msi: %s\n", cabOk ? L"ok" : L"FAILED", msiOk ? L"ok" : L"FAILED");
+  bela::FPrintF(stderr, L"makecab: %s\n", makecab < 0 ? L"FAILED" : (makecab == 0 ? L"skipped" : L"ok"));
+  return cabOk && msiOk && makecab >= 0 ? 0 : 1;
+}
@@ -0,0 +1,94 @@
+//
+#include <baulk/net/chunks.hpp>
+#include <bela/terminal.hpp>
+#include <bela/hash.hpp>
+#include <bela/io.hpp>
+#include <random>
+
+namespace net = baulk::net;
+
+constexpr size_t MiB = 1024 * 1024;
+
+// build: manifest of input written in uneven pieces, Finish records the partial tail
+net::ChunkManifest build(const std::vector<uint8_t> &input, bool finish) {
+  net::ChunkManifest m(net::chunks_block_size, static_cast<int64_t>(input.size()));
+  net::ChunkBuilder builder(m);
+  const size_t pieces[] = {1, 4095, MiB - 7, 65536, 2 * MiB + 3};
+  for (size_t pos = 0, i = 0; pos < input.size(); i++) {
+    auto n = (std::min)(pieces[i % std::size(pieces)], input.size() - pos);
+    builder.Update(input.data() + pos, n);
+    pos += n;
+  }
+  if (finish) {
+    builder.Finish();
+  }
+  return m;
+}
+
+bool check(size_t size, const std::filesystem::path &file) {
+  std::mt19937_64 rng(size);
+  std::vector<uint8_t> input(size);
+  for (auto &b : input) {
+    b = static_cast<uint8_t>(rng());
+  }
+  bela::hash::blake3::Hasher h;
+  h.Initialize();
+  h.Update(input.data(), input.size());
+  uint8_t hash[BLAKE3_OUT_LEN];
+  h.Finalize(hash, sizeof(hash));
+  auto blocks = (size + MiB - 1) / MiB;
+  auto m = build(input, true);
+  if (m.Blocks() != blocks || !m.Complete() || !m.Matches(hash, sizeof(hash))) {
+    bela::FPrintF(stderr, L"size %d: manifest tree does not match the BLAKE3 hash\n", size);
+    return false;
+  }
+  if (size % MiB != 0 && build(input, false).Complete()) {
+    bela::FPrintF(stderr, L"size %d: partial tail recorded without Finish\n", size);
+    return false;
+  }
+  bela::error_code ec;
+  net::ChunkManifest decoded;
+  if (!decoded.Decode(m.Encode(), ec) || !decoded.Matches(hash, sizeof(hash))) {
+    bela::FPrintF(stderr, L"size %d: decoded manifest does not match: %s\n", size, ec);
+    return false;
+  }
+  hash[0] ^= 1;
+  if (m.Matches(hash, sizeof(hash))) {
+    bela::FPrintF(stderr, L"size %d: manifest matches a wrong hash\n", size);
+    return false;
+  }
+  // block 1 corrupted: the verified prefix stops at block 0, a length inside block 0 verifies nothing
+  input[MiB + 17] ^= 0x5A;
+  if (!bela::io::AtomicWriteText(file.native(), {input.data(), input.size()}, ec)) {
+    bela::FPrintF(stderr, L"write %v error: %s\n", file, ec);
+    return false;
+  }
+  auto fd = bela::io::NewFile(file.native(), ec);
+  if (!fd) {
+    bela::FPrintF(stderr, L"open %v error: %s\n", file, ec);
+    return false;
+  }
+  auto all = m.VerifiedPrefix(fd->NativeFD(), static_cast<int64_t>(size), ec);
+  auto partial = m.VerifiedPrefix(fd->NativeFD(), static_cast<int64_t>(MiB / 2), ec);
+  auto bad = m.BadBlocks(fd->NativeFD(), ec);
+  if (all != static_cast<int64_t>(MiB) || partial != 0 || !bad || *bad != std::vector<size_t>{1}) {
+    bela::FPrintF(stderr, L"size %d: verified prefix %d/%d, bad blocks %d\n", size, all, partial,
+                  bad ? bad->size() : 0);
+    return false;
+  }
+  return true;
+}
+
+int wmain() {
+  std::error_code e;
+  auto file = std::filesystem::temp_directory_path(e) / L"baulk-chunks-test.bin";
+  auto closer = bela::finally([&] { std::filesystem::remove(file, e); });
+  int failed = 0;
+  for (auto size : {MiB + 1, 2 * MiB, 3 * MiB + 12345, 5 * MiB - 1}) {
+    if (!check(size, file)) {
+      failed++;
+    }
+  }
+  bela::FPrintF(stderr, L"chunks: %s\n", failed == 0 ? L"ok" : L"FAILED");
+  return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,88 @@
+//
+#include <baulk/archive.hpp>
+#include <baulk/archive/zip.hpp>
+#include <baulk/archive/delta.hpp>
+#include <baulk/hash.hpp>
+#include <bela/terminal.hpp>
+#include <bela/io.hpp>
+#include <random>
+
+namespace zip = baulk::archive::zip;
+namespace delta = baulk::archive::delta;
+namespace fs = std::filesystem;
+
+// writeTree: synthetic release, files of version 'rev' differ from rev 0 in every 16th file and one added file
+bool writeTree(const fs::path &root, int rev, bela::error_code &ec) {
+  std::mt19937_64 rng(1024);
+  std::string content;
+  for (int i = 0; i < 256 + rev; i++) {
+    auto size = static_cast<size_t>(1024 + rng() % (256 * 1024));
+    content.resize(size);
+    for (auto &c : content) {
+      // compressible enough to look like binaries and text of a toolchain
+      c = static_cast<char>("abcdefgh\x00\x01\xff\n"[rng() % 12]);
+    }
+    if (rev != 0 && i % 16 == 0) {
+      content.append(bela::StringNarrowCat("patched by release ", rev));
+    }
+    auto file = root / bela::StringCat(L"dir", i % 8) / bela::StringCat(L"file", i, L".bin");
+    std::error_code e;
+    fs::create_directories(file.parent_path(), e);
+    if (!bela::io::WriteText(file.native(), {reinterpret_cast<const uint8_t *>(content.data()), content.size()},
+                             ec)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool makeArchive(const fs::path &root, const fs::path &file, bela::error_code &ec) {
+  zip::ArchiveWriter w;
+  return w.OpenWriter(file.native(), {.method = zip::ZIP_DEFLATE, .workers = 1}, ec) && w.AddTree(root, "", ec) &&
+         w.Close(ec);
+}
+
+int roundtrip(const fs::path &base, const fs::path &target, const fs::path &patch) {
+  bela::error_code ec;
+  if (!delta::MakePatch(base, target, patch, 19, ec)) {
+    bela::FPrintF(stderr, L"make patch error: %s\n", ec);
+    return 1;
+  }
+  auto rebuilt = bela::StringCat(target.native(), L".rebuilt");
+  if (!delta::ApplyPatch(base, patch, rebuilt, ec)) {
+    bela::FPrintF(stderr, L"apply patch error: %s\n", ec);
+    return 1;
+  }
+  auto expected = baulk::hash::FileHash(target, baulk::hash::hash_t::BLAKE3, ec);
+  auto actual = baulk::hash::FileHash(rebuilt, baulk::hash::hash_t::BLAKE3, ec);
+  if (!expected || !actual || *expected != *actual) {
+    bela::FPrintF(stderr, L"rebuilt %s does not match %s\n", rebuilt, target.native());
+    return 1;
+  }
+  std::error_code e;
+  auto full = fs::file_size(target, e);
+  auto size = fs::file_size(patch, e);
+  bela::FPrintF(stderr, L"%s: %d bytes, patch %d bytes (%.2f%%), BLAKE3:%s\n", target.filename().native(), full, size,
+                static_cast<double>(size) * 100 / static_cast<double>(full), *expected);
+  fs::remove(rebuilt, e);
+  return 0;
+}
+
+int wmain(int argc, wchar_t **argv) {
+  if (argc == 4) {
+    // delta_test base target patch: patch pair for a bucket delta index
+    return roundtrip(argv[1], argv[2], argv[3]);
+  }
+  auto dir = fs::temp_directory_path() / L"baulk-delta";
+  std::error_code e;
+  fs::remove_all(dir, e);
+  bela::error_code ec;
+  for (int rev = 0; rev < 2; rev++) {
+    auto tree = dir / bela::StringCat(L"tree", rev);
+    if (!writeTree(tree, rev, ec) || !makeArchive(tree, dir / bela::StringCat(L"release", rev, L".zip"), ec)) {
+      bela::FPrintF(stderr, L"make release %d error: %s\n", rev, ec);
+      return 1;
+    }
+  }
+  return roundtrip(dir / L"release0.zip", dir / L"release1.zip", dir / L"release1.zip.zst");
+}
@@ -0,0 +1,120 @@
+//
+#include <baulk/archive.hpp>
+#include <baulk/archive/zip.hpp>
+#include <baulk/archive/extractor.hpp>
+#include <bela/terminal.hpp>
+#include <bela/path.hpp>
+#include <chrono>
+
+namespace zip = baulk::archive::zip;
+namespace fs = std::filesystem;
+
+// makeArchive: many small files spread over nested directories, directory entries come first like most zip tools
+bool makeArchive(std::wstring_view file, int count, bela::error_code &ec) {
+  zip::ArchiveWriter w;
+  if (!w.OpenWriter(file, {.method = zip::ZIP_STORE, .workers = 1}, ec)) {
+    return false;
+  }
+  auto modified = bela::Now() - bela::Hours(24 * 30);
+  std::string content(256, 'x');
+  for (int d = 0; d < count / 100; d++) {
+    auto dir = bela::StringNarrowCat("src/module", d / 10, "/part", d % 10, "/");
+    if (!w.AddDirectory(dir, modified, ec)) {
+      return false;
+    }
+    for (int i = 0; i < 100; i++) {
+      auto name = bela::StringNarrowCat(dir, "file", i, ".h");
+      if (!w.AddBuffer(name, {reinterpret_cast<const uint8_t *>(content.data()), content.size()}, modified, ec)) {
+        return false;
+      }
+    }
+  }
+  return w.Close(ec);
+}
+
+// eagerExtract: the previous flow, directory times are set while their children are still being written
+bool eagerExtract(std::wstring_view file, const fs::path &dest, bela::error_code &ec) {
+  zip::Reader reader;
+  if (!reader.OpenReader(file, ec)) {
+    return false;
+  }
+  for (const auto &f : reader.Files()) {
+    auto out = dest / bela::encode_into<char, wchar_t>(f.name);
+    if (f.IsDir()) {
+      if (!baulk::archive::MakeDirectories(out, f.time, ec)) {
+        return false;
+      }
+      continue;
+    }
+    auto fd = baulk::archive::File::NewFile(out, f.time, true, ec);
+    if (!fd) {
+      return false;
+    }
+    if (!reader.Decompress(
+            f, [&](const void *data, size_t len) { return fd->WriteFull(data, len, ec); }, ec) ||
+        !fd->Chtimes(f.time, ec)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// checkTimes: count directories whose mtime no longer matches the archive
+size_t checkTimes(const fs::path &dest, bela::Time expected) {
+  size_t mismatched = 0;
+  std::error_code e;
+  auto want = bela::ToUnixSeconds(expected);
+  for (auto &it : fs::recursive_directory_iterator(dest, e)) {
+    if (!it.is_directory(e)) {
+      continue;
+    }
+    WIN32_FILE_ATTRIBUTE_DATA wfd;
+    if (GetFileAttributesExW(it.path().c_str(), GetFileExInfoStandard, &wfd) != TRUE) {
+      continue;
+    }
+    if (auto got = bela::ToUnixSeconds(bela::FromFileTime(wfd.ftLastWriteTime)); got > want + 2 || got + 2 < want) {
+      mismatched++;
+    }
+  }
+  return mismatched;
+}
+
+int wmain(int argc, wchar_t **argv) {
+  bela::error_code ec;
+  int count = argc > 1 ? _wtoi(argv[1]) : 50000;
+  auto root = fs::temp_directory_path() / L"baulk-extractbench";
+  std::error_code e;
+  fs::remove_all(root, e);
+  fs::create_directories(root, e);
+  auto archive = (root / L"small.zip").native();
+  if (!makeArchive(archive, count, ec)) {
+    bela::FPrintF(stderr, L"make archive error: %s\n", ec);
+    return 1;
+  }
+  zip::Reader r;
+  if (!r.OpenReader(archive, ec)) {
+    bela::FPrintF(stderr, L"open archive error: %s\n", ec);
+    return 1;
+  }
+  auto modified = r.Files().front().time;
+
+  auto start = std::chrono::steady_clock::now();
+  if (!eagerExtract(archive, root / L"eager", ec)) {
+    bela::FPrintF(stderr, L"eager extract error: %s\n", ec);
+    return 1;
+  }
+  auto eager = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  bela::FPrintF(stderr, L"eager:    %.3fs, %d directories with wrong mtime\n", eager, checkTimes(root / L"eager", modified));
+
+  start = std::chrono::steady_clock::now();
+  zip::Extractor extractor(baulk::archive::ExtractorOptions{});
+  if (!extractor.OpenReader(archive, root / L"deferred", ec) || !extractor.Extract(nullptr, nullptr, ec)) {
+    bela::FPrintF(stderr, L"deferred extract error: %s\n", ec);
+    return 1;
+  }
+  auto deferred = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  bela::FPrintF(stderr, L"deferred: %.3fs, %d directories with wrong mtime, %d create_directories avoided\n", deferred,
+                checkTimes(root / L"deferred", modified), extractor.Directories().Avoided());
+  fs::remove_all(root, e);
+  return 0;
+}
@@ -0,0 +1,637 @@
+#!/usr/bin/env python3
+# Regenerates sample.cab, sample.msi and sample.7z, the contents must stay in sync with test/cabmsi.cc and test/n7z.cc
+# sample.cab: folder 0 is MSZIP (two frames and an empty file), folder 1 is LZX with a verbatim and an uncompressed block
+# sample.msi: File/Component/Directory/Media tables with sample.cab as an embedded stream
+# sample.7z: a BCJ2 solid block (LZMA2 main, LZMA call/jump), an LZMA2 block, empty entries and an LZMA packed header
+# --sources DIR writes the cabinet files to DIR, build makecab-*.cab from them on Windows for cabmsi_test:
+#   makecab /D CompressionType=MSZIP readme.txt makecab-mszip.cab
+#   makecab /D CompressionType=LZX /D CompressionMemory=21 sample.dll makecab-lzx.cab
+import lzma
+import os
+import struct
+import sys
+import zlib
+
+FRAME = 32768
+
+
+def readme():
+    lines = []
+    size = 0
+    i = 0
+    while size < 40000:
+        line = b"%05d baulk cabinet fixture, deflate frames share a 32K history\n" % i
+        lines.append(line)
+        size += len(line)
+        i += 1
+    return b"".join(lines)[:40000]
+
+
+def sample_dll():
+    # xorshift32, mostly back references so the LZX encoder finds matches of every length class
+    out = bytearray()
+    x = 2463534242
+    while len(out) < 50001:
+        x ^= (x << 13) & 0xFFFFFFFF
+        x ^= x >> 17
+        x ^= (x << 5) & 0xFFFFFFFF
+        if len(out) > 0 and x % 4 != 0:
+            off = 1 + (x >> 8) % min(len(out), 4000)
+            n = 3 + (x >> 20) % 60
+            for _ in range(n):
+                out.append(out[len(out) - off])
+        else:
+            out.append(x >> 24)
+    return bytes(out[:50001])
+
+
+FILES = [
+    # name, folder, content
+    ("readme.txt", 0, readme()),
+    ("empty.txt", 0, b""),
+    ("notes.txt", 0, b"MSZIP and LZX folders\r\n"),
+    ("sample.dll", 1, sample_dll()),
+]
+
+
+class BitWriter:
+    # LZX bit stream: 16-bit little endian words filled from the most significant bit
+    def __init__(self):
+        self.out = bytearray()
+        self.acc = 0
+        self.n = 0
+
+    def bits(self, v, n):
+        for i in range(n - 1, -1, -1):
+            self.acc = (self.acc << 1) | ((v >> i) & 1)
+            self.n += 1
+            if self.n == 16:
+                self.out += struct.pack("<H", self.acc)
+                self.acc = 0
+                self.n = 0
+
+    def align(self):
+        if self.n != 0:
+            self.bits(0, 16 - self.n)
+
+    def raw(self, data):
+        assert self.n == 0
+        self.out += data
+
+
+def position_tables():
+    extra = [0] * 51
+    j = 0
+    for i in range(0, 51, 2):
+        extra[i] = j
+        if i + 1 <= 50:
+            extra[i + 1] = j
+        if i != 0 and j < 17:
+            j += 1
+    base = [0] * 51
+    j = 0
+    for i in range(51):
+        base[i] = j
+        j += 1 << extra[i]
+    return base, extra
+
+
+def lzx_compress(data, window_bits):
+    slots = window_bits * 2
+    main_symbols = 256 + slots * 8
+    assert main_symbols == 512  # every main symbol gets a 9 bit code, the code is then simply the symbol
+    base, extra = position_tables()
+    verbatim = 40000  # spans the first frame boundary, the rest goes into an uncompressed block of odd length
+    w = BitWriter()
+    w.bits(0, 1)  # no E8 translation
+
+    def lengths(values, prev):
+        w_pre = [5] * 20
+        for l in w_pre:
+            w.bits(l, 4)
+        i = 0
+        while i < len(values):
+            z = (prev[i] - values[i]) % 17
+            if i + 5 <= len(values) and all(values[k] == values[i] and prev[k] == prev[i] for k in range(i, i + 5)):
+                w.bits(19, 5)
+                w.bits(1, 1)
+                w.bits(z, 5)
+                i += 5
+                continue
+            w.bits(z, 5)
+            i += 1
+
+    w.bits(1, 3)
+    w.bits(verbatim >> 8, 16)
+    w.bits(verbatim & 0xFF, 8)
+    lengths([9] * 256, [0] * 256)
+    lengths([9] * (main_symbols - 256), [0] * (main_symbols - 256))
+    lengths([8] * 249, [0] * 249)
+    r = [1, 1, 1]
+    frames = []
+    pos = 0
+    heads = {}
+
+    def frame_end(p):
+        return min((p // FRAME + 1) * FRAME, verbatim)
+
+    while pos < verbatim:
+        limit = frame_end(pos)
+        best_len, best_off = 0, 0
+        if pos + 3 <= limit:
+            for cand in reversed(heads.get(data[pos:pos + 3], [])[-16:]):
+                off = pos - cand
+                if off > (1 << window_bits) - 3:
+                    continue
+                n = 0
+                while pos + n < limit and n < 257 and data[cand + n] == data[pos + n]:
+                    n += 1
+                if n > best_len:
+                    best_len, best_off = n, off
+        for k in range(max(best_len, 1)):
+            if pos + k + 3 <= len(data):
+                heads.setdefault(data[pos + k:pos + k + 3], []).append(pos + k)
+        if best_len < 3:
+            w.bits(data[pos], 9)
+            pos += 1
+        else:
+            if best_off == r[0]:
+                slot = 0
+            elif best_off == r[1]:
+                slot = 1
+                r[0], r[1] = r[1], r[0]
+            elif best_off == r[2]:
+                slot = 2
+                r[0], r[2] = r[2], r[0]
+            else:
+                formatted = best_off + 2
+                slot = max(s for s in range(3, slots) if base[s] <= formatted)
+                r = [best_off, r[0], r[1]]
+            header = min(best_len - 2, 7)
+            w.bits(256 + slot * 8 + header, 9)
+            if header == 7:
+                w.bits(best_len - 9, 8)
+            if slot >= 3:
+                w.bits(best_off + 2 - base[slot], extra[slot])
+            pos += best_len
+        if pos % FRAME == 0:
+            w.align()
+            frames.append((bytes(w.out), FRAME))
+            w.out = bytearray()
+    rest = data[verbatim:]
+    assert len(rest) % 2 == 1
+    w.bits(3, 3)
+    w.bits(len(rest) >> 8, 16)
+    w.bits(len(rest) & 0xFF, 8)
+    if w.n == 0:
+        w.bits(0, 16)
+    w.align()
+    w.raw(struct.pack("<3I", *r))
+    w.raw(rest)
+    w.raw(b"\0")
+    frames.append((bytes(w.out), len(data) - len(frames) * FRAME))
+    return frames
+
+
+def mszip_compress(data):
+    blocks = []
+    prev = b""
+    for i in range(0, len(data), FRAME):
+        chunk = data[i:i + FRAME]
+        c = zlib.compressobj(9, zlib.DEFLATED, -15, zdict=prev) if prev else zlib.compressobj(9, zlib.DEFLATED, -15)
+        blocks.append((b"CK" + c.compress(chunk) + c.flush(), len(chunk)))
+        prev = chunk
+    return blocks
+
+
+def make_cab():
+    folders = [[], []]
+    for name, folder, content in FILES:
+        folders[folder].append((name, content))
+    streams = [
+        mszip_compress(b"".join(c for _, c in folders[0])),
+        lzx_compress(b"".join(c for _, c in folders[1]), 16),
+    ]
+    compression = [1, 3 | (16 << 8)]
+    header_size = 36
+    folder_table = header_size
+    file_table = folder_table + 8 * len(folders)
+    entries = bytearray()
+    for fi, items in enumerate(folders):
+        offset = 0
+        for name, content in items:
+            # 2024-05-01 12:00:00, archive attribute
+            entries += struct.pack("<IIHHHH", len(content), offset, fi, (44 << 9) | (5 << 5) | 1, 12 << 11, 0x20)
+            entries += name.encode() + b"\0"
+            offset += len(content)
+    data_start = file_table + len(entries)
+    folder_entries = bytearray()
+    data = bytearray()
+    for fi, blocks in enumerate(streams):
+        folder_entries += struct.pack("<IHH", data_start + len(data), len(blocks), compression[fi])
+        for payload, size in blocks:
+            data += struct.pack("<IHH", 0, len(payload), size) + payload
+    total = data_start + len(data)
+    header = b"MSCF" + struct.pack("<IIIIIBBHHHHH", 0, total, 0, file_table, 0, 3, 1, len(folders), len(FILES), 0,
+                                   0x4241, 0)
+    return header + folder_entries + entries + data
+
+
+# Windows Installer database
+
+def encode_stream_name(name, table):
+    def mime(c):
+        for lo, hi, first in ((ord("0"), ord("9"), 0), (ord("A"), ord("Z"), 10), (ord("a"), ord("z"), 36)):
+            if lo <= ord(c) <= hi:
+                return first + ord(c) - lo
+        return 62 if c == "." else 63
+    units = [0x4840] if table else []
+    i = 0
+    while i < len(name):
+        if i + 1 < len(name):
+            units.append(0x3800 + mime(name[i]) + (mime(name[i + 1]) << 6))
+            i += 2
+        else:
+            units.append(0x4800 + mime(name[i]))
+            i += 1
+    return units
+
+
+class StringPool:
+    def __init__(self):
+        self.strings = []
+        self.ids = {}
+        self.refs = []
+
+    def id(self, s):
+        if s is None:
+            return 0
+        if s not in self.ids:
+            self.strings.append(s.encode("cp1252"))
+            self.refs.append(0)
+            self.ids[s] = len(self.strings)
+        self.refs[self.ids[s] - 1] += 1
+        return self.ids[s]
+
+    def streams(self):
+        pool = struct.pack("<HH", 1252, 0)
+        for s, n in zip(self.strings, self.refs):
+            pool += struct.pack("<HH", len(s), n)
+        return pool, b"".join(self.strings)
+
+
+S72K, S72, L255, S255, S38, S20, S32, L64, I2K, I2, I2N, I4 = (0x2D48, 0x1D48, 0x0FFF, 0x1DFF, 0x1D26, 0x1D14, 0x1D20,
+                                                            0x1F40, 0x2502, 0x0502, 0x1502, 0x0104)
+KEYS72 = 0x0D48
+
+TABLES = {
+    "Directory": [("Directory", S72K), ("Directory_Parent", S72), ("DefaultDir", L255)],
+    "Component": [("Component", S72K), ("ComponentId", S38), ("Directory_", KEYS72), ("Attributes", I2),
+                  ("Condition", S255), ("KeyPath", S72)],
+    "File": [("File", S72K), ("Component_", KEYS72), ("FileName", L255), ("FileSize", I4), ("Version", S72),
+             ("Language", S20), ("Attributes", I2N), ("Sequence", I2)],
+    "Media": [("DiskId", I2K), ("LastSequence", I2), ("DiskPrompt", L64), ("Cabinet", S255), ("VolumeLabel", S32),
+              ("Source", S72)],
+}
+
+ROWS = {
+    "Directory": [
+        ("TARGETDIR", None, "SourceDir"),
+        ("ProgramFilesFolder", "TARGETDIR", "PFiles"),
+        ("INSTALLDIR", "ProgramFilesFolder", "SAMPLE~1|Sample App"),
+        ("BINDIR", "INSTALLDIR", "bin"),
+    ],
+    "Component": [
+        ("Docs", "{5E0A2C11-7F5B-4E8A-9C3D-2B1F6A7E8D90}", "INSTALLDIR", 0, None, "readme.txt"),
+        ("Library", "{9B3E4D22-1A6C-4F7B-8E2D-3C0A5B6F7E81}", "BINDIR", 0, None, "sample.dll"),
+    ],
+    "File": [
+        ("readme.txt", "Docs", "readme.txt", len(FILES[0][2]), None, None, 0, 1),
+        ("empty.txt", "Docs", "empty.txt", 0, None, None, 0, 2),
+        ("notes.txt", "Docs", "notes.txt", len(FILES[2][2]), None, None, 0, 3),
+        ("sample.dll", "Library", "SAMPLE.DLL|sample.dll", len(FILES[3][2]), "1.0.0.0", "0", 0, 4),
+    ],
+    "Media": [(1, 4, None, "#sample.cab", None, None)],
+}
+
+
+def table_stream(pool, columns, rows):
+    # column major, strings are pool ids and integers are offset encoded
+    out = bytearray()
+    for c, (_, t) in enumerate(columns):
+        for row in rows:
+            v = row[c]
+            if t & 0x0800:
+                out += struct.pack("<H", pool.id(v))
+            elif (t & 0xFF) <= 2:
+                out += struct.pack("<H", 0 if v is None else v + 0x8000)
+            else:
+                out += struct.pack("<I", 0 if v is None else (v ^ 0x80000000) & 0xFFFFFFFF)
+    return bytes(out)
+
+
+def make_msi(cabinet):
+    pool = StringPool()
+    streams = {}
+    for name in TABLES:
+        streams[name] = table_stream(pool, TABLES[name], ROWS[name])
+    columns = [(name, i + 1, col, t) for name in TABLES for i, (col, t) in enumerate(TABLES[name])]
+    streams["_Columns"] = table_stream(pool, [("Table", KEYS72), ("Number", I2), ("Name", KEYS72), ("Type", I2)],
+                                       columns)
+    streams["_Tables"] = table_stream(pool, [("Name", KEYS72)], [(name,) for name in TABLES])
+    streams["_StringPool"], streams["_StringData"] = pool.streams()
+    entries = [(encode_stream_name(name, True), data) for name, data in streams.items()]
+    entries.append((encode_stream_name("sample.cab", False), cabinet))
+    return compound_file(entries)
+
+
+def compound_file(entries):
+    sector = 512
+    mini = 64
+    cutoff = 4096
+    free, end, fatsect = 0xFFFFFFFF, 0xFFFFFFFE, 0xFFFFFFFD
+    # children of the root storage must be ordered by length, then by upper cased name
+    entries.sort(key=lambda e: (len(e[0]), [chr(u).upper() for u in e[0]]))
+    mini_stream = bytearray()
+    mini_fat = []
+    big = []
+    starts = []
+    for units, data in entries:
+        if len(data) < cutoff:
+            first = len(mini_stream) // mini
+            count = (len(data) + mini - 1) // mini
+            mini_fat += [first + k + 1 for k in range(count - 1)] + [end] if count else []
+            starts.append(("mini", first if count else end))
+            mini_stream += data + b"\0" * (count * mini - len(data))
+        else:
+            starts.append(("big", len(big)))
+            big.append(data)
+    mini_fat_bytes = b"".join(struct.pack("<I", v) for v in mini_fat)
+    dir_sectors = (len(entries) + 1 + 3) // 4
+
+    def sectors(n):
+        return (n + sector - 1) // sector
+
+    chains = [("dir", dir_sectors * sector), ("minifat", len(mini_fat_bytes)), ("ministream", len(mini_stream))]
+    chains += [("big%d" % i, len(d)) for i, d in enumerate(big)]
+    used = sum(sectors(n) for _, n in chains)
+    num_fat = 1
+    while num_fat * (sector // 4) < used + num_fat:
+        num_fat += 1
+    fat = [fatsect] * num_fat
+    first = {}
+    for name, n in chains:
+        count = sectors(n)
+        first[name] = len(fat) if count else end
+        fat += [len(fat) + k + 1 for k in range(count - 1)] + ([end] if count else [])
+    fat += [free] * (num_fat * (sector // 4) - len(fat))
+
+    def dir_entry(name_units, kind, left, right, child, start, size, clsid=b"\0" * 16):
+        name = b"".join(struct.pack("<H", u) for u in name_units) + b"\0\0"
+        e = name + b"\0" * (64 - len(name))
+        e += struct.pack("<HBBIII", len(name), kind, 1, left, right, child)
+        e += clsid + struct.pack("<IQQIQ", 0, 0, 0, start, size)
+        return e
+
+    # {000C1084-0000-0000-C000-000000000046}: installer database
+    msi_clsid = struct.pack("<IHH", 0x000C1084, 0, 0) + bytes([0xC0, 0, 0, 0, 0, 0, 0, 0x46])
+    # the children form a right leaning chain, a valid (if unbalanced) binary search tree of black nodes
+    directory = dir_entry([ord(c) for c in "Root Entry"], 5, free, free, 1 if entries else free,
+                          first["ministream"], len(mini_stream), msi_clsid)
+    for i, (units, data) in enumerate(entries):
+        kind, s = starts[i]
+        start = s if kind == "mini" else first["big%d" % s]
+        right = i + 2 if i + 1 < len(entries) else free
+        directory += dir_entry(units, 2, free, right, free, start, len(data))
+    directory += b"\0" * (dir_sectors * sector - len(directory))
+    for k in range(len(entries) + 1, dir_sectors * 4):
+        directory = directory[:k * 128 + 0x44] + struct.pack("<III", free, free, free) + directory[k * 128 + 0x50:]
+    header = bytes([0xD0, 0xCF, 0x11, 0xE0, 0xA1, 0xB1, 0x1A, 0xE1]) + b"\0" * 16
+    header += struct.pack("<HHHHH", 0x3E, 3, 0xFFFE, 9, 6) + b"\0" * 6
+    header += struct.pack("<IIIIIIIII", 0, num_fat, first["dir"], 0, cutoff, first["minifat"],
+                          sectors(len(mini_fat_bytes)), end, 0)
+    header += b"".join(struct.pack("<I", k if k < num_fat else free) for k in range(109))
+    body = b"".join(struct.pack("<I", v) for v in fat)
+
+    def pad(b):
+        return b + b"\0" * (sectors(len(b)) * sector - len(b))
+
+    body += pad(directory) + pad(mini_fat_bytes) + pad(bytes(mini_stream))
+    for d in big:
+        body += pad(d)
+    return header + body
+
+# 7z: folder 0 is BCJ2 over LZMA2 with LZMA call/jump streams, folder 1 is LZMA2, the header is LZMA packed
+
+def sample_exe():
+    # x86 like code, E8/E9/0F8x with targets inside and outside the image so BCJ2 converts some of them
+    out = bytearray()
+    x = 88172645
+    while len(out) < 70000:
+        x ^= (x << 13) & 0xFFFFFFFF
+        x ^= x >> 17
+        x ^= (x << 5) & 0xFFFFFFFF
+        kind = x % 8
+        if kind == 0:
+            rel = (x >> 8) % 70000 - (len(out) + 5)
+            out += b"\xe8" + struct.pack("<I", rel & 0xFFFFFFFF)
+        elif kind == 1:
+            out += b"\xe9" + struct.pack("<I", (x >> 3) & 0xFFFFFFFF)
+        elif kind == 2:
+            rel = (x >> 12) % 512 - 256
+            out += bytes([0x0F, 0x80 | ((x >> 4) & 0x0F)]) + struct.pack("<I", rel & 0xFFFFFFFF)
+        else:
+            out += bytes([0x55, 0x8B, 0xEC, x >> 24][:1 + (x >> 9) % 4])
+    return bytes(out[:70000])
+
+
+SEVENZIP_FILES = [
+    # name, folder (-1 for empty files and directories), content
+    ("bin\\sample.exe", 0, sample_exe()),
+    ("bin\\sample.dll", 0, sample_dll()),
+    ("docs\\readme.txt", 1, readme()),
+    ("docs\\notes.txt", 1, b"BCJ2 and LZMA2 folders\r\n"),
+    ("docs\\empty.txt", -1, b""),
+    ("bin", -1, None),
+    ("docs", -1, None),
+]
+
+
+class RangeEncoder:
+    def __init__(self):
+        self.low = 0
+        self.range = 0xFFFFFFFF
+        self.cache = 0
+        self.cache_size = 1
+        self.out = bytearray()
+
+    def shift_low(self):
+        if self.low < 0xFF000000 or self.low >= 1 << 32:
+            carry = self.low >> 32
+            temp = self.cache
+            while True:
+                self.out.append((temp + carry) & 0xFF)
+                temp = 0xFF
+                self.cache_size -= 1
+                if self.cache_size == 0:
+                    break
+            self.cache = (self.low >> 24) & 0xFF
+        self.cache_size += 1
+        self.low = (self.low << 8) & 0xFFFFFFFF
+
+    def bit(self, probs, i, bit):
+        bound = (self.range >> 11) * probs[i]
+        if bit == 0:
+            self.range = bound
+            probs[i] += (2048 - probs[i]) >> 5
+        else:
+            self.low += bound
+            self.range -= bound
+            probs[i] -= probs[i] >> 5
+        while self.range < 1 << 24:
+            self.range = (self.range << 8) & 0xFFFFFFFF
+            self.shift_low()
+
+    def flush(self):
+        for _ in range(5):
+            self.shift_low()
+        return bytes(self.out)
+
+
+def bcj2_encode(data):
+    # returns main, call, jump and range coder streams; no bit is coded for an opcode ending the data
+    main, call, jump = bytearray(), bytearray(), bytearray()
+    rc = RangeEncoder()
+    probs = [1024] * 258
+    prev = 0
+    i = 0
+    while i < len(data):
+        b = data[i]
+        main.append(b)
+        i += 1
+        if not ((b & 0xFE) == 0xE8 or (prev == 0x0F and (b & 0xF0) == 0x80)):
+            prev = b
+            continue
+        if i == len(data):
+            break
+        convert = False
+        if len(data) - i >= 4:
+            dest = (struct.unpack_from("<I", data, i)[0] + i + 4) & 0xFFFFFFFF
+            convert = dest < len(data)
+        rc.bit(probs, prev if b == 0xE8 else 256 if b == 0xE9 else 257, 1 if convert else 0)
+        if not convert:
+            prev = b
+            continue
+        (call if b == 0xE8 else jump).extend(struct.pack(">I", dest))
+        prev = data[i + 3]
+        i += 4
+    return bytes(main), bytes(call), bytes(jump), rc.flush()
+
+
+def lzma_raw(data, filter_id):
+    f = {"id": filter_id, "dict_size": 1 << 16}
+    return lzma.compress(data, format=lzma.FORMAT_RAW, filters=[f]), lzma._encode_filter_properties(f)
+
+
+def number(v):
+    # 7z variable length integer, the leading one bits of the first byte count the extra bytes
+    for n in range(8):
+        if v < 1 << (7 * (n + 1)):
+            first = ((0xFF00 >> n) & 0xFF) | (v >> (8 * n))
+            return bytes([first]) + (v & ((1 << (8 * n)) - 1)).to_bytes(n, "little")
+    return b"\xff" + v.to_bytes(8, "little")
+
+
+def bit_vector(bits):
+    out = bytearray((len(bits) + 7) // 8)
+    for i, b in enumerate(bits):
+        if b:
+            out[i // 8] |= 0x80 >> (i % 8)
+    return bytes(out)
+
+
+def coder(method, props=b"", streams=None):
+    flags = len(method) | (0x10 if streams else 0) | (0x20 if props else 0)
+    out = bytes([flags]) + method
+    if streams:
+        out += number(streams[0]) + number(streams[1])
+    if props:
+        out += number(len(props)) + props
+    return out
+
+
+def property_record(pid, data):
+    return number(pid) + number(len(data)) + data
+
+
+def make_7z():
+    kHeader, kMainStreamsInfo, kFilesInfo, kPackInfo, kUnPackInfo, kSubStreamsInfo = 1, 4, 5, 6, 7, 8
+    kSize, kCRC, kFolder, kCodersUnPackSize, kNumUnPackStream, kEmptyStream, kEmptyFile = 9, 10, 11, 12, 13, 14, 15
+    kName, kMTime, kWinAttributes, kEncodedHeader, kEnd = 17, 20, 21, 23, 0
+    blocks = [[c for _, fi, c in SEVENZIP_FILES if fi == k] for k in range(2)]
+    solid0 = b"".join(blocks[0])
+    solid1 = b"".join(blocks[1])
+    main, call, jump, rc = bcj2_encode(solid0)
+    main_packed, lzma2_props = lzma_raw(main, lzma.FILTER_LZMA2)
+    call_packed, lzma_props = lzma_raw(call, lzma.FILTER_LZMA1)
+    jump_packed, _ = lzma_raw(jump, lzma.FILTER_LZMA1)
+    text_packed, _ = lzma_raw(solid1, lzma.FILTER_LZMA2)
+    packs = [main_packed, call_packed, jump_packed, rc, text_packed]
+    # folder 0: BCJ2 in 0-2 are bound to the LZMA2/LZMA outs 1-3, in 3 (range coder) and in 4-6 are packed
+    folder0 = number(4) + coder(b"\x03\x03\x01\x1b", streams=(4, 1)) + coder(b"\x21", lzma2_props)
+    folder0 += coder(b"\x03\x01\x01", lzma_props) * 2
+    folder0 += number(0) + number(1) + number(1) + number(2) + number(2) + number(3)
+    folder0 += number(4) + number(5) + number(6) + number(3)
+    folder1 = number(1) + coder(b"\x21", lzma2_props)
+    h = bytearray(number(kHeader) + number(kMainStreamsInfo))
+    h += number(kPackInfo) + number(0) + number(len(packs)) + number(kSize)
+    h += b"".join(number(len(p)) for p in packs) + number(kEnd)
+    h += number(kUnPackInfo) + number(kFolder) + number(2) + b"\0" + folder0 + folder1 + number(kCodersUnPackSize)
+    h += b"".join(number(n) for n in (len(solid0), len(main), len(call), len(jump), len(solid1)))
+    h += number(kEnd)
+    h += number(kSubStreamsInfo) + number(kNumUnPackStream) + number(len(blocks[0])) + number(len(blocks[1]))
+    h += number(kSize) + number(len(blocks[0][0])) + number(len(blocks[1][0]))
+    h += number(kCRC) + b"\x01" + b"".join(struct.pack("<I", zlib.crc32(c)) for c in blocks[0] + blocks[1])
+    h += number(kEnd) + number(kEnd)
+    empty = [fi < 0 for _, fi, _ in SEVENZIP_FILES]
+    h += number(kFilesInfo) + number(len(SEVENZIP_FILES))
+    h += property_record(kEmptyStream, bit_vector(empty))
+    h += property_record(kEmptyFile, bit_vector([c is not None for _, fi, c in SEVENZIP_FILES if fi < 0]))
+    h += property_record(kName, b"\0" + b"".join(n.encode("utf-16-le") + b"\0\0" for n, _, _ in SEVENZIP_FILES))
+    # 2024-05-01 12:00:00 UTC
+    mtime = struct.pack("<Q", (1714564800 + 11644473600) * 10000000)
+    h += property_record(kMTime, b"\x01\0" + mtime * len(SEVENZIP_FILES))
+    attributes = b"".join(struct.pack("<I", 0x10 if c is None else 0x20) for _, _, c in SEVENZIP_FILES)
+    h += property_record(kWinAttributes, b"\x01\0" + attributes)
+    h += number(kEnd) + number(kEnd)
+    header_packed, _ = lzma_raw(bytes(h), lzma.FILTER_LZMA1)
+    data = b"".join(packs)
+    encoded = number(kEncodedHeader) + number(kPackInfo) + number(len(data)) + number(1) + number(kSize)
+    encoded += number(len(header_packed)) + number(kEnd)
+    encoded += number(kUnPackInfo) + number(kFolder) + number(1) + b"\0"
+    encoded += number(1) + coder(b"\x03\x01\x01", lzma_props)
+    encoded += number(kCodersUnPackSize) + number(len(h)) + number(kCRC) + b"\x01" + struct.pack("<I", zlib.crc32(h))
+    encoded += number(kEnd) + number(kEnd)
+    body = data + header_packed
+    start = struct.pack("<QQI", len(body), len(encoded), zlib.crc32(encoded))
+    return b"7z\xbc\xaf\x27\x1c\0\x04" + struct.pack("<I", zlib.crc32(start)) + start + body + encoded
+
+
+def main():
+    if len(sys.argv) == 3 and sys.argv[1] == "--sources":
+        for name, _, content in FILES:
+            with open(os.path.join(sys.argv[2], name), "wb") as f:
+                f.write(content)
+        return
+    here = os.path.dirname(os.path.abspath(__file__))
+    cabinet = make_cab()
+    with open(os.path.join(here, "sample.cab"), "wb") as f:
+        f.write(cabinet)
+    with open(os.path.join(here, "sample.msi"), "wb") as f:
+        f.write(make_msi(cabinet))
+    with open(os.path.join(here, "sample.7z"), "wb") as f:
+        f.write(make_7z())
+
+
+if __name__ == "__main__":
+    main()
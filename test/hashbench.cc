@@ -0,0 +1,123 @@
+//
+#include <baulk/hash.hpp>
+#include <bela/terminal.hpp>
+#include <bela/hash.hpp>
+#include <bela/str_cat.hpp>
+#include <chrono>
+#include <random>
+
+namespace fs = std::filesystem;
+
+// makeFile: random content written in 4 MiB pieces, reused when the file already has the size
+bool makeFile(const fs::path &file, uint64_t size, bela::error_code &ec) {
+  std::error_code e;
+  if (fs::file_size(file, e) == size) {
+    return true;
+  }
+  HANDLE FileHandle =
+      CreateFileW(file.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (FileHandle == INVALID_HANDLE_VALUE) {
+    ec = bela::make_system_error_code();
+    return false;
+  }
+  auto closer = bela::finally([&] { CloseHandle(FileHandle); });
+  std::mt19937_64 rng(size);
+  std::vector<uint64_t> block(512 * 1024);
+  for (uint64_t written = 0; written < size;) {
+    for (auto &b : block) {
+      b = rng();
+    }
+    auto n = static_cast<DWORD>((std::min)(size - written, static_cast<uint64_t>(block.size() * 8)));
+    DWORD dwwrite = 0;
+    if (WriteFile(FileHandle, block.data(), n, &dwwrite, nullptr) != TRUE) {
+      ec = bela::make_system_error_code();
+      return false;
+    }
+    written += dwwrite;
+  }
+  return true;
+}
+
+// legacyHash: the former Sumizer loop, 32678 byte ReadFile calls
+template <typename Hasher> bool legacyHash(const fs::path &file, Hasher &hasher, bela::error_code &ec) {
+  HANDLE FileHandle = CreateFileW(file.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (FileHandle == INVALID_HANDLE_VALUE) {
+    ec = bela::make_system_error_code();
+    return false;
+  }
+  auto closer = bela::finally([&] { CloseHandle(FileHandle); });
+  uint8_t bytes[32678];
+  for (;;) {
+    DWORD dwread = 0;
+    if (ReadFile(FileHandle, bytes, sizeof(bytes), &dwread, nullptr) != TRUE) {
+      ec = bela::make_system_error_code();
+      return false;
+    }
+    hasher.Update(bytes, static_cast<size_t>(dwread));
+    if (dwread < sizeof(bytes)) {
+      break;
+    }
+  }
+  hasher.Finalize();
+  return true;
+}
+
+template <typename Fn> double measure(Fn fn, bela::error_code &ec) {
+  auto start = std::chrono::steady_clock::now();
+  if (!fn(ec)) {
+    return -1;
+  }
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int wmain(int argc, wchar_t **argv) {
+  auto dir = argc > 1 ? fs::path(argv[1]) : fs::temp_directory_path() / L"baulk-hashbench";
+  std::error_code e;
+  fs::create_directories(dir, e);
+  constexpr uint64_t sizes[] = {10ULL << 20, 500ULL << 20, 4ULL << 30};
+  bela::error_code ec;
+  for (auto size : sizes) {
+    auto file = dir / bela::StringCat(L"hash-", size >> 20, L"M.bin");
+    if (!makeFile(file, size, ec)) {
+      bela::FPrintF(stderr, L"make %s error: %s\n", file.native(), ec);
+      return 1;
+    }
+    auto mb = static_cast<double>(size) / (1024 * 1024);
+    struct bench {
+      std::wstring_view name;
+      std::function<bool(bela::error_code &)> run;
+    };
+    bench benches[] = {
+        {L"sha256 32K reads",
+         [&](bela::error_code &ec) {
+           bela::hash::sha256::Hasher h;
+           h.Initialize();
+           return legacyHash(file, h, ec);
+         }},
+        {L"sha256 FileHash", [&](bela::error_code &ec) {
+           return baulk::hash::FileHash(file, baulk::hash::hash_t::SHA256, ec).has_value();
+         }},
+        {L"blake3 32K reads",
+         [&](bela::error_code &ec) {
+           bela::hash::blake3::Hasher h;
+           h.Initialize();
+           return legacyHash(file, h, ec);
+         }},
+        {L"blake3 FileHash", [&](bela::error_code &ec) {
+           return baulk::hash::FileHash(file, baulk::hash::hash_t::BLAKE3, ec).has_value();
+         }},
+    };
+    for (const auto &b : benches) {
+      // the first pass warms the page cache, the second one is reported
+      measure(b.run, ec);
+      auto seconds = measure(b.run, ec);
+      if (seconds < 0) {
+        bela::FPrintF(stderr, L"%s error: %s\n", b.name, ec);
+        return 1;
+      }
+      bela::FPrintF(stderr, L"%5.0f MB %-18s %8.2f MB/s\n", mb, b.name, mb / seconds);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,74 @@
+//
+#include <baulk/archive.hpp>
+#include <baulk/archive/zip.hpp>
+#include <baulk/archive/tar.hpp>
+#include <bela/terminal.hpp>
+#include <bela/path.hpp>
+#include <bela/match.hpp>
+
+namespace zip = baulk::archive::zip;
+namespace tar = baulk::archive::tar;
+
+// verify: every entry decompresses to its recorded size, crc32 is checked by the reader
+bool verify(std::wstring_view file, bela::error_code &ec) {
+  zip::Reader reader;
+  if (!reader.OpenReader(file, ec)) {
+    return false;
+  }
+  for (const auto &f : reader.Files()) {
+    if (f.IsDir()) {
+      continue;
+    }
+    uint64_t size = 0;
+    if (!reader.Decompress(
+            f,
+            [&](const void *, size_t len) {
+              size += len;
+              return true;
+            },
+            ec)) {
+      bela::FPrintF(stderr, L"decompress %s error: %s\n", f.name, ec);
+      return false;
+    }
+    if (size != f.uncompressed_size) {
+      ec = bela::make_error_code(bela::ErrGeneral, L"size mismatch ", bela::encode_into<char, wchar_t>(f.name));
+      return false;
+    }
+  }
+  bela::FPrintF(stderr, L"verified %d entries, %d -> %d bytes\n", reader.Files().size(), reader.UncompressedSize(),
+                reader.CompressedSize());
+  return true;
+}
+
+int wmain(int argc, wchar_t **argv) {
+  if (argc < 3) {
+    bela::FPrintF(stderr, L"usage: %s dir out.zip|out.tar.zst [store|deflate|zstd]\n", argv[0]);
+    return 1;
+  }
+  bela::error_code ec;
+  std::wstring_view out(argv[2]);
+  if (bela::EndsWithIgnoreCase(out, L".tar.zst")) {
+    tar::ArchiveWriter w;
+    if (!w.OpenWriter(out, tar::WriterOptions{}, ec) || !w.AddTree(argv[1], "", ec) || !w.Close(ec)) {
+      bela::FPrintF(stderr, L"create %s error: %s\n", out, ec);
+      return 1;
+    }
+    bela::FPrintF(stderr, L"wrote %d entries\n", w.Entries());
+    return 0;
+  }
+  zip::WriterOptions opts;
+  if (argc > 3) {
+    std::wstring_view m(argv[3]);
+    opts.method = m == L"store" ? zip::ZIP_STORE : (m == L"zstd" ? zip::ZIP_ZSTD : zip::ZIP_DEFLATE);
+  }
+  zip::ArchiveWriter w;
+  if (!w.OpenWriter(out, opts, ec) || !w.AddTree(argv[1], "", ec) || !w.Close(ec)) {
+    bela::FPrintF(stderr, L"create %s error: %s\n", out, ec);
+    return 1;
+  }
+  if (!verify(out, ec)) {
+    bela::FPrintF(stderr, L"verify %s error: %s\n", out, ec);
+    return 1;
+  }
+  return 0;
+}
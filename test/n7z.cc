@@ -0,0 +1,195 @@
+///
+#include <baulk/archive.hpp>
+#include <baulk/archive/7z.hpp>
+#include <baulk/archive/extractor.hpp>
+#include <bela/terminal.hpp>
+#include <bela/io.hpp>
+#include <cstdio>
+#include <filesystem>
+#include <map>
+
+// sample.7z comes from fixtures/mkfixtures.py, the contents below must match its generators
+namespace n7z = baulk::archive::n7z;
+
+std::string fixtureReadme() {
+  std::string s;
+  char line[96];
+  for (int i = 0; s.size() < 40000; i++) {
+    auto n = snprintf(line, sizeof(line), "%05d baulk cabinet fixture, deflate frames share a 32K history\n", i);
+    s.append(line, static_cast<size_t>(n));
+  }
+  s.resize(40000);
+  return s;
+}
+
+std::string fixtureLibrary() {
+  std::string s;
+  uint32_t x = 2463534242;
+  while (s.size() < 50001) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    if (!s.empty() && x % 4 != 0) {
+      auto off = 1 + (x >> 8) % (std::min)(static_cast<uint32_t>(s.size()), 4000U);
+      auto n = 3 + (x >> 20) % 60;
+      for (uint32_t i = 0; i < n; i++) {
+        s.push_back(s[s.size() - off]);
+      }
+      continue;
+    }
+    s.push_back(static_cast<char>(x >> 24));
+  }
+  s.resize(50001);
+  return s;
+}
+
+// x86 like code: E8/E9/0F8x with targets inside and outside the image
+std::string fixtureExecutable() {
+  std::string s;
+  auto put32 = [&](uint32_t v) {
+    for (int i = 0; i < 4; i++) {
+      s.push_back(static_cast<char>(v >> (8 * i)));
+    }
+  };
+  uint32_t x = 88172645;
+  while (s.size() < 70000) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    switch (x % 8) {
+    case 0:
+      s.push_back('\xE8');
+      put32((x >> 8) % 70000 - static_cast<uint32_t>(s.size() + 4));
+      break;
+    case 1:
+      s.push_back('\xE9');
+      put32(x >> 3);
+      break;
+    case 2:
+      s.push_back('\x0F');
+      s.push_back(static_cast<char>(0x80 | ((x >> 4) & 0x0F)));
+      put32((x >> 12) % 512 - 256);
+      break;
+    default: {
+      const uint8_t code[] = {0x55, 0x8B, 0xEC, static_cast<uint8_t>(x >> 24)};
+      s.append(reinterpret_cast<const char *>(code), 1 + (x >> 9) % 4);
+    } break;
+    }
+  }
+  s.resize(70000);
+  return s;
+}
+
+const std::map<std::string, std::string> &fixtureContent() {
+  static const std::map<std::string, std::string> contents{
+      {"bin/sample.exe", fixtureExecutable()},
+      {"bin/sample.dll", fixtureLibrary()},
+      {"docs/readme.txt", fixtureReadme()},
+      {"docs/notes.txt", "BCJ2 and LZMA2 folders\r\n"},
+  };
+  return contents;
+}
+
+bool checkReader(const std::filesystem::path &dir) {
+  bela::error_code ec;
+  n7z::Reader r;
+  if (!r.OpenReader((dir / L"sample.7z").native(), ec) || !r.CheckMethods(ec)) {
+    bela::FPrintF(stderr, L"open sample.7z error: %s\n", ec);
+    return false;
+  }
+  const auto &folders = r.Folders();
+  if (folders.size() != 2 || folders[0].coders.size() != 4 || folders[0].coders[0].method != n7z::methodBCJ2 ||
+      folders[0].coders[1].method != n7z::methodLZMA2 || folders[0].coders[2].method != n7z::methodLZMA ||
+      folders[1].coders.size() != 1 || folders[1].coders[0].method != n7z::methodLZMA2) {
+    bela::FPrintF(stderr, L"sample.7z: unexpected folders\n");
+    return false;
+  }
+  std::map<std::string, bool> entries;
+  for (const auto &file : r.Files()) {
+    if (!file.has_stream) {
+      entries[file.name] = file.IsDir();
+    }
+  }
+  if (r.Files().size() != 7 || entries != std::map<std::string, bool>{{"bin", true},
+                                                                      {"docs", true},
+                                                                      {"docs/empty.txt", false}}) {
+    bela::FPrintF(stderr, L"sample.7z: unexpected files\n");
+    return false;
+  }
+  std::map<std::string, std::string> got;
+  n7z::Reader::FolderHandler h{
+      .begin = [&](const n7z::File &file, bela::error_code &) -> bool {
+        got[file.name].clear();
+        return true;
+      },
+      .write = [&](const n7z::File &file, const void *data, size_t len, bela::error_code &) -> bool {
+        got[file.name].append(static_cast<const char *>(data), len);
+        return true;
+      },
+      .end = [](const n7z::File &, bela::error_code &) -> bool { return true; },
+  };
+  for (size_t i = 0; i < folders.size(); i++) {
+    if (!r.DecompressFolder(i, h, ec)) {
+      bela::FPrintF(stderr, L"sample.7z: folder %d error: %s\n", i, ec);
+      return false;
+    }
+  }
+  if (got != fixtureContent()) {
+    bela::FPrintF(stderr, L"sample.7z: decoded contents do not match\n");
+    return false;
+  }
+  return true;
+}
+
+bool readAll(const std::filesystem::path &file, std::string &out, bela::error_code &ec) {
+  auto fd = bela::io::NewFile(file.native(), ec);
+  if (!fd) {
+    return false;
+  }
+  auto size = fd->Size(ec);
+  if (size < 0) {
+    return false;
+  }
+  out.resize(static_cast<size_t>(size));
+  return out.empty() || fd->ReadFull({reinterpret_cast<uint8_t *>(out.data()), out.size()}, ec);
+}
+
+bool checkExtractor(const std::filesystem::path &dir) {
+  std::error_code e;
+  auto dest = std::filesystem::temp_directory_path(e) / L"baulk-n7z-test";
+  std::filesystem::remove_all(dest, e);
+  auto closer = bela::finally([&] { std::filesystem::remove_all(dest, e); });
+  bela::error_code ec;
+  n7z::Extractor extractor(baulk::archive::ExtractorOptions{});
+  if (!extractor.OpenReader(dir / L"sample.7z", dest, ec) || !extractor.Extract(nullptr, nullptr, ec)) {
+    bela::FPrintF(stderr, L"extract sample.7z error: %s\n", ec);
+    return false;
+  }
+  for (const auto &[name, expected] : fixtureContent()) {
+    auto path = dest / bela::encode_into<char, wchar_t>(name);
+    std::string content;
+    if (!readAll(path, content, ec)) {
+      bela::FPrintF(stderr, L"sample.7z: read %v error: %s\n", path, ec);
+      return false;
+    }
+    if (content != expected) {
+      bela::FPrintF(stderr, L"sample.7z: %v does not match\n", path);
+      return false;
+    }
+  }
+  if (!std::filesystem::is_regular_file(dest / L"docs" / L"empty.txt", e) ||
+      std::filesystem::file_size(dest / L"docs" / L"empty.txt", e) != 0) {
+    bela::FPrintF(stderr, L"sample.7z: docs/empty.txt missing\n");
+    return false;
+  }
+  bela::FPrintF(stderr, L"sample.7z: extracted with %d workers\n", extractor.Workers());
+  return true;
+}
+
+int wmain(int argc, wchar_t **argv) {
+  std::filesystem::path dir = argc > 1 ? std::filesystem::path(argv[1]) : std::filesystem::path(BAULK_FIXTURES_DIR);
+  auto readerOk = checkReader(dir);
+  auto extractorOk = checkExtractor(dir);
+  bela::FPrintF(stderr, L"reader: %s\nextractor: %s\n", readerOk ? L"ok" : L"FAILED", extractorOk ? L"ok" : L"FAILED");
+  return readerOk && extractorOk ? 0 : 1;
+}
@@ -0,0 +1,152 @@
+//
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <baulk/net.hpp>
+#include <baulk/net/scheduler.hpp>
+#include <bela/terminal.hpp>
+#include <atomic>
+#include <thread>
+
+namespace net = baulk::net;
+
+// serve: 'GET /<size>/<name>' answers size bytes, the send rate seen by the server is printed per connection
+class LocalServer {
+public:
+  ~LocalServer() {
+    if (ls != INVALID_SOCKET) {
+      closesocket(ls);
+    }
+    if (acceptor.joinable()) {
+      acceptor.join();
+    }
+  }
+  bool Listen() {
+    if ((ls = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) == INVALID_SOCKET) {
+      return false;
+    }
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int len = sizeof(addr);
+    if (bind(ls, reinterpret_cast<sockaddr *>(&addr), len) != 0 || listen(ls, 16) != 0 ||
+        getsockname(ls, reinterpret_cast<sockaddr *>(&addr), &len) != 0) {
+      return false;
+    }
+    port = ntohs(addr.sin_port);
+    acceptor = std::thread([this] { accept_loop(); });
+    return true;
+  }
+  int Port() const { return port; }
+
+private:
+  void accept_loop() {
+    for (;;) {
+      auto s = accept(ls, nullptr, nullptr);
+      if (s == INVALID_SOCKET) {
+        return;
+      }
+      std::thread([s] { serve(s); }).detach();
+    }
+  }
+  static void serve(SOCKET s) {
+    // a small send buffer keeps the server from running ahead of the client
+    int sndbuf = 64 * 1024;
+    setsockopt(s, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char *>(&sndbuf), sizeof(sndbuf));
+    std::string request;
+    char buf[4096];
+    while (request.find("\r\n\r\n") == std::string::npos) {
+      auto n = recv(s, buf, sizeof(buf), 0);
+      if (n <= 0) {
+        closesocket(s);
+        return;
+      }
+      request.append(buf, n);
+    }
+    size_t size = 0;
+    if (auto pos = request.find(" /"); pos != std::string::npos) {
+      size = strtoull(request.data() + pos + 2, nullptr, 10);
+    }
+    auto header = bela::StringNarrowCat("HTTP/1.1 200 OK\r\nContent-Length: ", size, "\r\nConnection: close\r\n\r\n");
+    send(s, header.data(), static_cast<int>(header.size()), 0);
+    std::string block(64 * 1024, 'b');
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t sent = 0; sent < size;) {
+      auto n = send(s, block.data(), static_cast<int>((std::min)(block.size(), size - sent)), 0);
+      if (n <= 0) {
+        break;
+      }
+      sent += static_cast<size_t>(n);
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    bela::FPrintF(stderr, L"server: %d bytes in %.2fs, %.0f bytes/s\n", size, elapsed,
+                  static_cast<double>(size) / (std::max)(elapsed, 0.001));
+    shutdown(s, SD_SEND);
+    closesocket(s);
+  }
+  SOCKET ls{INVALID_SOCKET};
+  int port{0};
+  std::thread acceptor;
+};
+
+int wmain(int argc, wchar_t **argv) {
+  uint64_t rate = 2 * 1024 * 1024;
+  if (argc > 1) {
+    if (auto n = net::ParseBytes(argv[1]); n) {
+      rate = *n;
+    }
+  }
+  WSADATA wsaData;
+  WSAStartup(MAKEWORD(2, 2), &wsaData);
+  LocalServer server;
+  if (!server.Listen()) {
+    bela::FPrintF(stderr, L"listen error: %s\n", bela::make_system_error_code());
+    return 1;
+  }
+  net::Scheduler::Default().SetRateLimit(rate);
+  net::Scheduler::Default().SetHostConnections(3);
+  auto size = rate * 4;
+  auto base = bela::StringCat(L"http://127.0.0.1:", server.Port(), L"/");
+  auto begin = std::chrono::steady_clock::now();
+  std::atomic_bool failed{false};
+  std::vector<std::thread> archives;
+  for (int i = 0; i < 2; i++) {
+    archives.emplace_back([&, i] {
+      bela::error_code ec;
+      auto file = net::WinGet(bela::StringCat(base, size / 2, L"/archive", i, L".bin"),
+                              {.cwd = std::filesystem::temp_directory_path(), .force_overwrite = true}, ec);
+      if (!file) {
+        bela::FPrintF(stderr, L"download error: %s\n", ec);
+        failed = true;
+        return;
+      }
+      std::error_code e;
+      std::filesystem::remove(*file, e);
+    });
+  }
+  // a feed fetched while both archives are throttled: it does not queue behind their bytes
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  auto feedBegin = std::chrono::steady_clock::now();
+  bela::error_code ec;
+  auto resp = net::RestGet(bela::StringCat(base, 4096, L"/feed.atom"), ec);
+  auto feedElapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - feedBegin).count();
+  for (auto &t : archives) {
+    t.join();
+  }
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  if (!resp || failed) {
+    bela::FPrintF(stderr, L"transfer error: %s\n", ec);
+    return 1;
+  }
+  auto measured = static_cast<double>(size) / elapsed;
+  bela::FPrintF(stderr, L"limit %d bytes/s, measured %.0f bytes/s, feed after %.2fs\n", rate, measured, feedElapsed);
+  // the burst lets the first tenth of a second through at full speed
+  if (measured > static_cast<double>(rate) * 1.1) {
+    bela::FPrintF(stderr, L"\x1b[31mrate limit exceeded\x1b[0m\n");
+    return 1;
+  }
+  if (feedElapsed > 1.0) {
+    bela::FPrintF(stderr, L"\x1b[31mfeed was not served before the archives\x1b[0m\n");
+    return 1;
+  }
+  return 0;
+}
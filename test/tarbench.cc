@@ -0,0 +1,196 @@
+//
+#include <bela/terminal.hpp>
+#include <bela/str_cat.hpp>
+#include <tar/tarinternal.hpp>
+#include <chrono>
+#include <vector>
+
+namespace tar = baulk::archive::tar;
+
+// MemoryReader: tar stream held in memory, isolates header processing from I/O
+class MemoryReader : public tar::ExtractReader {
+public:
+  MemoryReader(const std::vector<uint8_t> &data_) : data(data_) {}
+  tar::ssize_t Read(void *buffer, size_t len, bela::error_code &ec) override {
+    auto n = (std::min)(len, data.size() - pos);
+    memcpy(buffer, data.data() + pos, n);
+    pos += n;
+    return static_cast<tar::ssize_t>(n);
+  }
+  bool Discard(int64_t len, bela::error_code &ec) override {
+    pos = (std::min)(data.size(), pos + static_cast<size_t>(len));
+    return true;
+  }
+  bool WriteTo(const tar::Writer &w, int64_t filesize, int64_t &extracted, bela::error_code &ec) override {
+    auto n = (std::min)(static_cast<size_t>(filesize), data.size() - pos);
+    extracted = static_cast<int64_t>(n);
+    pos += n;
+    return w(data.data() + pos - n, n, ec);
+  }
+
+private:
+  const std::vector<uint8_t> &data;
+  size_t pos{0};
+};
+
+template <size_t N> void formatOctal(char (&field)[N], int64_t v) {
+  memset(field, '0', N - 1);
+  field[N - 1] = 0;
+  for (auto i = static_cast<int>(N) - 2; i >= 0 && v != 0; i--) {
+    field[i] = static_cast<char>('0' + (v & 7));
+    v >>= 3;
+  }
+}
+
+// makeTar: count USTAR entries of one data block each, like a source tarball full of tiny files
+std::vector<uint8_t> makeTar(int count) {
+  std::vector<uint8_t> data;
+  data.reserve(static_cast<size_t>(count + 1) * 1024);
+  for (int i = 0; i < count; i++) {
+    tar::ustar_header hdr{0};
+    auto name = bela::StringNarrowCat("src/module", i / 1000, "/file", i, ".c");
+    memcpy(hdr.name, name.data(), (std::min)(name.size(), sizeof(hdr.name)));
+    formatOctal(hdr.mode, 0644);
+    formatOctal(hdr.uid, 1000);
+    formatOctal(hdr.gid, 1000);
+    formatOctal(hdr.size, 100 + i % 400);
+    formatOctal(hdr.mtime, 1600000000 + i);
+    hdr.typeflag = tar::TypeReg;
+    memcpy(hdr.magic, tar::magicUSTAR, sizeof(hdr.magic));
+    memcpy(hdr.version, tar::versionUSTAR, sizeof(hdr.version));
+    memset(hdr.chksum, ' ', sizeof(hdr.chksum));
+    auto p = reinterpret_cast<const uint8_t *>(&hdr);
+    int64_t sum = 0;
+    for (size_t j = 0; j < sizeof(hdr); j++) {
+      sum += p[j];
+    }
+    char chksum[7];
+    formatOctal(chksum, sum);
+    memcpy(hdr.chksum, chksum, sizeof(chksum));
+    data.insert(data.end(), p, p + sizeof(hdr));
+    data.resize(data.size() + tar::blockSize, 'x');
+  }
+  data.resize(data.size() + tar::blockSize * 2, 0);
+  return data;
+}
+
+// scalar references, the previous implementation
+int64_t scalarSum(const tar::ustar_header &hdr) {
+  int64_t check = 0;
+  auto p = reinterpret_cast<const uint8_t *>(&hdr);
+  for (int i = 0; i < 512; i++) {
+    check += (148 <= i && i < 156) ? ' ' : p[i];
+  }
+  return check;
+}
+
+bool scalarChecksum(const tar::ustar_header &hdr) {
+  auto sum = std::strtoll(std::string(hdr.chksum, sizeof(hdr.chksum)).data(), nullptr, 8);
+  return scalarSum(hdr) == sum;
+}
+
+bool scalarZero(const tar::ustar_header &hdr) {
+  static tar::ustar_header zeroth = {0};
+  return memcmp(&hdr, &zeroth, sizeof(hdr)) == 0;
+}
+
+int64_t scalarOctal(const char *p, size_t n) {
+  int64_t val = 0;
+  std::from_chars(p, p + n, val, 8);
+  return val;
+}
+
+template <typename Fn> double measure(Fn fn) {
+  auto start = std::chrono::steady_clock::now();
+  fn();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int wmain(int argc, wchar_t **argv) {
+  int count = argc > 1 ? _wtoi(argv[1]) : 100000;
+  auto data = makeTar(count);
+  std::vector<const tar::ustar_header *> headers;
+  for (size_t i = 0; i < static_cast<size_t>(count); i++) {
+    headers.emplace_back(reinterpret_cast<const tar::ustar_header *>(data.data() + i * 2 * tar::blockSize));
+  }
+  bela::FPrintF(stderr, L"tar: %d entries %d bytes\n", count, data.size());
+
+  int64_t sink = 0;
+  auto report = [&](std::wstring_view name, double scalar, double fast) {
+    bela::FPrintF(stderr, L"%s: scalar %.2f ns/hdr fast %.2f ns/hdr x%.2f\n", name, scalar * 1e9 / count,
+                  fast * 1e9 / count, scalar / fast);
+  };
+  report(
+      L"checksum", measure([&] {
+        for (auto h : headers) {
+          sink += scalarChecksum(*h) ? 1 : 0;
+        }
+      }),
+      measure([&] {
+        for (auto h : headers) {
+          sink += tar::checksumBlock(*h).unsigned_sum == tar::parseNumeric(h->chksum) ? 1 : 0;
+        }
+      }));
+  report(
+      L"zero block", measure([&] {
+        for (auto h : headers) {
+          sink += scalarZero(*h) ? 1 : 0;
+        }
+      }),
+      measure([&] {
+        for (auto h : headers) {
+          sink += tar::isZeroBlock(*h) ? 1 : 0;
+        }
+      }));
+  report(
+      L"octal", measure([&] {
+        for (auto h : headers) {
+          sink += scalarOctal(h->size, sizeof(h->size)) + scalarOctal(h->mtime, sizeof(h->mtime)) +
+                  scalarOctal(h->mode, sizeof(h->mode));
+        }
+      }),
+      measure([&] {
+        for (auto h : headers) {
+          sink += tar::parseNumeric(h->size) + tar::parseNumeric(h->mtime) + tar::parseNumeric(h->mode);
+        }
+      }));
+  // results must agree, also for headers full of high bytes (long UTF-8 names) where the sum exceeds 16 bits
+  for (size_t high : {size_t{355}, size_t{512}}) {
+    tar::ustar_header hdr;
+    auto p = reinterpret_cast<uint8_t *>(&hdr);
+    memset(p, 'a', sizeof(hdr));
+    memset(p, 0xFF, high);
+    if (auto sum = tar::checksumBlock(hdr).unsigned_sum; sum != scalarSum(hdr)) {
+      bela::FPrintF(stderr, L"checksum mismatch with %d high bytes: %d != %d\n", high, sum, scalarSum(hdr));
+      return 1;
+    }
+  }
+  for (auto h : headers) {
+    if (scalarOctal(h->size, sizeof(h->size)) != tar::parseNumeric(h->size) ||
+        scalarOctal(h->mtime, sizeof(h->mtime)) != tar::parseNumeric(h->mtime) ||
+        scalarChecksum(*h) != (tar::checksumBlock(*h).unsigned_sum == tar::parseNumeric(h->chksum))) {
+      bela::FPrintF(stderr, L"mismatch at %s\n", h->name);
+      return 1;
+    }
+  }
+
+  bela::error_code ec;
+  MemoryReader mr(data);
+  tar::Reader tr(&mr);
+  int entries = 0;
+  auto seconds = measure([&] {
+    for (;;) {
+      auto fh = tr.Next(ec);
+      if (!fh) {
+        break;
+      }
+      entries++;
+    }
+  });
+  if (ec != bela::ErrEnded || entries != count) {
+    bela::FPrintF(stderr, L"reader: %d entries, error %s\n", entries, ec);
+    return 1;
+  }
+  bela::FPrintF(stderr, L"reader: %d entries %.2f ns/entry (%d)\n", entries, seconds * 1e9 / entries, sink);
+  return 0;
+}
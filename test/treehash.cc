@@ -0,0 +1,57 @@
+//
+#include "blake3.hpp"
+#include <bela/terminal.hpp>
+#include <bela/hash.hpp>
+#include <random>
+
+namespace blake3 = baulk::hash::blake3;
+
+constexpr size_t MiB = 1024 * 1024;
+
+// treeDigest: Update in pieces cycling through splits, a split of 0 means the whole input at once
+std::wstring treeDigest(const std::vector<uint8_t> &input, const std::vector<size_t> &splits) {
+  blake3::TreeHasher h;
+  size_t pos = 0;
+  for (size_t i = 0; pos < input.size(); i++) {
+    auto n = splits.empty() ? input.size() : (std::min)(splits[i % splits.size()], input.size() - pos);
+    h.Update(input.data() + pos, n);
+    pos += n;
+  }
+  uint8_t out[blake3::outLength];
+  h.Finalize(out);
+  std::wstring s;
+  bela::hash::HashEncode(out, sizeof(out), s);
+  return s;
+}
+
+int wmain() {
+  const size_t sizes[] = {0, 1, 1024, MiB - 1, MiB, MiB + 1, 2 * MiB, 5 * MiB + 4097, 8 * MiB + 1};
+  // pieces that end just before, on and after 1 MiB unit boundaries, and a run of small writes
+  const std::vector<std::vector<size_t>> splitSets{
+      {},
+      {MiB - 1, 2, MiB - 1},
+      {1, 1023, 4095, 65537, MiB + 3},
+      {3 * MiB + 1, 7},
+      {64 * 1024},
+  };
+  std::mt19937_64 rng(0x626c616b6533);
+  int failed = 0;
+  for (auto size : sizes) {
+    std::vector<uint8_t> input(size);
+    for (auto &b : input) {
+      b = static_cast<uint8_t>(rng());
+    }
+    bela::hash::blake3::Hasher ref;
+    ref.Initialize();
+    ref.Update(input.data(), input.size());
+    auto expected = ref.Finalize();
+    for (size_t k = 0; k < splitSets.size(); k++) {
+      if (auto got = treeDigest(input, splitSets[k]); got != expected) {
+        bela::FPrintF(stderr, L"size %d splits %d: %s != %s\n", size, k, got, expected);
+        failed++;
+      }
+    }
+  }
+  bela::FPrintF(stderr, L"TreeHasher: %s\n", failed == 0 ? L"ok" : L"FAILED");
+  return failed == 0 ? 0 : 1;
+}
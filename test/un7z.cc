@@ -0,0 +1,53 @@
+///
+#include <baulk/archive.hpp>
+#include <baulk/archive/7z.hpp>
+#include <baulk/archive/extractor.hpp>
+#include <bela/terminal.hpp>
+#include <chrono>
+
+namespace n7z = baulk::archive::n7z;
+
+int list(std::wstring_view file) {
+  bela::error_code ec;
+  n7z::Reader r;
+  if (!r.OpenReader(file, ec)) {
+    bela::FPrintF(stderr, L"open 7z %s error: %s\n", file, ec);
+    return 1;
+  }
+  for (const auto &folder : r.Folders()) {
+    bela::FPrintF(stderr, L"folder: %d coders %d files unpack %d dictionary %d\n", folder.coders.size(),
+                  folder.files.size(), folder.UnpackSize(), folder.DictionarySize());
+  }
+  for (const auto &f : r.Files()) {
+    bela::FPrintF(stderr, L"%s%s %d folder %d\n", f.name, f.IsDir() ? "/" : "", f.size, f.folder);
+  }
+  if (!r.CheckMethods(ec)) {
+    bela::FPrintF(stderr, L"%s\n", ec);
+  }
+  return 0;
+}
+
+int wmain(int argc, wchar_t **argv) {
+  if (argc < 2) {
+    bela::FPrintF(stderr, L"usage: %s 7z-file [destination]\n", argv[0]);
+    return 1;
+  }
+  if (argc == 2) {
+    return list(argv[1]);
+  }
+  bela::error_code ec;
+  n7z::Extractor extractor(baulk::archive::ExtractorOptions{});
+  if (!extractor.OpenReader(argv[1], argv[2], ec)) {
+    bela::FPrintF(stderr, L"open 7z %s error: %s\n", argv[1], ec);
+    return 1;
+  }
+  auto start = std::chrono::steady_clock::now();
+  if (!extractor.Extract(nullptr, nullptr, ec)) {
+    bela::FPrintF(stderr, L"extract 7z %s error: %s\n", argv[1], ec);
+    return 1;
+  }
+  auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  bela::FPrintF(stderr, L"extracted %d bytes in %.3fs with %d workers\n", extractor.UncompressedSize(), seconds,
+                extractor.Workers());
+  return 0;
+}
@@ -0,0 +1,60 @@
+///
+#include <baulk/archive.hpp>
+#include <baulk/archive/msi.hpp>
+#include <bela/terminal.hpp>
+#include <chrono>
+
+namespace msi = baulk::archive::msi;
+
+int list(std::wstring_view file) {
+  bela::error_code ec;
+  msi::Package pkg;
+  if (!pkg.Open(file, ec)) {
+    bela::FPrintF(stderr, L"open msi %s error: %s\n", file, ec);
+    return 1;
+  }
+  for (const auto &c : pkg.Cabinets()) {
+    baulk::archive::cab::Reader r;
+    auto source = pkg.OpenCabinet(c, ec);
+    if (!source || !r.OpenReader(source, ec)) {
+      bela::FPrintF(stderr, L"cabinet %s error: %s\n", c, ec);
+      continue;
+    }
+    for (const auto &folder : r.Folders()) {
+      bela::FPrintF(stderr, L"cabinet %s: folder method %d window %d blocks %d files %d\n", c, folder.Method(),
+                    folder.WindowBits(), folder.blocks, folder.files.size());
+    }
+    if (!r.CheckMethods(ec)) {
+      bela::FPrintF(stderr, L"%s\n", ec);
+    }
+  }
+  for (const auto &f : pkg.Files()) {
+    bela::FPrintF(stderr, L"%s %d %s\n", f.key, f.size, f.path);
+  }
+  return 0;
+}
+
+int wmain(int argc, wchar_t **argv) {
+  if (argc < 2) {
+    bela::FPrintF(stderr, L"usage: %s msi-file [destination]\n", argv[0]);
+    return 1;
+  }
+  if (argc == 2) {
+    return list(argv[1]);
+  }
+  bela::error_code ec;
+  msi::Unpacker unpacker;
+  if (!unpacker.OpenReader(argv[1], argv[2], ec)) {
+    bela::FPrintF(stderr, L"open msi %s error: %s\n", argv[1], ec);
+    return 1;
+  }
+  auto start = std::chrono::steady_clock::now();
+  if (!unpacker.Extract(nullptr, ec)) {
+    bela::FPrintF(stderr, L"extract msi %s error: %s\n", argv[1], ec);
+    return 1;
+  }
+  auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  bela::FPrintF(stderr, L"extracted %d bytes in %.3fs with %d workers\n", unpacker.UncompressedSize(), seconds,
+                unpacker.Workers());
+  return 0;
+}
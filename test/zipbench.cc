@@ -0,0 +1,127 @@
+//
+#include <baulk/archive.hpp>
+#include <baulk/archive/zip.hpp>
+#include <baulk/archive/tar.hpp>
+#include <bela/terminal.hpp>
+#include <bela/path.hpp>
+#include <bela/io.hpp>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace zip = baulk::archive::zip;
+namespace tar = baulk::archive::tar;
+namespace fs = std::filesystem;
+
+// makeTree: synthetic installed tree, compressible text mixed with random binary
+bool makeTree(const fs::path &root, uint64_t total, bela::error_code &ec) {
+  constexpr std::string_view words[] = {"baulk ", "package ", "manager ", "windows ", "archive ", "zstd ",
+                                        "deflate ", "toolchain ", "include ", "library "};
+  std::mt19937_64 rng(20201);
+  std::string content;
+  uint64_t written = 0;
+  for (int i = 0; written < total; i++) {
+    auto dir = root / bela::StringCat(L"dir", i % 64);
+    std::error_code e;
+    fs::create_directories(dir, e);
+    auto size = static_cast<size_t>(4096 + rng() % (4 * 1024 * 1024));
+    content.clear();
+    while (content.size() < size) {
+      if (rng() % 4 == 0) {
+        for (int j = 0; j < 64; j++) {
+          content.push_back(static_cast<char>(rng()));
+        }
+        continue;
+      }
+      content.append(words[rng() % std::size(words)]);
+    }
+    auto file = dir / bela::StringCat(L"file", i, L".bin");
+    if (!bela::io::WriteText(file.native(),
+                             {reinterpret_cast<const uint8_t *>(content.data()), content.size()}, ec)) {
+      return false;
+    }
+    written += content.size();
+  }
+  return true;
+}
+
+template <typename Fn> double measure(Fn fn, bela::error_code &ec) {
+  auto start = std::chrono::steady_clock::now();
+  if (!fn(ec)) {
+    return -1;
+  }
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int wmain(int argc, wchar_t **argv) {
+  bela::error_code ec;
+  fs::path root;
+  uint64_t total = 512ULL * 1024 * 1024;
+  if (argc > 1) {
+    root = argv[1];
+  } else {
+    root = fs::temp_directory_path() / L"baulk-zipbench";
+    if (!fs::exists(root) && !makeTree(root, total, ec)) {
+      bela::FPrintF(stderr, L"make tree error: %s\n", ec);
+      return 1;
+    }
+  }
+  total = 0;
+  std::error_code e;
+  for (auto &it : fs::recursive_directory_iterator(root, e)) {
+    if (it.is_regular_file(e)) {
+      total += it.file_size(e);
+    }
+  }
+  auto mb = static_cast<double>(total) / (1024 * 1024);
+  auto out = fs::temp_directory_path();
+  auto maxThreads = static_cast<int>((std::max)(std::thread::hardware_concurrency(), 1U));
+  // powers of two, then the core count itself when it is not one of them
+  std::vector<int> sweep;
+  for (int threads = 1; threads < maxThreads; threads *= 2) {
+    sweep.emplace_back(threads);
+  }
+  sweep.emplace_back(maxThreads);
+  bela::FPrintF(stderr, L"tree: %s %.2f MB\n", root.native(), mb);
+  struct bench {
+    std::wstring_view name;
+    std::function<bool(int, bela::error_code &)> run;
+  };
+  bench benches[] = {
+      {L"zip-deflate",
+       [&](int threads, bela::error_code &ec) {
+         zip::ArchiveWriter w;
+         return w.OpenWriter((out / L"zipbench.zip").native(), {.method = zip::ZIP_DEFLATE, .workers = threads},
+                             ec) &&
+                w.AddTree(root, "", ec) && w.Close(ec);
+       }},
+      {L"zip-zstd",
+       [&](int threads, bela::error_code &ec) {
+         zip::ArchiveWriter w;
+         return w.OpenWriter((out / L"zipbench.zip").native(), {.method = zip::ZIP_ZSTD, .workers = threads}, ec) &&
+                w.AddTree(root, "", ec) && w.Close(ec);
+       }},
+      {L"tar-zstd",
+       [&](int threads, bela::error_code &ec) {
+         tar::ArchiveWriter w;
+         return w.OpenWriter((out / L"zipbench.tar.zst").native(), {.workers = threads}, ec) &&
+                w.AddTree(root, "", ec) && w.Close(ec);
+       }},
+  };
+  for (const auto &b : benches) {
+    double base = 0;
+    for (auto threads : sweep) {
+      auto seconds = measure([&](bela::error_code &ec) { return b.run(threads, ec); }, ec);
+      if (seconds < 0) {
+        bela::FPrintF(stderr, L"%s error: %s\n", b.name, ec);
+        return 1;
+      }
+      if (threads == 1) {
+        base = seconds;
+      }
+      bela::FPrintF(stderr, L"%s threads %d: %.2f MB/s x%.2f\n", b.name, threads, mb / seconds, base / seconds);
+    }
+  }
+  return 0;
+}
@@ -46,7 +46,9 @@ std::optional<command_t> ParseArgv(int argc, wchar_t **argv) {
       .Add(L"force-delete", cli::no_argument, 1002)
       .Add(L"github-proxy", cli::required_argument, 1003)
       .Add(L"trace", cli::no_argument, 'T')
-      .Add(L"bucket");
+      .Add(L"bucket")
+      .Add(L"b3sum")
+      .Add(L"sha256sum");
 
   bela::error_code ec;
   auto result = pa.Execute(
@@ -131,6 +133,7 @@ std::optional<command_t> ParseArgv(int argc, wchar_t **argv) {
       {.name = L"freeze", .cmd_entry = baulk::commands::cmd_freeze, .require_context = true},    // freeze
       {.name = L"unfreeze", .cmd_entry = baulk::commands::cmd_unfreeze, .require_context = true},     // unfreeze
       {.name = L"cleancache", .cmd_entry = baulk::commands::cmd_cleancache, .require_context = true}, // cleancache
+      {.name = L"serve-cache", .cmd_entry = baulk::commands::cmd_servecache, .require_context = true}, // cache mirror
       {.name = L"bucket", .cmd_entry = baulk::commands::cmd_bucket, .require_context = true},         // bucket command
       {.name = L"b3sum", .cmd_entry = baulk::commands::cmd_b3sum, .require_context = false},          // b3sum
       {.name = L"sha256sum", .cmd_entry = baulk::commands::cmd_sha256sum, .require_context = false},  // sha256sum
@@ -148,7 +151,10 @@ std::optional<command_t> ParseArgv(int argc, wchar_t **argv) {
           bela::FPrintF(stderr, L"baulk initialize context error: \x1b[31m%s\x1b[0m\n", ec);
           return std::nullopt;
         }
+        auto start = std::chrono::steady_clock::now();
         net::HttpClient::DefaultClient().InitializeProxyFromEnv();
+        net::Scheduler::Default().InitializeFromEnv();
+        TracePhase(L"proxy", start);
       }
       return std::make_optional<command_t>(command_t{
           .argv = commands::argv_t(pa.Argv().begin() + 1, pa.Argv().end()),
@@ -176,9 +182,13 @@ public:
 };
 
 int wmain(int argc, wchar_t **argv) {
+  auto start = std::chrono::steady_clock::now();
   dotcom_global_initializer di;
   if (auto cmd = baulk::ParseArgv(argc, argv); cmd) {
-    return (*cmd)();
+    baulk::TracePhase(L"startup", start);
+    auto exitcode = (*cmd)();
+    baulk::TraceSummary(start);
+    return exitcode;
   }
   return 1;
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <bela/base.hpp>
 #include <bela/terminal.hpp>
 #include <bela/path.hpp>
+#include <chrono>
 #include <baulk/debug.hpp>
 #include "compiler.hpp"
 
@@ -74,10 +75,17 @@ bool InitializeContext(std::wstring_view profile, bela::error_code &ec);
 bool InitializeExecutor(bela::error_code &ec);
 std::wstring_view Profile();
 std::wstring_view LocaleName();
+// CacheQuota: byte quota of the download cache
+uint64_t CacheQuota();
+// CacheMirror: base url of a 'baulk serve-cache' mirror tried before upstream, empty when none is set
+std::wstring_view CacheMirror();
 Buckets &LoadedBuckets();
 compiler::Executor &LinkExecutor();
 bool IsFrozenedPackage(std::wstring_view pkgName);
 int BucketWeights(std::wstring_view bucket);
+// Startup trace: record phase elapsed time when trace mode is turned on
+void TracePhase(std::wstring_view phase, std::chrono::steady_clock::time_point start);
+void TraceSummary(std::chrono::steady_clock::time_point start);
 
 // package base
 
@@ -180,13 +188,15 @@ struct Package {
   bool Is7zExtension() const { return bela::EqualsIgnoreCase(L"7z", extension); }
 };
 
-inline std::wstring StringCategory(baulk::Package &pkg) {
-  if (pkg.venv.category.empty()) {
+inline std::wstring StringCategory(std::wstring_view category) {
+  if (category.empty()) {
     return L"";
   }
-  return bela::StringCat(L" \x1b[36m[", pkg.venv.category, L"]\x1b[0m");
+  return bela::StringCat(L" \x1b[36m[", category, L"]\x1b[0m");
 }
 
+inline std::wstring StringCategory(const baulk::Package &pkg) { return StringCategory(pkg.venv.category); }
+
 } // namespace baulk
 
 #endif
@@ -117,6 +117,7 @@ bool BucketUpdate(const baulk::Bucket &bucket, std::wstring_view id, bela::error
                                           {
                                               .hash_value = L"",
                                               .cwd = baulk::vfs::AppTemp(),
+                                              .priority = baulk::net::transfer_priority::metadata,
                                               .force_overwrite = true,
                                           },
                                           ec);
@@ -0,0 +1,387 @@
+// baulk download cache
+#include <algorithm>
+#include <bit>
+#include <map>
+#include <set>
+#include <bela/io.hpp>
+#include <bela/path.hpp>
+#include <bela/fs.hpp>
+#include <bela/str_split.hpp>
+#include <bela/match.hpp>
+#include <bela/ascii.hpp>
+#include <bela/numbers.hpp>
+#include <bela/time.hpp>
+#include <baulk/vfs.hpp>
+#include <baulk/fs.hpp>
+#include "cache.hpp"
+#include "localstate.hpp"
+
+namespace baulk::cache {
+namespace cache_internal {
+constexpr std::wstring_view index_header = L"#baulk-cache 1";
+constexpr std::wstring_view index_name = L"baulk.cache";
+
+inline std::wstring index_path() { return bela::StringCat(vfs::AppTemp(), L"\\", index_name); }
+
+struct FileState {
+  uint64_t size{0};
+  int64_t stamp{0}; // last write time
+};
+
+inline std::optional<FileState> file_state(std::wstring_view file) {
+  WIN32_FILE_ATTRIBUTE_DATA wfad;
+  if (GetFileAttributesExW(file.data(), GetFileExInfoStandard, &wfad) != TRUE) {
+    return std::nullopt;
+  }
+  return std::make_optional(FileState{
+      .size = (static_cast<uint64_t>(wfad.nFileSizeHigh) << 32) | wfad.nFileSizeLow,
+      .stamp = std::bit_cast<int64_t>(wfad.ftLastWriteTime),
+  });
+}
+
+struct Entry {
+  std::wstring package;
+  std::wstring version;
+  int64_t hit{0};    // unix seconds of the last download or reuse
+  std::wstring hash; // HashKey of a verified archive
+  FileState state;   // size and last write time when it was verified
+  std::vector<std::wstring> aliases; // urls and file names the archive was requested as
+};
+
+// origin: first url the archive was requested as, aliases also hold file names
+inline std::wstring origin(const Entry &e) {
+  for (const auto &a : e.aliases) {
+    if (a.find(L"://") != std::wstring::npos) {
+      return a;
+    }
+  }
+  return L"";
+}
+
+// unchanged: archive still has the size and last write time it was verified with
+inline bool unchanged(const std::filesystem::path &archive, const Entry &e) {
+  auto state = file_state(archive.native());
+  return state && state->size == e.state.size && state->stamp == e.state.stamp;
+}
+
+// Index: <downloads>/baulk.cache, counters and the last hit of every archive
+struct Index {
+  std::map<std::wstring, Entry, std::less<>> entries;
+  uint64_t hits{0};
+  uint64_t misses{0};
+  uint64_t served{0};
+  bool Load(bela::error_code &ec);
+  bool Save(bela::error_code &ec) const;
+  const std::wstring *FindHash(std::wstring_view hash) const {
+    for (const auto &[name, e] : entries) {
+      if (!e.hash.empty() && e.hash == hash) {
+        return &name;
+      }
+    }
+    return nullptr;
+  }
+};
+
+bool Index::Load(bela::error_code &ec) {
+  auto file = index_path();
+  if (!bela::PathFileIsExists(file)) {
+    return true;
+  }
+  std::wstring text;
+  if (!bela::io::ReadFile(file, text, ec)) {
+    return false;
+  }
+  std::vector<std::wstring_view> lines = bela::StrSplit(text, bela::ByChar('\n'), bela::SkipEmpty());
+  for (auto line : lines) {
+    if (!line.empty() && line.back() == '\r') {
+      line.remove_suffix(1);
+    }
+    std::vector<std::wstring_view> fv = bela::StrSplit(line, bela::ByChar('\t'));
+    if (fv.size() == 4 && fv[0] == L"S") {
+      (void)bela::SimpleAtoi(fv[1], &hits);
+      (void)bela::SimpleAtoi(fv[2], &misses);
+      (void)bela::SimpleAtoi(fv[3], &served);
+      continue;
+    }
+    if (fv.size() >= 5 && fv[0] == L"F") {
+      Entry e{.package = std::wstring(fv[2]), .version = std::wstring(fv[3])};
+      (void)bela::SimpleAtoi(fv[4], &e.hit);
+      if (fv.size() == 8) {
+        e.hash = fv[5];
+        (void)bela::SimpleAtoi(fv[6], &e.state.size);
+        (void)bela::SimpleAtoi(fv[7], &e.state.stamp);
+      }
+      entries.insert_or_assign(std::wstring(fv[1]), std::move(e));
+      continue;
+    }
+    // aliases follow their archive
+    if (fv.size() == 3 && fv[0] == L"A") {
+      if (auto it = entries.find(fv[1]); it != entries.end()) {
+        it->second.aliases.emplace_back(fv[2]);
+      }
+    }
+  }
+  return true;
+}
+
+bool Index::Save(bela::error_code &ec) const {
+  if (!baulk::fs::MakeDirectories(vfs::AppTemp(), ec)) {
+    return false;
+  }
+  auto text = bela::StringCat(index_header, L"\nS\t", hits, L"\t", misses, L"\t", served, L"\n");
+  for (const auto &[name, e] : entries) {
+    bela::StrAppend(&text, L"F\t", name, L"\t", e.package, L"\t", e.version, L"\t", e.hit);
+    if (!e.hash.empty()) {
+      bela::StrAppend(&text, L"\t", e.hash, L"\t", e.state.size, L"\t", e.state.stamp);
+    }
+    text.push_back('\n');
+    for (const auto &a : e.aliases) {
+      bela::StrAppend(&text, L"A\t", name, L"\t", a, L"\n");
+    }
+  }
+  return bela::io::AtomicWriteText(index_path(), bela::io::as_bytes<char>(bela::encode_into<wchar_t, char>(text)),
+                                   ec);
+}
+
+struct Archive {
+  std::wstring name;
+  uint64_t size{0};
+  int64_t hit{0};
+};
+
+// archives: files of the download directory, extraction folders are not part of the cache
+std::vector<Archive> archives(const Index &index) {
+  std::vector<Archive> av;
+  bela::fs::Finder finder;
+  bela::error_code ec;
+  if (!finder.First(vfs::AppTemp(), L"*", ec)) {
+    return av;
+  }
+  do {
+    if (finder.Ignore() || finder.IsDir() || bela::EqualsIgnoreCase(finder.Name(), index_name)) {
+      continue;
+    }
+    Archive a{.name = std::wstring(finder.Name()), .size = static_cast<uint64_t>(finder.Size())};
+    if (auto it = index.entries.find(a.name); it != index.entries.end()) {
+      a.hit = it->second.hit;
+    } else {
+      // not downloaded by install (.part files, 'baulk get'), last written is the best guess
+      a.hit = bela::ToUnixSeconds(bela::FromFileTime(finder.FD().ftLastWriteTime));
+    }
+    av.emplace_back(std::move(a));
+  } while (finder.Next());
+  return av;
+}
+
+void record(const std::filesystem::path &archive, const baulk::Package &pkg, std::wstring_view url, bool hit) {
+  bela::error_code ec;
+  Index index;
+  if (!index.Load(ec)) {
+    DbgPrint(L"load download cache index: %s", ec);
+    return;
+  }
+  const auto &name = archive.filename().native();
+  auto &e = index.entries[name];
+  auto hash = HashKey(pkg.hash);
+  if (!hash.empty()) {
+    // one archive per hash, a copy stored under another name before is dropped
+    if (auto other = index.FindHash(hash); other != nullptr && *other != name) {
+      std::wstring duplicate(*other);
+      DbgPrint(L"download cache: %s duplicates %s", name, duplicate);
+      e.aliases = std::move(index.entries[duplicate].aliases);
+      index.entries.erase(duplicate);
+      bela::error_code rec;
+      bela::fs::ForceDeleteFolders(bela::StringCat(vfs::AppTemp(), L"\\", duplicate), rec);
+    }
+  }
+  e.package = pkg.name;
+  e.version = pkg.version;
+  e.hit = bela::ToUnixSeconds(bela::Now());
+  e.hash.clear();
+  e.state = file_state(archive.native()).value_or(FileState{});
+  if (e.state.size != 0) {
+    e.hash = std::move(hash);
+  }
+  for (auto alias : {url, std::wstring_view(name)}) {
+    if (!alias.empty() && std::ranges::find(e.aliases, alias) == e.aliases.end()) {
+      e.aliases.emplace_back(alias);
+    }
+  }
+  if (hit) {
+    index.hits++;
+    index.served += e.state.size;
+  } else {
+    index.misses++;
+  }
+  if (!index.Save(ec)) {
+    DbgPrint(L"save download cache index: %s", ec);
+  }
+}
+} // namespace cache_internal
+
+std::wstring HashKey(std::wstring_view hash_value) {
+  if (hash_value.empty()) {
+    return L"";
+  }
+  std::wstring_view method = L"SHA256";
+  if (auto pos = hash_value.find(':'); pos != std::wstring_view::npos) {
+    method = hash_value.substr(0, pos);
+    hash_value.remove_prefix(pos + 1);
+  }
+  return bela::StringCat(bela::AsciiStrToUpper(method), L":", bela::AsciiStrToLower(hash_value));
+}
+
+std::optional<std::filesystem::path> Lookup(const baulk::Package &pkg) {
+  if (auto c = Find(pkg.hash); c) {
+    return std::make_optional(std::move(c->archive));
+  }
+  return std::nullopt;
+}
+
+std::optional<Cached> Find(std::wstring_view hash_value) {
+  auto hash = HashKey(hash_value);
+  if (hash.empty()) {
+    return std::nullopt;
+  }
+  cache_internal::Index index;
+  bela::error_code ec;
+  if (!index.Load(ec)) {
+    DbgPrint(L"load download cache index: %s", ec);
+    return std::nullopt;
+  }
+  auto name = index.FindHash(hash);
+  if (name == nullptr) {
+    return std::nullopt;
+  }
+  std::filesystem::path archive = std::filesystem::path(vfs::AppTemp()) / *name;
+  const auto &e = index.entries.find(*name)->second;
+  if (!cache_internal::unchanged(archive, e)) {
+    DbgPrint(L"download cache: %s changed since it was verified", *name);
+    return std::nullopt;
+  }
+  return std::make_optional(
+      Cached{.archive = std::move(archive), .version = e.version, .hash = e.hash, .url = cache_internal::origin(e)});
+}
+
+std::vector<Cached> Archives(std::wstring_view pkgName) {
+  std::vector<Cached> cv;
+  cache_internal::Index index;
+  bela::error_code ec;
+  if (!index.Load(ec)) {
+    DbgPrint(L"load download cache index: %s", ec);
+    return cv;
+  }
+  std::vector<std::pair<int64_t, Cached>> found;
+  for (const auto &[name, e] : index.entries) {
+    if (e.hash.empty() || !bela::EqualsIgnoreCase(e.package, pkgName)) {
+      continue;
+    }
+    auto archive = std::filesystem::path(vfs::AppTemp()) / name;
+    if (!cache_internal::unchanged(archive, e)) {
+      continue;
+    }
+    found.emplace_back(e.hit, Cached{.archive = std::move(archive),
+                                     .version = e.version,
+                                     .hash = e.hash,
+                                     .url = cache_internal::origin(e)});
+  }
+  std::ranges::sort(found, [](const auto &a, const auto &b) { return a.first > b.first; });
+  for (auto &[_, c] : found) {
+    cv.emplace_back(std::move(c));
+  }
+  return cv;
+}
+
+void Hit(const std::filesystem::path &archive, const baulk::Package &pkg, std::wstring_view url) {
+  cache_internal::record(archive, pkg, url, true);
+}
+
+void Served(const std::filesystem::path &archive, uint64_t bytes) {
+  bela::error_code ec;
+  cache_internal::Index index;
+  if (!index.Load(ec)) {
+    DbgPrint(L"load download cache index: %s", ec);
+    return;
+  }
+  if (auto it = index.entries.find(archive.filename().native()); it != index.entries.end()) {
+    it->second.hit = bela::ToUnixSeconds(bela::Now());
+  }
+  index.hits++;
+  index.served += bytes;
+  if (!index.Save(ec)) {
+    DbgPrint(L"save download cache index: %s", ec);
+  }
+}
+
+void Miss(const std::filesystem::path &archive, const baulk::Package &pkg, std::wstring_view url) {
+  cache_internal::record(archive, pkg, url, false);
+}
+
+bool Trim(uint64_t quota, bool keepInstalled, uint64_t &reclaimed, bela::error_code &ec) {
+  cache_internal::Index index;
+  if (!index.Load(ec)) {
+    return false;
+  }
+  auto &store = localstate::Store::Instance();
+  if (keepInstalled && !store.Load(ec)) {
+    return false;
+  }
+  auto pinned = [&](std::wstring_view name) {
+    if (!keepInstalled) {
+      return false;
+    }
+    auto it = index.entries.find(name);
+    if (it == index.entries.end()) {
+      return false;
+    }
+    auto r = store.Find(it->second.package);
+    return r != nullptr && r->version == it->second.version;
+  };
+  auto av = cache_internal::archives(index);
+  // forget archives removed outside of baulk
+  std::set<std::wstring, std::less<>> present;
+  for (const auto &a : av) {
+    present.emplace(a.name);
+  }
+  std::erase_if(index.entries, [&](const auto &kv) { return !present.contains(kv.first); });
+  uint64_t total = 0;
+  for (const auto &a : av) {
+    total += a.size;
+  }
+  std::ranges::sort(av, [](const cache_internal::Archive &a, const cache_internal::Archive &b) {
+    return a.hit < b.hit; // least recently used first
+  });
+  for (const auto &a : av) {
+    if (total <= quota) {
+      break;
+    }
+    if (pinned(a.name)) {
+      continue;
+    }
+    auto file = bela::StringCat(vfs::AppTemp(), L"\\", a.name);
+    bela::error_code rec;
+    if (!bela::fs::ForceDeleteFolders(file, rec)) {
+      bela::FPrintF(stderr, L"baulk: remove %s error: %s\n", a.name, rec);
+      continue;
+    }
+    DbgPrint(L"evict %s (%d bytes, last hit %d)", a.name, a.size, a.hit);
+    index.entries.erase(a.name);
+    total -= a.size;
+    reclaimed += a.size;
+  }
+  return index.Save(ec);
+}
+
+std::optional<Stats> CacheStats(bela::error_code &ec) {
+  cache_internal::Index index;
+  if (!index.Load(ec)) {
+    return std::nullopt;
+  }
+  Stats stats{.hits = index.hits, .misses = index.misses, .served = index.served};
+  for (const auto &a : cache_internal::archives(index)) {
+    stats.archives++;
+    stats.bytes += a.size;
+  }
+  return std::make_optional(stats);
+}
+} // namespace baulk::cache
@@ -0,0 +1,44 @@
+// baulk download cache
+#ifndef BAULK_CACHE_HPP
+#define BAULK_CACHE_HPP
+#include <filesystem>
+#include "baulk.hpp"
+
+namespace baulk::cache {
+struct Stats {
+  uint64_t hits{0};     // archives reused by install
+  uint64_t misses{0};   // archives downloaded
+  uint64_t served{0};   // bytes reused instead of downloaded
+  uint64_t archives{0}; // files in the download directory
+  uint64_t bytes{0};    // bytes of those files
+};
+
+struct Cached {
+  std::filesystem::path archive;
+  std::wstring version;
+  std::wstring hash; // HashKey
+  std::wstring url;  // first url it was downloaded from
+};
+
+// HashKey: 'METHOD:hex' whatever the case or a missing SHA256 prefix in the manifest
+std::wstring HashKey(std::wstring_view hash_value);
+// Lookup: archive stored under pkg.hash whatever its url or file name, no hash pass: the archive was verified when
+// it was recorded and still has the same size and last write time
+std::optional<std::filesystem::path> Lookup(const baulk::Package &pkg);
+// Find: verified archive stored under hash_value, what Lookup and the cache mirror serve
+std::optional<Cached> Find(std::wstring_view hash_value);
+// Archives: verified archives of a package still in the cache, most recently used first
+std::vector<Cached> Archives(std::wstring_view pkgName);
+// Hit: archive verified against pkg.hash and reused by package::Install, becomes the most recently used
+void Hit(const std::filesystem::path &archive, const baulk::Package &pkg, std::wstring_view url = L"");
+// Served: bytes of archive sent by 'baulk serve-cache', a hit that keeps the package and version recorded
+void Served(const std::filesystem::path &archive, uint64_t bytes);
+// Miss: archive downloaded from url (and verified when pkg.hash is set)
+void Miss(const std::filesystem::path &archive, const baulk::Package &pkg, std::wstring_view url);
+// Trim: remove least recently used archives until the download directory fits quota, archives of installed
+// versions are kept when keepInstalled is set
+bool Trim(uint64_t quota, bool keepInstalled, uint64_t &reclaimed, bela::error_code &ec);
+std::optional<Stats> CacheStats(bela::error_code &ec);
+} // namespace baulk::cache
+
+#endif
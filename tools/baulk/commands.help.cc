@@ -18,7 +18,7 @@ Usage: baulk [option] <command> [<args>]
   -P|--profile     Set profile path. default: $0\config\baulk.json
   -A|--user-agent  Send User-Agent <name> to server
   -k|--insecure    Allow insecure server connections when using SSL
-  -T|--trace       Turn on trace mode. track baulk execution details.
+  -T|--trace       Turn on trace mode. track baulk execution details and startup phase timing.
   --https-proxy    Use this proxy. Equivalent to setting the environment variable 'HTTPS_PROXY'
   --force-delete   When uninstalling the package, forcefully delete the related directories
   --github-proxy   Use github-proxy to download Github assets
@@ -37,6 +37,7 @@ Command:
   b3sum            Calculate the BLAKE3 checksum of a file
   sha256sum        Calculate the SHA256 checksum of a file
   cleancache       Cleanup download cache
+  serve-cache      Serve the download cache as a mirror for other agents
   bucket           Add, delete or list buckets
   untar            Extract files in a tar archive. support: tar.xz tar.bz2 tar.gz tar.zstd
   unzip            Extract compressed files in a ZIP archive
@@ -93,6 +94,7 @@ int cmd_help(const baulk::commands::argv_t &argv) {
       {.name = L"b3sum", .usage = baulk::commands::usage_b3sum},           // b3sum
       {.name = L"sha256sum", .usage = baulk::commands::usage_sha256sum},   // sha256sum
       {.name = L"cleancache", .usage = baulk::commands::usage_cleancache}, // cleancache
+      {.name = L"serve-cache", .usage = baulk::commands::usage_servecache}, // cache mirror
       {.name = L"bucket", .usage = baulk::commands::usage_bucket},         // bucket command
       {.name = L"untar", .usage = baulk::commands::usage_untar},           // untar
       {.name = L"unzip", .usage = baulk::commands::usage_unzip},           // unzip
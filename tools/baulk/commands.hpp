@@ -23,6 +23,7 @@ int cmd_b3sum(const argv_t &argv);
 int cmd_sha256sum(const argv_t &argv);
 //
 int cmd_cleancache(const argv_t &argv);
+int cmd_servecache(const argv_t &argv);
 //
 int cmd_bucket(const argv_t &argv);
 //
@@ -51,6 +52,7 @@ void usage_unfreeze();
 void usage_sha256sum();
 void usage_b3sum();
 void usage_cleancache();
+void usage_servecache();
 void usage_bucket();
 void usage_untar();
 void usage_unzip();
@@ -8,6 +8,8 @@
 #include "commands.hpp"
 #include "baulk.hpp"
 #include "bucket.hpp"
+#include "dedup.hpp"
+#include "cache.hpp"
 
 namespace baulk::commands {
 constexpr std::wstring_view infospaces = L"              ";
@@ -111,6 +113,19 @@ int cmd_info(const argv_t &argv) {
     PackageDisplayInfo(pkg);
     bela::FPrintF(stderr, L"\n");
   }
+  if (auto stats = dedup::StoreStats(ec); stats && stats->objects != 0) {
+    bela::FPrintF(stderr, L"Store:        %d objects, %s, \x1b[32m%s\x1b[0m shared by installs\n", stats->objects,
+                  dedup::FormatBytes(stats->physical), dedup::FormatBytes(stats->shared));
+    bela::FPrintF(stderr, L"              dedup ratio \x1b[32m%.2f\x1b[0m, %s logical over %s physical\n",
+                  stats->Ratio(), dedup::FormatBytes(stats->physical + stats->shared),
+                  dedup::FormatBytes(stats->physical));
+  }
+  if (auto stats = cache::CacheStats(ec); stats && (stats->archives != 0 || stats->hits + stats->misses != 0)) {
+    bela::FPrintF(stderr, L"Cache:        %d archives, %s of %s quota\n", stats->archives,
+                  dedup::FormatBytes(stats->bytes), dedup::FormatBytes(CacheQuota()));
+    bela::FPrintF(stderr, L"              %d hits, %d misses, \x1b[32m%s\x1b[0m served from cache\n", stats->hits,
+                  stats->misses, dedup::FormatBytes(stats->served));
+  }
   return 0;
 }
 } // namespace baulk::commands
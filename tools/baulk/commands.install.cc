@@ -7,6 +7,8 @@
 #include "commands.hpp"
 #include "baulk.hpp"
 #include "bucket.hpp"
+#include "localstate.hpp"
+#include "launcher.hpp"
 
 namespace baulk::commands {
 // https://docs.microsoft.com/en-us/cpp/preprocessor/predefined-macros
@@ -76,6 +78,8 @@ int cmd_install(const argv_t &argv) {
     }
     return baulk::package::Install(*pkg);
   };
+  localstate::Batch batch;
+  LinkMetaGroup linkGroup;
   for (auto p : argv) {
     oneInst(p);
   }
@@ -5,44 +5,34 @@
 #include "baulk.hpp"
 #include "bucket.hpp"
 #include "commands.hpp"
+#include "localstate.hpp"
 
 namespace baulk::commands {
+static void display_record(const localstate::Record &r, const localstate::Upgradable *u) {
+  if (u != nullptr) {
+    bela::FPrintF(stderr,
+                  L"\x1b[32m%s\x1b[0m/\x1b[34m%s\x1b[0m %s --> "
+                  L"\x1b[32m%s\x1b[0m/\x1b[34m%s\x1b[0m%s%s\n",
+                  r.name, r.bucket, r.version, u->version, u->bucket,
+                  baulk::IsFrozenedPackage(r.name) ? L" \x1b[33m(frozen)\x1b[0m" : L"", StringCategory(r.category));
+    return;
+  }
+  bela::FPrintF(stderr, L"\x1b[32m%s\x1b[0m/\x1b[34m%s\x1b[0m %s%s\n", r.name, r.bucket, r.version,
+                StringCategory(r.category));
+}
 
-// check upgradable
+// list installed packages from local state, upgradable set is refreshed only when buckets changed
 int cmd_list_all() {
-  bela::fs::Finder finder;
   bela::error_code ec;
-  size_t upgradable = 0;
-  if (finder.First(vfs::AppLocks(), L"*.json", ec)) {
-    do {
-      if (finder.Ignore()) {
-        continue;
-      }
-      auto pkgName = finder.Name();
-      if (!bela::EndsWithIgnoreCase(pkgName, L".json")) {
-        continue;
-      }
-      pkgName.remove_suffix(5);
-      auto localMeta = baulk::PackageLocalMeta(pkgName, ec);
-      if (!localMeta) {
-        continue;
-      }
-      baulk::Package pkg;
-      if (baulk::PackageUpdatableMeta(*localMeta, pkg)) {
-        upgradable++;
-        bela::FPrintF(stderr,
-                      L"\x1b[32m%s\x1b[0m/\x1b[34m%s\x1b[0m %s --> "
-                      L"\x1b[32m%s\x1b[0m/\x1b[34m%s\x1b[0m%s%s\n",
-                      localMeta->name, localMeta->bucket, localMeta->version, pkg.version, pkg.bucket,
-                      baulk::IsFrozenedPackage(pkgName) ? L" \x1b[33m(frozen)\x1b[0m" : L"",
-                      StringCategory(*localMeta));
-        continue;
-      }
-      bela::FPrintF(stderr, L"\x1b[32m%s\x1b[0m/\x1b[34m%s\x1b[0m %s%s\n", localMeta->name, localMeta->bucket,
-                    localMeta->version, StringCategory(*localMeta));
-    } while (finder.Next());
+  if (!localstate::EnsureUpgradable(ec)) {
+    bela::FPrintF(stderr, L"baulk list: load local state error: \x1b[31m%s\x1b[0m\n", ec);
+    return 1;
+  }
+  const auto &store = localstate::Store::Instance();
+  for (const auto &[pkgName, r] : store.Records()) {
+    display_record(r, store.FindUpgradable(pkgName));
   }
-  bela::FPrintF(stderr, L"\x1b[32m%d packages can be updated.\x1b[0m\n", upgradable);
+  bela::FPrintF(stderr, L"\x1b[32m%d packages can be updated.\x1b[0m\n", store.UpgradableSet().size());
   return 0;
 }
 
@@ -62,23 +52,18 @@ int cmd_list(const argv_t &argv) {
     return cmd_list_all();
   }
   bela::error_code ec;
+  if (!localstate::EnsureUpgradable(ec)) {
+    bela::FPrintF(stderr, L"baulk list: load local state error: \x1b[31m%s\x1b[0m\n", ec);
+    return 1;
+  }
+  const auto &store = localstate::Store::Instance();
   for (const auto a : argv) {
-    auto localMeta = baulk::PackageLocalMeta(a, ec);
-    if (!localMeta) {
-      baulk::DbgPrint(L"list package '%s' error: %s", a, ec);
-      continue;
-    }
-    baulk::Package pkg;
-    if (baulk::PackageUpdatableMeta(*localMeta, pkg)) {
-      bela::FPrintF(stderr,
-                    L"\x1b[32m%s\x1b[0m/\x1b[34m%s\x1b[0m %s --> "
-                    L"\x1b[32m%s\x1b[0m/\x1b[34m%s\x1b[0m%s%s\n",
-                    localMeta->name, localMeta->bucket, localMeta->version, pkg.version, pkg.bucket,
-                    baulk::IsFrozenedPackage(a) ? L" \x1b[33m(frozen)\x1b[0m" : L"", StringCategory(*localMeta));
+    auto r = store.Find(a);
+    if (r == nullptr) {
+      baulk::DbgPrint(L"list package '%s' not installed", a);
       continue;
     }
-    bela::FPrintF(stderr, L"\x1b[32m%s\x1b[0m/\x1b[34m%s\x1b[0m %s%s\n", localMeta->name, localMeta->bucket,
-                  localMeta->version, StringCategory(*localMeta));
+    display_record(*r, store.FindUpgradable(a));
   }
   return 0;
 }
@@ -6,6 +6,8 @@
 #include "baulk.hpp"
 #include "pkg.hpp"
 #include "launcher.hpp"
+#include "localstate.hpp"
+#include "dedup.hpp"
 #include "commands.hpp"
 
 namespace baulk::commands {
@@ -25,11 +27,15 @@ int remove_package(std::wstring_view pkgName) {
     bela::FPrintF(stderr, L"baulk remove '%s' links: \x1b[31m%s\x1b[0m\n", pkgName, ec);
   }
   bela::fs::ForceDeleteFolders(metaLock, ec);
+  if (!localstate::RemovePackage(pkgName, ec)) {
+    bela::FPrintF(stderr, L"baulk remove '%s' local state: \x1b[31m%s\x1b[0m\n", pkgName, ec);
+  }
   auto packageRoot = vfs::AppPackageFolder(pkgName);
   if (!bela::fs::ForceDeleteFolders(packageRoot, ec)) {
     bela::FPrintF(stderr, L"baulk remove '%s' error: \x1b[31m%s\x1b[0m\n", pkgName, ec);
     return 1;
   }
+  dedup::Release(pkgName);
   bela::FPrintF(stderr, L"baulk remove \x1b[34m%s\x1b[0m done.\n", pkgName);
   return 0;
 }
@@ -56,6 +62,8 @@ int cmd_remove(const argv_t &argv) {
     bela::FPrintF(stderr, L"baulk remove: \x1b[31mbaulk %s\x1b[0m\n", ec);
     return 1;
   }
+  localstate::Batch batch;
+  LinkMetaGroup linkGroup;
   for (auto a : argv) {
     remove_package(a);
   }
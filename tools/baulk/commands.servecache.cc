@@ -0,0 +1,71 @@
+// serve-cache command: share the download cache with other agents
+#include <bela/terminal.hpp>
+#include <baulk/argv.hpp>
+#include "baulk.hpp"
+#include "commands.hpp"
+#include "mirror.hpp"
+
+namespace baulk::commands {
+
+void usage_servecache() {
+  bela::FPrintF(stderr, LR"(Usage: baulk serve-cache [<args>]
+Serve the download cache over HTTP as a mirror for other agents.
+Archives are requested by hash, missing ones are downloaded from their upstream url once
+and kept in the cache. Agents use the mirror when 'cache_mirror' in the profile or
+BAULK_CACHE_MIRROR is set to its address, upstream is used when the mirror fails.
+Only this machine is served unless --listen names another address, the server then downloads
+any url the network asks for, use --no-fetch where clients are not trusted.
+
+Options:
+  -L, --listen     Listen address (default: 127.0.0.1:8089)
+  --no-fetch       Serve cached archives only, never download
+
+Example:
+  baulk serve-cache --listen 0.0.0.0:8089
+  set BAULK_CACHE_MIRROR=http://build-cache:8089
+
+)");
+}
+
+int cmd_servecache(const argv_t &argv) {
+  baulk::cli::ParseArgv pa(argv);
+  pa.Add(L"listen", baulk::cli::required_argument, L'L').Add(L"no-fetch", baulk::cli::no_argument, 1001);
+  mirror::ServeOptions opts;
+  bela::error_code ec;
+  auto ret = pa.Execute(
+      [&](int val, const wchar_t *oa, const wchar_t *) {
+        switch (val) {
+        case 'L': {
+          std::wstring_view listen(oa);
+          if (auto pos = listen.rfind(L':'); pos != std::wstring_view::npos) {
+            if (!bela::SimpleAtoi(listen.substr(pos + 1), &opts.port) || opts.port <= 0 || opts.port > 65535) {
+              ec = bela::make_error_code(bela::ErrGeneral, L"invalid listen port: ", oa);
+              return false;
+            }
+            listen = listen.substr(0, pos);
+          }
+          if (!listen.empty()) {
+            opts.address = listen;
+          }
+          break;
+        }
+        case 1001:
+          opts.fetch = false;
+          break;
+        default:
+          break;
+        }
+        return true;
+      },
+      ec);
+  if (!ret) {
+    bela::FPrintF(stderr, L"baulk serve-cache: \x1b[31m%s\x1b[0m\n", ec);
+    return 1;
+  }
+  if (!mirror::Serve(opts, ec)) {
+    bela::FPrintF(stderr, L"baulk serve-cache: \x1b[31m%s\x1b[0m\n", ec);
+    return 1;
+  }
+  return 0;
+}
+} // namespace baulk::commands
@@ -2,12 +2,17 @@
 #include <bela/terminal.hpp>
 #include <baulk/hash.hpp>
 #include <baulk/fs.hpp>
+#include <baulk/argv.hpp>
 #include "commands.hpp"
 
 namespace baulk::commands {
 void usage_sha256sum() {
-  bela::FPrintF(stderr, LR"(Usage: baulk sha256sum [file] ...
+  bela::FPrintF(stderr, LR"(Usage: baulk sha256sum [option] [file] ...
 Print SHA256 (256-bit) checksums.
+Files are hashed in parallel, results are printed in argument order.
+
+Options:
+  -j, --jobs       Number of files hashed at the same time (default: number of CPUs)
 
 Example:
   baulk sha256sum baulk.zip
@@ -19,15 +24,37 @@ int cmd_sha256sum(const argv_t &argv) {
     usage_sha256sum();
     return 1;
   }
+  baulk::cli::ParseArgv pa(argv);
+  pa.Add(L"jobs", baulk::cli::required_argument, L'j');
+  int jobs = 0;
   bela::error_code ec;
-  for (const auto a : argv) {
-    auto hv = baulk::hash::FileHash(a, baulk::hash::hash_t::SHA256, ec);
+  auto ret = pa.Execute(
+      [&](int val, const wchar_t *oa, const wchar_t *) {
+        if (val == L'j' && bela::SimpleAtoi(oa, &jobs)) {
+          return true;
+        }
+        ec = bela::make_error_code(bela::ErrGeneral, L"unable parse jobs: ", oa);
+        return false;
+      },
+      ec);
+  if (!ret) {
+    bela::FPrintF(stderr, L"baulk sha256sum: \x1b[31m%s\x1b[0m\n", ec);
+    return 1;
+  }
+  if (pa.Argv().empty()) {
+    usage_sha256sum();
+    return 1;
+  }
+  std::vector<std::filesystem::path> files(pa.Argv().begin(), pa.Argv().end());
+  auto printer = [](const std::filesystem::path &file, const std::optional<std::wstring> &hv,
+                    const bela::error_code &ec) {
     if (!hv) {
-      bela::FPrintF(stderr, L"File: '%s' cannot calculate sha256 checksum: \x1b[31m%s\x1b[0m\n", a, ec);
-      continue;
+      bela::FPrintF(stderr, L"File: '%s' cannot calculate sha256 checksum: \x1b[31m%s\x1b[0m\n", file.native(), ec);
+      return;
     }
-    bela::FPrintF(stdout, L"%s %s\n", *hv, baulk::fs::FileName(a));
-  }
+    bela::FPrintF(stdout, L"%s %s\n", *hv, baulk::fs::FileName(file.native()));
+  };
+  baulk::hash::FileHashes(files, baulk::hash::hash_t::SHA256, jobs, printer);
   return 0;
 }
 } // namespace baulk::commands
\ No newline at end of file
@@ -10,6 +10,7 @@
 #include <baulk/fs.hpp>
 #include <baulk/json_utils.hpp>
 #include "bucket.hpp"
+#include "localstate.hpp"
 
 #include "commands.hpp"
 
@@ -112,36 +113,25 @@ bool BucketUpdater::Update(const baulk::Bucket &bucket) {
 }
 
 bool PackageScanUpdatable() {
-  bela::fs::Finder finder;
   bela::error_code ec;
-  size_t upgradable = 0;
-  if (finder.First(vfs::AppLocks(), L"*.json", ec)) {
-    do {
-      if (finder.Ignore()) {
-        continue;
-      }
-      auto pkgName = finder.Name();
-      if (!bela::EndsWithIgnoreCase(pkgName, L".json")) {
-        continue;
-      }
-      pkgName.remove_suffix(5);
-      auto localMeta = baulk::PackageLocalMeta(pkgName, ec);
-      if (!localMeta) {
-        continue;
-      }
-      baulk::Package pkg;
-      if (baulk::PackageUpdatableMeta(*localMeta, pkg)) {
-        upgradable++;
-        bela::FPrintF(stderr,
-                      L"\x1b[32m%s\x1b[0m/\x1b[34m%s\x1b[0m %s --> "
-                      L"\x1b[32m%s\x1b[0m/\x1b[34m%s\x1b[0m%s%s\n",
-                      localMeta->name, localMeta->bucket, localMeta->version, pkg.version, pkg.bucket,
-                      IsFrozenedPackage(pkgName) ? L" \x1b[33m(frozen)\x1b[0m" : L"", StringCategory(pkg));
-        continue;
-      }
-    } while (finder.Next());
+  if (!localstate::RefreshUpgradable(ec)) {
+    bela::FPrintF(stderr, L"baulk update: refresh upgradable packages error: \x1b[31m%s\x1b[0m\n", ec);
+    return false;
+  }
+  const auto &store = localstate::Store::Instance();
+  for (const auto &[pkgName, u] : store.UpgradableSet()) {
+    auto r = store.Find(pkgName);
+    if (r == nullptr) {
+      continue;
+    }
+    bela::FPrintF(stderr,
+                  L"\x1b[32m%s\x1b[0m/\x1b[34m%s\x1b[0m %s --> "
+                  L"\x1b[32m%s\x1b[0m/\x1b[34m%s\x1b[0m%s%s\n",
+                  r->name, r->bucket, r->version, u.version, u.bucket,
+                  IsFrozenedPackage(pkgName) ? L" \x1b[33m(frozen)\x1b[0m" : L"",
+                  StringCategory(r->category));
   }
-  bela::FPrintF(stderr, L"\x1b[32m%d packages can be updated.\x1b[0m\n", upgradable);
+  bela::FPrintF(stderr, L"\x1b[32m%d packages can be updated.\x1b[0m\n", store.UpgradableSet().size());
   return true;
 }
 
@@ -157,9 +147,17 @@ int UpdateBucket(bool showUpdatable) {
   if (!updater.Initialize()) {
     return 1;
   }
+  std::vector<std::wstring> urls;
+  for (const auto &bucket : baulk::LoadedBuckets()) {
+    urls.emplace_back(bucket.url);
+  }
+  baulk::net::PrefetchHosts(urls);
   for (const auto &bucket : baulk::LoadedBuckets()) {
     updater.Update(bucket);
   }
+  auto dns = baulk::net::ResolverStats();
+  DbgPrint(L"baulk update buckets dns: %d lookups, %d cached, %d.%03d ms", dns.lookups, dns.hits, dns.elapsed / 1000,
+           dns.elapsed % 1000);
   if (!updater.Immobilized()) {
     return 1;
   }
@@ -5,10 +5,13 @@
 #include <baulk/fs.hpp>
 #include <baulk/vfs.hpp>
 #include <baulk/fsmutex.hpp>
+#include <baulk/net.hpp>
 #include "commands.hpp"
 #include "baulk.hpp"
 #include "bucket.hpp"
 #include "pkg.hpp"
+#include "localstate.hpp"
+#include "launcher.hpp"
 
 namespace baulk::commands {
 void usage_upgrade() {
@@ -45,27 +48,33 @@ int cmd_upgrade(const argv_t &argv) {
     baulk::DbgPrint(L"baulk upgrade: unable initialize compiler executor: %s", ec);
   }
 
-  bela::fs::Finder finder;
-  if (finder.First(vfs::AppLocks(), L"*.json", ec)) {
-    do {
-      if (finder.Ignore()) {
-        continue;
-      }
-      auto pkgName = finder.Name();
-      if (!bela::EndsWithIgnoreCase(pkgName, L".json")) {
-        continue;
-      }
-      pkgName.remove_suffix(5);
-      auto localMeta = baulk::PackageLocalMeta(pkgName, ec);
-      if (!localMeta) {
-        continue;
-      }
-      baulk::Package pkg;
-      if (baulk::PackageUpdatableMeta(*localMeta, pkg)) {
-        baulk::package::Install(pkg);
-        continue;
-      }
-    } while (finder.Next());
+  if (!localstate::EnsureUpgradable(ec)) {
+    bela::FPrintF(stderr, L"baulk upgrade: load local state error: \x1b[31m%s\x1b[0m\n", ec);
+    return 1;
+  }
+  // Install updates the store, take a copy of the upgradable set
+  std::vector<baulk::Package> pkgLocals;
+  const auto &store = localstate::Store::Instance();
+  for (const auto &[pkgName, _] : store.UpgradableSet()) {
+    if (auto r = store.Find(pkgName); r != nullptr) {
+      pkgLocals.emplace_back(r->AsPackage());
+    }
+  }
+  localstate::Batch batch;
+  LinkMetaGroup linkGroup;
+  std::vector<baulk::Package> pkgs;
+  std::vector<std::wstring> urls;
+  for (const auto &pkgLocal : pkgLocals) {
+    baulk::Package pkg;
+    if (baulk::PackageUpdatableMeta(pkgLocal, pkg)) {
+      urls.insert(urls.end(), pkg.urls.begin(), pkg.urls.end());
+      pkgs.emplace_back(std::move(pkg));
+    }
+  }
+  // every host of the upgrade resolves while the first packages download
+  baulk::net::PrefetchHosts(urls);
+  for (const auto &pkg : pkgs) {
+    baulk::package::Install(pkg);
   }
   return 0;
 }
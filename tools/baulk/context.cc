@@ -1,10 +1,12 @@
 // baulk context
 #include <algorithm>
+#include <chrono>
 #include <version.hpp>
 #include <bela/io.hpp>
 #include <baulk/vfs.hpp>
 #include <baulk/json_utils.hpp>
 #include <baulk/fs.hpp>
+#include <baulk/net/scheduler.hpp>
 #include "baulk.hpp"
 
 namespace baulk {
@@ -27,6 +29,8 @@ inline std::wstring default_locale_name() {
 }
 // https://github.com/baulk/bucket/commits/master.atom
 constexpr std::wstring_view DefaultBucket = L"https://github.com/baulk/bucket";
+constexpr uint64_t DefaultCacheQuota = 4ULL * 1024 * 1024 * 1024;
+
 } // namespace baulk_internal
 
 class Context {
@@ -39,20 +43,50 @@ public:
   }
   bool Initialize(std::wstring_view profile_, bela::error_code &ec);
   bool InitializeExecutor(bela::error_code &ec);
-  bool IsFrozenedPackage(std::wstring_view pkgName) const { return std::ranges::find(pkgs, pkgName) != pkgs.end(); }
-  std::wstring_view LocaleName() const { return localeName; }
+  bool IsFrozenedPackage(std::wstring_view pkgName) {
+    loadFreezeSection();
+    return std::ranges::find(pkgs, pkgName) != pkgs.end();
+  }
+  std::wstring_view LocaleName() {
+    loadLocaleSection();
+    return localeName;
+  }
   std::wstring_view Profile() const { return profile; }
-  auto &LoadedBuckets() { return buckets; }
+  uint64_t CacheQuota() {
+    loadCacheSection();
+    return cacheQuota;
+  }
+  std::wstring_view CacheMirror() {
+    loadCacheSection();
+    return cacheMirror;
+  }
+  auto &LoadedBuckets() {
+    loadBucketSection();
+    return buckets;
+  }
   auto &LinkExecutor() { return executor; }
 
 private:
-  bool initializeInternal(const std::wstring &profile_, bela::error_code &ec);
   Context() = default;
+  // profile sections are loaded on first use, 'baulk list' never touches buckets
+  const nlohmann::json *loadProfile();
+  void loadLocaleSection();
+  void loadBucketSection();
+  void loadFreezeSection();
+  void loadCacheSection();
   std::wstring localeName; // mirrors
   std::wstring profile;
+  std::optional<nlohmann::json> meta;
   Buckets buckets;
   std::vector<std::wstring> pkgs;
   compiler::Executor executor;
+  std::wstring cacheMirror;
+  uint64_t cacheQuota{baulk_internal::DefaultCacheQuota};
+  bool profileLoaded{false};
+  bool localeLoaded{false};
+  bool bucketsLoaded{false};
+  bool freezeLoaded{false};
+  bool cacheLoaded{false};
 };
 
 constexpr std::wstring_view default_content = LR"({
@@ -68,23 +102,51 @@ constexpr std::wstring_view default_content = LR"({
     "channel": "insider"
 })";
 
-bool Context::initializeInternal(const std::wstring &profile_, bela::error_code &ec) {
-  profile = profile_;
-  DbgPrint(L"Baulk use profile '%s'", profile);
+const nlohmann::json *Context::loadProfile() {
+  if (profileLoaded) {
+    return meta ? &*meta : nullptr;
+  }
+  profileLoaded = true;
+  auto start = std::chrono::steady_clock::now();
+  auto closer = bela::finally([&] { TracePhase(L"profile", start); });
+  bela::error_code ec;
   auto jo = baulk::parse_json_file(profile, ec);
   if (!jo) {
-    buckets.emplace_back(L"Baulk default bucket", L"Baulk", baulk_internal::DefaultBucket);
-    bela::FPrintF(stderr, L"baulk: \x1b[31m%s\x1b[0m\nprofile path %s\n", ec, profile_);
+    bela::FPrintF(stderr, L"baulk: \x1b[31m%s\x1b[0m\nprofile path %s\n", ec, profile);
     if (ec.code == ERROR_FILE_NOT_FOUND) {
       baulk::fs::MakeParentDirectories(profile, ec);
       bela::io::WriteText(profile, default_content, ec);
     }
-    return true;
+    return nullptr;
   }
+  meta.emplace(std::move(jo->obj));
+  return &*meta;
+}
 
-  auto jv = jo->view();
-  localeName = jv.get("locale", localeName);
-  auto svs = jv.subviews("bucket");
+void Context::loadLocaleSection() {
+  if (localeLoaded) {
+    return;
+  }
+  localeLoaded = true;
+  localeName = baulk_internal::default_locale_name();
+  if (auto obj = loadProfile(); obj != nullptr) {
+    localeName = json_view(*obj).get("locale", localeName);
+  }
+  DbgPrint(L"Baulk Locale Name '%s'", localeName);
+}
+
+void Context::loadBucketSection() {
+  if (bucketsLoaded) {
+    return;
+  }
+  bucketsLoaded = true;
+  auto obj = loadProfile();
+  if (obj == nullptr) {
+    buckets.emplace_back(L"Baulk default bucket", L"Baulk", baulk_internal::DefaultBucket);
+    return;
+  }
+  auto start = std::chrono::steady_clock::now();
+  auto svs = json_view(*obj).subviews("bucket");
   for (auto sv : svs) {
     buckets.emplace_back(
         sv.get("description"), sv.get("name"), sv.get("url"), sv.get_as_integer("weights", 100),
@@ -98,22 +160,62 @@ bool Context::initializeInternal(const std::wstring &profile_, bela::error_code
       DbgPrint(L"    variant:  %s", BucketVariantName(bk.variant));
     }
   }
-  if (jv.get_strings_checked("freeze", pkgs) && !pkgs.empty() && IsDebugMode) {
+  TracePhase(L"buckets", start);
+}
+
+void Context::loadFreezeSection() {
+  if (freezeLoaded) {
+    return;
+  }
+  freezeLoaded = true;
+  auto obj = loadProfile();
+  if (obj == nullptr) {
+    return;
+  }
+  if (json_view(*obj).get_strings_checked("freeze", pkgs) && !pkgs.empty() && IsDebugMode) {
     for (const auto &p : pkgs) {
       DbgPrint(L"Freeze package %s", p);
     }
   }
-  return true;
+}
+
+// download cache: BAULK_CACHE_QUOTA and BAULK_CACHE_MIRROR override 'cache_quota' and 'cache_mirror' of the profile
+void Context::loadCacheSection() {
+  if (cacheLoaded) {
+    return;
+  }
+  cacheLoaded = true;
+  std::wstring quota = bela::GetEnv(L"BAULK_CACHE_QUOTA");
+  cacheMirror = bela::GetEnv(L"BAULK_CACHE_MIRROR");
+  if (auto obj = loadProfile(); obj != nullptr) {
+    if (cacheMirror.empty()) {
+      cacheMirror = json_view(*obj).get("cache_mirror");
+    }
+    if (quota.empty()) {
+      if (uint64_t n = 0; json_view(*obj).get_integer_checked("cache_quota", n)) {
+        cacheQuota = n;
+        return;
+      }
+      quota = json_view(*obj).get("cache_quota");
+    }
+  }
+  if (quota.empty()) {
+    return;
+  }
+  if (auto n = net::ParseBytes(quota); n) {
+    cacheQuota = *n;
+    return;
+  }
+  bela::FPrintF(stderr, L"baulk: \x1b[33mignore bad cache quota '%s'\x1b[0m\n", quota);
 }
 
 bool Context::Initialize(std::wstring_view profile_, bela::error_code &ec) {
+  auto start = std::chrono::steady_clock::now();
   if (!baulk::vfs::InitializePathFs(ec)) {
     return false;
   }
-
-  localeName = baulk_internal::default_locale_name();
+  TracePhase(L"vfs", start);
   if (IsDebugMode) {
-
     DbgPrint(L"Baulk %s [%s] time: %s", BAULK_VERSION, vfs::AppMode(), BAULK_BUILD_TIME);
     DbgPrint(L"Baulk Location    '%s'", vfs::AppLocation());
     DbgPrint(L"Baulk baulk.exe   '%s'", vfs::AppLocationPath(L"baulk.exe"));
@@ -125,13 +227,11 @@ bool Context::Initialize(std::wstring_view profile_, bela::error_code &ec) {
     DbgPrint(L"Baulk AppLocks    '%s'", vfs::AppLocks());
     DbgPrint(L"Baulk AppBuckets  '%s'", vfs::AppBuckets());
     DbgPrint(L"Baulk AppLinks    '%s'", vfs::AppLinks());
-    DbgPrint(L"Baulk Locale Name '%s'", localeName);
-  }
-
-  if (profile_.empty()) {
-    return initializeInternal(baulk::vfs::AppDefaultProfile(), ec);
   }
-  return initializeInternal(baulk_internal::path_expand(profile_), ec);
+  // The profile is only resolved here, parsing is deferred until a section is requested
+  profile = profile_.empty() ? baulk::vfs::AppDefaultProfile() : baulk_internal::path_expand(profile_);
+  DbgPrint(L"Baulk use profile '%s'", profile);
+  return true;
 }
 
 bool Context::InitializeExecutor(bela::error_code &ec) { return executor.Initialize(ec); }
@@ -143,6 +243,8 @@ bool InitializeContext(std::wstring_view profile, bela::error_code &ec) {
 bool InitializeExecutor(bela::error_code &ec) { return Context::Instance().InitializeExecutor(ec); }
 std::wstring_view LocaleName() { return Context::Instance().LocaleName(); }
 std::wstring_view Profile() { return Context::Instance().Profile(); }
+uint64_t CacheQuota() { return Context::Instance().CacheQuota(); }
+std::wstring_view CacheMirror() { return Context::Instance().CacheMirror(); }
 Buckets &LoadedBuckets() { return Context::Instance().LoadedBuckets(); }
 compiler::Executor &LinkExecutor() { return Context::Instance().LinkExecutor(); }
 bool IsFrozenedPackage(std::wstring_view pkgName) { return Context::Instance().IsFrozenedPackage(pkgName); }
@@ -155,4 +257,37 @@ int BucketWeights(std::wstring_view bucket) {
   return 0;
 }
 
+// startup trace
+namespace baulk_internal {
+struct trace_phase {
+  std::wstring name;
+  int64_t elapsed; // microseconds
+};
+inline std::vector<trace_phase> &trace_phases() {
+  static std::vector<trace_phase> phases;
+  return phases;
+}
+} // namespace baulk_internal
+
+void TracePhase(std::wstring_view phase, std::chrono::steady_clock::time_point start) {
+  if (!IsTraceMode) {
+    return;
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+  baulk_internal::trace_phases().emplace_back(std::wstring(phase), elapsed.count());
+}
+
+void TraceSummary(std::chrono::steady_clock::time_point start) {
+  if (!IsTraceMode) {
+    return;
+  }
+  auto total =
+      std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+  bela::FPrintF(stderr, L"\x1b[35mbaulk trace phases:\x1b[0m\n");
+  for (const auto &p : baulk_internal::trace_phases()) {
+    bela::FPrintF(stderr, L"  %-10s %d.%03d ms\n", p.name, p.elapsed / 1000, p.elapsed % 1000);
+  }
+  bela::FPrintF(stderr, L"  %-10s %d.%03d ms\n", L"total", total / 1000, total % 1000);
+}
+
 } // namespace baulk
\ No newline at end of file
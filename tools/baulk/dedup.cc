@@ -0,0 +1,488 @@
+// baulk content-addressed file store
+#include <bela/path.hpp>
+#include <bela/fs.hpp>
+#include <bela/io.hpp>
+#include <bela/ascii.hpp>
+#include <bela/numbers.hpp>
+#include <bela/str_split.hpp>
+#include <baulk/vfs.hpp>
+#include <baulk/fs.hpp>
+#include <baulk/hash.hpp>
+#include <map>
+#include <set>
+#include <winioctl.h>
+#include "dedup.hpp"
+
+namespace baulk::dedup {
+namespace dedup_internal {
+// small files are not worth a link
+constexpr uint64_t minimum_dedup_size = 4096;
+// NTFS hardlink limit is 1024, keep some room for the store itself
+constexpr DWORD maximum_links = 1000;
+// FSCTL_DUPLICATE_EXTENTS_TO_FILE clones less than 4 GB per call
+constexpr uint64_t maximum_clone_size = 1ULL << 30;
+
+inline std::wstring objects_path() { return bela::StringCat(vfs::AppStore(), L"\\objects"); }
+inline std::wstring stats_path() { return bela::StringCat(vfs::AppStore(), L"\\baulk.store"); }
+inline std::wstring refs_path() { return bela::StringCat(vfs::AppStore(), L"\\refs"); }
+
+// Files that packages or users commonly edit in place are never hardlinked, a clone is safe for them
+inline bool is_mutable_file(const std::filesystem::path &p) {
+  constexpr std::wstring_view extensions[] = {L".ini",  L".cfg",        L".conf", L".config", L".json",
+                                              L".toml", L".yaml",       L".yml",  L".xml",    L".properties",
+                                              L".env",  L".gitconfig",  L".rc",   L".lock",   L".log"};
+  auto ext = p.extension().native();
+  for (const auto e : extensions) {
+    if (bela::EqualsIgnoreCase(ext, e)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+struct object_info {
+  uint64_t size{0};
+  DWORD links{0};
+};
+
+inline std::optional<object_info> stat_object(std::wstring_view file, bela::error_code &ec) {
+  auto FileHandle =
+      CreateFileW(file.data(), FILE_READ_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                  OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+  if (FileHandle == INVALID_HANDLE_VALUE) {
+    ec = bela::make_system_error_code(L"CreateFileW() ");
+    return std::nullopt;
+  }
+  auto closer = bela::finally([&] { CloseHandle(FileHandle); });
+  BY_HANDLE_FILE_INFORMATION bi;
+  if (GetFileInformationByHandle(FileHandle, &bi) != TRUE) {
+    ec = bela::make_system_error_code(L"GetFileInformationByHandle() ");
+    return std::nullopt;
+  }
+  return std::make_optional(object_info{
+      .size = (static_cast<uint64_t>(bi.nFileSizeHigh) << 32) | bi.nFileSizeLow,
+      .links = bi.nNumberOfLinks,
+  });
+}
+
+// clone_file: copy-on-write copy by block cloning (ReFS, Dev Drive), target is a file of its own that shares
+// clusters with source until either of them is written
+bool clone_file(std::wstring_view source, std::wstring_view target, uint64_t size, bela::error_code &ec) {
+  auto src = CreateFileW(source.data(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                         FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (src == INVALID_HANDLE_VALUE) {
+    ec = bela::make_system_error_code(L"CreateFileW() ");
+    return false;
+  }
+  auto srcCloser = bela::finally([&] { CloseHandle(src); });
+  FSCTL_GET_INTEGRITY_INFORMATION_BUFFER integrity{};
+  DWORD dwBytes = 0;
+  // fails on volumes without block cloning
+  if (DeviceIoControl(src, FSCTL_GET_INTEGRITY_INFORMATION, nullptr, 0, &integrity, sizeof(integrity), &dwBytes,
+                      nullptr) != TRUE) {
+    ec = bela::make_system_error_code(L"FSCTL_GET_INTEGRITY_INFORMATION ");
+    return false;
+  }
+  auto dst = CreateFileW(target.data(), GENERIC_READ | GENERIC_WRITE | DELETE, 0, nullptr, CREATE_ALWAYS,
+                         FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (dst == INVALID_HANDLE_VALUE) {
+    ec = bela::make_system_error_code(L"CreateFileW() ");
+    return false;
+  }
+  bool cloned = false;
+  auto dstCloser = bela::finally([&] {
+    if (!cloned) {
+      FILE_DISPOSITION_INFO di;
+      di.DeleteFile = TRUE;
+      SetFileInformationByHandle(dst, FileDispositionInfo, &di, sizeof(di));
+    }
+    CloseHandle(dst);
+  });
+  FILE_END_OF_FILE_INFO eof;
+  eof.EndOfFile.QuadPart = static_cast<LONGLONG>(size);
+  if (SetFileInformationByHandle(dst, FileEndOfFileInfo, &eof, sizeof(eof)) != TRUE) {
+    ec = bela::make_system_error_code(L"SetFileInformationByHandle() ");
+    return false;
+  }
+  uint64_t cluster = integrity.ClusterSizeInBytes == 0 ? 4096 : integrity.ClusterSizeInBytes;
+  // the last cluster is cloned whole, the end of file keeps the size
+  auto aligned = (size + cluster - 1) / cluster * cluster;
+  for (uint64_t offset = 0; offset < aligned; offset += maximum_clone_size) {
+    DUPLICATE_EXTENTS_DATA dd{.FileHandle = src};
+    dd.SourceFileOffset.QuadPart = static_cast<LONGLONG>(offset);
+    dd.TargetFileOffset.QuadPart = static_cast<LONGLONG>(offset);
+    dd.ByteCount.QuadPart = static_cast<LONGLONG>((std::min)(maximum_clone_size, aligned - offset));
+    if (DeviceIoControl(dst, FSCTL_DUPLICATE_EXTENTS_TO_FILE, &dd, sizeof(dd), nullptr, 0, &dwBytes, nullptr) !=
+        TRUE) {
+      ec = bela::make_system_error_code(L"FSCTL_DUPLICATE_EXTENTS_TO_FILE ");
+      return false;
+    }
+  }
+  cloned = true;
+  return true;
+}
+
+// copy_times: the file replaced by a clone keeps its own timestamps
+inline void copy_times(std::wstring_view from, std::wstring_view to) {
+  WIN32_FILE_ATTRIBUTE_DATA wfd;
+  if (GetFileAttributesExW(from.data(), GetFileExInfoStandard, &wfd) != TRUE) {
+    return;
+  }
+  auto FileHandle = CreateFileW(to.data(), FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (FileHandle == INVALID_HANDLE_VALUE) {
+    return;
+  }
+  SetFileTime(FileHandle, &wfd.ftCreationTime, &wfd.ftLastAccessTime, &wfd.ftLastWriteTime);
+  CloseHandle(FileHandle);
+}
+
+inline bool not_supported(const bela::error_code &ec) {
+  return ec.code == ERROR_INVALID_FUNCTION || ec.code == ERROR_NOT_SUPPORTED || ec.code == ERROR_NOT_SAME_DEVICE;
+}
+
+// store_record: baulk.store, 'S' objects and their bytes, then one 'P' line per package with the bytes it shares
+struct store_record {
+  Stats stats;
+  std::map<std::wstring, uint64_t, std::less<>> packages;
+};
+
+bool load_stats(store_record &sr, bela::error_code &ec) {
+  auto file = stats_path();
+  if (!bela::PathFileIsExists(file)) {
+    return true;
+  }
+  std::wstring text;
+  if (!bela::io::ReadFile(file, text, ec)) {
+    return false;
+  }
+  std::vector<std::wstring_view> lines = bela::StrSplit(text, bela::ByChar('\n'), bela::SkipEmpty());
+  for (auto line : lines) {
+    std::vector<std::wstring_view> fv = bela::StrSplit(bela::StripTrailingAsciiWhitespace(line), bela::ByChar('\t'));
+    if (fv.size() >= 3 && fv[0] == L"S") {
+      (void)bela::SimpleAtoi(fv[1], &sr.stats.objects);
+      (void)bela::SimpleAtoi(fv[2], &sr.stats.physical);
+      continue;
+    }
+    if (uint64_t shared = 0; fv.size() == 3 && fv[0] == L"P" && bela::SimpleAtoi(fv[2], &shared)) {
+      sr.packages[std::wstring(fv[1])] = shared;
+    }
+  }
+  sr.stats.shared = 0;
+  for (const auto &[_, shared] : sr.packages) {
+    sr.stats.shared += shared;
+  }
+  return true;
+}
+
+bool save_stats(const store_record &sr, bela::error_code &ec) {
+  auto text = bela::StringCat(L"S\t", sr.stats.objects, L"\t", sr.stats.physical, L"\n");
+  for (const auto &[name, shared] : sr.packages) {
+    bela::StrAppend(&text, L"P\t", name, L"\t", shared, L"\n");
+  }
+  return bela::io::AtomicWriteText(stats_path(), bela::io::as_bytes<char>(bela::encode_into<wchar_t, char>(text)),
+                                   ec);
+}
+
+// refs\<package>: the objects a package's files were stored as or share, what Collect keeps for installed packages
+bool save_refs(std::wstring_view pkgName, const std::set<std::wstring> &refs, bela::error_code &ec) {
+  if (!baulk::fs::MakeDirectories(refs_path(), ec)) {
+    return false;
+  }
+  std::wstring text;
+  for (const auto &h : refs) {
+    bela::StrAppend(&text, h, L"\n");
+  }
+  return bela::io::AtomicWriteText(bela::StringCat(refs_path(), L"\\", pkgName),
+                                   bela::io::as_bytes<char>(bela::encode_into<wchar_t, char>(text)), ec);
+}
+
+class Materializer {
+public:
+  Materializer() = default;
+  Materializer(const Materializer &) = delete;
+  Materializer &operator=(const Materializer &) = delete;
+  bool Initialize(bela::error_code &ec) {
+    objects = objects_path();
+    return baulk::fs::MakeDirectories(objects, ec);
+  }
+  bool Materialize(const std::filesystem::path &file, uint64_t size, Result &result, bela::error_code &ec);
+  const Stats &Added() const { return added; }
+  const std::set<std::wstring> &Refs() const { return refs; }
+
+private:
+  bool store(const std::filesystem::path &file, std::wstring_view object, uint64_t size, bool replacing,
+             bela::error_code &ec);
+  bool replace(const std::filesystem::path &file, std::wstring_view staged, bela::error_code &ec);
+  std::wstring objects;
+  std::set<std::wstring> refs;
+  Stats added;
+  bool cloning{true};
+};
+
+// store: the first file seen with a content becomes its object, a clone where the volume clones, otherwise a second
+// hardlink of the file itself, the store never holds a copy of its own
+bool Materializer::store(const std::filesystem::path &file, std::wstring_view object, uint64_t size, bool replacing,
+                         bela::error_code &ec) {
+  auto staged = bela::StringCat(object, L".tmp");
+  bela::error_code ec2;
+  if (!cloning || !clone_file(file.native(), staged, size, ec2)) {
+    if (cloning && !not_supported(ec2)) {
+      ec = std::move(ec2);
+      return false;
+    }
+    cloning = false;
+    // an object edited through the package would no longer match its name
+    if (is_mutable_file(file)) {
+      return true;
+    }
+    DeleteFileW(staged.data());
+    if (CreateHardLinkW(staged.data(), file.c_str(), nullptr) != TRUE) {
+      ec = bela::make_system_error_code(L"CreateHardLinkW() ");
+      return false;
+    }
+  }
+  if (MoveFileExW(staged.data(), object.data(), MOVEFILE_REPLACE_EXISTING) != TRUE) {
+    ec = bela::make_system_error_code(L"MoveFileExW() ");
+    DeleteFileW(staged.data());
+    return false;
+  }
+  if (!replacing) {
+    added.objects++;
+    added.physical += size;
+  }
+  return true;
+}
+
+bool Materializer::replace(const std::filesystem::path &file, std::wstring_view staged, bela::error_code &ec) {
+  if (MoveFileExW(staged.data(), file.c_str(), MOVEFILE_REPLACE_EXISTING) != TRUE) {
+    ec = bela::make_system_error_code(L"MoveFileExW() ");
+    DeleteFileW(staged.data());
+    return false;
+  }
+  return true;
+}
+
+bool Materializer::Materialize(const std::filesystem::path &file, uint64_t size, Result &result,
+                               bela::error_code &ec) {
+  auto h = baulk::hash::FileHash(file, baulk::hash::hash_t::BLAKE3, ec);
+  if (!h) {
+    return false;
+  }
+  auto prefix = std::wstring_view(*h).substr(0, 2);
+  auto object = bela::StringCat(objects, L"\\", prefix, L"\\", *h);
+  bela::error_code ec2;
+  auto oi = stat_object(object, ec2);
+  if (!oi) {
+    if (!baulk::fs::MakeDirectories(bela::StringCat(objects, L"\\", prefix), ec)) {
+      return false;
+    }
+    if (!store(file, object, size, false, ec)) {
+      return false;
+    }
+    // mutable files are not stored by hardlink
+    if (bela::PathFileIsExists(object)) {
+      refs.emplace(*h);
+    }
+    return true;
+  }
+  if (oi->size != size) {
+    return true;
+  }
+  auto staged = bela::StringCat(file.native(), L".baulk-link");
+  if (cloning) {
+    if (clone_file(object, staged, size, ec2)) {
+      copy_times(file.native(), staged);
+      if (!replace(file, staged, ec)) {
+        return false;
+      }
+      refs.emplace(*h);
+      result.linked++;
+      result.saved += size;
+      return true;
+    }
+    if (!not_supported(ec2)) {
+      ec = std::move(ec2);
+      return false;
+    }
+    cloning = false;
+  }
+  // no block cloning: a hardlink shares the file itself, attributes are left alone so an uninstall or an update of
+  // one package changes nothing another package relies on
+  if (is_mutable_file(file) || oi->links >= maximum_links) {
+    return true;
+  }
+  // a file edited in place through another link changed the object as well, it is replaced by this copy
+  if (oi->links > 1) {
+    auto oh = baulk::hash::FileHash(object, baulk::hash::hash_t::BLAKE3, ec2);
+    if (!oh || *oh != *h) {
+      DbgPrint(L"dedup: store object %s was modified, replace it", *h);
+      if (!store(file, object, size, true, ec)) {
+        return false;
+      }
+      refs.emplace(*h);
+      return true;
+    }
+  }
+  if (CreateHardLinkW(staged.data(), object.data(), nullptr) != TRUE) {
+    ec = bela::make_system_error_code(L"CreateHardLinkW() ");
+    return false;
+  }
+  if (!replace(file, staged, ec)) {
+    return false;
+  }
+  refs.emplace(*h);
+  result.linked++;
+  result.saved += size;
+  return true;
+}
+
+} // namespace dedup_internal
+
+bool Deduplicate(const std::filesystem::path &root, std::wstring_view pkgName, Result &result, bela::error_code &ec) {
+  dedup_internal::Materializer materializer;
+  if (!materializer.Initialize(ec)) {
+    return false;
+  }
+  auto record = bela::finally([&] {
+    // an upgrade replaces what the previous version shared
+    dedup_internal::store_record sr;
+    bela::error_code ec2;
+    if (!dedup_internal::load_stats(sr, ec2)) {
+      DbgPrint(L"dedup: load store stats: %s", ec2);
+    }
+    const auto &added = materializer.Added();
+    sr.stats.objects += added.objects;
+    sr.stats.physical += added.physical;
+    if (result.saved != 0) {
+      sr.packages[std::wstring(pkgName)] = result.saved;
+    } else {
+      sr.packages.erase(pkgName);
+    }
+    if (!dedup_internal::save_stats(sr, ec2)) {
+      DbgPrint(L"dedup: save store stats: %s", ec2);
+    }
+    if (!dedup_internal::save_refs(pkgName, materializer.Refs(), ec2)) {
+      DbgPrint(L"dedup: save refs of %s: %s", pkgName, ec2);
+    }
+  });
+  std::error_code e;
+  for (auto it = std::filesystem::recursive_directory_iterator(root, e); !e && it != std::filesystem::end(it);
+       it.increment(e)) {
+    const auto &entry = *it;
+    if (entry.is_symlink(e) || !entry.is_regular_file(e)) {
+      continue;
+    }
+    auto size = entry.file_size(e);
+    if (e || size < dedup_internal::minimum_dedup_size) {
+      e.clear();
+      continue;
+    }
+    result.files++;
+    if (!materializer.Materialize(entry.path(), size, result, ec)) {
+      // different volume or filesystem without hardlinks, nothing else can succeed
+      if (ec.code == ERROR_NOT_SAME_DEVICE || ec.code == ERROR_INVALID_FUNCTION) {
+        return false;
+      }
+      DbgPrint(L"dedup %s: %s", entry.path().native(), ec);
+      ec.clear();
+    }
+  }
+  if (e) {
+    ec = bela::make_error_code_from_std(e, L"walk extracted files: ");
+    return false;
+  }
+  return true;
+}
+
+std::optional<Stats> StoreStats(bela::error_code &ec) {
+  dedup_internal::store_record sr;
+  if (!dedup_internal::load_stats(sr, ec)) {
+    return std::nullopt;
+  }
+  return std::make_optional(sr.stats);
+}
+
+void Release(std::wstring_view pkgName) {
+  dedup_internal::store_record sr;
+  bela::error_code ec;
+  if (!dedup_internal::load_stats(sr, ec)) {
+    DbgPrint(L"dedup: load store stats: %s", ec);
+    return;
+  }
+  DeleteFileW(bela::StringCat(dedup_internal::refs_path(), L"\\", pkgName).data());
+  if (sr.packages.erase(pkgName) != 0 && !dedup_internal::save_stats(sr, ec)) {
+    DbgPrint(L"dedup: save store stats: %s", ec);
+  }
+}
+
+bool Collect(uint64_t &reclaimed, bela::error_code &ec) {
+  auto objects = dedup_internal::objects_path();
+  if (!bela::PathExists(objects)) {
+    return true;
+  }
+  dedup_internal::store_record sr;
+  if (bela::error_code ec2; !dedup_internal::load_stats(sr, ec2)) {
+    DbgPrint(L"dedup: load store stats: %s", ec2);
+  }
+  // packages removed without baulk remove stop counting, the objects of the others stay
+  std::set<std::wstring, std::less<>> referenced;
+  std::error_code e;
+  for (const auto &entry : std::filesystem::directory_iterator(dedup_internal::refs_path(), e)) {
+    auto name = entry.path().filename().native();
+    if (!bela::PathExists(vfs::AppPackageFolder(name))) {
+      sr.packages.erase(name);
+      std::filesystem::remove(entry.path(), e);
+      continue;
+    }
+    std::wstring text;
+    if (bela::error_code ec2; !bela::io::ReadFile(entry.path().native(), text, ec2)) {
+      DbgPrint(L"dedup: read refs of %s: %s", name, ec2);
+      continue;
+    }
+    std::vector<std::wstring_view> hv = bela::StrSplit(text, bela::ByChar('\n'), bela::SkipEmpty());
+    for (auto h : hv) {
+      referenced.emplace(bela::StripTrailingAsciiWhitespace(h));
+    }
+  }
+  e.clear();
+  sr.stats.objects = 0;
+  sr.stats.physical = 0;
+  sr.stats.shared = 0;
+  for (const auto &[_, shared] : sr.packages) {
+    sr.stats.shared += shared;
+  }
+  std::vector<std::filesystem::path> garbage;
+  for (auto it = std::filesystem::recursive_directory_iterator(objects, e); !e && it != std::filesystem::end(it);
+       it.increment(e)) {
+    if (!it->is_regular_file(e)) {
+      continue;
+    }
+    bela::error_code ec2;
+    auto oi = dedup_internal::stat_object(it->path().native(), ec2);
+    if (!oi) {
+      continue;
+    }
+    // a clone has one link however many installs share its clusters, the refs tell whether one still needs it
+    if (oi->links <= 1 && !referenced.contains(it->path().filename().native())) {
+      reclaimed += oi->size;
+      garbage.emplace_back(it->path());
+      continue;
+    }
+    sr.stats.objects++;
+    sr.stats.physical += oi->size;
+  }
+  if (e) {
+    ec = bela::make_error_code_from_std(e, L"walk store: ");
+    return false;
+  }
+  for (const auto &p : garbage) {
+    bela::error_code ec2;
+    if (!bela::fs::ForceDeleteFile(p.native(), ec2)) {
+      DbgPrint(L"remove store object %s: %s", p.native(), ec2);
+    }
+  }
+  return dedup_internal::save_stats(sr, ec);
+}
+
+} // namespace baulk::dedup
@@ -0,0 +1,54 @@
+// baulk content-addressed file store
+#ifndef BAULK_DEDUP_HPP
+#define BAULK_DEDUP_HPP
+#include <filesystem>
+#include <bela/fmt.hpp>
+#include "baulk.hpp"
+
+namespace baulk::dedup {
+struct Result {
+  uint64_t files{0};  // files checked
+  uint64_t linked{0}; // files sharing their content with a store object
+  uint64_t saved{0};  // bytes no longer stored twice
+};
+
+// Stats: counters of <store>\baulk.store, kept by Deduplicate and Release, recounted by Collect
+struct Stats {
+  uint64_t objects{0};  // objects in the store
+  uint64_t physical{0}; // bytes of those objects, each content is stored once
+  uint64_t shared{0};   // bytes installed packages share with an object instead of storing their own copy
+  // Ratio: bytes the deduplicated files would take without the store over what they take with it
+  double Ratio() const {
+    return physical == 0 ? 1.0 : static_cast<double>(physical + shared) / static_cast<double>(physical);
+  }
+};
+
+// Deduplicate: hash files under root (BLAKE3), a file seen before shares the content of its store object (block
+// clone, or a hardlink where the volume cannot clone), the first file of a content becomes its object. What pkgName
+// shares replaces the count of its previous version
+bool Deduplicate(const std::filesystem::path &root, std::wstring_view pkgName, Result &result, bela::error_code &ec);
+// Release: pkgName was removed, its shared bytes and object references are dropped
+void Release(std::wstring_view pkgName);
+// StoreStats: recorded counters, the store itself is not walked
+std::optional<Stats> StoreStats(bela::error_code &ec);
+// Collect: remove objects neither linked nor referenced by an installed package
+bool Collect(uint64_t &reclaimed, bela::error_code &ec);
+
+inline std::wstring FormatBytes(uint64_t size) {
+  constexpr uint64_t KB = 1024ULL;
+  constexpr uint64_t MB = KB * 1024;
+  constexpr uint64_t GB = MB * 1024;
+  if (size >= GB) {
+    return bela::StrFormat(L"%.2f GB", static_cast<double>(size) / GB);
+  }
+  if (size >= MB) {
+    return bela::StrFormat(L"%.2f MB", static_cast<double>(size) / MB);
+  }
+  if (size >= KB) {
+    return bela::StrFormat(L"%.2f KB", static_cast<double>(size) / KB);
+  }
+  return bela::StringCat(size, L" B");
+}
+} // namespace baulk::dedup
+
+#endif
@@ -0,0 +1,121 @@
+// baulk delta upgrades
+#include <bela/terminal.hpp>
+#include <bela/path.hpp>
+#include <baulk/vfs.hpp>
+#include <baulk/fs.hpp>
+#include <baulk/net.hpp>
+#include <baulk/hash.hpp>
+#include <baulk/json_utils.hpp>
+#include <baulk/archive/delta.hpp>
+#include "delta.hpp"
+#include "cache.hpp"
+
+namespace baulk::delta {
+namespace delta_internal {
+struct Patch {
+  std::wstring from; // HashKey of the base archive
+  std::wstring url;
+  std::wstring hash; // patch file hash, optional
+};
+
+// patches: deltas of the bucket that produce the archive of pkg
+std::vector<Patch> patches(const baulk::Package &pkg, const std::wstring &target) {
+  std::vector<Patch> pv;
+  auto index = bela::StringCat(vfs::AppBuckets(), L"\\", pkg.bucket, L"\\deltas\\", pkg.name, L".json");
+  if (!bela::PathFileIsExists(index)) {
+    return pv;
+  }
+  bela::error_code ec;
+  auto jo = baulk::parse_json_file(index, ec);
+  if (!jo) {
+    DbgPrint(L"parse delta index %s: %s", index, ec);
+    return pv;
+  }
+  for (auto sv : jo->view().subviews("deltas")) {
+    if (cache::HashKey(sv.get("to")) != target) {
+      continue;
+    }
+    auto from = cache::HashKey(sv.get("from"));
+    auto url = sv.get("url");
+    if (from.empty() || url.empty()) {
+      continue;
+    }
+    pv.emplace_back(Patch{.from = std::move(from), .url = std::move(url), .hash = sv.get("hash")});
+  }
+  return pv;
+}
+
+std::optional<std::filesystem::path> apply(const baulk::Package &pkg, const cache::Cached &base, const Patch &patch,
+                                           const std::filesystem::path &downloads) {
+  bela::error_code ec;
+  auto patch_file = baulk::net::WinGet(patch.url,
+                                       {
+                                           .hash_value = patch.hash,
+                                           .cwd = downloads,
+                                           .force_overwrite = true,
+                                       },
+                                       ec);
+  if (!patch_file) {
+    bela::FPrintF(stderr, L"Download patch '%s' error: \x1b[31m%s\x1b[0m\n", patch.url, ec);
+    return std::nullopt;
+  }
+  auto closer = bela::finally([&] {
+    std::error_code e;
+    std::filesystem::remove(*patch_file, e);
+  });
+  if (!patch.hash.empty() && !hash::HashEqual(*patch_file, patch.hash, ec)) {
+    bela::FPrintF(stderr, L"baulk patch '%s' error: \x1b[31m%s\x1b[0m\n", patch_file->filename(), ec);
+    return std::nullopt;
+  }
+  auto target = downloads / net::url_path_name(pkg.urls.front());
+  auto rebuilt = bela::StringCat(target.native(), L".delta");
+  if (!baulk::archive::delta::ApplyPatch(base.archive, *patch_file, rebuilt, ec)) {
+    bela::FPrintF(stderr, L"baulk apply patch '%s' error: \x1b[31m%s\x1b[0m\n", patch_file->filename(), ec);
+    return std::nullopt;
+  }
+  std::error_code e;
+  if (!hash::HashEqual(rebuilt, pkg.hash, ec)) {
+    bela::FPrintF(stderr, L"baulk patched '%s' error: \x1b[31m%s\x1b[0m\n", target.filename(), ec);
+    std::filesystem::remove(rebuilt, e);
+    return std::nullopt;
+  }
+  if (std::filesystem::rename(rebuilt, target, e); e) {
+    bela::FPrintF(stderr, L"baulk rename '%s' error: \x1b[31m%s\x1b[0m\n", rebuilt, e.message());
+    std::filesystem::remove(rebuilt, e);
+    return std::nullopt;
+  }
+  return std::make_optional(std::move(target));
+}
+} // namespace delta_internal
+
+std::optional<std::filesystem::path> Fetch(const baulk::Package &pkg, const std::filesystem::path &downloads) {
+  auto target = cache::HashKey(pkg.hash);
+  if (target.empty() || pkg.urls.empty()) {
+    return std::nullopt;
+  }
+  auto pv = delta_internal::patches(pkg, target);
+  if (pv.empty()) {
+    return std::nullopt;
+  }
+  auto bases = cache::Archives(pkg.name);
+  for (const auto &base : bases) {
+    for (const auto &patch : pv) {
+      if (patch.from != base.hash) {
+        continue;
+      }
+      bela::FPrintF(stderr,
+                    L"Patch '\x1b[36m%s\x1b[0m' from \x1b[33m%s\x1b[0m to \x1b[32m%s\x1b[0m\n"
+                    L"url: \x1b[36m%s\x1b[0m\n",
+                    pkg.name, base.version, pkg.version, patch.url);
+      if (bela::error_code ec; !baulk::fs::MakeDirectories(downloads, ec)) {
+        bela::FPrintF(stderr, L"baulk: unable make %s error: %s\n", downloads, ec);
+        return std::nullopt;
+      }
+      if (auto archive_file = delta_internal::apply(pkg, base, patch, downloads); archive_file) {
+        return archive_file;
+      }
+    }
+  }
+  return std::nullopt;
+}
+} // namespace baulk::delta
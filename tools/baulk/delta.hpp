@@ -0,0 +1,14 @@
+// baulk delta upgrades
+#ifndef BAULK_DELTA_HPP
+#define BAULK_DELTA_HPP
+#include <filesystem>
+#include "baulk.hpp"
+
+namespace baulk::delta {
+// Fetch: rebuild the archive of pkg from a cached archive of an earlier version and a zstd patch listed in
+// <bucket>\deltas\<name>.json, {"deltas":[{"from":"<hash>","to":"<hash>","url":"...","hash":"<patch hash>"}]}.
+// The result is verified against pkg.hash, nullopt means a full download is needed
+std::optional<std::filesystem::path> Fetch(const baulk::Package &pkg, const std::filesystem::path &downloads);
+} // namespace baulk::delta
+
+#endif
@@ -52,8 +52,8 @@ class ZipExtractor final : public Extractor {
 public:
   ZipExtractor(bela::io::FD &&fd_, std::filesystem::path archive_file_, std::filesystem::path destination_,
                const ExtractorOptions &opts)
-      : fd(std::move(fd_)), extractor(opts), archive_file(std::move(archive_file_)),
-        destination(std::move(destination_)) {}
+      : fd(std::move(fd_)), archive_file(std::move(archive_file_)), destination(std::move(destination_)),
+        extractor(opts) {}
   bool Extract(bela::error_code &ec) override;
   bool Initialize(int64_t size, int64_t offset, bela::error_code &ec) {
     return extractor.OpenReader(fd, destination, size, offset, ec);
@@ -84,6 +84,8 @@ bool ZipExtractor::Extract(bela::error_code &ec) {
   if (!baulk::IsDebugMode && !baulk::IsQuietMode) {
     bela::FPrintF(stderr, L"\n");
   }
+  DbgPrint(L"directories created: %v, create_directories calls avoided: %v", extractor.Directories().Created(),
+           extractor.Directories().Avoided());
   return true;
 }
 
@@ -131,6 +133,8 @@ bool UniversalExtractor::tar_extract(baulk::archive::tar::FileReader &fr, baulk:
   if (!baulk::IsDebugMode && !baulk::IsQuietMode) {
     bela::FPrintF(stderr, L"\n");
   }
+  DbgPrint(L"directories created: %v, create_directories calls avoided: %v", extractor.Directories().Created(),
+           extractor.Directories().Avoided());
   return true;
 }
 
@@ -209,10 +213,50 @@ public:
 private:
   std::filesystem::path archive_file;
   std::filesystem::path destination;
+  bool native_extract(bool &started, bela::error_code &ec);
 };
 
+// native_extract: cabinets are decoded in process, a package the reader cannot open is left to Windows Installer,
+// started tells whether output was written
+bool MsiExtractor::native_extract(bool &started, bela::error_code &ec) {
+  baulk::archive::msi::Unpacker unpacker;
+  if (!unpacker.OpenReader(archive_file, destination, ec)) {
+    return false;
+  }
+  started = true;
+  baulk::ProgressBar bar;
+  bar.FileName(bela::StringCat(L"Extracting ", archive_file.filename()));
+  bar.Maximum(static_cast<uint64_t>(unpacker.UncompressedSize()));
+  if (!baulk::IsQuietMode) {
+    bar.Execute();
+  }
+  auto close_bar = bela::finally([&] { bar.Finish(); });
+  if (!unpacker.Extract(
+          [&](int64_t extracted, int64_t /*total*/) -> bool {
+            bar.Update(static_cast<uint64_t>(extracted));
+            return true;
+          },
+          ec)) {
+    bar.MarkFault();
+    bar.MarkCompleted();
+    return false;
+  }
+  bar.MarkCompleted();
+  DbgPrint(L"msi cabinet folders decoded by %v workers", unpacker.Workers());
+  return true;
+}
+
 bool MsiExtractor::Extract(bela::error_code &ec) {
   bela::FPrintF(stderr, L"Extracting \x1b[36m%v\x1b[0m ...\n", archive_file.filename());
+  bool started = false;
+  if (native_extract(started, ec)) {
+    return true;
+  }
+  if (started) {
+    return false;
+  }
+  DbgPrint(L"native msi: %v, fallback to Windows Installer", ec);
+  ec.clear();
   baulk::archive::msi::Extractor extractor;
   baulk::ProgressBar bar;
   bar.FileName(bela::StringCat(L"Extracting ", archive_file.filename()));
@@ -316,6 +360,61 @@ private:
   baulk::archive::file_format_t afmt;
 };
 
+// Native7zExtractor: LZMA/LZMA2 with BCJ/BCJ2 and delta filters, other coders still go through 7z.exe
+class Native7zExtractor final : public Extractor {
+public:
+  Native7zExtractor(bela::io::FD &&fd_, std::filesystem::path archive_file_, std::filesystem::path destination_,
+                    const ExtractorOptions &opts)
+      : fd(std::move(fd_)), archive_file(std::move(archive_file_)), destination(std::move(destination_)),
+        extractor(opts) {}
+  bool Extract(bela::error_code &ec) override;
+  // Initialize: ErrUnimplemented when a folder needs a coder we cannot decode
+  bool Initialize(int64_t size, int64_t offset, bela::error_code &ec) {
+    return extractor.OpenReader(fd, destination, size, offset, ec) && extractor.CheckMethods(ec);
+  }
+
+private:
+  bela::io::FD fd;
+  std::filesystem::path archive_file;
+  std::filesystem::path destination;
+  baulk::archive::n7z::Extractor extractor;
+};
+
+bool Native7zExtractor::Extract(bela::error_code &ec) {
+  bela::FPrintF(stderr, L"Extracting \x1b[36m%v\x1b[0m ...\n", archive_file.filename());
+  bela::terminal::terminal_size termsz;
+  terminal_size_initialize(termsz);
+  if (!extractor.Extract(
+          [&](const baulk::archive::n7z::File &file, const std::wstring &relative_name) -> bool {
+            progress_show(termsz, relative_name);
+            return true;
+          },
+          nullptr, ec)) {
+    return false;
+  }
+  if (!baulk::IsDebugMode && !baulk::IsQuietMode) {
+    bela::FPrintF(stderr, L"\n");
+  }
+  DbgPrint(L"7z folders decoded by %v workers, directories created: %v", extractor.Workers(),
+           extractor.Directories().Created());
+  return true;
+}
+
+// make_7z_extractor: native first, 7z.exe for coders the native reader does not implement
+std::shared_ptr<Extractor> make_7z_extractor(bela::io::FD &&fd, int64_t baseOffset,
+                                             const std::filesystem::path &archive_file,
+                                             const std::filesystem::path &destination, const ExtractorOptions &opts,
+                                             bela::error_code &ec) {
+  auto e = std::make_shared<Native7zExtractor>(std::move(fd), archive_file, destination, opts);
+  // nothing is written before Initialize succeeds, whatever the native reader rejects goes to 7z.exe
+  if (e->Initialize(bela::SizeUnInitialized, baseOffset, ec)) {
+    return e;
+  }
+  DbgPrint(L"native 7z: %v, fallback to 7z.exe", ec);
+  ec.clear();
+  return std::make_shared<_7zExtractor>(archive_file, destination, baulk::archive::file_format_t::_7z);
+}
+
 std::shared_ptr<Extractor> MakeExtractor(const std::filesystem::path &archive_file,
                                          const std::filesystem::path &destination, const ExtractorOptions &opts,
                                          bela::error_code &ec) {
@@ -355,15 +454,19 @@ std::shared_ptr<Extractor> MakeExtractor(const std::filesystem::path &archive_fi
     [[fallthrough]];
   case baulk::archive::file_format_t::rpm:
     [[fallthrough]];
+  case baulk::archive::file_format_t::xar:
+    [[fallthrough]];
+  case baulk::archive::file_format_t::z:
+    [[fallthrough]];
   case baulk::archive::file_format_t::wim:
     [[fallthrough]];
   case baulk::archive::file_format_t::rar:
     [[fallthrough]];
   case baulk::archive::file_format_t::nsis:
-    [[fallthrough]];
-  case baulk::archive::file_format_t::_7z:
     fd->Assgin(INVALID_HANDLE_VALUE, false);
     return std::make_shared<_7zExtractor>(archive_file, destination, afmt);
+  case baulk::archive::file_format_t::_7z:
+    return make_7z_extractor(std::move(*fd), baseOffset, archive_file, destination, opts, ec);
   case baulk::archive::file_format_t::msi:
     fd->Assgin(INVALID_HANDLE_VALUE, false);
     return std::make_shared<MsiExtractor>(archive_file, destination);
@@ -433,9 +536,15 @@ bool extract_7z(const std::filesystem::path &archive_file, const std::filesystem
     bela::FPrintF(stderr, L"baulk open archive %s error: %s\n", archive_file.filename(), ec);
     return false;
   }
-  fd->Assgin(INVALID_HANDLE_VALUE, false);
-  _7zExtractor extractor(archive_file, destination, afmt);
-  if (!extractor.Extract(ec)) {
+  std::shared_ptr<Extractor> extractor;
+  if (afmt == baulk::archive::file_format_t::_7z) {
+    extractor = make_7z_extractor(std::move(*fd), baseOffset, archive_file, destination,
+                                  baulk::archive::ExtractorOptions{}, ec);
+  } else {
+    fd->Assgin(INVALID_HANDLE_VALUE, false);
+    extractor = std::make_shared<_7zExtractor>(archive_file, destination, afmt);
+  }
+  if (!extractor || !extractor->Extract(ec)) {
     return false;
   }
   return baulk::fs::MakeFlattened(destination, ec);
@@ -1,5 +1,9 @@
 //
 #include <chrono>
+#include <map>
+#include <atomic>
+#include <thread>
+#include <algorithm>
 #include <bela/subsitute.hpp>
 #include <bela/base.hpp>
 #include <bela/path.hpp>
@@ -17,30 +21,167 @@
 
 namespace baulk {
 
-bool LinkMetaStore(const std::vector<LinkMeta> &metas, const Package &pkg, bela::error_code &ec) {
-  if (metas.empty()) {
+// LinkMetaTable: keyed view of baulk.linkmeta.json, loaded once per process.
+// Package add/remove are applied in memory and written back once per group.
+class LinkMetaTable {
+public:
+  LinkMetaTable(const LinkMetaTable &) = delete;
+  LinkMetaTable &operator=(const LinkMetaTable &) = delete;
+  static LinkMetaTable &Instance() {
+    static LinkMetaTable inst;
+    return inst;
+  }
+  bool Add(const std::vector<LinkMeta> &metas, const Package &pkg, bela::error_code &ec);
+  bool Drop(std::wstring_view pkgName, bela::error_code &ec);
+  // Prune: drop package links that are not in the new link set
+  bool Prune(std::wstring_view pkgName, const std::vector<std::wstring_view> &keep, bela::error_code &ec);
+  void BeginGroup() { groupDepth++; }
+  bool EndGroup(bela::error_code &ec) {
+    if (groupDepth == 0 || --groupDepth > 0) {
+      return true;
+    }
+    return flush(ec);
+  }
+
+private:
+  LinkMetaTable() = default;
+  bool load();
+  bool flush(bela::error_code &ec);
+  bool commit(bela::error_code &ec) { return groupDepth > 0 || flush(ec); }
+  void unbind(std::wstring_view alias);
+  void remove(const std::wstring &alias);
+  nlohmann::json obj;
+  std::map<std::wstring, std::wstring, std::less<>> links; // alias --> pkg@path@version
+  std::map<std::wstring, std::vector<std::wstring>, std::less<>> aliases; // pkg --> aliases
+  int groupDepth{0};
+  bool loaded{false};
+  bool dirty{false};
+};
+
+bool LinkMetaTable::load() {
+  if (loaded) {
     return true;
   }
+  loaded = true;
+  bela::error_code ec;
   auto linkMeta = bela::StringCat(vfs::AppLinks(), L"\\baulk.linkmeta.json");
-  nlohmann::json obj;
-  if (auto jv = parse_json_file(linkMeta, ec); jv) {
-    obj = std::move(jv->obj);
+  auto jv = parse_json_file(linkMeta, ec);
+  if (!jv) {
+    return true;
   }
-  ec.clear();
+  obj = std::move(jv->obj);
   try {
-    nlohmann::json newLinks;
-    if (auto it = obj.find("links"); it != obj.end()) {
-      for (const auto &item : it.value().items()) {
-        if (item.value().is_string()) {
-          newLinks[item.key()] = item.value().get<std::string>();
-        }
+    auto it = obj.find("links");
+    if (it == obj.end() || !it->is_object()) {
+      return true;
+    }
+    for (const auto &item : it.value().items()) {
+      if (!item.value().is_string()) {
+        continue;
       }
+      auto alias = bela::encode_into<char, wchar_t>(item.key());
+      auto value = bela::encode_into<char, wchar_t>(item.value().get<std::string_view>());
+      if (auto pos = value.find('@'); pos != std::wstring::npos && pos != 0) {
+        aliases[value.substr(0, pos)].emplace_back(alias);
+      }
+      links.insert_or_assign(std::move(alias), std::move(value));
+    }
+  } catch (const std::exception &e) {
+    DbgPrint(L"decode link meta error: %s", e.what());
+  }
+  return true;
+}
+
+void LinkMetaTable::unbind(std::wstring_view alias) {
+  auto it = links.find(alias);
+  if (it == links.end()) {
+    return;
+  }
+  std::wstring_view value(it->second);
+  if (auto pos = value.find('@'); pos != std::wstring_view::npos) {
+    if (auto a = aliases.find(value.substr(0, pos)); a != aliases.end()) {
+      std::erase(a->second, alias);
+    }
+  }
+}
+
+bool LinkMetaTable::Add(const std::vector<LinkMeta> &metas, const Package &pkg, bela::error_code &ec) {
+  if (metas.empty()) {
+    return true;
+  }
+  load();
+  auto &pkgAliases = aliases[pkg.name];
+  for (const auto &lm : metas) {
+    // alias may be owned by another package, overwrite it
+    unbind(lm.alias);
+    // "7z.exe":"7z@7z.exe@19.01"
+    links.insert_or_assign(lm.alias, bela::StringCat(pkg.name, L"@", lm.path, L"@", pkg.version));
+    pkgAliases.emplace_back(lm.alias);
+  }
+  dirty = true;
+  return commit(ec);
+}
+
+void LinkMetaTable::remove(const std::wstring &alias) {
+  links.erase(alias);
+  auto file = bela::StringCat(vfs::AppLinks(), L"\\", alias);
+  std::error_code e;
+  if (!std::filesystem::remove(file, e)) {
+    auto le = bela::make_error_code_from_std(e);
+    baulk::DbgPrint(L"baulk remove link %s error: %s\n", file, le.message);
+  }
+}
+
+bool LinkMetaTable::Drop(std::wstring_view pkgName, bela::error_code &ec) {
+  load();
+  auto it = aliases.find(pkgName);
+  if (it == aliases.end()) {
+    return true;
+  }
+  for (const auto &alias : it->second) {
+    remove(alias);
+  }
+  aliases.erase(it);
+  dirty = true;
+  return commit(ec);
+}
+
+bool LinkMetaTable::Prune(std::wstring_view pkgName, const std::vector<std::wstring_view> &keep,
+                          bela::error_code &ec) {
+  load();
+  auto it = aliases.find(pkgName);
+  if (it == aliases.end()) {
+    return true;
+  }
+  std::vector<std::wstring> stale;
+  std::erase_if(it->second, [&](const std::wstring &alias) {
+    if (std::ranges::find(keep, alias) != keep.end()) {
+      return false;
     }
-    for (const auto &lm : metas) {
-      auto meta = bela::encode_into<wchar_t, char>(bela::StringCat(pkg.name, L"@", lm.path, L"@", pkg.version));
-      newLinks[bela::encode_into<wchar_t, char>(lm.alias)] = meta; // "7z.exe":"7z@7z.exe@19.01"
+    stale.emplace_back(alias);
+    return true;
+  });
+  if (stale.empty()) {
+    return true;
+  }
+  for (const auto &alias : stale) {
+    remove(alias);
+  }
+  dirty = true;
+  return commit(ec);
+}
+
+bool LinkMetaTable::flush(bela::error_code &ec) {
+  if (!dirty) {
+    return true;
+  }
+  auto linkMeta = bela::StringCat(vfs::AppLinks(), L"\\baulk.linkmeta.json");
+  try {
+    nlohmann::json newLinks = nlohmann::json::object();
+    for (const auto &[alias, value] : links) {
+      newLinks[bela::encode_into<wchar_t, char>(alias)] = bela::encode_into<wchar_t, char>(value);
     }
-    obj["links"] = newLinks;
+    obj["links"] = std::move(newLinks);
     obj["updated"] = bela::FormatTime<char>(bela::Now());
     obj["app_packages_root"] = bela::encode_into<wchar_t, char>(vfs::AppPackages());
     DbgPrint(L"write link meta: %v", linkMeta);
@@ -51,51 +192,129 @@ bool LinkMetaStore(const std::vector<LinkMeta> &metas, const Package &pkg, bela:
     ec = bela::make_error_code(bela::ErrGeneral, bela::encode_into<char, wchar_t>(e.what()));
     return false;
   }
+  dirty = false;
   return true;
 }
 
-bool DropLinks(std::wstring_view pkgName, bela::error_code &ec) {
-  auto linkMeta = bela::StringCat(vfs::AppLinks(), L"\\baulk.linkmeta.json");
-  auto appLinks = vfs::AppLinks();
-  nlohmann::json obj;
-  if (auto jv = parse_json_file(linkMeta, ec); jv) {
-    obj = std::move(jv->obj);
+bool LinkMetaStore(const std::vector<LinkMeta> &metas, const Package &pkg, bela::error_code &ec) {
+  return LinkMetaTable::Instance().Add(metas, pkg, ec);
+}
+
+bool DropLinks(std::wstring_view pkgName, bela::error_code &ec) { return LinkMetaTable::Instance().Drop(pkgName, ec); }
+
+LinkMetaGroup::LinkMetaGroup() { LinkMetaTable::Instance().BeginGroup(); }
+
+LinkMetaGroup::~LinkMetaGroup() {
+  bela::error_code ec;
+  if (!LinkMetaTable::Instance().EndGroup(ec)) {
+    bela::FPrintF(stderr, L"baulk: write link meta error: \x1b[31m%s\x1b[0m\n", ec);
   }
-  ec.clear();
-  std::string newjson;
+}
+
+// parallel_for: run fn(i) for i in [0, n) on a small worker pool
+template <typename F> void parallel_for(size_t n, F &&fn) {
+  constexpr size_t maxWorkers = 8;
+  auto workers = (std::min)({n, maxWorkers, static_cast<size_t>((std::max)(std::thread::hardware_concurrency(), 1U))});
+  if (workers <= 1) {
+    for (size_t i = 0; i < n; i++) {
+      fn(i);
+    }
+    return;
+  }
+  std::atomic_size_t next{0};
+  std::vector<std::jthread> threads;
+  threads.reserve(workers);
+  for (size_t w = 0; w < workers; w++) {
+    threads.emplace_back([&] {
+      for (auto i = next.fetch_add(1); i < n; i = next.fetch_add(1)) {
+        fn(i);
+      }
+    });
+  }
+}
+
+// LinkStaging: links are created in AppLinks\.staging-<pkg> (same volume), then moved into
+// AppLinks by rename. Replaced links are kept until the whole set is committed.
+class LinkStaging {
+public:
+  LinkStaging() = default;
+  LinkStaging(const LinkStaging &) = delete;
+  LinkStaging &operator=(const LinkStaging &) = delete;
+  ~LinkStaging() {
+    if (!stagingPath.empty()) {
+      std::error_code e;
+      std::filesystem::remove_all(stagingPath, e);
+    }
+  }
+  bool Initialize(std::wstring_view appLinks_, std::wstring_view pkgName, bela::error_code &ec);
+  std::wstring_view Root() const { return stagingPath; }
+  std::wstring Path(std::wstring_view alias) const { return bela::StringCat(stagingPath, L"\\", alias); }
+  bool Commit(const std::vector<LinkMeta> &metas, bool forceoverwrite, bela::error_code &ec);
+
+private:
+  std::wstring appLinks;
+  std::wstring stagingPath;
+};
+
+bool LinkStaging::Initialize(std::wstring_view appLinks_, std::wstring_view pkgName, bela::error_code &ec) {
+  appLinks = appLinks_;
+  auto newStagingPath = bela::StringCat(appLinks, L"\\.staging-", pkgName);
   std::error_code e;
-  try {
-    auto it = obj.find("links");
-    if (it == obj.end()) {
-      return true;
+  // remove staging left by interrupted install
+  std::filesystem::remove_all(newStagingPath, e);
+  if (std::filesystem::create_directories(newStagingPath, e); e) {
+    ec = bela::make_error_code_from_std(e, L"create staging: ");
+    return false;
+  }
+  stagingPath = std::move(newStagingPath);
+  return true;
+}
+
+bool LinkStaging::Commit(const std::vector<LinkMeta> &metas, bool forceoverwrite, bela::error_code &ec) {
+  struct committed_link {
+    std::wstring target;
+    std::wstring backup;
+  };
+  std::vector<committed_link> committed;
+  auto backupPath = bela::StringCat(stagingPath, L"\\.old");
+  auto rollback = [&] {
+    std::error_code e;
+    for (auto it = committed.rbegin(); it != committed.rend(); it++) {
+      std::filesystem::remove(it->target, e);
+      if (!it->backup.empty()) {
+        MoveFileExW(it->backup.data(), it->target.data(), MOVEFILE_REPLACE_EXISTING);
+      }
     }
-    nlohmann::json newLinks;
-    auto links = it.value();
-    for (auto link = links.begin(); link != links.end(); ++link) {
-      auto raw = link.value().get<std::string>();
-      auto value = bela::encode_into<char, wchar_t>(raw);
-      std::vector<std::wstring_view> mv = bela::StrSplit(value, bela::ByChar('@'), bela::SkipEmpty());
-      if (mv.size() < 2) {
-        continue;
+  };
+  for (const auto &lm : metas) {
+    auto &c = committed.emplace_back(committed_link{.target = bela::StringCat(appLinks, L"\\", lm.alias)});
+    if (bela::PathExists(c.target)) {
+      if (!forceoverwrite) {
+        ec = bela::make_error_code(bela::ErrGeneral, L"link '", lm.alias, L"' already exists");
+        committed.pop_back();
+        rollback();
+        return false;
       }
-      if (mv[0] != pkgName) {
-        newLinks[link.key()] = raw;
-        continue;
+      if (!baulk::fs::MakeDirectories(backupPath, ec)) {
+        committed.pop_back();
+        rollback();
+        return false;
       }
-      auto file = bela::StringCat(appLinks, L"\\", bela::encode_into<char, wchar_t>(link.key()));
-      if (!std::filesystem::remove(file, e)) {
-        auto le = bela::make_error_code_from_std(e);
-        baulk::DbgPrint(L"baulk remove link %s error: %s\n", file, le.message);
+      auto backup = bela::StringCat(backupPath, L"\\", lm.alias);
+      if (MoveFileExW(c.target.data(), backup.data(), MOVEFILE_REPLACE_EXISTING) != TRUE) {
+        ec = bela::make_system_error_code(L"MoveFileExW() ");
+        committed.pop_back();
+        rollback();
+        return false;
       }
+      c.backup = std::move(backup);
     }
-    obj["updated"] = bela::FormatTime<char>(bela::Now());
-    obj["links"] = newLinks;
-    if (!bela::io::AtomicWriteText(linkMeta, bela::io::as_bytes<char>(obj.dump(4)), ec)) {
+    auto staged = Path(lm.alias);
+    if (MoveFileExW(staged.data(), c.target.data(), MOVEFILE_REPLACE_EXISTING) != TRUE) {
+      ec = bela::make_system_error_code(L"MoveFileExW() ");
+      rollback();
       return false;
     }
-  } catch (const std::exception &e) {
-    ec = bela::make_error_code(bela::ErrGeneral, bela::encode_into<char, wchar_t>(e.what()));
-    return false;
   }
   return true;
 }
@@ -229,9 +448,6 @@ bool Builder::Compile(const baulk::Package &pkg, std::wstring_view source, std::
   auto target = bela::StringCat(appLinks, L"\\", linkMeta.alias);
   auto genTarget = buildPath / linkMeta.alias;
   std::error_code e;
-  if (std::filesystem::exists(target, e)) {
-    std::filesystem::remove_all(target, e);
-  }
   std::filesystem::rename(genTarget, target, e);
   if (e) {
     ec = bela::make_error_code_from_std(e);
@@ -278,13 +494,10 @@ std::optional<std::wstring> path_reachable_cat(const std::filesystem::path &pack
   return std::nullopt;
 }
 
-bool NewLaunchers(const baulk::Package &pkg, bool forceoverwrite, bela::error_code &ec) {
-  (void)forceoverwrite;
+// StageLaunchers: compiler executor is not thread-safe, launchers are built serially into staging
+bool StageLaunchers(const baulk::Package &pkg, const LinkStaging &staging, std::vector<LinkMeta> &linkmetas,
+                    bela::error_code &ec) {
   auto packageRoot = std::filesystem::path(vfs::AppPackageFolder(pkg.name));
-  auto appLinks = vfs::AppLinks();
-  if (!baulk::fs::MakeDirectories(appLinks, ec)) {
-    return false;
-  }
   Builder builder;
   if (!builder.Initialize(ec)) {
     return false;
@@ -293,18 +506,15 @@ bool NewLaunchers(const baulk::Package &pkg, bool forceoverwrite, bela::error_co
     std::wstring relativePath(lm.path);
     auto source = path_reachable_cat(packageRoot, lm.path, relativePath);
     if (!source) {
-      bela::FPrintF(stderr, L"New launcher '%s' error: \x1b[31m%s\x1b[0m\n", lm.path, ec);
+      bela::FPrintF(stderr, L"New launcher '%s' error: \x1b[31mpath not found\x1b[0m\n", lm.path);
       continue;
     }
     bela::FPrintF(stderr, L"New launcher: \x1b[35m%v\x1b[0m@\x1b[36m%v\x1b[0m\n", pkg.name, relativePath);
-    if (!builder.Compile(pkg, *source, appLinks, lm, ec)) {
+    if (!builder.Compile(pkg, *source, staging.Root(), lm, ec)) {
       bela::FPrintF(stderr, L"New launcher '%s': \x1b[31m%s\x1b[0m\n", lm.path, ec);
     }
   }
-  if (!LinkMetaStore(builder.LinkMetas(), pkg, ec)) {
-    bela::FPrintF(stderr, L"Link '%s' error: %s\nYour can run 'baulk uninstall' and retry\n", pkg.name, ec);
-    return false;
-  }
+  linkmetas.insert(linkmetas.end(), builder.LinkMetas().begin(), builder.LinkMetas().end());
   return true;
 }
 
@@ -335,91 +545,111 @@ std::optional<std::wstring> FindProxyLauncher(bela::error_code &ec) {
   return std::make_optional(std::move(localLauncher));
 }
 
-bool NewProxyLaunchers(const baulk::Package &pkg, bool forceoverwrite, bela::error_code &ec) {
+struct link_task {
+  std::wstring relativePath;
+  std::optional<std::wstring> source;
+  bela::error_code ec;
+  bool linked{false};
+};
+
+// make_staged_links: resolve and create symlinks in staging concurrently, target empty means link to source
+std::vector<link_task> make_staged_links(const std::vector<LinkMeta> &lms, const std::filesystem::path &packageRoot,
+                                         const LinkStaging &staging, std::wstring_view target) {
+  std::vector<link_task> tasks(lms.size());
+  parallel_for(lms.size(), [&](size_t i) {
+    const auto &lm = lms[i];
+    auto &t = tasks[i];
+    t.relativePath = lm.path;
+    if (t.source = path_reachable_cat(packageRoot, lm.path, t.relativePath); !t.source) {
+      return;
+    }
+    t.linked = baulk::fs::SymLink(target.empty() ? std::wstring_view(*t.source) : target, staging.Path(lm.alias), t.ec);
+  });
+  return tasks;
+}
+
+bool StageProxyLaunchers(const baulk::Package &pkg, const LinkStaging &staging, std::vector<LinkMeta> &linkmetas,
+                         bela::error_code &ec) {
   auto proxyLauncher = FindProxyLauncher(ec);
   if (!proxyLauncher) {
     return false;
   }
   auto packageRoot = std::filesystem::path(vfs::AppPackageFolder(pkg.name));
-  auto appLinks = vfs::AppLinks();
-  if (!baulk::fs::MakeDirectories(appLinks, ec)) {
-    return false;
-  }
-  std::vector<LinkMeta> linkmetas;
-  for (const auto &lm : pkg.launchers) {
-    std::wstring relativePath(lm.path);
-    auto source = path_reachable_cat(packageRoot, lm.path, relativePath);
-    if (!source) {
-      bela::FPrintF(stderr, L"unable proxy link '%s': \x1b[31m%s\x1b[0m\n", lm.path, ec);
+  // use baulk-lnk.exe as proxy
+  auto tasks = make_staged_links(pkg.launchers, packageRoot, staging, *proxyLauncher);
+  for (size_t i = 0; i < tasks.size(); i++) {
+    const auto &lm = pkg.launchers[i];
+    const auto &t = tasks[i];
+    if (!t.source) {
+      bela::FPrintF(stderr, L"unable proxy link '%s': \x1b[31mpath not found\x1b[0m\n", lm.path);
       continue;
     }
-    bela::FPrintF(stderr, L"new proxy link: \x1b[35m%v\x1b[0m@\x1b[36m%v\x1b[0m\n", pkg.name, relativePath);
-    auto lnk = bela::StringCat(appLinks, L"\\", lm.alias);
-    if (bela::PathExists(lnk)) {
-      if (forceoverwrite) {
-        bela::fs::ForceDeleteFile(lnk, ec);
-      }
-    }
-    // use baulk-lnk.exe as proxy
-    if (!baulk::fs::SymLink(*proxyLauncher, lnk, ec)) {
+    if (!t.linked) {
+      ec = t.ec;
       return false;
     }
-    linkmetas.emplace_back(relativePath, lm.alias);
-  }
-  if (!LinkMetaStore(linkmetas, pkg, ec)) {
-    bela::FPrintF(stderr, L"Link '%s' error: %s\nYour can run 'baulk uninstall' and retry\n", pkg.name, ec);
-    return false;
+    bela::FPrintF(stderr, L"new proxy link: \x1b[35m%v\x1b[0m@\x1b[36m%v\x1b[0m\n", pkg.name, t.relativePath);
+    linkmetas.emplace_back(t.relativePath, lm.alias);
   }
   return true;
 }
 
-// create symlink
-bool NewSymlinks(const baulk::Package &pkg, bool forceoverwrite, bela::error_code &ec) {
+// StageSymlinks: create symlink
+bool StageSymlinks(const baulk::Package &pkg, const LinkStaging &staging, std::vector<LinkMeta> &linkmetas,
+                   bela::error_code &ec) {
   auto packageRoot = std::filesystem::path(vfs::AppPackageFolder(pkg.name));
-  auto appLinks = vfs::AppLinks();
-  if (!baulk::fs::MakeDirectories(appLinks, ec)) {
-    return false;
-  }
-  std::vector<LinkMeta> linkmetas;
-  for (auto &lm : pkg.links) {
-    std::wstring relativePath(lm.path);
-    auto source = path_reachable_cat(packageRoot, lm.path, relativePath);
-    if (!source) {
-      bela::FPrintF(stderr, L"Link '%s' error: \x1b[31m%s\x1b[0m\n", lm.path, ec);
+  auto tasks = make_staged_links(pkg.links, packageRoot, staging, L"");
+  for (size_t i = 0; i < tasks.size(); i++) {
+    const auto &lm = pkg.links[i];
+    const auto &t = tasks[i];
+    if (!t.source) {
+      bela::FPrintF(stderr, L"Link '%s' error: \x1b[31mpath not found\x1b[0m\n", lm.path);
       continue;
     }
-    bela::FPrintF(stderr, L"Link: \x1b[35m%v\x1b[0m@\x1b[36m%v\x1b[0m\n", pkg.name, relativePath);
-    auto lnk = bela::StringCat(appLinks, L"\\", lm.alias);
-    if (bela::PathExists(lnk)) {
-      if (forceoverwrite) {
-        bela::fs::ForceDeleteFolders(lnk, ec);
-      }
-    }
-    if (!baulk::fs::SymLink(*source, lnk, ec)) {
-      DbgPrint(L"make %s -> %s: %s\n", *source, lnk, ec);
+    if (!t.linked) {
+      DbgPrint(L"make %s -> %s: %s\n", *t.source, staging.Path(lm.alias), t.ec);
+      ec = t.ec;
       return false;
     }
-    linkmetas.emplace_back(relativePath, lm.alias);
-  }
-  if (!LinkMetaStore(linkmetas, pkg, ec)) {
-    bela::FPrintF(stderr, L"Link '%s' error: %s\nYour can run 'baulk uninstall' and retry\n", pkg.name, ec);
-    return false;
+    bela::FPrintF(stderr, L"Link: \x1b[35m%v\x1b[0m@\x1b[36m%v\x1b[0m\n", pkg.name, t.relativePath);
+    linkmetas.emplace_back(t.relativePath, lm.alias);
   }
   return true;
 }
 
 bool NewLinks(const baulk::Package &pkg, bool forceoverwrite, bela::error_code &ec) {
-  if (!pkg.links.empty()) {
-    if (!NewSymlinks(pkg, forceoverwrite, ec)) {
+  auto appLinks = vfs::AppLinks();
+  if (!baulk::fs::MakeDirectories(appLinks, ec)) {
+    return false;
+  }
+  LinkStaging staging;
+  if (!staging.Initialize(appLinks, pkg.name, ec)) {
+    return false;
+  }
+  // symlinks and launchers are staged together and committed as one set, a failure leaves every previous link
+  std::vector<LinkMeta> linkmetas;
+  if (!pkg.links.empty() && !StageSymlinks(pkg, staging, linkmetas, ec)) {
+    return false;
+  }
+  if (!pkg.launchers.empty()) {
+    auto result = LinkExecutor().Initialized() ? StageLaunchers(pkg, staging, linkmetas, ec)
+                                               : StageProxyLaunchers(pkg, staging, linkmetas, ec);
+    if (!result) {
       return false;
     }
   }
-  if (pkg.launchers.empty()) {
-    return true;
+  if (!staging.Commit(linkmetas, forceoverwrite, ec)) {
+    return false;
+  }
+  if (!LinkMetaStore(linkmetas, pkg, ec)) {
+    bela::FPrintF(stderr, L"Link '%s' error: %s\nYour can run 'baulk uninstall' and retry\n", pkg.name, ec);
+    return false;
   }
-  if (!LinkExecutor().Initialized()) {
-    return NewProxyLaunchers(pkg, forceoverwrite, ec);
+  // links were replaced in place, drop aliases the new version no longer provides or whose target is gone
+  std::vector<std::wstring_view> keep;
+  for (const auto &lm : linkmetas) {
+    keep.emplace_back(lm.alias);
   }
-  return NewLaunchers(pkg, forceoverwrite, ec);
+  return LinkMetaTable::Instance().Prune(pkg.name, keep, ec);
 }
 } // namespace baulk
@@ -6,6 +6,14 @@
 namespace baulk {
 bool NewLinks(const baulk::Package &pkg, bool forceoverwrite, bela::error_code &ec);
 bool DropLinks(std::wstring_view pkg, bela::error_code &ec);
+// LinkMetaGroup: write baulk.linkmeta.json once when the multi-package operation ends
+class LinkMetaGroup {
+public:
+  LinkMetaGroup();
+  LinkMetaGroup(const LinkMetaGroup &) = delete;
+  LinkMetaGroup &operator=(const LinkMetaGroup &) = delete;
+  ~LinkMetaGroup();
+};
 } // namespace baulk
 
 #endif
\ No newline at end of file
@@ -0,0 +1,437 @@
+// baulk local state store
+#include <algorithm>
+#include <bit>
+#include <iterator>
+#include <set>
+#include <bela/io.hpp>
+#include <bela/path.hpp>
+#include <bela/str_split.hpp>
+#include <bela/numbers.hpp>
+#include <bela/semver.hpp>
+#include <bela/fs.hpp>
+#include <baulk/vfs.hpp>
+#include <baulk/fs.hpp>
+#include <baulk/json_utils.hpp>
+#include "localstate.hpp"
+#include "bucket.hpp"
+
+namespace baulk::localstate {
+namespace localstate_internal {
+constexpr std::wstring_view snapshot_header = L"#baulk-state 1";
+// Compact the log when it holds more entries than this
+constexpr size_t compact_threshold = 256;
+
+inline std::wstring snapshot_path() { return bela::StringCat(vfs::AppLocks(), L"\\baulk.state"); }
+inline std::wstring log_path() { return bela::StringCat(vfs::AppLocks(), L"\\baulk.state.log"); }
+
+inline int64_t file_stamp(std::wstring_view file) {
+  WIN32_FILE_ATTRIBUTE_DATA wfad;
+  if (GetFileAttributesExW(file.data(), GetFileExInfoStandard, &wfad) != TRUE) {
+    return 0;
+  }
+  return std::bit_cast<int64_t>(wfad.ftLastWriteTime);
+}
+
+// field: tabs and newlines are separators
+inline std::wstring field(std::wstring_view sv) {
+  std::wstring s(sv);
+  for (auto &c : s) {
+    if (c == '\t' || c == '\r' || c == '\n') {
+      c = ' ';
+    }
+  }
+  return s;
+}
+
+// import_lock: read locks/<pkg>.json without touching buckets
+std::optional<Record> import_lock(std::wstring_view pkgName, int64_t stamp, bela::error_code &ec) {
+  auto pkglock = bela::StringCat(vfs::AppLocks(), L"\\", pkgName, L".json");
+  auto pkj = baulk::parse_json_file(pkglock, ec);
+  if (!pkj) {
+    return std::nullopt;
+  }
+  auto jv = pkj->view();
+  Record r{
+      .name = std::wstring(pkgName),
+      .version = jv.get("version"),
+      .bucket = jv.get("bucket"),
+      .mask = static_cast<PackageMask>(jv.get_as_integer("mask", bela::integral_cast(MaskNone))),
+      .stamp = stamp,
+  };
+  if (auto sv = jv.subview("venv"); sv) {
+    r.category = sv->get("category");
+  }
+  return std::make_optional(std::move(r));
+}
+} // namespace localstate_internal
+
+baulk::Package Record::AsPackage() const {
+  return baulk::Package{
+      .name = name,
+      .version = version,
+      .bucket = bucket,
+      .venv = {.category = category},
+      .weights = baulk::BucketWeights(bucket),
+      .mask = mask,
+  };
+}
+
+void Transaction::Put(const Record &r) {
+  using localstate_internal::field;
+  ops.emplace_back(bela::StringCat(L"P\t", field(r.name), L"\t", field(r.version), L"\t", field(r.bucket), L"\t",
+                                   bela::integral_cast(r.mask), L"\t", r.stamp, L"\t", field(r.category)));
+}
+
+void Transaction::Remove(std::wstring_view name) {
+  ops.emplace_back(bela::StringCat(L"D\t", localstate_internal::field(name)));
+}
+
+void Transaction::ResetUpgradable(std::wstring_view key) {
+  ops.emplace_back(bela::StringCat(L"K\t", localstate_internal::field(key)));
+}
+
+void Transaction::PutUpgradable(const Upgradable &u) {
+  using localstate_internal::field;
+  ops.emplace_back(bela::StringCat(L"U\t", field(u.name), L"\t", field(u.version), L"\t", field(u.bucket)));
+}
+
+bool Store::apply(std::wstring_view op) {
+  std::vector<std::wstring_view> fv = bela::StrSplit(op, bela::ByChar('\t'));
+  if (fv.size() < 2 || fv[0].size() != 1) {
+    return false;
+  }
+  switch (fv[0][0]) {
+  case 'P': {
+    if (fv.size() < 7) {
+      return false;
+    }
+    uint32_t mask = 0;
+    int64_t stamp = 0;
+    (void)bela::SimpleAtoi(fv[4], &mask);
+    (void)bela::SimpleAtoi(fv[5], &stamp);
+    Record r{
+        .name = std::wstring(fv[1]),
+        .version = std::wstring(fv[2]),
+        .bucket = std::wstring(fv[3]),
+        .category = std::wstring(fv[6]),
+        .mask = static_cast<PackageMask>(mask),
+        .stamp = stamp,
+    };
+    // installed version caught up with upgradable version
+    if (auto it = upgradable.find(r.name);
+        it != upgradable.end() && bela::version(r.version) >= bela::version(it->second.version)) {
+      upgradable.erase(it);
+    }
+    records.insert_or_assign(r.name, std::move(r));
+    return true;
+  }
+  case 'D':
+    if (auto it = records.find(fv[1]); it != records.end()) {
+      records.erase(it);
+    }
+    if (auto it = upgradable.find(fv[1]); it != upgradable.end()) {
+      upgradable.erase(it);
+    }
+    return true;
+  case 'K':
+    upgradable.clear();
+    upgradableKey.assign(fv[1]);
+    return true;
+  case 'U':
+    if (fv.size() < 4) {
+      return false;
+    }
+    upgradable.insert_or_assign(std::wstring(fv[1]), Upgradable{
+                                                         .name = std::wstring(fv[1]),
+                                                         .version = std::wstring(fv[2]),
+                                                         .bucket = std::wstring(fv[3]),
+                                                     });
+    return true;
+  default:
+    break;
+  }
+  return false;
+}
+
+bool Store::replay(std::wstring_view text, bool snapshot) {
+  std::vector<std::wstring_view> lines = bela::StrSplit(text, bela::ByChar('\n'), bela::SkipEmpty());
+  std::vector<std::wstring_view> pending;
+  for (auto line : lines) {
+    if (!line.empty() && line.back() == '\r') {
+      line.remove_suffix(1);
+    }
+    if (line.empty() || line.front() == '#') {
+      continue;
+    }
+    if (snapshot) {
+      apply(line);
+      continue;
+    }
+    logEntries++;
+    if (!line.starts_with(L"C\t")) {
+      pending.emplace_back(line);
+      continue;
+    }
+    size_t count = 0;
+    if (!bela::SimpleAtoi(line.substr(2), &count) || count != pending.size()) {
+      DbgPrint(L"local state: discard broken transaction (%d operations)", pending.size());
+      pending.clear();
+      continue;
+    }
+    for (const auto op : pending) {
+      apply(op);
+    }
+    pending.clear();
+  }
+  if (!pending.empty()) {
+    DbgPrint(L"local state: discard uncommitted transaction (%d operations)", pending.size());
+  }
+  return true;
+}
+
+bool Store::reconcile(bela::error_code &ec) {
+  Transaction txn;
+  std::set<std::wstring, std::less<>> seen;
+  bela::fs::Finder finder;
+  bela::error_code fec;
+  if (finder.First(vfs::AppLocks(), L"*.json", fec)) {
+    do {
+      if (finder.Ignore()) {
+        continue;
+      }
+      auto pkgName = finder.Name();
+      if (!bela::EndsWithIgnoreCase(pkgName, L".json")) {
+        continue;
+      }
+      pkgName.remove_suffix(5);
+      seen.emplace(pkgName);
+      auto stamp = std::bit_cast<int64_t>(finder.FD().ftLastWriteTime);
+      if (auto r = Find(pkgName); r != nullptr && r->stamp == stamp) {
+        continue;
+      }
+      // lock file written outside the store (first run, older baulk or interrupted batch)
+      bela::error_code ec2;
+      auto r = localstate_internal::import_lock(pkgName, stamp, ec2);
+      if (!r) {
+        DbgPrint(L"local state: import %s error: %s", pkgName, ec2);
+        continue;
+      }
+      DbgPrint(L"local state: import %s@%s", r->name, r->version);
+      txn.Put(*r);
+    } while (finder.Next());
+  }
+  for (const auto &[name, _] : records) {
+    if (!seen.contains(name)) {
+      txn.Remove(name);
+    }
+  }
+  if (txn.empty()) {
+    return true;
+  }
+  return Commit(std::move(txn), ec);
+}
+
+bool Store::Load(bela::error_code &ec) {
+  if (loaded) {
+    return true;
+  }
+  loaded = true;
+  std::wstring text;
+  if (auto snapshot = localstate_internal::snapshot_path(); bela::PathFileIsExists(snapshot)) {
+    if (!bela::io::ReadFile(snapshot, text, ec)) {
+      return false;
+    }
+    replay(text, true);
+  }
+  if (auto logfile = localstate_internal::log_path(); bela::PathFileIsExists(logfile)) {
+    text.clear();
+    if (!bela::io::ReadFile(logfile, text, ec)) {
+      return false;
+    }
+    replay(text, false);
+  }
+  return reconcile(ec);
+}
+
+const Record *Store::Find(std::wstring_view name) const {
+  if (auto it = records.find(name); it != records.end()) {
+    return &it->second;
+  }
+  return nullptr;
+}
+
+const Upgradable *Store::FindUpgradable(std::wstring_view name) const {
+  if (auto it = upgradable.find(name); it != upgradable.end()) {
+    return &it->second;
+  }
+  return nullptr;
+}
+
+bool Store::UpgradableIsFresh() const { return !upgradableKey.empty() && upgradableKey == BucketsStateKey(); }
+
+bool Store::appendLog(const Transaction &txn, bela::error_code &ec) {
+  if (!baulk::fs::MakeDirectories(vfs::AppLocks(), ec)) {
+    return false;
+  }
+  std::wstring text;
+  for (const auto &op : txn.ops) {
+    bela::StrAppend(&text, op, L"\n");
+  }
+  bela::StrAppend(&text, L"C\t", txn.ops.size(), L"\n");
+  auto u8text = bela::encode_into<wchar_t, char>(text);
+  auto logfile = localstate_internal::log_path();
+  auto FileHandle = CreateFileW(logfile.data(), FILE_APPEND_DATA, FILE_SHARE_READ, nullptr, OPEN_ALWAYS,
+                                FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (FileHandle == INVALID_HANDLE_VALUE) {
+    ec = bela::make_system_error_code(L"CreateFileW() ");
+    return false;
+  }
+  auto closer = bela::finally([&] { CloseHandle(FileHandle); });
+  if (!bela::io::WriteFull(FileHandle, bela::io::as_bytes<char>(u8text), ec)) {
+    return false;
+  }
+  if (FlushFileBuffers(FileHandle) != TRUE) {
+    ec = bela::make_system_error_code(L"FlushFileBuffers() ");
+    return false;
+  }
+  return true;
+}
+
+void Store::logged(const Transaction &txn) {
+  logEntries += txn.ops.size() + 1;
+  if (logEntries > localstate_internal::compact_threshold) {
+    bela::error_code ec2;
+    if (!Compact(ec2)) {
+      DbgPrint(L"local state: compact error: %s", ec2);
+    }
+  }
+}
+
+bool Store::Commit(Transaction &&txn, bela::error_code &ec) {
+  if (txn.empty()) {
+    return true;
+  }
+  if (batchDepth > 0) {
+    // Find sees staged operations at once, the log gets them at EndBatch
+    for (const auto &op : txn.ops) {
+      apply(op);
+    }
+    std::ranges::move(txn.ops, std::back_inserter(batch.ops));
+    return true;
+  }
+  if (!appendLog(txn, ec)) {
+    return false;
+  }
+  for (const auto &op : txn.ops) {
+    apply(op);
+  }
+  logged(txn);
+  return true;
+}
+
+bool Store::EndBatch(bela::error_code &ec) {
+  if (batchDepth == 0 || --batchDepth > 0) {
+    return true;
+  }
+  auto txn = std::move(batch);
+  batch = Transaction();
+  if (txn.empty()) {
+    return true;
+  }
+  // operations are already applied in memory, a failed append is repaired by reconcile on the next load
+  if (!appendLog(txn, ec)) {
+    return false;
+  }
+  logged(txn);
+  return true;
+}
+
+bool Store::Compact(bela::error_code &ec) {
+  Transaction snapshot;
+  snapshot.ResetUpgradable(upgradableKey);
+  for (const auto &[_, r] : records) {
+    snapshot.Put(r);
+  }
+  for (const auto &[_, u] : upgradable) {
+    snapshot.PutUpgradable(u);
+  }
+  std::wstring text(localstate_internal::snapshot_header);
+  text.push_back('\n');
+  for (const auto &op : snapshot.ops) {
+    bela::StrAppend(&text, op, L"\n");
+  }
+  if (!bela::io::AtomicWriteText(localstate_internal::snapshot_path(),
+                                 bela::io::as_bytes<char>(bela::encode_into<wchar_t, char>(text)), ec)) {
+    return false;
+  }
+  // replaying the log over the new snapshot is idempotent, a failed delete is harmless
+  if (DeleteFileW(localstate_internal::log_path().data()) != TRUE && GetLastError() != ERROR_FILE_NOT_FOUND) {
+    ec = bela::make_system_error_code(L"DeleteFileW() ");
+    return false;
+  }
+  logEntries = 0;
+  return true;
+}
+
+std::wstring BucketsStateKey() {
+  using localstate_internal::file_stamp;
+  return bela::StringCat(file_stamp(bela::StringCat(vfs::AppBuckets(), L"\\buckets.lock.json")), L":",
+                         file_stamp(baulk::Profile()));
+}
+
+bool PutPackage(const baulk::Package &pkg, bela::error_code &ec) {
+  auto &store = Store::Instance();
+  if (!store.Load(ec)) {
+    return false;
+  }
+  Transaction txn;
+  txn.Put(Record{
+      .name = pkg.name,
+      .version = pkg.version,
+      .bucket = pkg.bucket,
+      .category = pkg.venv.category,
+      .mask = pkg.mask,
+      .stamp = localstate_internal::file_stamp(bela::StringCat(vfs::AppLocks(), L"\\", pkg.name, L".json")),
+  });
+  return store.Commit(std::move(txn), ec);
+}
+
+bool RemovePackage(std::wstring_view pkgName, bela::error_code &ec) {
+  auto &store = Store::Instance();
+  if (!store.Load(ec)) {
+    return false;
+  }
+  Transaction txn;
+  txn.Remove(pkgName);
+  return store.Commit(std::move(txn), ec);
+}
+
+bool RefreshUpgradable(bela::error_code &ec) {
+  auto &store = Store::Instance();
+  if (!store.Load(ec)) {
+    return false;
+  }
+  Transaction txn;
+  txn.ResetUpgradable(BucketsStateKey());
+  for (const auto &[_, r] : store.Records()) {
+    baulk::Package pkg;
+    if (baulk::PackageUpdatableMeta(r.AsPackage(), pkg)) {
+      txn.PutUpgradable(Upgradable{.name = r.name, .version = pkg.version, .bucket = pkg.bucket});
+    }
+  }
+  return store.Commit(std::move(txn), ec);
+}
+
+bool EnsureUpgradable(bela::error_code &ec) {
+  auto &store = Store::Instance();
+  if (!store.Load(ec)) {
+    return false;
+  }
+  if (store.UpgradableIsFresh()) {
+    return true;
+  }
+  DbgPrint(L"local state: buckets changed, refresh upgradable packages");
+  return RefreshUpgradable(ec);
+}
+
+} // namespace baulk::localstate
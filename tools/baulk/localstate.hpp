@@ -0,0 +1,113 @@
+// baulk local state store
+#ifndef BAULK_LOCALSTATE_HPP
+#define BAULK_LOCALSTATE_HPP
+#include <map>
+#include "baulk.hpp"
+
+namespace baulk::localstate {
+// Record: summary of locks/<pkg>.json
+struct Record {
+  std::wstring name;
+  std::wstring version;
+  std::wstring bucket;
+  std::wstring category;
+  PackageMask mask{MaskNone};
+  int64_t stamp{0}; // locks/<pkg>.json last write time
+  baulk::Package AsPackage() const;
+};
+
+// Upgradable: newer package found in buckets
+struct Upgradable {
+  std::wstring name;
+  std::wstring version;
+  std::wstring bucket;
+};
+
+// Transaction: operations are appended to the log as a single unit, a transaction
+// without the commit marker is discarded on replay
+class Transaction {
+public:
+  Transaction() = default;
+  Transaction(const Transaction &) = delete;
+  Transaction &operator=(const Transaction &) = delete;
+  Transaction(Transaction &&) = default;
+  Transaction &operator=(Transaction &&) = default;
+  void Put(const Record &r);
+  void Remove(std::wstring_view name);
+  // ResetUpgradable: drop upgradable set, key records the buckets state it was computed from
+  void ResetUpgradable(std::wstring_view key);
+  void PutUpgradable(const Upgradable &u);
+  bool empty() const { return ops.empty(); }
+
+private:
+  friend class Store;
+  std::vector<std::wstring> ops;
+};
+
+// Store: locks/baulk.state (compacted snapshot) + locks/baulk.state.log (append-only log)
+class Store {
+public:
+  using records_t = std::map<std::wstring, Record, std::less<>>;
+  using upgradable_t = std::map<std::wstring, Upgradable, std::less<>>;
+  Store(const Store &) = delete;
+  Store &operator=(const Store &) = delete;
+  static Store &Instance() {
+    static Store inst;
+    return inst;
+  }
+  // Load: replay snapshot and log, then reconcile with locks/*.json by last write time
+  bool Load(bela::error_code &ec);
+  const Record *Find(std::wstring_view name) const;
+  const records_t &Records() const { return records; }
+  const Upgradable *FindUpgradable(std::wstring_view name) const;
+  const upgradable_t &UpgradableSet() const { return upgradable; }
+  // UpgradableIsFresh: upgradable set computed from current buckets state
+  bool UpgradableIsFresh() const;
+  bool Commit(Transaction &&txn, bela::error_code &ec);
+  // BeginBatch/EndBatch: multi-package operations are committed as one transaction
+  void BeginBatch() { batchDepth++; }
+  bool EndBatch(bela::error_code &ec);
+  bool Compact(bela::error_code &ec);
+
+private:
+  Store() = default;
+  bool replay(std::wstring_view text, bool snapshot);
+  bool apply(std::wstring_view op);
+  bool reconcile(bela::error_code &ec);
+  bool appendLog(const Transaction &txn, bela::error_code &ec);
+  void logged(const Transaction &txn);
+  records_t records;
+  upgradable_t upgradable;
+  std::wstring upgradableKey;
+  Transaction batch;
+  size_t logEntries{0};
+  int batchDepth{0};
+  bool loaded{false};
+};
+
+// Batch: scoped multi-package transaction
+class Batch {
+public:
+  Batch() { Store::Instance().BeginBatch(); }
+  Batch(const Batch &) = delete;
+  Batch &operator=(const Batch &) = delete;
+  ~Batch() {
+    bela::error_code ec;
+    if (!Store::Instance().EndBatch(ec)) {
+      bela::FPrintF(stderr, L"baulk: commit local state error: \x1b[31m%s\x1b[0m\n", ec);
+    }
+  }
+};
+
+// BucketsStateKey: changed by 'baulk update' and 'baulk bucket'
+std::wstring BucketsStateKey();
+// PutPackage: record package after locks/<pkg>.json written
+bool PutPackage(const baulk::Package &pkg, bela::error_code &ec);
+bool RemovePackage(std::wstring_view pkgName, bela::error_code &ec);
+// RefreshUpgradable: scan buckets for all installed packages and persist upgradable set
+bool RefreshUpgradable(bela::error_code &ec);
+// EnsureUpgradable: load store and refresh upgradable set when buckets changed
+bool EnsureUpgradable(bela::error_code &ec);
+} // namespace baulk::localstate
+
+#endif
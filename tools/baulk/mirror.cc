@@ -0,0 +1,569 @@
+// baulk cache mirror
+#include <bela/terminal.hpp>
+#include <bela/io.hpp>
+#include <bela/match.hpp>
+#include <bela/ascii.hpp>
+#include <bela/numbers.hpp>
+#include <bela/str_split_narrow.hpp>
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <baulk/vfs.hpp>
+#include <baulk/fs.hpp>
+#include <baulk/fsmutex.hpp>
+#include <baulk/net.hpp>
+#include <baulk/net/chunks.hpp>
+#include <baulk/hash.hpp>
+#include <baulk/cdn.hpp>
+#include "mirror.hpp"
+#include "cache.hpp"
+
+namespace baulk::mirror {
+namespace mirror_internal {
+constexpr size_t max_header_size = 16 * 1024;
+constexpr size_t max_connections = 64;
+constexpr DWORD receive_timeout = 30 * 1000;
+constexpr std::wstring_view staging_dir = L".mirror";
+
+struct request {
+  std::string method;
+  std::wstring hash; // HashKey
+  std::wstring filename;
+  std::wstring url;     // upstream
+  std::string range;    // Range header
+  bool manifest{false}; // '<archive url>.b3chunks', the suffix of a chunk manifest request lands in the url query
+};
+
+struct hash_method {
+  std::wstring_view prefix;
+  size_t hex_size;
+};
+constexpr hash_method hash_methods[] = {
+    {L"BLAKE3", 64},   {L"SHA224", 56},   {L"SHA256", 64},   {L"SHA384", 96},   {L"SHA512", 128},
+    {L"SHA3-224", 56}, {L"SHA3-256", 64}, {L"SHA3-384", 96}, {L"SHA3-512", 128}, {L"SHA3", 64},
+};
+
+// valid_hash_key: 'METHOD:hex' of a method baulk verifies, the key names the staged download
+bool valid_hash_key(std::wstring_view key) {
+  auto pos = key.find(':');
+  if (pos == std::wstring_view::npos) {
+    return false;
+  }
+  auto hex = key.substr(pos + 1);
+  for (const auto &m : hash_methods) {
+    if (m.prefix == key.substr(0, pos)) {
+      return hex.size() == m.hex_size && std::ranges::all_of(hex, [](wchar_t c) { return bela::ascii_isxdigit(c); });
+    }
+  }
+  return false;
+}
+
+inline std::wstring decode(std::string_view s) {
+  return bela::encode_into<char, wchar_t>(net::url_decode(bela::encode_into<char, wchar_t>(s)));
+}
+
+std::optional<request> parse_request(std::string_view header, int &status) {
+  std::vector<std::string_view> lines = bela::narrow::StrSplit(header, bela::narrow::ByString("\r\n"));
+  std::vector<std::string_view> rl =
+      bela::narrow::StrSplit(lines.front(), bela::narrow::ByChar(' '), bela::narrow::SkipEmpty());
+  if (rl.size() != 3) {
+    status = 400;
+    return std::nullopt;
+  }
+  request r{.method = std::string(rl[0])};
+  if (r.method != "GET" && r.method != "HEAD") {
+    status = 405;
+    return std::nullopt;
+  }
+  auto target = rl[1];
+  std::string_view query;
+  if (auto pos = target.find('?'); pos != std::string_view::npos) {
+    query = target.substr(pos + 1);
+    target = target.substr(0, pos);
+  }
+  if (!target.starts_with("/cdn/")) {
+    status = 404;
+    return std::nullopt;
+  }
+  target.remove_prefix(5);
+  auto pos = target.find('/');
+  if (pos == std::string_view::npos) {
+    status = 404;
+    return std::nullopt;
+  }
+  r.hash = cache::HashKey(decode(target.substr(0, pos)));
+  if (!valid_hash_key(r.hash)) {
+    status = 400;
+    return std::nullopt;
+  }
+  r.filename = decode(target.substr(pos + 1));
+  std::vector<std::string_view> params =
+      bela::narrow::StrSplit(query, bela::narrow::ByChar('&'), bela::narrow::SkipEmpty());
+  for (auto p : params) {
+    if (p.starts_with("url=")) {
+      r.url = decode(p.substr(4));
+    }
+  }
+  for (auto suffix : {&r.url, &r.filename}) {
+    if (suffix->ends_with(net::chunks_suffix)) {
+      suffix->resize(suffix->size() - net::chunks_suffix.size());
+      r.manifest = true;
+      break;
+    }
+  }
+  for (size_t i = 1; i < lines.size(); i++) {
+    auto line = lines[i];
+    if (auto colon = line.find(':'); colon != std::string_view::npos &&
+                                     bela::EqualsIgnoreCase(line.substr(0, colon), "Range")) {
+      r.range = bela::StripAsciiWhitespace(line.substr(colon + 1));
+    }
+  }
+  return std::make_optional(std::move(r));
+}
+
+enum class range_result { whole, partial, unsatisfiable };
+
+// parse_range: one 'bytes=first-last', 'bytes=first-' or 'bytes=-suffix', several ranges get the whole file
+range_result parse_range(std::string_view value, int64_t size, int64_t &first, int64_t &last) {
+  if (!value.starts_with("bytes=") || value.find(',') != std::string_view::npos) {
+    return range_result::whole;
+  }
+  value.remove_prefix(6);
+  auto dash = value.find('-');
+  if (dash == std::string_view::npos) {
+    return range_result::whole;
+  }
+  auto a = bela::StripAsciiWhitespace(value.substr(0, dash));
+  auto b = bela::StripAsciiWhitespace(value.substr(dash + 1));
+  if (a.empty()) {
+    int64_t suffix = 0;
+    if (!bela::SimpleAtoi(b, &suffix) || suffix <= 0 || size == 0) {
+      return range_result::unsatisfiable;
+    }
+    first = (std::max)(size - suffix, int64_t{0});
+    last = size - 1;
+    return range_result::partial;
+  }
+  if (!bela::SimpleAtoi(a, &first) || first < 0 || first >= size) {
+    return range_result::unsatisfiable;
+  }
+  last = size - 1;
+  if (!b.empty() && (!bela::SimpleAtoi(b, &last) || last < first)) {
+    return range_result::unsatisfiable;
+  }
+  last = (std::min)(last, size - 1);
+  return range_result::partial;
+}
+
+inline std::string_view status_text(int status) {
+  switch (status) {
+  case 200:
+    return "OK";
+  case 206:
+    return "Partial Content";
+  case 400:
+    return "Bad Request";
+  case 404:
+    return "Not Found";
+  case 405:
+    return "Method Not Allowed";
+  case 416:
+    return "Range Not Satisfiable";
+  case 502:
+    return "Bad Gateway";
+  case 503:
+    return "Service Unavailable";
+  default:
+    break;
+  }
+  return "Internal Server Error";
+}
+
+bool send_all(SOCKET s, const char *data, size_t len) {
+  while (len > 0) {
+    auto n = send(s, data, static_cast<int>((std::min)(len, size_t{1024 * 1024})), 0);
+    if (n <= 0) {
+      return false;
+    }
+    data += n;
+    len -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+void reply_status(SOCKET s, int status, std::string_view extra = "") {
+  auto text = status_text(status);
+  auto resp = bela::StringNarrowCat("HTTP/1.1 ", status, " ", text, "\r\nContent-Type: text/plain\r\nContent-Length: ",
+                                    text.size(), "\r\n", extra, "Connection: close\r\n\r\n", text);
+  send_all(s, resp.data(), resp.size());
+}
+
+// lock_index: baulk commands running next to the server change the cache index under the fs mutex
+std::optional<FsMutex> lock_index(int attempts, bela::error_code &ec) {
+  for (int i = 1;; i++) {
+    if (auto mtx = MakeFsMutex(vfs::AppFsMutexPath(), ec); mtx || i >= attempts) {
+      return mtx;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+}
+
+inline bool safe_name(std::wstring_view name) {
+  if (name.empty() || name == L"." || name == L"..") {
+    return false;
+  }
+  constexpr std::wstring_view reserved = L"\\/:*?\"<>|";
+  return std::ranges::none_of(name, [&](wchar_t c) { return c < 0x20 || reserved.find(c) != std::wstring_view::npos; });
+}
+
+// publish: move a verified download into the cache, a name taken by another archive is never replaced
+std::optional<std::filesystem::path> publish(const std::filesystem::path &staged, std::wstring_view url,
+                                             std::wstring_view stem, bela::error_code &ec) {
+  std::filesystem::path dir(vfs::AppTemp());
+  auto name = net::url_path_name(url);
+  if (!safe_name(name)) {
+    name.clear();
+  }
+  if (auto target = dir / name; !name.empty() && MoveFileExW(staged.c_str(), target.c_str(), 0) == TRUE) {
+    return std::make_optional(std::move(target));
+  }
+  // a file already under the hash qualified name has the same content
+  auto target = dir / (name.empty() ? std::wstring(stem) : bela::StringCat(stem, L"-", name));
+  if (MoveFileExW(staged.c_str(), target.c_str(), MOVEFILE_REPLACE_EXISTING) != TRUE) {
+    ec = bela::make_system_error_code(L"MoveFileExW() ");
+    return std::nullopt;
+  }
+  return std::make_optional(std::move(target));
+}
+
+class Server {
+public:
+  Server(const ServeOptions &opts_) : opts(opts_) {}
+  Server(const Server &) = delete;
+  Server &operator=(const Server &) = delete;
+  bool Run(bela::error_code &ec);
+
+private:
+  void serve(SOCKET s);
+  std::optional<cache::Cached> resolve(const request &r, int &status);
+  const ServeOptions &opts;
+  std::mutex cacheMutex; // the cache index is read, changed and written back
+  std::mutex fetchMutex;
+  std::map<std::wstring, std::shared_ptr<std::mutex>, std::less<>> fetching;
+  std::atomic_size_t active{0};
+};
+
+// resolve: the cached archive of r.hash, fetched from upstream once however many agents ask for it
+std::optional<cache::Cached> Server::resolve(const request &r, int &status) {
+  {
+    std::lock_guard lock(cacheMutex);
+    if (auto c = cache::Find(r.hash); c) {
+      return c;
+    }
+  }
+  status = 404;
+  if (!opts.fetch || r.hash.empty() ||
+      !(bela::StartsWithIgnoreCase(r.url, L"https://") || bela::StartsWithIgnoreCase(r.url, L"http://"))) {
+    return std::nullopt;
+  }
+  std::shared_ptr<std::mutex> m;
+  {
+    std::lock_guard lock(fetchMutex);
+    auto &p = fetching[r.hash];
+    if (!p) {
+      p = std::make_shared<std::mutex>();
+    }
+    m = p;
+  }
+  std::lock_guard fetchLock(*m);
+  {
+    std::lock_guard lock(cacheMutex);
+    if (auto c = cache::Find(r.hash); c) {
+      return c;
+    }
+  }
+  bela::FPrintF(stderr, L"fetch \x1b[36m%s\x1b[0m\n", r.url);
+  bela::error_code ec;
+  // the download is named after the hash and reaches the cache only once verified, a request never picks the file
+  // it replaces
+  auto stem = r.hash;
+  std::ranges::replace(stem, L':', L'-');
+  auto staging = std::filesystem::path(vfs::AppTemp()) / staging_dir;
+  auto destination = staging / stem;
+  if (destination.parent_path() != staging || destination.filename() != stem) {
+    // parse_request only lets hash keys through, never write outside the staging folder anyway
+    status = 400;
+    return std::nullopt;
+  }
+  if (!baulk::fs::MakeDirectories(staging, ec)) {
+    bela::FPrintF(stderr, L"fetch %s error: \x1b[31m%s\x1b[0m\n", r.url, ec);
+    status = 500;
+    return std::nullopt;
+  }
+  // several fetches may run at once, their progress bars would overwrite each other
+  auto file = net::WinGet(r.url,
+                          {
+                              .hash_value = r.hash,
+                              .cwd = staging,
+                              .destination = destination,
+                              .force_overwrite = true,
+                              .progress = [](int64_t, int64_t) {},
+                          },
+                          ec);
+  if (!file || !hash::HashEqual(*file, r.hash, ec)) {
+    bela::FPrintF(stderr, L"fetch %s error: \x1b[31m%s\x1b[0m\n", r.url, ec);
+    if (file) {
+      std::error_code e;
+      std::filesystem::remove(*file, e);
+    }
+    status = 502;
+    return std::nullopt;
+  }
+  std::lock_guard lock(cacheMutex);
+  auto mtx = lock_index(50, ec);
+  if (!mtx) {
+    bela::FPrintF(stderr, L"fetch %s: cache index busy: \x1b[33m%s\x1b[0m\n", r.url, ec);
+    std::error_code e;
+    std::filesystem::remove(*file, e);
+    status = 503;
+    return std::nullopt;
+  }
+  auto archive = publish(*file, r.url, stem, ec);
+  if (!archive) {
+    bela::FPrintF(stderr, L"fetch %s error: \x1b[31m%s\x1b[0m\n", r.url, ec);
+    std::error_code e;
+    std::filesystem::remove(*file, e);
+    status = 500;
+    return std::nullopt;
+  }
+  baulk::Package pkg;
+  pkg.hash = r.hash;
+  cache::Miss(*archive, pkg, r.url);
+  // archives of installed packages stay, the one just fetched is the most recently used
+  if (uint64_t reclaimed = 0; !cache::Trim(CacheQuota(), true, reclaimed, ec)) {
+    DbgPrint(L"baulk serve-cache trim: %s", ec);
+  } else if (reclaimed != 0) {
+    bela::FPrintF(stderr, L"trim download cache: %d bytes reclaimed\n", reclaimed);
+  }
+  return cache::Find(r.hash);
+}
+
+void Server::serve(SOCKET s) {
+  auto closer = bela::finally([&] {
+    shutdown(s, SD_SEND);
+    closesocket(s);
+    active--;
+  });
+  setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char *>(&receive_timeout), sizeof(receive_timeout));
+  std::string header;
+  char buf[4096];
+  while (header.find("\r\n\r\n") == std::string::npos) {
+    if (header.size() > max_header_size) {
+      reply_status(s, 400);
+      return;
+    }
+    auto n = recv(s, buf, sizeof(buf), 0);
+    if (n <= 0) {
+      return;
+    }
+    header.append(buf, n);
+  }
+  header.resize(header.find("\r\n\r\n"));
+  int status = 0;
+  auto r = parse_request(header, status);
+  if (!r) {
+    reply_status(s, status);
+    return;
+  }
+  auto c = resolve(*r, status);
+  if (!c) {
+    bela::FPrintF(stderr, L"%s %s/%s \x1b[31m%d\x1b[0m\n", bela::encode_into<char, wchar_t>(r->method), r->hash,
+                  r->filename, status);
+    reply_status(s, status);
+    return;
+  }
+  auto fd = CreateFileW(c->archive.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                        FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (fd == INVALID_HANDLE_VALUE) {
+    reply_status(s, 500);
+    return;
+  }
+  auto fdCloser = bela::finally([&] { CloseHandle(fd); });
+  bela::error_code ec;
+  auto size = bela::io::Size(fd, ec);
+  if (size < 0) {
+    reply_status(s, 500);
+    return;
+  }
+  auto mirrorHeaders =
+      bela::StringNarrowCat(bela::encode_into<wchar_t, char>(BaulkChecksumKey), ": ",
+                            bela::encode_into<wchar_t, char>(c->hash), "\r\n",
+                            bela::encode_into<wchar_t, char>(BaulkMirrorURL), ": ",
+                            bela::encode_into<wchar_t, char>(c->url.empty() ? r->url : c->url), "\r\n");
+  if (r->manifest) {
+    // resumed BLAKE3 downloads check their partial file against it
+    net::ChunkManifest chunks(net::chunks_block_size, size);
+    if (!c->hash.starts_with(L"BLAKE3:") || !chunks.Compute(fd, size, ec)) {
+      reply_status(s, 404);
+      return;
+    }
+    auto body = chunks.Encode();
+    auto resp = bela::StringNarrowCat("HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: ", body.size(),
+                                      "\r\n", mirrorHeaders, "Connection: close\r\n\r\n");
+    if (send_all(s, resp.data(), resp.size()) && r->method == "GET") {
+      send_all(s, body.data(), body.size());
+    }
+    return;
+  }
+  int64_t first = 0;
+  int64_t last = size - 1;
+  status = 200;
+  std::string contentRange;
+  if (!r->range.empty()) {
+    switch (parse_range(r->range, size, first, last)) {
+    case range_result::partial:
+      status = 206;
+      contentRange = bela::StringNarrowCat("Content-Range: bytes ", first, "-", last, "/", size, "\r\n");
+      break;
+    case range_result::unsatisfiable:
+      reply_status(s, 416, bela::StringNarrowCat("Content-Range: bytes */", size, "\r\n"));
+      return;
+    default:
+      break;
+    }
+  }
+  auto length = last - first + 1;
+  auto resp = bela::StringNarrowCat("HTTP/1.1 ", status, " ", status_text(status),
+                                    "\r\nContent-Type: application/octet-stream\r\nContent-Length: ", length,
+                                    "\r\nAccept-Ranges: bytes\r\n", contentRange, mirrorHeaders,
+                                    "Connection: close\r\n\r\n");
+  if (!send_all(s, resp.data(), resp.size()) || r->method == "HEAD") {
+    return;
+  }
+  if (!bela::io::Seek(fd, first, ec)) {
+    return;
+  }
+  std::vector<char> buffer(256 * 1024);
+  int64_t sent = 0;
+  while (sent < length) {
+    DWORD dwread = 0;
+    auto want = static_cast<DWORD>((std::min)(static_cast<int64_t>(buffer.size()), length - sent));
+    if (ReadFile(fd, buffer.data(), want, &dwread, nullptr) != TRUE || dwread == 0) {
+      break;
+    }
+    if (!send_all(s, buffer.data(), dwread)) {
+      break;
+    }
+    sent += dwread;
+  }
+  {
+    // statistics only, a command holding the index is not waited for
+    std::lock_guard lock(cacheMutex);
+    if (auto mtx = lock_index(1, ec); mtx) {
+      cache::Served(c->archive, static_cast<uint64_t>(sent));
+    }
+  }
+  bela::FPrintF(stderr, L"%s %s \x1b[32m%d\x1b[0m %d bytes\n", bela::encode_into<char, wchar_t>(r->method),
+                c->archive.filename().native(), status, sent);
+}
+
+bool Server::Run(bela::error_code &ec) {
+  WSADATA wsaData;
+  if (auto err = WSAStartup(MAKEWORD(2, 2), &wsaData); err != 0) {
+    ec = bela::make_system_error_code(L"WSAStartup() ");
+    return false;
+  }
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(static_cast<u_short>(opts.port));
+  if (InetPtonW(AF_INET, opts.address.data(), &addr.sin_addr) != 1) {
+    ec = bela::make_error_code(bela::ErrGeneral, L"invalid listen address '", opts.address, L"'");
+    return false;
+  }
+  auto ls = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (ls == INVALID_SOCKET) {
+    ec = bela::make_system_error_code(L"socket() ");
+    return false;
+  }
+  auto closer = bela::finally([&] { closesocket(ls); });
+  if (bind(ls, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) != 0) {
+    ec = bela::make_system_error_code(L"bind() ");
+    return false;
+  }
+  if (listen(ls, SOMAXCONN) != 0) {
+    ec = bela::make_system_error_code(L"listen() ");
+    return false;
+  }
+  bela::FPrintF(stderr, L"baulk serve-cache: listening on \x1b[36mhttp://%s:%d\x1b[0m, cache: %s\n", opts.address,
+                opts.port, vfs::AppTemp());
+  for (;;) {
+    auto s = accept(ls, nullptr, nullptr);
+    if (s == INVALID_SOCKET) {
+      ec = bela::make_system_error_code(L"accept() ");
+      return false;
+    }
+    if (active >= max_connections) {
+      reply_status(s, 503);
+      closesocket(s);
+      continue;
+    }
+    active++;
+    std::thread([this, s] { serve(s); }).detach();
+  }
+}
+} // namespace mirror_internal
+
+bool Serve(const ServeOptions &opts, bela::error_code &ec) {
+  // connection threads outlive a failed accept loop until the process exits
+  static mirror_internal::Server server(opts);
+  return server.Run(ec);
+}
+
+std::optional<std::filesystem::path> Fetch(const baulk::Package &pkg, const std::filesystem::path &downloads) {
+  std::wstring_view mirror = CacheMirror();
+  auto hash = cache::HashKey(pkg.hash);
+  if (mirror.empty() || hash.empty() || pkg.urls.empty()) {
+    return std::nullopt;
+  }
+  while (mirror.ends_with(L'/')) {
+    mirror.remove_suffix(1);
+  }
+  std::wstring_view upstream = pkg.urls.front();
+  if (auto pos = upstream.find(L'#'); pos != std::wstring_view::npos) {
+    upstream = upstream.substr(0, pos);
+  }
+  auto filename = net::url_path_name(upstream);
+  auto url = bela::StringCat(mirror, cdn_prefix, net::url_encode(hash), L"/", net::url_encode(filename),
+                             L"?url=", net::url_encode(upstream));
+  bela::error_code ec;
+  if (!baulk::fs::MakeDirectories(downloads, ec)) {
+    bela::FPrintF(stderr, L"baulk: unable make %s error: %s\n", downloads, ec);
+    return std::nullopt;
+  }
+  bela::FPrintF(stderr, L"Download '\x1b[36m%s\x1b[0m' from cache mirror \x1b[36m%s\x1b[0m\n", filename, mirror);
+  auto archive_file = net::WinGet(url,
+                                  {
+                                      .hash_value = pkg.hash,
+                                      .cwd = downloads,
+                                      .destination = downloads / filename,
+                                      .force_overwrite = true,
+                                  },
+                                  ec);
+  if (!archive_file) {
+    bela::FPrintF(stderr, L"cache mirror: \x1b[33m%s\x1b[0m, download from upstream\n", ec);
+    return std::nullopt;
+  }
+  if (!hash::HashEqual(*archive_file, pkg.hash, ec)) {
+    bela::FPrintF(stderr, L"cache mirror: \x1b[31m%s\x1b[0m, download from upstream\n", ec);
+    std::error_code e;
+    std::filesystem::remove(*archive_file, e);
+    return std::nullopt;
+  }
+  return archive_file;
+}
+} // namespace baulk::mirror
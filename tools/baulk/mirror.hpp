@@ -0,0 +1,24 @@
+// baulk cache mirror
+#ifndef BAULK_MIRROR_HPP
+#define BAULK_MIRROR_HPP
+#include <filesystem>
+#include "baulk.hpp"
+
+namespace baulk::mirror {
+// archives are requested as <mirror>/cdn/<hash>/<file name>?url=<upstream url>, see baulk/cdn.hpp
+constexpr std::wstring_view cdn_prefix = L"/cdn/";
+constexpr int default_port = 8089;
+
+struct ServeOptions {
+  std::wstring address{L"127.0.0.1"}; // serving other agents is a choice, fetch downloads any url it is given
+  int port{default_port};
+  bool fetch{true}; // download missing archives from their upstream url
+};
+
+// Serve: answer cdn requests from the download cache until the process is stopped
+bool Serve(const ServeOptions &opts, bela::error_code &ec);
+// Fetch: download the archive of pkg from CacheMirror(), verified against pkg.hash. nullopt means upstream is used
+std::optional<std::filesystem::path> Fetch(const baulk::Package &pkg, const std::filesystem::path &downloads);
+} // namespace baulk::mirror
+
+#endif
@@ -14,6 +14,11 @@
 #include "launcher.hpp"
 #include "pkg.hpp"
 #include "extractor.hpp"
+#include "localstate.hpp"
+#include "dedup.hpp"
+#include "cache.hpp"
+#include "delta.hpp"
+#include "mirror.hpp"
 
 namespace baulk::package {
 
@@ -53,7 +58,10 @@ bool PackageLocalMetaWrite(const baulk::Package &pkg, bela::error_code &ec) {
     }
     bela::StrAppend(&file, L"\\", pkg.name, L".json");
     DbgPrint(L"write %s lock: %s", pkg.name, file);
-    return bela::io::AtomicWriteText(file, bela::io::as_bytes<char>(j.dump(4)), ec);
+    if (!bela::io::AtomicWriteText(file, bela::io::as_bytes<char>(j.dump(4)), ec)) {
+      return false;
+    }
+    return localstate::PutPackage(pkg, ec);
   } catch (const std::exception &e) {
     ec = bela::make_error_code(bela::ErrGeneral, bela::encode_into<char, wchar_t>(e.what()));
   }
@@ -123,9 +131,8 @@ bool NewLinks(const baulk::Package &pkg) {
     }
   }
   bela::error_code ec;
-  baulk::DropLinks(pkg.name, ec);
   // check package is good installed
-  // rebuild launcher and links
+  // rebuild launcher and links, previous links are kept when it fails
   if (!baulk::NewLinks(pkg, true, ec)) {
     bela::FPrintF(stderr, L"baulk unable make %s links: %s\n", pkg.name, ec);
     return false;
@@ -196,6 +203,14 @@ bool Expand(const baulk::Package &pkg, const std::filesystem::path &archive_file
     bela::FPrintF(stderr, L"baulk extract: %v error: %v\n", archive_file.filename(), ec);
     return false;
   }
+  // files seen in other installed versions share their content with store objects, a failure only costs disk space
+  if (dedup::Result dr; !dedup::Deduplicate(*destination, pkg.name, dr, ec)) {
+    DbgPrint(L"baulk dedup %s: %s", pkg.name, ec);
+    ec.clear();
+  } else if (dr.linked != 0) {
+    bela::FPrintF(stderr, L"baulk: \x1b[32m%d\x1b[0m of %d files shared with installed packages, %s saved\n", dr.linked,
+                  dr.files, dedup::FormatBytes(dr.saved));
+  }
   std::filesystem::path packages(baulk::vfs::AppPackages());
   auto pkgRoot = packages / pkg.name;
   std::error_code e;
@@ -249,6 +264,40 @@ void DisplayDependencies(const baulk::Package &pkg) {
                 bela::StrJoin(pkg.venv.dependencies, L"\n    "));
 }
 
+// debug output of the names a phase resolved and the time it waited for them, snapshot restarts the count
+inline void TraceResolver(std::wstring_view pkgName, std::wstring_view phase, net::resolver_stats &snapshot) {
+  auto now = net::ResolverStats();
+  auto elapsed = now.elapsed - snapshot.elapsed;
+  DbgPrint(L"baulk '%s' %s dns: %d lookups, %d cached, %d prefetched, %d.%03d ms", pkgName, phase,
+           now.lookups - snapshot.lookups, now.hits - snapshot.hits, now.prefetched - snapshot.prefetched,
+           elapsed / 1000, elapsed % 1000);
+  snapshot = now;
+}
+
+// InstallDownloaded: an archive fetched for this install, however it arrived, is recorded, expanded and trimmed
+bool InstallDownloaded(const baulk::Package &pkg, const std::filesystem::path &archive_file, std::wstring_view url) {
+  cache::Miss(archive_file, pkg, url);
+  if (!Expand(pkg, archive_file)) {
+    return false;
+  }
+  // the new version is installed now, its archive is kept by the trim
+  bela::error_code ec;
+  if (uint64_t reclaimed = 0; !cache::Trim(CacheQuota(), true, reclaimed, ec)) {
+    DbgPrint(L"baulk trim download cache: %s", ec);
+  } else if (reclaimed != 0) {
+    DbgPrint(L"baulk trim download cache: %d bytes reclaimed", reclaimed);
+  }
+  if (!pkg.suggest.empty()) {
+    bela::FPrintF(stderr, L"'%s' suggests installing: '\x1b[32m%s\x1b[0m'\n", pkg.name,
+                  bela::StrJoin(pkg.suggest, L"\x1b[0m' or '\x1b[32m"));
+  }
+  if (!pkg.notes.empty()) {
+    bela::FPrintF(stderr, L"'%s' notes\n-----\n%s\n", pkg.name, pkg.notes);
+  }
+  DisplayDependencies(pkg);
+  return true;
+}
+
 bool Install(const baulk::Package &pkg) {
   bela::error_code ec;
   auto pkgLocal = baulk::PackageLocalMeta(pkg.name, ec);
@@ -283,17 +332,38 @@ bool Install(const baulk::Package &pkg) {
                   L"\x1b[32m%s\x1b[0m@\x1b[34m%s\x1b[0m\n",
                   pkg.name, pkgLocal->version, pkgLocal->bucket, pkg.version, pkg.bucket);
   }
+  // same artifact under another url, mirror or file name: no url probing and no download
+  if (auto archive_file = cache::Lookup(pkg); archive_file) {
+    DbgPrint(L"baulk '%s/%s' cached: '%s'\n", pkg.name, pkg.version, archive_file->filename());
+    cache::Hit(*archive_file, pkg);
+    return Expand(pkg, *archive_file);
+  }
+  // names resolve while the mirror and the delta are tried, url probing and the download find them cached
+  auto dns = net::ResolverStats();
+  net::PrefetchHosts(pkg.urls);
+  std::filesystem::path downloads(vfs::AppTemp());
+  // a fleet mirror serves archives by hash and downloads each from upstream only once
+  if (auto archive_file = mirror::Fetch(pkg, downloads); archive_file) {
+    return InstallDownloaded(pkg, *archive_file, pkg.urls.front());
+  }
+  // an earlier version still cached and a bucket patch: only the difference is downloaded
+  if (auto archive_file = delta::Fetch(pkg, downloads); archive_file) {
+    // the index keeps the upstream url, the patch source is not where the archive can be found again
+    return InstallDownloaded(pkg, *archive_file, pkg.urls.front());
+  }
+  TraceResolver(pkg.name, L"mirror", dns);
   auto url = baulk::net::BestUrl(pkg.urls, LocaleName());
+  TraceResolver(pkg.name, L"probe", dns);
   if (url.empty()) {
     bela::FPrintF(stderr, L"baulk: \x1b[31m%s\x1b[0m no valid url\n", pkg.name);
     return false;
   }
   DbgPrint(L"baulk '%s/%s' url: '%s'\n", pkg.name, pkg.version, url);
-  std::filesystem::path downloads(vfs::AppTemp());
   auto filename = net::url_path_name(url);
   if (!pkg.hash.empty()) {
     DbgPrint(L"baulk '%s/%s' filename: '%s'\n", pkg.name, pkg.version, filename);
     if (auto archive_file = PackageCached(downloads, filename, pkg.hash); archive_file) {
+      cache::Hit(*archive_file, pkg, url);
       return Expand(pkg, *archive_file);
     }
   }
@@ -327,21 +397,12 @@ bool Install(const baulk::Package &pkg) {
       break;
     }
     bela::FPrintF(stderr, L"baulk download '%s' error: \x1b[31m%s\x1b[0m\n", archive_file->filename(), ec);
+    archive_file.reset();
   }
+  TraceResolver(pkg.name, L"download", dns);
   if (!archive_file) {
     return false;
   }
-  if (!Expand(pkg, *archive_file)) {
-    return false;
-  }
-  if (!pkg.suggest.empty()) {
-    bela::FPrintF(stderr, L"'%s' suggests installing: '\x1b[32m%s\x1b[0m'\n", pkg.name,
-                  bela::StrJoin(pkg.suggest, L"\x1b[0m' or '\x1b[32m"));
-  }
-  if (!pkg.notes.empty()) {
-    bela::FPrintF(stderr, L"'%s' notes\n-----\n%s\n", pkg.name, pkg.notes);
-  }
-  DisplayDependencies(pkg);
-  return true;
+  return InstallDownloaded(pkg, *archive_file, url);
 }
 } // namespace baulk::package
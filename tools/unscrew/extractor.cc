@@ -21,8 +21,8 @@ class ZipExtractor final : public Extractor {
 public:
   ZipExtractor(bela::io::FD &&fd_, const std::filesystem::path &archive_file_,
                const std::filesystem::path &destination_, const ExtractorOptions &opts)
-      : fd(std::move(fd_)), extractor(opts), archive_file(archive_file_), destination(destination_) {}
-  bool Extract(ProgressBar *bar, bela::error_code &ec);
+      : fd(std::move(fd_)), archive_file(archive_file_), destination(destination_), extractor(opts) {}
+  bool Extract(ProgressBar *bar, bela::error_code &ec) override;
   bool Initialize(int64_t size, int64_t offset, bela::error_code &ec) {
     return extractor.OpenReader(fd, destination, size, offset, ec);
   }
@@ -161,9 +161,36 @@ public:
 private:
   std::filesystem::path archive_file;
   std::filesystem::path destination;
+  bool native_extract(ProgressBar *bar, bool &started, bela::error_code &ec);
 };
 
+// native_extract: cabinets are decoded in process, a package the reader cannot open is left to Windows Installer,
+// started tells whether output was written
+bool MsiExtractor::native_extract(ProgressBar *bar, bool &started, bela::error_code &ec) {
+  baulk::archive::msi::Unpacker unpacker;
+  if (!unpacker.OpenReader(archive_file, destination, ec)) {
+    return false;
+  }
+  started = true;
+  bar->Title(bela::StringCat(L"Extracting ", archive_file.filename()));
+  bar->UpdateLine(1, destination.native(), TRUE);
+  return unpacker.Extract(
+      [&](int64_t extracted, int64_t total) -> bool {
+        bar->Update(extracted, total);
+        return !bar->Cancelled();
+      },
+      ec);
+}
+
 bool MsiExtractor::Extract(ProgressBar *bar, bela::error_code &ec) {
+  bool started = false;
+  if (native_extract(bar, started, ec)) {
+    return true;
+  }
+  if (started) {
+    return false;
+  }
+  ec.clear();
   baulk::archive::msi::Extractor extractor;
   if (!extractor.Initialize(
           archive_file, destination,
@@ -250,6 +277,44 @@ private:
   file_format_t afmt;
 };
 
+// Native7zExtractor: LZMA/LZMA2 with BCJ/BCJ2 and delta filters, other coders still go through 7zG.exe
+class Native7zExtractor final : public Extractor {
+public:
+  Native7zExtractor(bela::io::FD &&fd_, const std::filesystem::path &archive_file_,
+                    const std::filesystem::path &destination_, const ExtractorOptions &opts)
+      : fd(std::move(fd_)), archive_file(archive_file_), destination(destination_), extractor(opts) {}
+  bool Extract(ProgressBar *bar, bela::error_code &ec) override;
+  // Initialize: ErrUnimplemented when a folder needs a coder we cannot decode
+  bool Initialize(int64_t size, int64_t offset, bela::error_code &ec) {
+    return extractor.OpenReader(fd, destination, size, offset, ec) && extractor.CheckMethods(ec);
+  }
+
+private:
+  bela::io::FD fd;
+  std::filesystem::path archive_file;
+  std::filesystem::path destination;
+  baulk::archive::n7z::Extractor extractor;
+};
+
+bool Native7zExtractor::Extract(ProgressBar *bar, bela::error_code &ec) {
+  bar->Title(bela::StringCat(L"Extracting ", archive_file.filename()));
+  bar->UpdateLine(1, destination.native(), TRUE);
+  auto uncompressed_size = extractor.UncompressedSize();
+  int64_t completed_bytes = 0;
+  // progress is serialized by the extractor, folders are decoded on several threads
+  return extractor.Extract(
+      [&](const baulk::archive::n7z::File &file, const std::wstring &relative_name) -> bool {
+        bar->UpdateLine(2, relative_name, TRUE);
+        return !bar->Cancelled();
+      },
+      [&](size_t bytes) -> bool {
+        completed_bytes += bytes;
+        bar->Update(completed_bytes, uncompressed_size);
+        return !bar->Cancelled();
+      },
+      ec);
+}
+
 std::shared_ptr<Extractor> MakeExtractor(const std::filesystem::path &archive_file,
                                          const std::filesystem::path &destination, const ExtractorOptions &opts,
                                          bela::error_code &ec) {
@@ -291,15 +356,26 @@ std::shared_ptr<Extractor> MakeExtractor(const std::filesystem::path &archive_fi
     [[fallthrough]];
   case file_format_t::rpm:
     [[fallthrough]];
+  case file_format_t::xar:
+    [[fallthrough]];
+  case file_format_t::z:
+    [[fallthrough]];
   case file_format_t::wim:
     [[fallthrough]];
   case file_format_t::rar:
     [[fallthrough]];
   case file_format_t::nsis:
-    [[fallthrough]];
-  case file_format_t::_7z:
     fd->Assgin(INVALID_HANDLE_VALUE, false);
     return std::make_shared<_7zExtractor>(archive_file, destination, afmt);
+  case file_format_t::_7z: {
+    auto e = std::make_shared<Native7zExtractor>(std::move(*fd), archive_file, destination, opts);
+    if (e->Initialize(bela::SizeUnInitialized, baseOffset, ec)) {
+      return e;
+    }
+    // coders such as PPMd or AES, or anything else the native reader rejects before writing, go to 7zG.exe
+    ec.clear();
+    return std::make_shared<_7zExtractor>(archive_file, destination, afmt);
+  }
   default:
     break;
   }
@@ -1,8 +1,11 @@
 // A simple program download network resource
 #include <bela/parseargv.hpp>
+#include <bela/numbers.hpp>
 #include <filesystem>
+#include <thread>
 #include <baulk/hash.hpp>
 #include <baulk/net/client.hpp>
+#include <baulk/indicators.hpp>
 #include <baulk/debug.hpp>
 #include <version.hpp>
 
@@ -20,11 +23,14 @@ Usage: wind [option]... [url]...
   -K|--insecure    Allow insecure server connections when using SSL
   -O|--output      Write file to the specified path
   -A|--user-agent  Send User-Agent <name> to server
+  -j|--jobs        Download <N> URLs at the same time, progress is shown for all of them
+  --per-host       Open at most <N> connections to one host (default 6, 0 is unlimited)
   --https-proxy    Use this proxy. Equivalent to setting the environment variable 'HTTPS_PROXY'
   --no-cache       Download directly without caching
 
 Example:
   wind https://aka.ms/win32-x64-user-stable
+  wind -j 8 -W D:\cache https://example.com/a.zip https://example.com/b.zip
 
 )";
   bela::terminal::WriteAuto(stderr, usage);
@@ -56,9 +62,11 @@ public:
 private:
   int single_download();
   int multi_download();
+  int concurrent_download();
   std::vector<std::wstring> urls;
   std::filesystem::path cwd;
   std::filesystem::path destination;
+  size_t jobs{1};
   bool replace{false};
 };
 
@@ -76,6 +84,8 @@ void verify_file(const std::filesystem::path &file) {
 
 bool Executor::ParseArgv(int argc, wchar_t **argv) {
   using baulk::net::HttpClient;
+  // --per-host overrides BAULK_HOST_CONNECTIONS
+  baulk::net::Scheduler::Default().InitializeFromEnv();
   bela::ParseArgv pa(argc, argv);
   pa.Add(L"help", bela::no_argument, L'h')
       .Add(L"version", bela::no_argument, L'v')
@@ -85,8 +95,10 @@ bool Executor::ParseArgv(int argc, wchar_t **argv) {
       .Add(L"insecure", bela::no_argument, L'K')
       .Add(L"output", bela::required_argument, L'O')
       .Add(L"user-agent", bela::required_argument, 'A')
+      .Add(L"jobs", bela::required_argument, L'j')
       .Add(L"https-proxy", bela::required_argument, 1001)
-      .Add(L"no-cache", bela::no_argument, 1002); // option
+      .Add(L"no-cache", bela::no_argument, 1002)
+      .Add(L"per-host", bela::required_argument, 1003); // option
   bela::error_code ec;
   auto ret = pa.Execute(
       [&](int val, const wchar_t *oa, const wchar_t *) {
@@ -101,21 +113,24 @@ bool Executor::ParseArgv(int argc, wchar_t **argv) {
           baulk::IsDebugMode = true;
           HttpClient::DefaultClient().SetDebugMode(true);
           break;
-        case 'f':
+        case 'R':
           replace = true;
           break;
-        case 'k':
+        case 'K':
           HttpClient::DefaultClient().SetInsecureMode(true);
           break;
-        case 'd':
-          // ww.nocache = true;
-          break;
-        case 'w':
+        case 'W':
           cwd = oa;
           break;
-        case 'o':
+        case 'O':
           destination = oa;
           break;
+        case 'j':
+          if (!bela::SimpleAtoi(oa, &jobs) || jobs == 0) {
+            bela::FPrintF(stderr, L"wind: \x1b[31minvalid jobs '%s'\x1b[0m\n", oa);
+            return false;
+          }
+          break;
         case 'A':
           HttpClient::DefaultClient().SetUserAgent(oa);
           break;
@@ -125,6 +140,11 @@ bool Executor::ParseArgv(int argc, wchar_t **argv) {
         case 1002:
           HttpClient::DefaultClient().SetNoCache(true);
           break;
+        case 1003:
+          if (size_t n = 0; bela::SimpleAtoi(oa, &n)) {
+            baulk::net::Scheduler::Default().SetHostConnections(n);
+          }
+          break;
         default:
           break;
         }
@@ -170,6 +190,9 @@ int Executor::single_download() {
   return 0;
 }
 int Executor::multi_download() {
+  if (jobs > 1) {
+    return concurrent_download();
+  }
   size_t success = 0;
   bela::error_code ec;
   for (const auto &u : urls) {
@@ -184,12 +207,95 @@ int Executor::multi_download() {
       bela::FPrintF(stderr, L"download failed: \x1b[31m%s\x1b[0m\n", ec);
       continue;
     }
+    success++;
     baulk::verify_file(*file);
     bela::FPrintF(stdout, L"\x1b[32m'%s' saved\x1b[0m\n", *file);
   }
   return success == urls.size() ? 0 : 1;
 }
 
+struct download_result {
+  std::optional<std::filesystem::path> file;
+  std::optional<baulk::hash::file_hash_sums> sums;
+  bela::error_code ec;
+  int64_t bytes{0};
+  double seconds{0};
+};
+
+int Executor::concurrent_download() {
+  std::vector<download_result> results(urls.size());
+  // per url progress, the bar shows their sums
+  std::vector<std::atomic_int64_t> received(urls.size());
+  std::vector<std::atomic_int64_t> totals(urls.size());
+  std::atomic_uint64_t receivedSum{0};
+  std::atomic_uint64_t totalSum{0};
+  std::atomic_size_t next{0};
+  baulk::ProgressBar bar;
+  bar.FileName(bela::StringCat(urls.size(), L" files, ", jobs, L" jobs"));
+  bar.Execute();
+  auto worker = [&] {
+    for (size_t i = next++; i < urls.size(); i = next++) {
+      auto &r = results[i];
+      auto begin = std::chrono::steady_clock::now();
+      r.file = baulk::net::WinGet(urls[i],
+                                  {
+                                      .hash_value = L"",
+                                      .cwd = cwd,
+                                      .force_overwrite = replace,
+                                      .progress =
+                                          [&, i](int64_t current, int64_t total) {
+                                            receivedSum += current - received[i].exchange(current);
+                                            totalSum += total - totals[i].exchange(total);
+                                            bar.Maximum(totalSum);
+                                            bar.Update(receivedSum);
+                                          },
+                                  },
+                                  r.ec);
+      r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+      r.bytes = received[i];
+      if (r.file) {
+        r.sums = baulk::hash::HashSums(*r.file, r.ec);
+      }
+    }
+  };
+  std::vector<std::thread> threads;
+  auto n = (std::min)(jobs, urls.size());
+  for (size_t i = 0; i < n; i++) {
+    threads.emplace_back(worker);
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  size_t failed = 0;
+  for (const auto &r : results) {
+    if (!r.file) {
+      failed++;
+    }
+  }
+  if (failed != 0) {
+    bar.MarkFault();
+  }
+  bar.MarkCompleted();
+  bar.Finish();
+  // summary: one line per url, throughput of the transfer itself, hashing is not counted
+  for (size_t i = 0; i < urls.size(); i++) {
+    const auto &r = results[i];
+    if (!r.file) {
+      bela::FPrintF(stderr, L"\x1b[31mfailed\x1b[0m %s: \x1b[31m%s\x1b[0m\n", urls[i], r.ec);
+      continue;
+    }
+    auto rate = static_cast<double>(r.bytes) / (std::max)(r.seconds, 0.001) / 1024;
+    bela::FPrintF(stderr, L"\x1b[32msaved\x1b[0m %s %d bytes in %.2fs (%.2f KB/s)\n", r.file->native(), r.bytes,
+                  r.seconds, rate);
+    if (r.sums) {
+      bela::FPrintF(stderr, L"\x1b[34mSHA256:%s %s\x1b[0m\n", r.sums->sha256sum, r.file->filename().native());
+      bela::FPrintF(stderr, L"\x1b[34mBLAKE3:%s %s\x1b[0m\n", r.sums->blake3sum, r.file->filename().native());
+    }
+  }
+  bela::FPrintF(stderr, L"%d downloaded, %d failed\n", urls.size() - failed, failed);
+  return failed == 0 ? 0 : 1;
+}
+
 } // namespace baulk
 
 int wmain(int argc, wchar_t **argv) {